@@ -0,0 +1,319 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "argb_blender.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Standard:
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define XEFIS_ARGB_BLENDER_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace xf {
+
+/**
+ * Qt's BYTE_MUL(): multiply each of four 8-bit channels by alpha/255 with rounding.
+ */
+static inline uint32_t
+byte_mul (uint32_t const x, uint32_t const alpha) noexcept
+{
+	uint32_t t = (x & 0x00ff00ff) * alpha;
+	t = (t + ((t >> 8) & 0x00ff00ff) + 0x00800080) >> 8;
+	t &= 0x00ff00ff;
+
+	uint32_t u = ((x >> 8) & 0x00ff00ff) * alpha;
+	u = u + ((u >> 8) & 0x00ff00ff) + 0x00800080;
+	u &= 0xff00ff00;
+
+	return t | u;
+}
+
+
+static inline void
+blend_pixel (uint32_t& target, uint32_t const source) noexcept
+{
+	auto const alpha = source >> 24;
+
+	if (alpha == 0xff)
+		target = source;
+	else if (source != 0)
+		target = source + byte_mul (target, 0xff - alpha);
+}
+
+
+static void
+blend_row_scalar (uint32_t* target, uint32_t const* source, std::size_t const pixels) noexcept
+{
+	for (std::size_t i = 0; i < pixels; ++i)
+		blend_pixel (target[i], source[i]);
+}
+
+
+#if XEFIS_ARGB_BLENDER_X86
+
+/**
+ * BYTE_MUL() on 16-bit channels.
+ */
+[[gnu::target ("sse4.1")]]
+static inline __m128i
+byte_mul_sse4 (__m128i const x, __m128i const alpha) noexcept
+{
+	__m128i t = _mm_mullo_epi16 (x, alpha);
+	t = _mm_add_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), _mm_set1_epi16 (0x80));
+	return _mm_srli_epi16 (t, 8);
+}
+
+
+/**
+ * Compute target × (255 - alpha) / 255 + source for four pixels.
+ */
+[[gnu::target ("sse4.1")]]
+static inline __m128i
+blend_sse4 (__m128i const target, __m128i const source) noexcept
+{
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const alpha_shuffle = _mm_setr_epi8 (3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+	// 255 - alpha in each byte of a pixel:
+	__m128i const inv_alpha = _mm_xor_si128 (_mm_shuffle_epi8 (source, alpha_shuffle), _mm_set1_epi32 (-1));
+
+	__m128i const lo = byte_mul_sse4 (_mm_unpacklo_epi8 (target, zero), _mm_unpacklo_epi8 (inv_alpha, zero));
+	__m128i const hi = byte_mul_sse4 (_mm_unpackhi_epi8 (target, zero), _mm_unpackhi_epi8 (inv_alpha, zero));
+
+	return _mm_add_epi8 (source, _mm_packus_epi16 (lo, hi));
+}
+
+
+[[gnu::target ("sse4.1")]]
+static void
+blend_row_sse4 (uint32_t* target, uint32_t const* source, std::size_t const pixels) noexcept
+{
+	__m128i const alpha_mask = _mm_set1_epi32 (static_cast<int> (0xff000000));
+	std::size_t i = 0;
+
+	for (; i + 4 <= pixels; i += 4)
+	{
+		auto* const t = reinterpret_cast<__m128i*> (target + i);
+		__m128i const s = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (source + i));
+
+		// Premultiplied, so fully transparent means all zeros:
+		if (_mm_testz_si128 (s, s))
+			continue;
+		else if (_mm_testc_si128 (s, alpha_mask))
+			_mm_storeu_si128 (t, s);
+		else
+			_mm_storeu_si128 (t, blend_sse4 (_mm_loadu_si128 (t), s));
+	}
+
+	blend_row_scalar (target + i, source + i, pixels - i);
+}
+
+
+[[gnu::target ("avx2")]]
+static inline __m256i
+byte_mul_avx2 (__m256i const x, __m256i const alpha) noexcept
+{
+	__m256i t = _mm256_mullo_epi16 (x, alpha);
+	t = _mm256_add_epi16 (_mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8)), _mm256_set1_epi16 (0x80));
+	return _mm256_srli_epi16 (t, 8);
+}
+
+
+/**
+ * Compute target × (255 - alpha) / 255 + source for eight pixels.
+ */
+[[gnu::target ("avx2")]]
+static inline __m256i
+blend_avx2 (__m256i const target, __m256i const source) noexcept
+{
+	__m256i const zero = _mm256_setzero_si256();
+	// Shuffle works within 128-bit lanes, so the pattern is the same for both halves:
+	__m256i const alpha_shuffle = _mm256_setr_epi8 (3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15,
+													3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+	__m256i const inv_alpha = _mm256_xor_si256 (_mm256_shuffle_epi8 (source, alpha_shuffle), _mm256_set1_epi32 (-1));
+
+	// Unpack and pack work within lanes too, so pixel order is preserved:
+	__m256i const lo = byte_mul_avx2 (_mm256_unpacklo_epi8 (target, zero), _mm256_unpacklo_epi8 (inv_alpha, zero));
+	__m256i const hi = byte_mul_avx2 (_mm256_unpackhi_epi8 (target, zero), _mm256_unpackhi_epi8 (inv_alpha, zero));
+
+	return _mm256_add_epi8 (source, _mm256_packus_epi16 (lo, hi));
+}
+
+
+[[gnu::target ("avx2")]]
+static void
+blend_row_avx2 (uint32_t* target, uint32_t const* source, std::size_t const pixels) noexcept
+{
+	__m256i const alpha_mask = _mm256_set1_epi32 (static_cast<int> (0xff000000));
+	std::size_t i = 0;
+
+	for (; i + 8 <= pixels; i += 8)
+	{
+		auto* const t = reinterpret_cast<__m256i*> (target + i);
+		__m256i const s = _mm256_loadu_si256 (reinterpret_cast<__m256i const*> (source + i));
+
+		if (_mm256_testz_si256 (s, s))
+			continue;
+		else if (_mm256_testc_si256 (s, alpha_mask))
+			_mm256_storeu_si256 (t, s);
+		else
+			_mm256_storeu_si256 (t, blend_avx2 (_mm256_loadu_si256 (t), s));
+	}
+
+	blend_row_scalar (target + i, source + i, pixels - i);
+}
+
+#endif
+
+
+ArgbBlender::ArgbBlender (std::optional<Kernel> const kernel):
+	_kernel (kernel.value_or (best_kernel()))
+{
+	if (!supported (_kernel))
+		throw InvalidArgument (std::string ("ArgbBlender: kernel ") + kernel_name (_kernel) + " is not supported by this CPU");
+
+	switch (_kernel)
+	{
+		case Kernel::Scalar:
+			_blend_row = blend_row_scalar;
+			break;
+
+#if XEFIS_ARGB_BLENDER_X86
+		case Kernel::SSE4:
+			_blend_row = blend_row_sse4;
+			break;
+
+		case Kernel::AVX2:
+			_blend_row = blend_row_avx2;
+			break;
+#else
+		default:
+			_blend_row = blend_row_scalar;
+			break;
+#endif
+	}
+}
+
+
+bool
+ArgbBlender::supported (Kernel const kernel) noexcept
+{
+	switch (kernel)
+	{
+		case Kernel::Scalar:
+			return true;
+
+#if XEFIS_ARGB_BLENDER_X86
+		case Kernel::SSE4:
+			return __builtin_cpu_supports ("sse4.1");
+
+		case Kernel::AVX2:
+			return __builtin_cpu_supports ("avx2");
+#else
+		default:
+			return false;
+#endif
+	}
+
+	return false;
+}
+
+
+ArgbBlender::Kernel
+ArgbBlender::best_kernel() noexcept
+{
+	static Kernel const best = []{
+		for (auto const kernel: { Kernel::AVX2, Kernel::SSE4 })
+			if (supported (kernel))
+				return kernel;
+
+		return Kernel::Scalar;
+	}();
+
+	return best;
+}
+
+
+char const*
+ArgbBlender::kernel_name (Kernel const kernel) noexcept
+{
+	switch (kernel)
+	{
+		case Kernel::Scalar:	return "scalar";
+		case Kernel::SSE4:		return "SSE4.1";
+		case Kernel::AVX2:		return "AVX2";
+	}
+
+	return "unknown";
+}
+
+
+void
+ArgbBlender::blend (QImage& target, QPoint const target_position, QImage const& source, QRect source_rect) const
+{
+	if (target.format() != QImage::Format_ARGB32_Premultiplied || source.format() != QImage::Format_ARGB32_Premultiplied)
+		throw InvalidArgument ("ArgbBlender::blend(): images must be in Format_ARGB32_Premultiplied");
+
+	// Clip to both images:
+	QPoint const offset = target_position - source_rect.topLeft();
+	source_rect &= source.rect();
+	source_rect &= target.rect().translated (-offset);
+
+	if (source_rect.isEmpty())
+		return;
+
+	QRect const target_rect = source_rect.translated (offset);
+	auto const target_stride = target.bytesPerLine();
+	auto const source_stride = source.bytesPerLine();
+	auto* const target_bits = target.bits();
+	auto const* const source_bits = source.constBits();
+	auto const width = static_cast<std::size_t> (source_rect.width());
+
+	for (int y = 0; y < source_rect.height(); ++y)
+	{
+		auto* const t = reinterpret_cast<uint32_t*> (target_bits + (target_rect.top() + y) * target_stride) + target_rect.left();
+		auto const* const s = reinterpret_cast<uint32_t const*> (source_bits + (source_rect.top() + y) * source_stride) + source_rect.left();
+		_blend_row (t, s, width);
+	}
+}
+
+
+void
+ArgbBlender::fill (QImage& target, QRect rect, QRgb const color)
+{
+	if (target.depth() != 32)
+		throw InvalidArgument ("ArgbBlender::fill(): image must be in a 32-bit format");
+
+	rect &= target.rect();
+
+	if (rect.isEmpty())
+		return;
+
+	auto const stride = target.bytesPerLine();
+	auto* const bits = target.bits();
+
+	for (int y = rect.top(); y <= rect.bottom(); ++y)
+		std::fill_n (reinterpret_cast<uint32_t*> (bits + y * stride) + rect.left(), rect.width(), color);
+}
+
+} // namespace xf
+
@@ -0,0 +1,125 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__ARGB_BLENDER_H__INCLUDED
+#define XEFIS__CORE__ARGB_BLENDER_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Qt:
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+
+namespace xf {
+
+/**
+ * Source-over blending of QImage::Format_ARGB32_Premultiplied images, a replacement for
+ * QPainter::drawImage() on the hot composition paths.
+ *
+ * Instrument canvases are mostly fully transparent or fully opaque. Each source row is processed
+ * in short spans (8 pixels for AVX2, 4 for SSE4.1, 1 for scalar code): fully transparent spans
+ * are skipped, opaque ones are copied and only the rest is actually blended. The arithmetic is
+ * the same as Qt's (dst = src + dst × (255 - src_alpha) / 255 with Qt rounding), so results
+ * don't depend on the kernel used.
+ *
+ * The best kernel supported by the CPU is selected at runtime, so no special compiler flags are needed.
+ */
+class ArgbBlender
+{
+  public:
+	enum class Kernel
+	{
+		Scalar,
+		SSE4,
+		AVX2,
+	};
+
+  public:
+	// Ctor
+	explicit
+	ArgbBlender (std::optional<Kernel> = std::nullopt);
+
+	/**
+	 * Return true if given kernel can run on this CPU.
+	 */
+	[[nodiscard]]
+	static bool
+	supported (Kernel) noexcept;
+
+	/**
+	 * Return the fastest kernel supported by this CPU.
+	 */
+	[[nodiscard]]
+	static Kernel
+	best_kernel() noexcept;
+
+	[[nodiscard]]
+	static char const*
+	kernel_name (Kernel) noexcept;
+
+	/**
+	 * Return kernel used by this blender.
+	 */
+	[[nodiscard]]
+	Kernel
+	kernel() const noexcept
+		{ return _kernel; }
+
+	/**
+	 * Blend pixels of source over target.
+	 */
+	void
+	blend_row (uint32_t* target, uint32_t const* source, std::size_t pixels) const noexcept
+		{ _blend_row (target, source, pixels); }
+
+	/**
+	 * Blend source_rect part of the source image over target, with source_rect's top-left corner placed
+	 * at target_position. The area is clipped to both images.
+	 * Both images must be in QImage::Format_ARGB32_Premultiplied format.
+	 */
+	void
+	blend (QImage& target, QPoint target_position, QImage const& source, QRect source_rect) const;
+
+	/**
+	 * Blend whole source image over target at given position.
+	 */
+	void
+	blend (QImage& target, QPoint target_position, QImage const& source) const
+		{ blend (target, target_position, source, source.rect()); }
+
+	/**
+	 * Fill rect of target with given color (no blending).
+	 * Target must be in a 32-bit format.
+	 */
+	static void
+	fill (QImage& target, QRect, QRgb);
+
+  private:
+	using BlendRowFunction = void (*)(uint32_t*, uint32_t const*, std::size_t) noexcept;
+
+	Kernel				_kernel;
+	BlendRowFunction	_blend_row;
+};
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,153 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "canvas_pool.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Standard:
+#include <cstddef>
+#include <utility>
+
+
+namespace xf {
+
+static std::size_t
+image_bytes (QImage const& image)
+{
+	return static_cast<std::size_t> (image.bytesPerLine()) * image.height();
+}
+
+
+CanvasPool::CanvasPool (std::size_t memory_budget):
+	_memory_budget (memory_budget)
+{ }
+
+
+CanvasPool&
+CanvasPool::shared()
+{
+	static CanvasPool pool;
+	return pool;
+}
+
+
+QImage
+CanvasPool::acquire (QSize size, QImage::Format format)
+{
+	{
+		std::lock_guard lock (_mutex);
+
+		if (auto bucket = _buckets.find ({ size.width(), size.height(), format }); bucket != _buckets.end())
+		{
+			// Most recently released image is the most likely to still be in CPU cache:
+			QImage image = std::move (bucket->second.back().image);
+			bucket->second.pop_back();
+
+			if (bucket->second.empty())
+				_buckets.erase (bucket);
+
+			_memory_usage -= image_bytes (image);
+			--_images;
+			++_hits;
+			return image;
+		}
+
+		++_misses;
+	}
+
+	// Allocate without holding the lock:
+	return QImage (size, format);
+}
+
+
+void
+CanvasPool::release (QImage&& image)
+{
+	if (image.isNull())
+		return;
+
+	auto const bytes = image_bytes (image);
+	std::lock_guard lock (_mutex);
+
+	if (bytes > _memory_budget)
+		return;
+
+	evict_until (_memory_budget - bytes);
+	_buckets[{ image.width(), image.height(), image.format() }].push_back ({ std::move (image), _releases++ });
+	_memory_usage += bytes;
+	++_images;
+}
+
+
+void
+CanvasPool::set_memory_budget (std::size_t bytes)
+{
+	std::lock_guard lock (_mutex);
+	_memory_budget = bytes;
+	evict_until (_memory_budget);
+}
+
+
+void
+CanvasPool::clear()
+{
+	std::lock_guard lock (_mutex);
+	_buckets.clear();
+	_memory_usage = 0;
+	_images = 0;
+}
+
+
+CanvasPool::Statistics
+CanvasPool::statistics() const
+{
+	std::lock_guard lock (_mutex);
+
+	return {
+		.images = _images,
+		.memory_usage = _memory_usage,
+		.memory_budget = _memory_budget,
+		.hits = _hits,
+		.misses = _misses,
+	};
+}
+
+
+void
+CanvasPool::evict_until (std::size_t const max_memory_usage)
+{
+	// Buckets are never empty and images in each bucket are ordered by release, so the least
+	// recently released image is at the front of one of the buckets. There are only a few buckets,
+	// so a linear search is fine:
+	while (_memory_usage > max_memory_usage)
+	{
+		auto oldest = _buckets.begin();
+
+		for (auto bucket = _buckets.begin(); bucket != _buckets.end(); ++bucket)
+			if (bucket->second.front().release_number < oldest->second.front().release_number)
+				oldest = bucket;
+
+		_memory_usage -= image_bytes (oldest->second.front().image);
+		oldest->second.pop_front();
+		--_images;
+
+		if (oldest->second.empty())
+			_buckets.erase (oldest);
+	}
+}
+
+} // namespace xf
+
@@ -0,0 +1,132 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__CANVAS_POOL_H__INCLUDED
+#define XEFIS__CORE__CANVAS_POOL_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Qt:
+#include <QImage>
+#include <QSize>
+
+// Standard:
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+
+namespace xf {
+
+/**
+ * Pool of unused canvas images, bucketed by size and format.
+ *
+ * Screens return instrument canvases here when instruments get resized or deregistered,
+ * and take them back instead of allocating new ones. Images returned by acquire() have
+ * undefined content.
+ *
+ * Memory held by the pool is bounded by a budget. When a released image doesn't fit,
+ * least recently released images are freed to make room for it, so that the pool
+ * follows instruments changing sizes.
+ * All methods are thread-safe.
+ */
+class CanvasPool
+{
+  public:
+	static constexpr std::size_t kDefaultMemoryBudget = 128 * 1024 * 1024;
+
+	class Statistics
+	{
+	  public:
+		std::size_t	images			{ 0 };
+		std::size_t	memory_usage	{ 0 };
+		std::size_t	memory_budget	{ 0 };
+		std::size_t	hits			{ 0 };
+		std::size_t	misses			{ 0 };
+	};
+
+  public:
+	// Ctor
+	explicit
+	CanvasPool (std::size_t memory_budget = kDefaultMemoryBudget);
+
+	/**
+	 * Return the process-wide pool.
+	 */
+	[[nodiscard]]
+	static CanvasPool&
+	shared();
+
+	/**
+	 * Return image of given size and format, reusing a pooled one if possible.
+	 */
+	[[nodiscard]]
+	QImage
+	acquire (QSize, QImage::Format = QImage::Format_ARGB32_Premultiplied);
+
+	/**
+	 * Put image back to the pool, evicting least recently released images if needed.
+	 * Null images and images larger than the whole budget are dropped.
+	 */
+	void
+	release (QImage&&);
+
+	/**
+	 * Set memory budget. Frees pooled images if needed.
+	 */
+	void
+	set_memory_budget (std::size_t bytes);
+
+	/**
+	 * Free all pooled images.
+	 */
+	void
+	clear();
+
+	[[nodiscard]]
+	Statistics
+	statistics() const;
+
+  private:
+	using Bucket = std::tuple<int, int, QImage::Format>;
+
+	struct PooledImage
+	{
+		QImage		image;
+		std::size_t	release_number;
+	};
+
+	/**
+	 * Free least recently released images until memory usage is at most given number of bytes.
+	 */
+	void
+	evict_until (std::size_t max_memory_usage);
+
+  private:
+	std::mutex mutable							_mutex;
+	std::size_t									_memory_budget;
+	std::size_t									_memory_usage	{ 0 };
+	std::size_t									_images			{ 0 };
+	std::size_t									_hits			{ 0 };
+	std::size_t									_misses			{ 0 };
+	std::size_t									_releases		{ 0 };
+	std::map<Bucket, std::deque<PooledImage>>	_buckets;
+};
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,129 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__CLOCK_H__INCLUDED
+#define XEFIS__CORE__CLOCK_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+#include <neutrino/nonmovable.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace xf {
+
+/**
+ * Process-wide source of the current time for cycles, sockets, temporals, etc.
+ *
+ * Normally returns the system time. In virtual mode returns time set explicitly with set_virtual_time()
+ * or advance(), which lets ProcessingLoop::run_virtual() run simulations faster (or slower) than real time.
+ *
+ * Use TimeHelper directly for measuring real durations (processing times, painting times);
+ * use Clock for anything that's part of the simulated world.
+ */
+class Clock
+{
+  public:
+	/**
+	 * Switches the clock to virtual mode for the lifetime of the object, starting at given time,
+	 * and restores previous mode on destruction. If the clock is already virtual, nothing is changed.
+	 */
+	class VirtualTimeScope:
+		private Noncopyable,
+		private Nonmovable
+	{
+	  public:
+		// Ctor
+		explicit
+		VirtualTimeScope (si::Time start_time):
+			_was_virtual (Clock::is_virtual())
+		{
+			if (!_was_virtual)
+				Clock::set_virtual_time (start_time);
+		}
+
+		// Dtor
+		~VirtualTimeScope()
+		{
+			if (!_was_virtual)
+				Clock::use_system_time();
+		}
+
+	  private:
+		bool _was_virtual;
+	};
+
+  public:
+	/**
+	 * Return current time.
+	 */
+	[[nodiscard]]
+	static si::Time
+	now() noexcept
+	{
+		if (_virtual.load (std::memory_order_acquire)) [[unlikely]]
+			return 1_ns * static_cast<double> (_virtual_time_ns.load (std::memory_order_relaxed));
+		else
+			return TimeHelper::now();
+	}
+
+	/**
+	 * Return true if clock is in virtual mode.
+	 */
+	[[nodiscard]]
+	static bool
+	is_virtual() noexcept
+		{ return _virtual.load (std::memory_order_relaxed); }
+
+	/**
+	 * Switch to virtual mode (if not already) and set current time.
+	 */
+	static void
+	set_virtual_time (si::Time time) noexcept
+	{
+		_virtual_time_ns.store (std::llround (time.in<si::Nanosecond>()), std::memory_order_relaxed);
+		_virtual.store (true, std::memory_order_release);
+	}
+
+	/**
+	 * Advance virtual time by given duration. Has no effect in system-time mode.
+	 */
+	static void
+	advance (si::Time dt) noexcept
+		{ _virtual_time_ns.fetch_add (std::llround (dt.in<si::Nanosecond>()), std::memory_order_relaxed); }
+
+	/**
+	 * Switch back to the system time.
+	 */
+	static void
+	use_system_time() noexcept
+		{ _virtual.store (false, std::memory_order_release); }
+
+  private:
+	static inline std::atomic<bool>		_virtual			{ false };
+	static inline std::atomic<int64_t>	_virtual_time_ns	{ 0 };
+};
+
+} // namespace xf
+
+#endif
+
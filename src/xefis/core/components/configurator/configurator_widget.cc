@@ -37,7 +37,7 @@ ConfiguratorWidget::ConfiguratorWidget (Machine& machine, QWidget* parent):
 	auto const ph = PaintHelper (*this, palette(), font());
 
 	_module_configurator = new ModuleConfigurator (_machine, this);
-	_data_recorder = new DataRecorder (this);
+	_data_recorder = new DataRecorder (_machine, this);
 
 	_tabs = new QTabWidget (this);
 	_tabs->addTab (_module_configurator, "Module &configuration");
@@ -15,10 +15,19 @@
 #include "data_recorder.h"
 
 // Xefis:
+#include <xefis/app/xefis.h>
 #include <xefis/config/all.h>
+#include <xefis/core/machine.h>
+#include <xefis/core/processing_loop.h>
+
+// Neutrino:
+#include <neutrino/exception_support.h>
 
 // Qt:
+#include <QtCore/QDir>
+#include <QtWidgets/QFileDialog>
 #include <QtWidgets/QLayout>
+#include <QtWidgets/QMessageBox>
 
 // Standard:
 #include <cstddef>
@@ -26,11 +35,28 @@
 
 namespace xf {
 
-DataRecorder::DataRecorder (QWidget* parent):
-	QWidget (parent)
+DataRecorder::DataRecorder (Machine& machine, QWidget* parent):
+	QWidget (parent),
+	_machine (machine)
 {
 	setSizePolicy (QSizePolicy::Expanding, QSizePolicy::Expanding);
 
+	_record_button = new QPushButton ("Record flight data…", this);
+	_record_button->setCheckable (true);
+	QObject::connect (_record_button, &QPushButton::clicked, [this] (bool checked) {
+		if (checked)
+			start_recording();
+		else
+			stop_recording();
+	});
+
+	_status_label = new QLabel (this);
+
+	auto* controls_layout = new QHBoxLayout();
+	controls_layout->addWidget (_record_button);
+	controls_layout->addWidget (_status_label);
+	controls_layout->addStretch();
+
 	_graphs_stack = new GraphsStack (this);
 
 	_scroll_area = new QScrollArea (this);
@@ -39,7 +65,71 @@ DataRecorder::DataRecorder (QWidget* parent):
 
 	QVBoxLayout* layout = new QVBoxLayout (this);
 	layout->setMargin (0);
+	layout->addLayout (controls_layout);
 	layout->addWidget (_scroll_area);
+
+	update_status();
+}
+
+
+DataRecorder::~DataRecorder()
+{
+	stop_recording();
+}
+
+
+void
+DataRecorder::start_recording()
+{
+	auto const directory = QFileDialog::getExistingDirectory (this, "Directory for flight data logs");
+
+	if (!directory.isEmpty())
+	{
+		try {
+			for (auto& disclosure: _machine.processing_loops())
+			{
+				auto& loop = disclosure.value();
+				auto const file_name = QDir (directory).filePath (QString::fromStdString (loop.instance()) + ".xfdr").toStdString();
+
+				_writers.push_back (std::make_unique<FlightDataWriter> (file_name));
+				loop.set_flight_data_writer (_writers.back().get());
+			}
+		}
+		catch (...)
+		{
+			stop_recording();
+			QMessageBox::warning (this, "Recording failed", QString::fromStdString (describe_exception (std::current_exception())));
+		}
+	}
+
+	update_status();
+}
+
+
+void
+DataRecorder::stop_recording()
+{
+	for (auto& disclosure: _machine.processing_loops())
+	{
+		Exception::catch_and_log (_machine.xefis().logger(), [&] {
+			disclosure.value().set_flight_data_writer (nullptr);
+		});
+	}
+
+	_writers.clear();
+	update_status();
+}
+
+
+void
+DataRecorder::update_status()
+{
+	_record_button->setChecked (!_writers.empty());
+
+	if (_writers.empty())
+		_status_label->setText ("Not recording");
+	else
+		_status_label->setText (QString ("Recording %1 processing loop(s)").arg (_writers.size()));
 }
 
 } // namespace xf
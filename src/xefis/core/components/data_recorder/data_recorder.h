@@ -15,31 +15,60 @@
 #define XEFIS__CORE__COMPONENTS__DATA_RECORDER__DATA_RECORDER_H__INCLUDED
 
 // Local:
+#include "flight_data_writer.h"
 #include "graphs_stack.h"
 
 // Xefis:
 #include <xefis/config/all.h>
 
 // Qt:
+#include <QtWidgets/QLabel>
+#include <QtWidgets/QPushButton>
 #include <QtWidgets/QWidget>
 #include <QtWidgets/QScrollArea>
 
 // Standard:
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 
 namespace xf {
 
+class Machine;
+
+
+/**
+ * Data recorder tab. Records all output sockets of all processing loops of the machine
+ * into flight data logs, one file per processing loop (see FlightDataWriter).
+ */
 class DataRecorder: public QWidget
 {
   public:
 	// Ctor
 	explicit
-	DataRecorder (QWidget* parent);
+	DataRecorder (Machine&, QWidget* parent);
+
+	// Dtor
+	~DataRecorder();
+
+  private:
+	void
+	start_recording();
+
+	void
+	stop_recording();
+
+	void
+	update_status();
 
   private:
-	GraphsStack*	_graphs_stack;
-	QScrollArea*	_scroll_area;
+	Machine&										_machine;
+	std::vector<std::unique_ptr<FlightDataWriter>>	_writers;
+	QPushButton*									_record_button;
+	QLabel*											_status_label;
+	GraphsStack*									_graphs_stack;
+	QScrollArea*									_scroll_area;
 };
 
 } // namespace xf
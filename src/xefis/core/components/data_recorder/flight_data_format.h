@@ -0,0 +1,130 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_FORMAT_H__INCLUDED
+#define XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_FORMAT_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/exception.h>
+
+// Boost:
+#include <boost/endian/conversion.hpp>
+
+// Standard:
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+/**
+ * Flight data log file format. All integers are little-endian.
+ *
+ *   file     := header record*
+ *   header   := magic[8]
+ *   record   := type:u8 payload_size:u32 payload[payload_size]
+ *
+ * Record payloads:
+ *
+ *   Socket   := socket_id:u32 path_size:u16 path[path_size] type_size:u16 type[type_size]
+ *               Dictionary entry. Written once, before the first value of the socket.
+ *   Cycle    := cycle_number:u64 update_time_ns:i64 count:u32 change[count]
+ *               Sockets which serials changed in the cycle.
+ *   Keyframe := same as Cycle, but contains all known sockets. Written periodically so that
+ *               seeking doesn't require replaying the log from the beginning.
+ *   change   := socket_id:u32 blob_size:u32 blob[blob_size]
+ *               Blob is the socket's to_blob() serialization, including the nil-flag.
+ *
+ * Records of unknown types are skipped by readers.
+ */
+namespace xf::flight_data {
+
+using SocketID = uint32_t;
+
+
+/**
+ * Thrown on I/O errors and malformed log files.
+ */
+class Error: public Exception
+{
+  public:
+	// Ctor
+	explicit
+	Error (std::string const& message):
+		Exception (message)
+	{ }
+};
+
+
+enum class RecordType: uint8_t
+{
+	Socket		= 1,
+	Cycle		= 2,
+	Keyframe	= 3,
+};
+
+constexpr std::array<uint8_t, 8>	kMagic				{ 'X', 'F', 'D', 'R', 0, 0, 0, 1 };
+constexpr std::size_t				kRecordHeaderSize	= sizeof (uint8_t) + sizeof (uint32_t);
+constexpr std::size_t				kCycleHeaderSize	= sizeof (uint64_t) + sizeof (int64_t) + sizeof (uint32_t);
+constexpr std::size_t				kChangeHeaderSize	= sizeof (SocketID) + sizeof (uint32_t);
+
+
+/**
+ * Append little-endian integer to the buffer.
+ */
+template<class Integer>
+	inline void
+	append (std::vector<uint8_t>& buffer, Integer const value)
+	{
+		auto const le = boost::endian::native_to_little (value);
+		auto const offset = buffer.size();
+		buffer.resize (offset + sizeof (le));
+		std::memcpy (buffer.data() + offset, &le, sizeof (le));
+	}
+
+
+/**
+ * Store little-endian integer at given position in the buffer.
+ */
+template<class Integer>
+	inline void
+	store (std::vector<uint8_t>& buffer, std::size_t const offset, Integer const value)
+	{
+		auto const le = boost::endian::native_to_little (value);
+		std::memcpy (buffer.data() + offset, &le, sizeof (le));
+	}
+
+
+/**
+ * Read little-endian integer from memory and advance the pointer.
+ * Caller must ensure there's enough data.
+ */
+template<class Integer>
+	inline Integer
+	consume (uint8_t const*& data)
+	{
+		Integer le;
+		std::memcpy (&le, data, sizeof (le));
+		data += sizeof (le);
+		return boost::endian::little_to_native (le);
+	}
+
+} // namespace xf::flight_data
+
+#endif
+
@@ -0,0 +1,233 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "flight_data_reader.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// System:
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Standard:
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+
+namespace xf {
+
+using namespace flight_data;
+
+
+FlightDataReader::FlightDataReader (std::string const& file_name)
+{
+	_fd = ::open (file_name.c_str(), O_RDONLY);
+
+	if (_fd == -1)
+		throw Error ("could not open flight data log '" + file_name + "': " + std::strerror (errno));
+
+	struct stat st;
+
+	if (::fstat (_fd, &st) == -1)
+	{
+		::close (_fd);
+		throw Error ("could not stat flight data log '" + file_name + "': " + std::strerror (errno));
+	}
+
+	_size = static_cast<std::size_t> (st.st_size);
+
+	if (_size < kMagic.size())
+	{
+		::close (_fd);
+		throw Error ("'" + file_name + "' is not a flight data log");
+	}
+
+	auto* mapping = ::mmap (nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+	if (mapping == MAP_FAILED)
+	{
+		::close (_fd);
+		throw Error ("could not map flight data log '" + file_name + "': " + std::strerror (errno));
+	}
+
+	_data = static_cast<uint8_t const*> (mapping);
+
+	if (!std::equal (kMagic.begin(), kMagic.end(), _data))
+	{
+		::munmap (const_cast<uint8_t*> (_data), _size);
+		::close (_fd);
+		throw Error ("'" + file_name + "' is not a flight data log");
+	}
+
+	::madvise (const_cast<uint8_t*> (_data), _size, MADV_SEQUENTIAL);
+
+	try {
+		build_index();
+	}
+	catch (...)
+	{
+		::munmap (const_cast<uint8_t*> (_data), _size);
+		::close (_fd);
+		throw;
+	}
+}
+
+
+FlightDataReader::~FlightDataReader()
+{
+	::munmap (const_cast<uint8_t*> (_data), _size);
+	::close (_fd);
+}
+
+
+std::optional<SocketID>
+FlightDataReader::find_socket (std::string const& path) const
+{
+	if (auto const found = _sockets_by_path.find (path); found != _sockets_by_path.end())
+		return found->second;
+	else
+		return std::nullopt;
+}
+
+
+std::optional<std::size_t>
+FlightDataReader::find_cycle (Cycle::Number const number) const
+{
+	auto const upper = std::upper_bound (_cycles.begin(), _cycles.end(), number, [](Cycle::Number n, CycleInfo const& c) {
+		return n < c.number;
+	});
+
+	if (upper == _cycles.begin())
+		return std::nullopt;
+	else
+		return static_cast<std::size_t> (std::distance (_cycles.begin(), upper) - 1);
+}
+
+
+std::size_t
+FlightDataReader::keyframe_for (std::size_t const cycle_index) const
+{
+	auto const upper = std::upper_bound (_keyframes.begin(), _keyframes.end(), cycle_index);
+
+	// Writer always starts with a keyframe, but be tolerant:
+	if (upper == _keyframes.begin())
+		return 0;
+	else
+		return *std::prev (upper);
+}
+
+
+void
+FlightDataReader::build_index()
+{
+	std::size_t offset = kMagic.size();
+
+	while (offset + kRecordHeaderSize <= _size)
+	{
+		uint8_t const* data = _data + offset;
+		auto const type = static_cast<RecordType> (consume<uint8_t> (data));
+		auto const payload_size = consume<uint32_t> (data);
+		auto const payload_offset = offset + kRecordHeaderSize;
+		auto const payload_end = payload_offset + payload_size;
+
+		// Incomplete record at the end of the log:
+		if (payload_end > _size)
+			break;
+
+		switch (type)
+		{
+			case RecordType::Socket:
+			{
+				if (payload_size < sizeof (SocketID) + sizeof (uint16_t))
+					throw Error ("malformed socket record");
+
+				auto const id = consume<SocketID> (data);
+				auto const path_size = consume<uint16_t> (data);
+
+				if (data + path_size + sizeof (uint16_t) > _data + payload_end)
+					throw Error ("malformed socket record");
+
+				std::string path (reinterpret_cast<char const*> (data), path_size);
+				data += path_size;
+				auto const type_size = consume<uint16_t> (data);
+
+				if (data + type_size > _data + payload_end)
+					throw Error ("malformed socket record");
+
+				std::string type_name (reinterpret_cast<char const*> (data), type_size);
+
+				// Writer assigns IDs sequentially, so a record can only redeclare a known ID or declare the next one.
+				// This also prevents huge allocations caused by corrupted IDs:
+				if (id > _sockets.size())
+					throw Error ("socket record with out-of-order ID");
+
+				if (id == _sockets.size())
+					_sockets.emplace_back();
+
+				_sockets[id] = SocketInfo { id, path, type_name };
+				_sockets_by_path[path] = id;
+				break;
+			}
+
+			case RecordType::Cycle:
+			case RecordType::Keyframe:
+			{
+				if (payload_size < kCycleHeaderSize)
+					throw Error ("malformed cycle record");
+
+				CycleInfo info;
+				info.number = consume<uint64_t> (data);
+				info.update_time = 1_ns * static_cast<double> (consume<int64_t> (data));
+				info.changes_count = consume<uint32_t> (data);
+				info.keyframe = type == RecordType::Keyframe;
+				info.changes_offset = static_cast<std::size_t> (data - _data);
+
+				// Validate changes, so that for_each_change() doesn't need to:
+				for (uint32_t i = 0; i < info.changes_count; ++i)
+				{
+					if (data + kChangeHeaderSize > _data + payload_end)
+						throw Error ("malformed cycle record");
+
+					auto const id = consume<SocketID> (data);
+					auto const blob_size = consume<uint32_t> (data);
+
+					if (id >= _sockets.size() || data + blob_size > _data + payload_end)
+						throw Error ("malformed cycle record");
+
+					data += blob_size;
+				}
+
+				if (info.keyframe)
+					_keyframes.push_back (_cycles.size());
+
+				_cycles.push_back (info);
+				break;
+			}
+
+			default:
+				// Skip unknown records.
+				break;
+		}
+
+		offset = payload_end;
+	}
+}
+
+} // namespace xf
+
@@ -0,0 +1,162 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_READER_H__INCLUDED
+#define XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_READER_H__INCLUDED
+
+// Local:
+#include "flight_data_format.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle.h>
+
+// Neutrino:
+#include <neutrino/blob.h>
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace xf {
+
+/**
+ * Memory-mapped reader of flight data logs written by FlightDataWriter.
+ *
+ * On open the file is scanned once to build the socket dictionary and an index of cycles,
+ * so seeking to any cycle is a binary search followed by applying at most one keyframe and
+ * the deltas recorded after it. Values are returned as views into the mapped file; nothing is copied.
+ *
+ * A log that was not closed properly (eg. after a crash) is readable up to the last complete record.
+ */
+class FlightDataReader: private Noncopyable
+{
+  public:
+	class SocketInfo
+	{
+	  public:
+		flight_data::SocketID	id;
+		std::string				path;
+		std::string				type;
+	};
+
+	class CycleInfo
+	{
+	  public:
+		Cycle::Number	number;
+		si::Time		update_time;
+		bool			keyframe;
+		// Offset of the first change in the mapped file:
+		std::size_t		changes_offset;
+		uint32_t		changes_count;
+	};
+
+  public:
+	/**
+	 * Map the file and build the index.
+	 *
+	 * \throw	flight_data::Error
+	 *			When file can't be opened or isn't a flight data log.
+	 */
+	explicit
+	FlightDataReader (std::string const& file_name);
+
+	// Dtor
+	~FlightDataReader();
+
+	/**
+	 * Return socket dictionary, indexed by socket ID.
+	 */
+	[[nodiscard]]
+	std::vector<SocketInfo> const&
+	sockets() const noexcept
+		{ return _sockets; }
+
+	/**
+	 * Find socket ID by socket path.
+	 */
+	[[nodiscard]]
+	std::optional<flight_data::SocketID>
+	find_socket (std::string const& path) const;
+
+	/**
+	 * Return all recorded cycles, in order.
+	 */
+	[[nodiscard]]
+	std::vector<CycleInfo> const&
+	cycles() const noexcept
+		{ return _cycles; }
+
+	/**
+	 * Return index (into cycles()) of the last recorded cycle with number not greater than given one.
+	 * Return std::nullopt if there's no such cycle.
+	 */
+	[[nodiscard]]
+	std::optional<std::size_t>
+	find_cycle (Cycle::Number) const;
+
+	/**
+	 * Return index of the last keyframe at or before given cycle index.
+	 */
+	[[nodiscard]]
+	std::size_t
+	keyframe_for (std::size_t cycle_index) const;
+
+	/**
+	 * Call callback (flight_data::SocketID, BlobView) for each change recorded in given cycle.
+	 */
+	template<class Callback>
+		void
+		for_each_change (CycleInfo const&, Callback&&) const;
+
+  private:
+	void
+	build_index();
+
+  private:
+	int															_fd				{ -1 };
+	uint8_t const*												_data			{ nullptr };
+	std::size_t													_size			{ 0 };
+	std::vector<SocketInfo>										_sockets;
+	std::unordered_map<std::string, flight_data::SocketID>		_sockets_by_path;
+	std::vector<CycleInfo>										_cycles;
+	// Indexes into _cycles:
+	std::vector<std::size_t>									_keyframes;
+};
+
+
+template<class Callback>
+	inline void
+	FlightDataReader::for_each_change (CycleInfo const& cycle, Callback&& callback) const
+	{
+		uint8_t const* data = _data + cycle.changes_offset;
+
+		for (uint32_t i = 0; i < cycle.changes_count; ++i)
+		{
+			auto const id = flight_data::consume<flight_data::SocketID> (data);
+			auto const size = flight_data::consume<uint32_t> (data);
+			callback (id, BlobView (data, size));
+			data += size;
+		}
+	}
+
+} // namespace xf
+
+#endif
+
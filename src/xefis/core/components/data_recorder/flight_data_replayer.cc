@@ -0,0 +1,110 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "flight_data_replayer.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/basic_module_out.h>
+
+// Neutrino:
+#include <neutrino/exception_support.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf {
+
+FlightDataReplayer::FlightDataReplayer (FlightDataReader const& reader, Logger const& logger):
+	_reader (reader),
+	_logger (logger),
+	_targets (reader.sockets().size(), nullptr)
+{ }
+
+
+void
+FlightDataReplayer::add_module (Module& module)
+{
+	module.set_processing_policy (Module::ProcessingPolicy::External);
+
+	for (auto* socket: Module::ModuleSocketAPI (module).output_sockets())
+	{
+		if (auto const id = _reader.find_socket (identifier (module) + "/" + socket->path().string()))
+		{
+			if (!_targets[*id])
+				++_mapped_sockets;
+
+			_targets[*id] = socket;
+		}
+	}
+}
+
+
+void
+FlightDataReplayer::seek (Cycle::Number const number)
+{
+	_previous_update_time.reset();
+
+	if (auto const index = _reader.find_cycle (number))
+	{
+		auto const& cycles = _reader.cycles();
+
+		for (auto i = _reader.keyframe_for (*index); i <= *index; ++i)
+			apply (cycles[i]);
+
+		_previous_update_time = cycles[*index].update_time;
+		_next_cycle_index = *index + 1;
+	}
+	else
+		_next_cycle_index = 0;
+}
+
+
+std::optional<Cycle>
+FlightDataReplayer::step()
+{
+	if (at_end())
+		return std::nullopt;
+
+	auto const& info = _reader.cycles()[_next_cycle_index++];
+	auto const dt = _previous_update_time ? info.update_time - *_previous_update_time : 0_s;
+
+	apply (info);
+	_previous_update_time = info.update_time;
+
+	return Cycle (info.number, info.update_time, dt, dt, _logger);
+}
+
+
+void
+FlightDataReplayer::apply (FlightDataReader::CycleInfo const& info)
+{
+	_reader.for_each_change (info, [this] (flight_data::SocketID id, BlobView blob) {
+		if (auto* target = _targets[id])
+		{
+			try {
+				target->from_blob (blob);
+			}
+			catch (...)
+			{
+				_logger << "Could not replay socket " << _reader.sockets()[id].path << ": " << describe_exception (std::current_exception()) << std::endl;
+			}
+		}
+	});
+}
+
+} // namespace xf
+
@@ -0,0 +1,136 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_REPLAYER_H__INCLUDED
+#define XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_REPLAYER_H__INCLUDED
+
+// Local:
+#include "flight_data_reader.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+
+namespace xf {
+
+class BasicModuleOut;
+class Module;
+
+
+/**
+ * Feeds values from a flight data log back into ModuleOuts of a (usually headless) machine.
+ *
+ * Recorded sockets are matched with output sockets of added modules by path (module identifier
+ * and socket path), so the replaying machine should create modules with the same types and instance names
+ * as the recorded one. Added modules get ProcessingPolicy::External, so that fetching their outputs
+ * by downstream modules doesn't call their process() which would overwrite replayed values.
+ *
+ * Replay is not paced by any clock: each step() applies one recorded cycle and returns a Cycle
+ * with the recorded update time, so replay runs as fast as downstream modules can process.
+ */
+class FlightDataReplayer: private Noncopyable
+{
+  public:
+	// Ctor
+	explicit
+	FlightDataReplayer (FlightDataReader const&, Logger const&);
+
+	/**
+	 * Map output sockets of the module to recorded sockets and set module's processing policy
+	 * to ProcessingPolicy::External.
+	 */
+	void
+	add_module (Module&);
+
+	/**
+	 * Return number of recorded sockets that have a matching output socket.
+	 */
+	[[nodiscard]]
+	std::size_t
+	mapped_sockets() const noexcept
+		{ return _mapped_sockets; }
+
+	/**
+	 * Restore socket values as they were at the end of given cycle (or the last recorded cycle before it).
+	 * Next step() will replay the following cycle.
+	 */
+	void
+	seek (Cycle::Number);
+
+	/**
+	 * Apply next recorded cycle to sockets.
+	 * Return the Cycle object to use for processing downstream modules, or std::nullopt at the end of the log.
+	 */
+	std::optional<Cycle>
+	step();
+
+	/**
+	 * Return true if all cycles have been replayed.
+	 */
+	[[nodiscard]]
+	bool
+	at_end() const noexcept
+		{ return _next_cycle_index >= _reader.cycles().size(); }
+
+	/**
+	 * Replay all remaining cycles, calling callback (Cycle const&) after each one.
+	 * Return number of replayed cycles.
+	 */
+	template<class Callback>
+		std::size_t
+		run (Callback&&);
+
+  private:
+	void
+	apply (FlightDataReader::CycleInfo const&);
+
+  private:
+	FlightDataReader const&			_reader;
+	Logger							_logger;
+	// Indexed by flight_data::SocketID:
+	std::vector<BasicModuleOut*>	_targets;
+	std::size_t						_mapped_sockets		{ 0 };
+	std::size_t						_next_cycle_index	{ 0 };
+	std::optional<si::Time>			_previous_update_time;
+};
+
+
+template<class Callback>
+	inline std::size_t
+	FlightDataReplayer::run (Callback&& callback)
+	{
+		std::size_t replayed = 0;
+
+		while (auto cycle = step())
+		{
+			callback (*cycle);
+			++replayed;
+		}
+
+		return replayed;
+	}
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,164 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "flight_data_writer.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/basic_module_out.h>
+
+// Neutrino:
+#include <neutrino/demangle.h>
+
+// Standard:
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+
+namespace xf {
+
+using namespace flight_data;
+
+
+namespace {
+
+constexpr std::size_t kFileBufferSize = 1024 * 1024;
+
+
+std::string
+socket_path (Module& module, BasicModuleOut const& socket)
+{
+	return identifier (module) + "/" + socket.path().string();
+}
+
+} // namespace
+
+
+FlightDataWriter::FlightDataWriter (std::string const& file_name, Cycle::Number keyframe_interval):
+	_file (std::fopen (file_name.c_str(), "wb")),
+	_keyframe_interval (std::max<Cycle::Number> (keyframe_interval, 1))
+{
+	if (!_file)
+		throw Error ("could not open flight data log '" + file_name + "': " + std::strerror (errno));
+
+	std::setvbuf (_file, nullptr, _IOFBF, kFileBufferSize);
+	_buffer.assign (kMagic.begin(), kMagic.end());
+	write_buffer();
+}
+
+
+FlightDataWriter::~FlightDataWriter()
+{
+	std::fclose (_file);
+}
+
+
+void
+FlightDataWriter::add_module (Module& module)
+{
+	if (std::find (_modules.begin(), _modules.end(), &module) != _modules.end())
+		return;
+
+	_modules.push_back (&module);
+
+	for (auto* socket: Module::ModuleSocketAPI (module).output_sockets())
+	{
+		auto const id = static_cast<SocketID> (_entries.size());
+		auto const path = socket_path (module, *socket);
+		auto const type = demangle (typeid (*socket));
+
+		_entries.push_back (Entry { socket, id, socket->serial() - 1 });
+
+		_buffer.clear();
+		append (_buffer, static_cast<uint8_t> (RecordType::Socket));
+		append (_buffer, static_cast<uint32_t> (sizeof (SocketID) + 2 * sizeof (uint16_t) + path.size() + type.size()));
+		append (_buffer, id);
+		append (_buffer, static_cast<uint16_t> (path.size()));
+		_buffer.insert (_buffer.end(), path.begin(), path.end());
+		append (_buffer, static_cast<uint16_t> (type.size()));
+		_buffer.insert (_buffer.end(), type.begin(), type.end());
+		write_buffer();
+	}
+}
+
+
+void
+FlightDataWriter::record_cycle (Cycle const& cycle)
+{
+	// First recorded cycle is always a keyframe, so that the log is self-contained:
+	bool const keyframe = _recorded_cycles == 0 || cycle.number() % _keyframe_interval == 0;
+	auto const update_time_ns = static_cast<int64_t> (std::llround (cycle.update_time().in<si::Nanosecond>()));
+	uint32_t count = 0;
+
+	_buffer.clear();
+	append (_buffer, static_cast<uint8_t> (keyframe ? RecordType::Keyframe : RecordType::Cycle));
+	append (_buffer, uint32_t (0)); // Payload size, filled in later.
+	append (_buffer, static_cast<uint64_t> (cycle.number()));
+	append (_buffer, update_time_ns);
+	auto const count_offset = _buffer.size();
+	append (_buffer, count);
+
+	for (auto& entry: _entries)
+	{
+		auto const serial = entry.socket->serial();
+
+		if (keyframe || serial != entry.last_serial)
+		{
+			append_change (entry);
+			entry.last_serial = serial;
+			++count;
+		}
+	}
+
+	store (_buffer, count_offset, count);
+	store (_buffer, sizeof (uint8_t), static_cast<uint32_t> (_buffer.size() - kRecordHeaderSize));
+	write_buffer();
+	++_recorded_cycles;
+}
+
+
+void
+FlightDataWriter::flush()
+{
+	std::fflush (_file);
+}
+
+
+void
+FlightDataWriter::append_change (Entry const& entry)
+{
+	auto const blob_size = entry.socket->blob_size();
+	auto const offset = _buffer.size();
+
+	append (_buffer, entry.id);
+	append (_buffer, static_cast<uint32_t> (blob_size));
+	_buffer.resize (_buffer.size() + blob_size);
+	entry.socket->to_blob (std::span<uint8_t> (_buffer.data() + offset + kChangeHeaderSize, blob_size));
+}
+
+
+void
+FlightDataWriter::write_buffer()
+{
+	if (std::fwrite (_buffer.data(), 1, _buffer.size(), _file) != _buffer.size())
+		throw Error (std::string ("could not write flight data log: ") + std::strerror (errno));
+}
+
+} // namespace xf
+
@@ -0,0 +1,127 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_WRITER_H__INCLUDED
+#define XEFIS__CORE__COMPONENTS__DATA_RECORDER__FLIGHT_DATA_WRITER_H__INCLUDED
+
+// Local:
+#include "flight_data_format.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle.h>
+#include <xefis/core/sockets/basic_socket.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+namespace xf {
+
+class Module;
+
+
+/**
+ * Writes values of all ModuleOuts of given modules into an append-only flight data log
+ * (see flight_data_format.h). Called at the end of each ProcessingLoop cycle, records only
+ * sockets which serials changed since the previous cycle, plus periodic keyframes.
+ *
+ * Steady-state recording doesn't allocate memory: the cycle record is built in a reused buffer
+ * and written with a single buffered write.
+ */
+class FlightDataWriter: private Noncopyable
+{
+  public:
+	static constexpr Cycle::Number kDefaultKeyframeInterval = 1000;
+
+  private:
+	class Entry
+	{
+	  public:
+		BasicSocket const*		socket;
+		flight_data::SocketID	id;
+		BasicSocket::Serial		last_serial;
+	};
+
+  public:
+	/**
+	 * Create new log file (truncates existing file).
+	 *
+	 * \throw	flight_data::Error
+	 *			When file can't be opened.
+	 */
+	explicit
+	FlightDataWriter (std::string const& file_name, Cycle::Number keyframe_interval = kDefaultKeyframeInterval);
+
+	// Dtor
+	~FlightDataWriter();
+
+	/**
+	 * Add all output sockets of the module to the dictionary.
+	 * Adding the same module again has no effect.
+	 */
+	void
+	add_module (Module&);
+
+	/**
+	 * Record changed sockets. Call at the end of a processing cycle.
+	 *
+	 * \throw	flight_data::Error
+	 *			On write errors.
+	 */
+	void
+	record_cycle (Cycle const&);
+
+	/**
+	 * Flush buffered data to the file.
+	 */
+	void
+	flush();
+
+	/**
+	 * Return number of recorded cycles.
+	 */
+	[[nodiscard]]
+	std::size_t
+	recorded_cycles() const noexcept
+		{ return _recorded_cycles; }
+
+  private:
+	/**
+	 * Append socket's serialized value as a change to the cycle buffer.
+	 */
+	void
+	append_change (Entry const&);
+
+	void
+	write_buffer();
+
+  private:
+	std::FILE*					_file;
+	Cycle::Number				_keyframe_interval;
+	std::vector<Entry>			_entries;
+	std::vector<Module*>		_modules;
+	std::vector<uint8_t>		_buffer;
+	std::size_t					_recorded_cycles	{ 0 };
+};
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,261 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/components/data_recorder/flight_data_reader.h>
+#include <xefis/core/components/data_recorder/flight_data_replayer.h>
+#include <xefis/core/components/data_recorder/flight_data_writer.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+xf::LoggerOutput g_logger_output (std::clog);
+xf::Logger g_logger (g_logger_output);
+
+
+class Sensors: public Module
+{
+  public:
+	ModuleOut<si::Length>	altitude	{ this, "altitude" };
+	ModuleOut<int64_t>		counter		{ this, "counter" };
+	ModuleOut<std::string>	status		{ this, "status" };
+
+  public:
+	using Module::Module;
+};
+
+
+/**
+ * Producer module that computes its output by itself, like a module reading hardware.
+ */
+class AltitudeSensor: public Module
+{
+  public:
+	ModuleOut<si::Length>	altitude	{ this, "altitude" };
+	int						readings	{ 0 };
+
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const&) override
+	{
+		++readings;
+		altitude = 1000_m + 10_m * readings;
+	}
+};
+
+
+class AltitudeDoubler: public Module
+{
+  public:
+	ModuleIn<si::Length>	altitude	{ this, "altitude" };
+	ModuleOut<si::Length>	doubled		{ this, "doubled" };
+
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const&) override
+	{
+		doubled = 2.0 * altitude.value_or (0_m);
+	}
+};
+
+
+std::string
+temporary_log_file()
+{
+	return (std::filesystem::temp_directory_path() / "xefis-flight-data.test.xfdr").string();
+}
+
+
+/**
+ * Record 10 cycles. Altitude changes every cycle, counter every other cycle,
+ * status is set once and becomes nil in cycle 7.
+ */
+void
+record (std::string const& file_name)
+{
+	Sensors sensors ("sensors");
+	FlightDataWriter writer (file_name, 4);
+	TestCycle cycle;
+
+	writer.add_module (sensors);
+	sensors.status = "ok";
+
+	for (int i = 1; i <= 10; ++i)
+	{
+		sensors.altitude = 100_m * i;
+
+		if (i % 2 == 0)
+			sensors.counter = i;
+
+		if (i == 7)
+			sensors.status = xf::nil;
+
+		writer.record_cycle (cycle);
+		cycle += 1_s;
+	}
+}
+
+
+AutoTest t1 ("xf::FlightDataWriter/Reader: only changed sockets are recorded, keyframes are indexed", []{
+	auto const file_name = temporary_log_file();
+	record (file_name);
+
+	FlightDataReader reader (file_name);
+
+	test_asserts::verify ("dictionary has 3 sockets", reader.sockets().size() == 3);
+	test_asserts::verify ("socket path contains module identifier", reader.find_socket (identifier (Sensors ("sensors")) + "/altitude").has_value());
+	test_asserts::verify ("10 cycles recorded", reader.cycles().size() == 10);
+	test_asserts::verify ("first cycle is a keyframe", reader.cycles()[0].keyframe && reader.cycles()[0].changes_count == 3);
+	test_asserts::verify ("cycle 4 is a keyframe", reader.cycles()[3].keyframe);
+	test_asserts::verify ("cycle 3 records only altitude", reader.cycles()[2].changes_count == 1);
+	test_asserts::verify ("cycle 6 records altitude and counter", reader.cycles()[5].changes_count == 2);
+	test_asserts::verify ("cycle 7 records altitude and status", reader.cycles()[6].changes_count == 2);
+	test_asserts::verify ("find_cycle() finds cycle 7", reader.find_cycle (7) == 6u);
+	test_asserts::verify ("keyframe for cycle 7 is cycle 4", reader.keyframe_for (6) == 3u);
+	test_asserts::verify ("find_cycle() before first cycle", !reader.find_cycle (0));
+
+	std::filesystem::remove (file_name);
+});
+
+
+AutoTest t2 ("xf::FlightDataReplayer: replay and seek restore recorded values", []{
+	auto const file_name = temporary_log_file();
+	record (file_name);
+
+	FlightDataReader reader (file_name);
+	Sensors sensors ("sensors");
+	FlightDataReplayer replayer (reader, g_logger);
+	replayer.add_module (sensors);
+
+	test_asserts::verify ("all sockets mapped", replayer.mapped_sockets() == 3);
+
+	replayer.seek (6);
+	test_asserts::verify ("altitude at cycle 6", sensors.altitude.value_or (0_m) == 600_m);
+	test_asserts::verify ("counter at cycle 6", sensors.counter.value_or (0) == 6);
+	test_asserts::verify ("status at cycle 6", sensors.status.value_or ("") == "ok");
+
+	auto const cycle = replayer.step();
+	test_asserts::verify ("step() replays cycle 7", cycle && cycle->number() == 7);
+	test_asserts::verify ("recorded dt is restored", cycle && cycle->update_dt() > 0.999_s && cycle->update_dt() < 1.001_s);
+	test_asserts::verify ("altitude at cycle 7", sensors.altitude.value_or (0_m) == 700_m);
+	test_asserts::verify ("status is nil at cycle 7", !sensors.status);
+
+	auto const replayed = replayer.run ([](Cycle const&) { });
+	test_asserts::verify ("remaining cycles replayed", replayed == 3 && replayer.at_end());
+	test_asserts::verify ("counter at the end", sensors.counter.value_or (0) == 10);
+
+	replayer.seek (1);
+	test_asserts::verify ("seek backwards", sensors.altitude.value_or (0_m) == 100_m && sensors.status.value_or ("") == "ok");
+
+	std::filesystem::remove (file_name);
+});
+
+
+AutoTest t3 ("xf::FlightDataReplayer: replayed values aren't overwritten by producer modules", []{
+	auto const file_name = temporary_log_file();
+
+	{
+		AltitudeSensor sensor ("sensor");
+		FlightDataWriter writer (file_name);
+		TestCycle cycle;
+
+		writer.add_module (sensor);
+
+		for (int i = 0; i < 5; ++i)
+		{
+			Module::ProcessingLoopAPI (sensor).reset_cache();
+			Module::ProcessingLoopAPI (sensor).fetch_and_process (cycle);
+			writer.record_cycle (cycle);
+			cycle += 1_s;
+		}
+	}
+
+	FlightDataReader reader (file_name);
+	AltitudeSensor sensor ("sensor");
+	AltitudeDoubler doubler ("doubler");
+	FlightDataReplayer replayer (reader, g_logger);
+	std::vector<si::Length> doubled;
+
+	replayer.add_module (sensor);
+	doubler.altitude << sensor.altitude;
+
+	// Process only the downstream module; it fetches the sensor's output through ModuleOut::do_fetch():
+	replayer.run ([&] (Cycle const& cycle) {
+		Module::ProcessingLoopAPI (sensor).reset_cache();
+		Module::ProcessingLoopAPI (doubler).reset_cache();
+		Module::ProcessingLoopAPI (doubler).fetch_and_process (cycle);
+		doubled.push_back (doubler.doubled.value_or (0_m));
+	});
+
+	test_asserts::verify ("producer module is marked as externally driven", sensor.processing_policy() == Module::ProcessingPolicy::External);
+	test_asserts::verify ("producer module is not processed during replay", sensor.readings == 0);
+	test_asserts::verify ("downstream module gets replayed values", doubled == std::vector<si::Length> { 2020_m, 2040_m, 2060_m, 2080_m, 2100_m });
+
+	std::filesystem::remove (file_name);
+});
+
+
+AutoTest t4 ("xf::FlightDataReader: socket record with out-of-order ID is rejected", []{
+	auto const file_name = temporary_log_file();
+	std::string const path = "sensors/altitude";
+	std::string const type = "si::Length";
+	std::vector<uint8_t> buffer (flight_data::kMagic.begin(), flight_data::kMagic.end());
+
+	flight_data::append (buffer, static_cast<uint8_t> (flight_data::RecordType::Socket));
+	flight_data::append (buffer, static_cast<uint32_t> (sizeof (flight_data::SocketID) + 2 * sizeof (uint16_t) + path.size() + type.size()));
+	// Corrupted ID that would require a huge dictionary:
+	flight_data::append (buffer, static_cast<flight_data::SocketID> (0xffffffff));
+	flight_data::append (buffer, static_cast<uint16_t> (path.size()));
+	buffer.insert (buffer.end(), path.begin(), path.end());
+	flight_data::append (buffer, static_cast<uint16_t> (type.size()));
+	buffer.insert (buffer.end(), type.begin(), type.end());
+
+	std::ofstream (file_name, std::ios::binary).write (reinterpret_cast<char const*> (buffer.data()), static_cast<std::streamsize> (buffer.size()));
+
+	bool thrown = false;
+
+	try {
+		FlightDataReader reader (file_name);
+	}
+	catch (flight_data::Error const&)
+	{
+		thrown = true;
+	}
+
+	test_asserts::verify ("reader throws flight_data::Error", thrown);
+
+	std::filesystem::remove (file_name);
+});
+
+} // namespace
+} // namespace xf::test
+
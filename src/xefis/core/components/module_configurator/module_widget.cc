@@ -32,6 +32,7 @@
 
 // Standard:
 #include <cstddef>
+#include <numeric>
 #include <optional>
 
 
@@ -92,7 +93,7 @@ ModuleWidget::refresh()
 	auto const accounting_api = Module::AccountingAPI (_module);
 
 	{
-		auto const& samples = accounting_api.communication_times();
+		auto const samples = accounting_api.communication_times();
 		bool const enabled = processing_loop_api.implements_communicate_method();
 
 		_communication_time_group->setEnabled (enabled);
@@ -109,7 +110,7 @@ ModuleWidget::refresh()
 	}
 
 	{
-		auto const& samples = accounting_api.processing_times();
+		auto const samples = accounting_api.processing_times();
 		bool const enabled = processing_loop_api.implements_process_method();
 
 		_processing_time_group->setEnabled (enabled);
@@ -125,6 +126,24 @@ ModuleWidget::refresh()
 		}
 	}
 
+	{
+		auto const processed = accounting_api.processed_cycles();
+		auto const skipped = accounting_api.skipped_cycles();
+		auto const total = processed + skipped;
+		auto const ratio = total > 0 ? 100.0 * skipped / total : 0.0;
+		auto policy = "every cycle";
+
+		switch (_module.processing_policy())
+		{
+			case Module::ProcessingPolicy::EveryCycle:		policy = "every cycle"; break;
+			case Module::ProcessingPolicy::OnInputChange:	policy = "on input change"; break;
+			case Module::ProcessingPolicy::External:		policy = "external"; break;
+		}
+
+		_skip_ratio_label->setText (QString ("Processing policy: %1; skipped cycles: %2 of %3 (%4%)")
+									.arg (policy).arg (skipped).arg (total).arg (ratio, 0, 'f', 1));
+	}
+
 	if (_painting_time_histogram)
 	{
 		auto const accounting_api = Instrument::AccountingAPI (*_instrument);
@@ -135,6 +154,25 @@ ModuleWidget::refresh()
 		_painting_time_histogram->set_data (histogram, { accounting_api.frame_time() });
 		_painting_time_histogram->set_grid_lines (grid_lines);
 		_painting_time_stats->set_data (histogram, std::make_optional<Milliseconds> (accounting_api.frame_time()));
+
+		QStringList layer_lines;
+
+		for (auto const& [layer_name, layer_samples]: accounting_api.layer_painting_times())
+		{
+			if (!layer_samples.empty())
+			{
+				auto const sum = std::accumulate (layer_samples.begin(), layer_samples.end(), 0_s);
+				auto const max = *std::max_element (layer_samples.begin(), layer_samples.end());
+
+				layer_lines << QString ("%1: avg %2 ms, max %3 ms")
+					.arg (QString::fromStdString (layer_name))
+					.arg ((sum / layer_samples.size()).in<si::Millisecond>(), 0, 'f', 2)
+					.arg (max.in<si::Millisecond>(), 0, 'f', 2);
+			}
+		}
+
+		_layer_painting_times_label->setVisible (!layer_lines.isEmpty());
+		_layer_painting_times_label->setText ("Layer painting times:\n" + layer_lines.join ("\n"));
 	}
 }
 
@@ -149,18 +187,28 @@ ModuleWidget::create_performance_tab()
 	std::tie (_processing_time_histogram, _processing_time_stats, _processing_time_group) = create_performance_widget (widget, "Processing time");
 
 	if (_instrument)
+	{
 		std::tie (_painting_time_histogram, _painting_time_stats, painting_time_group) = create_performance_widget (widget, "Painting time");
+		_layer_painting_times_label = new QLabel (widget);
+		_layer_painting_times_label->hide();
+	}
+
+	_skip_ratio_label = new QLabel (widget);
 
 	auto layout = new QGridLayout (widget);
 	layout->setMargin (0);
 	layout->addWidget (_communication_time_group, 0, 0);
 	layout->addWidget (_processing_time_group, 1, 0);
+	layout->addWidget (_skip_ratio_label, 2, 0);
 
 	if (painting_time_group)
-		layout->addWidget (painting_time_group, 2, 0);
+	{
+		layout->addWidget (painting_time_group, 3, 0);
+		layout->addWidget (_layer_painting_times_label, 4, 0);
+	}
 
 	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Expanding, QSizePolicy::Fixed), 0, 1);
-	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 3, 0);
+	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 5, 0);
 
 	return widget;
 }
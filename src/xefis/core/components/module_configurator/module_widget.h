@@ -75,8 +75,10 @@ class ModuleWidget: public ConfigWidget
 	QWidget*					_processing_time_group			{ nullptr };
 	xf::HistogramWidget*		_processing_time_histogram		{ nullptr };
 	xf::HistogramStatsWidget*	_processing_time_stats			{ nullptr };
+	QLabel*						_skip_ratio_label				{ nullptr };
 	xf::HistogramWidget*		_painting_time_histogram		{ nullptr };
 	xf::HistogramStatsWidget*	_painting_time_stats			{ nullptr };
+	QLabel*						_layer_painting_times_label		{ nullptr };
 	QTimer*						_refresh_timer;
 };
 
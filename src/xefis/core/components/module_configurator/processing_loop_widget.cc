@@ -17,6 +17,7 @@
 // Xefis:
 #include <xefis/config/all.h>
 #include <xefis/core/components/module_configurator/config_widget.h>
+#include <xefis/core/cycle_trace.h>
 #include <xefis/support/ui/paint_helper.h>
 
 // Neutrino:
@@ -25,11 +26,15 @@
 
 // Qt:
 #include <QBoxLayout>
+#include <QFileDialog>
 #include <QGridLayout>
+#include <QMessageBox>
+#include <QPushButton>
 #include <QTabWidget>
 
 // Standard:
 #include <cstddef>
+#include <fstream>
 
 
 namespace xf::configurator {
@@ -43,6 +48,7 @@ ProcessingLoopWidget::ProcessingLoopWidget (ProcessingLoop& processing_loop, QWi
 
 	auto tabs = new QTabWidget (this);
 	tabs->addTab (create_performance_tab(), "Performance");
+	tabs->addTab (create_tracing_tab(), "Tracing");
 
 	auto* layout = new QVBoxLayout (this);
 	layout->setMargin (0);
@@ -109,6 +115,46 @@ ProcessingLoopWidget::refresh()
 			_processing_latency_stats->set_data (histogram);
 		}
 	}
+
+	{
+		auto const& samples = _processing_loop.wakeup_jitters();
+
+		_wakeup_jitter_group->setEnabled (_processing_loop.driver() == ProcessingLoop::Driver::RealTimeThread);
+
+		if (!samples.empty())
+		{
+			auto const [range, grid_lines] = get_max_for_axis<Milliseconds> (*std::max_element (samples.begin(), samples.end()));
+			xf::Histogram<Milliseconds> histogram (samples.begin(), samples.end(), range / 100, 0.0_ms, range);
+
+			_wakeup_jitter_histogram->set_data (histogram, { _processing_loop.period() });
+			_wakeup_jitter_histogram->set_grid_lines (grid_lines);
+			_wakeup_jitter_stats->set_data (histogram);
+		}
+	}
+
+	{
+		auto const& samples = _processing_loop.critical_path_times();
+
+		_critical_path_time_group->setEnabled (_processing_loop.execution_mode() == ProcessingLoop::ExecutionMode::Parallel);
+
+		if (!samples.empty())
+		{
+			auto const [range, grid_lines] = get_max_for_axis<Milliseconds> (*std::max_element (samples.begin(), samples.end()));
+			xf::Histogram<Milliseconds> histogram (samples.begin(), samples.end(), range / 100, 0.0_ms, range);
+
+			_critical_path_time_histogram->set_data (histogram, { _processing_loop.period() });
+			_critical_path_time_histogram->set_grid_lines (grid_lines);
+			_critical_path_time_stats->set_data (histogram, std::make_optional<Milliseconds> (_processing_loop.period()));
+		}
+	}
+
+	{
+		_trace_enabled_checkbox->setChecked (CycleTrace::enabled());
+		_perf_counters_checkbox->setChecked (CycleTrace::perf_counters_enabled());
+		_trace_events_label->setText (QString ("Recorded events: %1, dropped: %2")
+			.arg (CycleTrace::events_count())
+			.arg (CycleTrace::dropped_events_count()));
+	}
 }
 
 
@@ -123,18 +169,80 @@ ProcessingLoopWidget::create_performance_tab()
 	std::tie (_communication_time_histogram, _communication_time_stats, communication_time_group) = create_performance_widget (widget, "HW communication time");
 	std::tie (_processing_time_histogram, _processing_time_stats, processing_time_group) = create_performance_widget (widget, "Processing time");
 	std::tie (_processing_latency_histogram, _processing_latency_stats, processing_latency_group) = create_performance_widget (widget, "Processing latency");
+	std::tie (_wakeup_jitter_histogram, _wakeup_jitter_stats, _wakeup_jitter_group) = create_performance_widget (widget, "Wake-up jitter");
+	std::tie (_critical_path_time_histogram, _critical_path_time_stats, _critical_path_time_group) = create_performance_widget (widget, "Critical path time");
 
 	auto layout = new QGridLayout (widget);
 	layout->setMargin (0);
 	layout->addWidget (communication_time_group, 0, 0);
 	layout->addWidget (processing_time_group, 1, 0);
 	layout->addWidget (processing_latency_group, 2, 0);
+	layout->addWidget (_wakeup_jitter_group, 3, 0);
+	layout->addWidget (_critical_path_time_group, 4, 0);
 
 	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Expanding, QSizePolicy::Fixed), 0, 1);
-	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 3, 0);
+	layout->addItem (new QSpacerItem (0, 0, QSizePolicy::Fixed, QSizePolicy::Expanding), 5, 0);
 
 	return widget;
 }
 
+
+QWidget*
+ProcessingLoopWidget::create_tracing_tab()
+{
+	auto* widget = new QWidget (this);
+
+	_trace_enabled_checkbox = new QCheckBox ("Record cycle trace (all processing loops and screens)", widget);
+	QObject::connect (_trace_enabled_checkbox, &QCheckBox::toggled, [](bool checked) {
+		CycleTrace::set_enabled (checked);
+	});
+
+	_perf_counters_checkbox = new QCheckBox ("Sample performance counters (cycles, instructions, cache misses, context switches)", widget);
+	QObject::connect (_perf_counters_checkbox, &QCheckBox::toggled, [](bool checked) {
+		CycleTrace::set_perf_counters_enabled (checked);
+	});
+
+	_trace_events_label = new QLabel (widget);
+
+	auto* clear_button = new QPushButton ("Clear", widget);
+	QObject::connect (clear_button, &QPushButton::clicked, [this] {
+		CycleTrace::clear();
+		refresh();
+	});
+
+	auto* export_button = new QPushButton ("Export Chrome trace…", widget);
+	QObject::connect (export_button, &QPushButton::clicked, this, &ProcessingLoopWidget::export_trace);
+
+	auto* buttons_layout = new QHBoxLayout();
+	buttons_layout->addWidget (clear_button);
+	buttons_layout->addWidget (export_button);
+	buttons_layout->addStretch();
+
+	auto* layout = new QVBoxLayout (widget);
+	layout->addWidget (_trace_enabled_checkbox);
+	layout->addWidget (_perf_counters_checkbox);
+	layout->addWidget (_trace_events_label);
+	layout->addLayout (buttons_layout);
+	layout->addStretch();
+
+	return widget;
+}
+
+
+void
+ProcessingLoopWidget::export_trace()
+{
+	auto const file_name = QFileDialog::getSaveFileName (this, "Export Chrome trace", "xefis-trace.json", "Trace event JSON (*.json)");
+
+	if (!file_name.isEmpty())
+	{
+		std::ofstream file (file_name.toStdString());
+		CycleTrace::export_chrome_trace (file);
+
+		if (!file)
+			QMessageBox::warning (this, "Export failed", "Could not write trace to " + file_name);
+	}
+}
+
 } // namespace xf::configurator
 
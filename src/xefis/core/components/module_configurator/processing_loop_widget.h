@@ -23,6 +23,8 @@
 #include <xefis/support/ui/widget.h>
 
 // Qt:
+#include <QCheckBox>
+#include <QLabel>
 #include <QTimer>
 #include <QWidget>
 
@@ -49,6 +51,12 @@ class ProcessingLoopWidget: public ConfigWidget
 	QWidget*
 	create_performance_tab();
 
+	QWidget*
+	create_tracing_tab();
+
+	void
+	export_trace();
+
   private:
 	ProcessingLoop&				_processing_loop;
 	xf::HistogramWidget*		_communication_time_histogram	{ nullptr };
@@ -57,6 +65,15 @@ class ProcessingLoopWidget: public ConfigWidget
 	xf::HistogramStatsWidget*	_processing_time_stats			{ nullptr };
 	xf::HistogramWidget*		_processing_latency_histogram	{ nullptr };
 	xf::HistogramStatsWidget*	_processing_latency_stats		{ nullptr };
+	QWidget*					_wakeup_jitter_group			{ nullptr };
+	xf::HistogramWidget*		_wakeup_jitter_histogram		{ nullptr };
+	xf::HistogramStatsWidget*	_wakeup_jitter_stats			{ nullptr };
+	QWidget*					_critical_path_time_group		{ nullptr };
+	xf::HistogramWidget*		_critical_path_time_histogram	{ nullptr };
+	xf::HistogramStatsWidget*	_critical_path_time_stats		{ nullptr };
+	QCheckBox*					_trace_enabled_checkbox			{ nullptr };
+	QCheckBox*					_perf_counters_checkbox			{ nullptr };
+	QLabel*						_trace_events_label				{ nullptr };
 	QTimer*						_refresh_timer;
 };
 
@@ -0,0 +1,275 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "cycle_trace.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/time_helper.h>
+
+// System:
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Standard:
+#include <cstddef>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+
+namespace xf {
+namespace {
+
+class ThreadBuffer
+{
+  public:
+	std::mutex						mutex;
+	uint64_t						thread_id;
+	std::string						thread_name;
+	std::vector<CycleTrace::Event>	events;
+	std::size_t						dropped	{ 0 };
+};
+
+
+class Registry
+{
+  public:
+	std::mutex									mutex;
+	std::vector<std::shared_ptr<ThreadBuffer>>	buffers;
+};
+
+
+Registry&
+registry()
+{
+	static Registry registry;
+	return registry;
+}
+
+
+ThreadBuffer&
+thread_buffer()
+{
+	thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+		auto new_buffer = std::make_shared<ThreadBuffer>();
+		new_buffer->thread_id = static_cast<uint64_t> (::syscall (SYS_gettid));
+		new_buffer->thread_name = "thread " + std::to_string (new_buffer->thread_id);
+
+		auto& reg = registry();
+		std::lock_guard lock (reg.mutex);
+		reg.buffers.push_back (new_buffer);
+		return new_buffer;
+	}();
+
+	return *buffer;
+}
+
+
+void
+write_json_string (std::ostream& out, std::string_view const string)
+{
+	out << '"';
+
+	for (char const c: string)
+	{
+		switch (c)
+		{
+			case '"':	out << "\\\""; break;
+			case '\\':	out << "\\\\"; break;
+			case '\n':	out << "\\n"; break;
+			case '\t':	out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char> (c) < 0x20)
+					out << "\\u" << std::hex << std::setw (4) << std::setfill ('0') << static_cast<int> (c) << std::dec;
+				else
+					out << c;
+		}
+	}
+
+	out << '"';
+}
+
+} // namespace
+
+
+void
+CycleTrace::Scope::begin (char const* category, std::string&& name)
+{
+	_event.name = std::move (name);
+	_event.category = category;
+
+	if (CycleTrace::perf_counters_enabled())
+		_event.counters = PerfCounters::for_current_thread().read();
+
+	// Take the timestamp last, so that reading counters isn't included in the duration:
+	_event.start = TimeHelper::now();
+}
+
+
+void
+CycleTrace::Scope::end()
+{
+	_event.duration = TimeHelper::now() - _event.start;
+
+	if (_event.counters)
+	{
+		if (auto const counters = PerfCounters::for_current_thread().read())
+			_event.counters = *counters - *_event.counters;
+		else
+			_event.counters.reset();
+	}
+
+	CycleTrace::record (std::move (_event));
+}
+
+
+void
+CycleTrace::set_thread_name (std::string const& name)
+{
+	auto& buffer = thread_buffer();
+	std::lock_guard lock (buffer.mutex);
+	buffer.thread_name = name;
+}
+
+
+void
+CycleTrace::clear()
+{
+	auto& reg = registry();
+	std::lock_guard lock (reg.mutex);
+
+	for (auto& buffer: reg.buffers)
+	{
+		std::lock_guard buffer_lock (buffer->mutex);
+		buffer->events.clear();
+		buffer->dropped = 0;
+	}
+}
+
+
+std::size_t
+CycleTrace::events_count()
+{
+	auto& reg = registry();
+	std::lock_guard lock (reg.mutex);
+	std::size_t count = 0;
+
+	for (auto& buffer: reg.buffers)
+	{
+		std::lock_guard buffer_lock (buffer->mutex);
+		count += buffer->events.size();
+	}
+
+	return count;
+}
+
+
+std::size_t
+CycleTrace::dropped_events_count()
+{
+	auto& reg = registry();
+	std::lock_guard lock (reg.mutex);
+	std::size_t count = 0;
+
+	for (auto& buffer: reg.buffers)
+	{
+		std::lock_guard buffer_lock (buffer->mutex);
+		count += buffer->dropped;
+	}
+
+	return count;
+}
+
+
+void
+CycleTrace::export_chrome_trace (std::ostream& out)
+{
+	auto const pid = ::getpid();
+	auto& reg = registry();
+	std::lock_guard lock (reg.mutex);
+	bool first = true;
+
+	auto const separator = [&] {
+		if (!first)
+			out << ",\n";
+
+		first = false;
+	};
+
+	auto const saved_flags = out.flags();
+	auto const saved_precision = out.precision();
+	auto const saved_fill = out.fill();
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << std::fixed << std::setprecision (3);
+
+	for (auto& buffer: reg.buffers)
+	{
+		std::lock_guard buffer_lock (buffer->mutex);
+
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+		write_json_string (out, buffer->thread_name);
+		out << "}}";
+
+		for (auto const& event: buffer->events)
+		{
+			separator();
+			out << "{\"name\":";
+			write_json_string (out, event.name);
+			out << ",\"cat\":";
+			write_json_string (out, event.category ? event.category : "");
+			out << ",\"ph\":\"X\",\"ts\":" << event.start.in<si::Microsecond>()
+				<< ",\"dur\":" << event.duration.in<si::Microsecond>()
+				<< ",\"pid\":" << pid
+				<< ",\"tid\":" << buffer->thread_id;
+
+			if (event.counters)
+			{
+				auto const& c = *event.counters;
+				out << ",\"args\":{\"cycles\":" << c.cycles
+					<< ",\"instructions\":" << c.instructions
+					<< ",\"cache_misses\":" << c.cache_misses
+					<< ",\"context_switches\":" << c.context_switches
+					<< "}";
+			}
+
+			out << "}";
+		}
+	}
+
+	out << "\n]}\n";
+	out.flags (saved_flags);
+	out.precision (saved_precision);
+	out.fill (saved_fill);
+}
+
+
+void
+CycleTrace::record (Event&& event)
+{
+	auto& buffer = thread_buffer();
+	std::lock_guard lock (buffer.mutex);
+
+	if (buffer.events.size() < kMaxEventsPerThread)
+		buffer.events.push_back (std::move (event));
+	else
+		++buffer.dropped;
+}
+
+} // namespace xf
+
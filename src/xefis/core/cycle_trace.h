@@ -0,0 +1,185 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__CYCLE_TRACE_H__INCLUDED
+#define XEFIS__CORE__CYCLE_TRACE_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/utility/perf_counters.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace xf {
+
+/**
+ * Process-wide recorder of timed events (module communicate()/process() calls, paint jobs, etc.)
+ * that can be exported as Chrome trace-event JSON (chrome://tracing, https://ui.perfetto.dev).
+ *
+ * Recording is switched at runtime with set_enabled(). When disabled, a Scope costs a single relaxed atomic load.
+ * Optionally each event also gets perf_event_open() counter deltas (cycles, instructions, cache misses,
+ * context switches) measured on the thread that executed it.
+ *
+ * Events are stored in per-thread buffers, so recording threads don't contend with each other.
+ */
+class CycleTrace
+{
+  public:
+	// Maximum number of events stored per thread; later events are dropped and counted.
+	static constexpr std::size_t kMaxEventsPerThread = 1'000'000;
+
+	class Event
+	{
+	  public:
+		std::string					name;
+		char const*					category	{ nullptr };
+		si::Time					start;
+		si::Time					duration;
+		std::optional<PerfSample>	counters;
+	};
+
+	/**
+	 * RAII object that records one event spanning its lifetime.
+	 */
+	class Scope: private Noncopyable
+	{
+	  public:
+		/**
+		 * Name provider is called only when tracing is enabled, so that building a name costs nothing otherwise.
+		 */
+		template<class NameProvider>
+			explicit
+			Scope (char const* category, NameProvider&& name_provider);
+
+		// Dtor
+		~Scope();
+
+	  private:
+		void
+		begin (char const* category, std::string&& name);
+
+		void
+		end();
+
+	  private:
+		bool						_active;
+		Event						_event;
+	};
+
+  public:
+	/**
+	 * Return true if recording is enabled.
+	 */
+	[[nodiscard]]
+	static bool
+	enabled() noexcept
+		{ return _enabled.load (std::memory_order_relaxed); }
+
+	/**
+	 * Enable or disable recording.
+	 */
+	static void
+	set_enabled (bool enabled) noexcept
+		{ _enabled.store (enabled, std::memory_order_relaxed); }
+
+	/**
+	 * Return true if events are recorded with performance counters.
+	 */
+	[[nodiscard]]
+	static bool
+	perf_counters_enabled() noexcept
+		{ return _perf_counters_enabled.load (std::memory_order_relaxed); }
+
+	/**
+	 * Enable or disable sampling performance counters for each event.
+	 * Has effect only when recording is enabled.
+	 */
+	static void
+	set_perf_counters_enabled (bool enabled) noexcept
+		{ _perf_counters_enabled.store (enabled, std::memory_order_relaxed); }
+
+	/**
+	 * Set name of the calling thread as shown in the trace viewer.
+	 */
+	static void
+	set_thread_name (std::string const& name);
+
+	/**
+	 * Remove all recorded events.
+	 */
+	static void
+	clear();
+
+	/**
+	 * Return total number of recorded events.
+	 */
+	[[nodiscard]]
+	static std::size_t
+	events_count();
+
+	/**
+	 * Return number of events dropped because of kMaxEventsPerThread limit.
+	 */
+	[[nodiscard]]
+	static std::size_t
+	dropped_events_count();
+
+	/**
+	 * Write recorded events as Chrome trace-event JSON. Recording may continue while exporting.
+	 */
+	static void
+	export_chrome_trace (std::ostream&);
+
+  private:
+	static void
+	record (Event&&);
+
+  private:
+	static inline std::atomic<bool>	_enabled				{ false };
+	static inline std::atomic<bool>	_perf_counters_enabled	{ false };
+};
+
+
+template<class NameProvider>
+	inline
+	CycleTrace::Scope::Scope (char const* category, NameProvider&& name_provider):
+		_active (CycleTrace::enabled())
+	{
+		if (_active) [[unlikely]]
+			begin (category, std::invoke (std::forward<NameProvider> (name_provider)));
+	}
+
+
+inline
+CycleTrace::Scope::~Scope()
+{
+	if (_active) [[unlikely]]
+		end();
+}
+
+} // namespace xf
+
+#endif
+
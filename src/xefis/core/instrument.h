@@ -18,6 +18,7 @@
 #include <xefis/config/all.h>
 #include <xefis/core/module.h>
 #include <xefis/core/paint_request.h>
+#include <xefis/core/sockets/module_out.h>
 
 // Neutrino:
 #include <neutrino/noncopyable.h>
@@ -28,9 +29,13 @@
 // Standard:
 #include <cstddef>
 #include <atomic>
+#include <functional>
 #include <future>
+#include <map>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 
 namespace xf {
@@ -41,6 +46,59 @@ class Instrument: public Module
 {
 	static constexpr std::size_t kMaxPaintingTimesBackLog = 1000;
 
+  public:
+	/**
+	 * Independently paintable part of an instrument, see paint_layers().
+	 */
+	class PaintLayer
+	{
+	  public:
+		std::string									name;
+		// Paints onto the layer's own transparent canvas given in the PaintRequest.
+		// Called from a WorkPerformer thread, possibly concurrently with other layers:
+		std::function<void (PaintRequest const&)>	paint;
+	};
+
+	using LayerPaintingTimes = std::map<std::string, boost::circular_buffer<si::Time>>;
+
+	enum class RefreshPriority
+	{
+		// Slowed down first when painting can't keep up:
+		Low,
+		Normal,
+		// Never slowed down below its maximum rate:
+		High,
+	};
+
+	/**
+	 * Tells the Screen how often the instrument should be repainted.
+	 * The instrument is still repainted only if it's marked dirty.
+	 */
+	class RefreshPolicy
+	{
+	  public:
+		// Maximum repaint rate; if not set, the Screen's refresh rate is used:
+		std::optional<si::Frequency>	max_rate;
+		// Under load the repaint rate may be lowered, but not below this one:
+		si::Frequency					min_rate	{ 1_Hz };
+		RefreshPriority					priority	{ RefreshPriority::Normal };
+	};
+
+	/**
+	 * Tells the Screen how to prepare the canvas before painting.
+	 * Canvases are double-buffered and reused, so they contain an older frame.
+	 */
+	enum class CanvasClearing
+	{
+		// Clear the whole canvas to transparent:
+		Full,
+		// Clear only the region that the instrument reported with PaintRequest::mark_painted()
+		// when it painted on the same canvas last time:
+		PaintedRegion,
+		// Don't clear at all; instrument is opaque and paints every pixel of its canvas:
+		None,
+	};
+
   public:
 	/**
 	 * Accesses accounting data (time spent on processing, etc.
@@ -78,10 +136,41 @@ class Instrument: public Module
 		boost::circular_buffer<si::Time> const&
 		painting_times() const noexcept;
 
+		/**
+		 * Add new measured painting time of a layer painted by paint_layers().
+		 */
+		void
+		add_layer_painting_time (std::string const& layer_name, si::Time);
+
+		/**
+		 * Painting times of individual layers, empty if instrument isn't painted in layers.
+		 */
+		[[nodiscard]]
+		LayerPaintingTimes const&
+		layer_painting_times() const noexcept;
+
+		/**
+		 * Set repaint rate achieved on the Screen. Will be published to the achieved_refresh_rate
+		 * socket in the next processing cycle. Thread-safe.
+		 */
+		void
+		set_achieved_refresh_rate (si::Frequency) noexcept;
+
+		/**
+		 * Publish the last rate set with set_achieved_refresh_rate() to the achieved_refresh_rate socket.
+		 * Called by the ProcessingLoop on its own thread at the beginning of each cycle.
+		 */
+		void
+		publish_achieved_refresh_rate();
+
 	  private:
 		Instrument& _instrument;
 	};
 
+  public:
+	// Repaint rate measured by the Screen:
+	ModuleOut<si::Frequency>	achieved_refresh_rate	{ this, "instrument/achieved-refresh-rate" };
+
   public:
 	using Module::Module;
 
@@ -95,6 +184,54 @@ class Instrument: public Module
 	virtual std::packaged_task<void()>
 	paint (PaintRequest) const = 0;
 
+	/**
+	 * Optional alternative to paint() for heavy instruments that can be split into independent layers.
+	 * Called instead of paint() if the Screen has additional WorkPerformers for the instrument.
+	 * Each layer is painted by a separate task into its own buffer and the buffers are then composited
+	 * onto the instrument canvas in order, bottom-most first.
+	 *
+	 * The PaintRequest refers to the whole instrument canvas; it may be used to update caches shared by
+	 * the layers before they're painted. Return an empty vector (the default) to be painted with paint().
+	 */
+	virtual std::vector<PaintLayer>
+	paint_layers (PaintRequest const&) const
+		{ return {}; }
+
+	/**
+	 * Set refresh policy used by the Screen to schedule painting.
+	 */
+	void
+	set_refresh_policy (RefreshPolicy const&);
+
+	/**
+	 * Return refresh policy.
+	 */
+	[[nodiscard]]
+	RefreshPolicy const&
+	refresh_policy() const noexcept;
+
+	/**
+	 * Set canvas clearing mode. Default is CanvasClearing::Full.
+	 */
+	void
+	set_canvas_clearing (CanvasClearing canvas_clearing) noexcept
+		{ _canvas_clearing = canvas_clearing; }
+
+	/**
+	 * Return canvas clearing mode.
+	 */
+	[[nodiscard]]
+	CanvasClearing
+	canvas_clearing() const noexcept
+		{ return _canvas_clearing; }
+
+	/**
+	 * Return true if instrument wants to be repainted, without unmarking it.
+	 */
+	[[nodiscard]]
+	bool
+	dirty() const noexcept;
+
 	/**
 	 * Return true if instrument wants to be repainted.
 	 * Also unmark the instrument as dirty atomically.
@@ -112,7 +249,12 @@ class Instrument: public Module
   private:
 	std::atomic<bool>					_dirty			{ true };
 	boost::circular_buffer<si::Time>	_painting_times	{ kMaxPaintingTimesBackLog };
+	LayerPaintingTimes					_layer_painting_times;
 	si::Time							_frame_time		{ 0_s };
+	RefreshPolicy						_refresh_policy;
+	CanvasClearing						_canvas_clearing	{ CanvasClearing::Full };
+	// Stored in Hz, negative if not measured yet:
+	std::atomic<double>					_achieved_refresh_rate_hz	{ -1.0 };
 };
 
 
@@ -150,6 +292,61 @@ Instrument::AccountingAPI::painting_times() const noexcept
 }
 
 
+inline void
+Instrument::AccountingAPI::add_layer_painting_time (std::string const& layer_name, si::Time time)
+{
+	auto it = _instrument._layer_painting_times.find (layer_name);
+
+	if (it == _instrument._layer_painting_times.end())
+		it = _instrument._layer_painting_times.emplace (layer_name, boost::circular_buffer<si::Time> (kMaxPaintingTimesBackLog)).first;
+
+	it->second.push_back (time);
+}
+
+
+inline auto
+Instrument::AccountingAPI::layer_painting_times() const noexcept -> LayerPaintingTimes const&
+{
+	return _instrument._layer_painting_times;
+}
+
+
+inline void
+Instrument::AccountingAPI::set_achieved_refresh_rate (si::Frequency rate) noexcept
+{
+	_instrument._achieved_refresh_rate_hz.store (rate.in<si::Hertz>(), std::memory_order_relaxed);
+}
+
+
+inline void
+Instrument::AccountingAPI::publish_achieved_refresh_rate()
+{
+	if (auto const rate_hz = _instrument._achieved_refresh_rate_hz.load (std::memory_order_relaxed); rate_hz >= 0.0)
+		_instrument.achieved_refresh_rate = 1_Hz * rate_hz;
+}
+
+
+inline void
+Instrument::set_refresh_policy (RefreshPolicy const& refresh_policy)
+{
+	_refresh_policy = refresh_policy;
+}
+
+
+inline auto
+Instrument::refresh_policy() const noexcept -> RefreshPolicy const&
+{
+	return _refresh_policy;
+}
+
+
+inline bool
+Instrument::dirty() const noexcept
+{
+	return _dirty.load();
+}
+
+
 inline bool
 Instrument::dirty_since_last_check() noexcept
 {
@@ -16,6 +16,8 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/cycle_trace.h>
+#include <xefis/core/sockets/fetch_plan.h>
 #include <xefis/core/sockets/module_socket.h>
 #include <xefis/core/setting.h>
 
@@ -86,6 +88,7 @@ void
 Module::ModuleSocketAPI::register_input_socket (BasicModuleIn& socket)
 {
 	_module._registered_input_sockets.push_back (&socket);
+	FetchPlan::invalidate (_module._fetch_plan_generation);
 }
 
 
@@ -94,6 +97,7 @@ Module::ModuleSocketAPI::unregister_input_socket (BasicModuleIn& socket)
 {
 	auto new_end = std::remove (_module._registered_input_sockets.begin(), _module._registered_input_sockets.end(), &socket);
 	_module._registered_input_sockets.resize (neutrino::to_unsigned (std::distance (_module._registered_input_sockets.begin(), new_end)));
+	FetchPlan::invalidate (_module._fetch_plan_generation);
 }
 
 
@@ -136,7 +140,12 @@ Module::ModuleSocketAPI::output_sockets() const noexcept
 void
 Module::ProcessingLoopAPI::communicate (Cycle const& cycle)
 {
+	if (_module._processing_policy == ProcessingPolicy::External)
+		return;
+
 	try {
+		CycleTrace::Scope trace_scope ("communicate", [&] { return identifier (_module); });
+
 		auto communication_time = TimeHelper::measure ([&] {
 			_module.communicate (cycle);
 		});
@@ -159,15 +168,38 @@ Module::ProcessingLoopAPI::fetch_and_process (Cycle const& cycle)
 		{
 			_module._cached = true;
 
-			for (auto* socket: _module._registered_input_sockets)
-				socket->fetch (cycle);
-
-			auto processing_time = TimeHelper::measure ([&] {
-				_module.process (cycle);
-			});
-
-			if (implements_process_method())
-				Module::AccountingAPI (_module).add_processing_time (processing_time);
+			// Outputs are driven from outside, process() would overwrite them:
+			if (_module._processing_policy == ProcessingPolicy::External)
+				return;
+
+			if (_module._fetch_plan)
+			{
+				if (!_module._fetch_plan->up_to_date())
+					compile_fetch_plan();
+
+				_module._fetch_plan->execute (cycle);
+			}
+			else
+			{
+				for (auto* socket: _module._registered_input_sockets)
+					socket->fetch (cycle);
+			}
+
+			if (skip_processing (cycle))
+				_module._skipped_cycles.fetch_add (1, std::memory_order_relaxed);
+			else
+			{
+				CycleTrace::Scope trace_scope ("process", [&] { return identifier (_module); });
+
+				auto processing_time = TimeHelper::measure ([&] {
+					_module.process (cycle);
+				});
+
+				_module._processed_cycles.fetch_add (1, std::memory_order_relaxed);
+
+				if (implements_process_method())
+					Module::AccountingAPI (_module).add_processing_time (processing_time);
+			}
 		}
 	}
 	catch (...)
@@ -177,6 +209,54 @@ Module::ProcessingLoopAPI::fetch_and_process (Cycle const& cycle)
 }
 
 
+bool
+Module::ProcessingLoopAPI::skip_processing (Cycle const& cycle)
+{
+	if (_module._processing_policy != ProcessingPolicy::OnInputChange)
+		return false;
+
+	auto& serials = _module._last_input_serials;
+	auto const& inputs = _module._registered_input_sockets;
+	bool changed = serials.size() != inputs.size();
+
+	if (changed)
+		serials.resize (inputs.size());
+
+	for (std::size_t i = 0; i < inputs.size(); ++i)
+	{
+		if (auto const serial = inputs[i]->serial(); serials[i] != serial)
+		{
+			serials[i] = serial;
+			changed = true;
+		}
+	}
+
+	auto const now = cycle.update_time();
+	auto const stale = !_module._last_processing_time
+		|| (_module._max_staleness && now - *_module._last_processing_time >= *_module._max_staleness);
+
+	if (changed || stale)
+	{
+		_module._last_processing_time = now;
+		return false;
+	}
+	else
+		return true;
+}
+
+
+void
+Module::ProcessingLoopAPI::compile_fetch_plan()
+{
+	auto plan = std::make_unique<FetchPlan> (_module._fetch_plan_generation);
+
+	for (auto* socket: _module._registered_input_sockets)
+		socket->compile_fetch (*plan);
+
+	_module._fetch_plan = std::move (plan);
+}
+
+
 void
 Module::ProcessingLoopAPI::handle_exception (Cycle const& cycle, std::string_view const& context_info)
 {
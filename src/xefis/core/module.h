@@ -17,6 +17,7 @@
 // Xefis:
 #include <xefis/config/all.h>
 #include <xefis/core/cycle.h>
+#include <xefis/core/sockets/basic_socket.h>
 #include <xefis/utility/named_instance.h>
 
 // Neutrino:
@@ -27,11 +28,13 @@
 #include <boost/circular_buffer.hpp>
 
 // Standard:
+#include <atomic>
 #include <cstddef>
 #include <vector>
 #include <exception>
 #include <optional>
 #include <memory>
+#include <mutex>
 #include <type_traits>
 
 
@@ -42,6 +45,7 @@ namespace xf {
 class BasicSetting;
 class BasicModuleIn;
 class BasicModuleOut;
+class FetchPlan;
 
 
 /**
@@ -78,6 +82,17 @@ class Module:
 	static constexpr std::size_t kMaxProcessingTimesBackLog = 1000;
 
   public:
+	enum class ProcessingPolicy
+	{
+		// Call process() in every cycle:
+		EveryCycle,
+		// Call process() only if serial of any registered input socket changed since last process():
+		OnInputChange,
+		// Never call communicate() nor process() and don't fetch inputs; output sockets are set
+		// from outside of the module (eg. by FlightDataReplayer):
+		External,
+	};
+
 	/**
 	 * A set of methods for module socket to use on the module.
 	 */
@@ -207,7 +222,23 @@ class Module:
 		void
 		reset_cache();
 
+		/**
+		 * Flatten fetching of all input sockets into a FetchPlan that will be used by
+		 * fetch_and_process() from now on. The plan is automatically recompiled when
+		 * socket connections change.
+		 */
+		void
+		compile_fetch_plan();
+
 	  private:
+		/**
+		 * Return true if process() should be skipped in this cycle according to the processing policy.
+		 * Updates state used to make the decision.
+		 */
+		[[nodiscard]]
+		bool
+		skip_processing (Cycle const&);
+
 		/**
 		 * Print current exception information.
 		 */
@@ -220,6 +251,7 @@ class Module:
 
 	/**
 	 * Accesses accounting data (time spent on processing, etc.
+	 * Thread-safe, since the data is written by processing threads and read by the GUI.
 	 */
 	class AccountingAPI
 	{
@@ -233,7 +265,7 @@ class Module:
 		 */
 		[[nodiscard]]
 		si::Time
-		cycle_time() const noexcept;
+		cycle_time() const;
 
 		/**
 		 * Set cycle time of he ProcessingLoop that this module is being processed in.
@@ -254,18 +286,32 @@ class Module:
 		add_processing_time (si::Time);
 
 		/**
-		 * Communication times buffer.
+		 * Copy of communication times buffer.
 		 */
 		[[nodiscard]]
-		boost::circular_buffer<si::Time> const&
-		communication_times() const noexcept;
+		boost::circular_buffer<si::Time>
+		communication_times() const;
 
 		/**
-		 * Processing times buffer.
+		 * Copy of processing times buffer.
 		 */
 		[[nodiscard]]
-		boost::circular_buffer<si::Time> const&
-		processing_times() const noexcept;
+		boost::circular_buffer<si::Time>
+		processing_times() const;
+
+		/**
+		 * Number of cycles in which process() was called.
+		 */
+		[[nodiscard]]
+		uint64_t
+		processed_cycles() const noexcept;
+
+		/**
+		 * Number of cycles in which process() was skipped because of the OnInputChange processing policy.
+		 */
+		[[nodiscard]]
+		uint64_t
+		skipped_cycles() const noexcept;
 
 	  private:
 		Module& _module;
@@ -314,6 +360,26 @@ class Module:
 	verify_settings()
 	{ }
 
+	/**
+	 * Set processing policy.
+	 * With OnInputChange policy process() is skipped if no registered input socket changed its serial since
+	 * the last call. Use it only for modules whose outputs depend solely on the current values of inputs,
+	 * never for modules that read hardware or generate data by themselves.
+	 *
+	 * \param	max_staleness
+	 *			If set, process() will be called at least once per given period even if inputs didn't change.
+	 *			Useful for modules that integrate over time.
+	 */
+	void
+	set_processing_policy (ProcessingPolicy, std::optional<si::Time> max_staleness = std::nullopt);
+
+	/**
+	 * Return current processing policy.
+	 */
+	[[nodiscard]]
+	ProcessingPolicy
+	processing_policy() const noexcept;
+
   protected:
 	/**
 	 * Communicate with sensors/actuators to send/receive processing data and results.
@@ -355,9 +421,20 @@ class Module:
 	bool								_did_not_process: 1			{ false };
 	bool								_cached: 1					{ false };
 	bool								_set_nil_on_exception: 1	{ true };
+	// Accounting data is written by the processing thread(s) and read by the GUI:
+	std::mutex							_accounting_mutex;
 	boost::circular_buffer<si::Time>	_communication_times		{ kMaxProcessingTimesBackLog };
 	boost::circular_buffer<si::Time>	_processing_times			{ kMaxProcessingTimesBackLog };
 	si::Time							_cycle_time					{ 0_s };
+	std::unique_ptr<FetchPlan>			_fetch_plan;
+	// Bumped by input sockets compiled into _fetch_plan when their connections change:
+	FetchPlan::GenerationCounter		_fetch_plan_generation		{ 0 };
+	ProcessingPolicy					_processing_policy			{ ProcessingPolicy::EveryCycle };
+	std::optional<si::Time>				_max_staleness;
+	std::optional<si::Time>				_last_processing_time;
+	std::vector<BasicSocket::Serial>	_last_input_serials;
+	std::atomic<uint64_t>				_processed_cycles			{ 0 };
+	std::atomic<uint64_t>				_skipped_cycles				{ 0 };
 };
 
 
@@ -395,8 +472,9 @@ Module::AccountingAPI::AccountingAPI (Module& module):
 
 
 inline si::Time
-Module::AccountingAPI::cycle_time() const noexcept
+Module::AccountingAPI::cycle_time() const
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	return _module._cycle_time;
 }
 
@@ -404,6 +482,7 @@ Module::AccountingAPI::cycle_time() const noexcept
 inline void
 Module::AccountingAPI::set_cycle_time (si::Time cycle_time)
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	_module._cycle_time = cycle_time;
 }
 
@@ -411,6 +490,7 @@ Module::AccountingAPI::set_cycle_time (si::Time cycle_time)
 inline void
 Module::AccountingAPI::add_communication_time (si::Time t)
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	_module._communication_times.push_back (t);
 }
 
@@ -418,24 +498,58 @@ Module::AccountingAPI::add_communication_time (si::Time t)
 inline void
 Module::AccountingAPI::add_processing_time (si::Time t)
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	_module._processing_times.push_back (t);
 }
 
 
-inline boost::circular_buffer<si::Time> const&
-Module::AccountingAPI::communication_times() const noexcept
+inline boost::circular_buffer<si::Time>
+Module::AccountingAPI::communication_times() const
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	return _module._communication_times;
 }
 
 
-inline boost::circular_buffer<si::Time> const&
-Module::AccountingAPI::processing_times() const noexcept
+inline boost::circular_buffer<si::Time>
+Module::AccountingAPI::processing_times() const
 {
+	std::lock_guard lock (_module._accounting_mutex);
 	return _module._processing_times;
 }
 
 
+inline uint64_t
+Module::AccountingAPI::processed_cycles() const noexcept
+{
+	return _module._processed_cycles.load (std::memory_order_relaxed);
+}
+
+
+inline uint64_t
+Module::AccountingAPI::skipped_cycles() const noexcept
+{
+	return _module._skipped_cycles.load (std::memory_order_relaxed);
+}
+
+
+inline void
+Module::set_processing_policy (ProcessingPolicy processing_policy, std::optional<si::Time> max_staleness)
+{
+	_processing_policy = processing_policy;
+	_max_staleness = max_staleness;
+	_last_processing_time.reset();
+	_last_input_serials.clear();
+}
+
+
+inline auto
+Module::processing_policy() const noexcept -> ProcessingPolicy
+{
+	return _processing_policy;
+}
+
+
 inline void
 Module::set_nil_on_exception (bool enable) noexcept
 {
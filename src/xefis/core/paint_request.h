@@ -23,6 +23,7 @@
 
 // Qt:
 #include <QPaintDevice>
+#include <QRect>
 
 // Standard:
 #include <cstddef>
@@ -81,7 +82,7 @@ class PaintRequest
   public:
 	// Ctor
 	explicit
-	PaintRequest (QPaintDevice&, Metric const&, QSize previous_canvas_size);
+	PaintRequest (QPaintDevice&, Metric const&, QSize previous_canvas_size, QRect* painted_rect = nullptr);
 
 	// Move ctor
 	PaintRequest (PaintRequest&&) = default;
@@ -111,10 +112,31 @@ class PaintRequest
 	bool
 	size_changed() const noexcept;
 
+	/**
+	 * Return true if the Screen wants to know which part of the canvas gets painted
+	 * (see Instrument::CanvasClearing::PaintedRegion).
+	 */
+	[[nodiscard]]
+	bool
+	tracks_painted_region() const noexcept
+		{ return _painted_rect != nullptr; }
+
+	/**
+	 * Report that given rect (in canvas coordinates, without any painter transforms) has been painted.
+	 * Only this area will be cleared before the next painting on the same canvas.
+	 * No-op if painted region is not tracked.
+	 */
+	void
+	mark_painted (QRect const&) const noexcept;
+
+	void
+	mark_painted (QRectF const&) const noexcept;
+
   private:
 	QPaintDevice*	_canvas;
 	Metric			_metric;
 	bool			_size_changed;
+	QRect*			_painted_rect;
 };
 
 
@@ -166,10 +188,11 @@ PaintRequest::Metric::font_height() const noexcept
 
 
 inline
-PaintRequest::PaintRequest (QPaintDevice& canvas, Metric const& metric, QSize previous_canvas_size):
+PaintRequest::PaintRequest (QPaintDevice& canvas, Metric const& metric, QSize previous_canvas_size, QRect* painted_rect):
 	_canvas (&canvas),
 	_metric (metric),
-	_size_changed (QSize (canvas.width(), canvas.height()) != previous_canvas_size)
+	_size_changed (QSize (canvas.width(), canvas.height()) != previous_canvas_size),
+	_painted_rect (painted_rect)
 { }
 
 
@@ -193,6 +216,21 @@ PaintRequest::size_changed() const noexcept
 	return _size_changed;
 }
 
+
+inline void
+PaintRequest::mark_painted (QRect const& rect) const noexcept
+{
+	if (_painted_rect)
+		*_painted_rect |= rect & _metric.canvas_rect();
+}
+
+
+inline void
+PaintRequest::mark_painted (QRectF const& rect) const noexcept
+{
+	mark_painted (rect.toAlignedRect());
+}
+
 } // namespace xf
 
 #endif
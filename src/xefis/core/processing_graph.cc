@@ -0,0 +1,211 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "processing_graph.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/socket_clock.h>
+
+// Neutrino:
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+
+namespace xf {
+
+ProcessingGraph::ProcessingGraph (std::vector<Module*> const& modules)
+{
+	std::vector<Module*> serial_order;
+	std::unordered_set<Module*> visited;
+	// Pairs of (source module, target module):
+	std::vector<std::pair<Module*, Module*>> connections;
+
+	// Simulate the pull-based recursion that serial processing does: for each input socket, fetching
+	// its source ModuleOut causes the source module to be processed first, unless it's already being
+	// processed (the _cached flag in Module).
+	std::function<void (Module*)> visit = [&] (Module* module) {
+		if (!visited.insert (module).second)
+			return;
+
+		for (auto* input: Module::ModuleSocketAPI (*module).input_sockets())
+		{
+			for (auto* socket = input->data_source_socket(); socket; socket = socket->data_source_socket())
+			{
+				if (auto* module_socket = dynamic_cast<BasicModuleSocket*> (socket))
+				{
+					auto* source_module = &module_socket->module();
+
+					if (source_module != module)
+						connections.emplace_back (source_module, module);
+
+					if (dynamic_cast<BasicModuleOut*> (socket))
+						visit (source_module);
+				}
+			}
+		}
+
+		serial_order.push_back (module);
+	};
+
+	for (auto* module: modules)
+		visit (module);
+
+	std::unordered_map<Module*, std::size_t> index_of;
+
+	_nodes.reserve (serial_order.size());
+
+	for (auto* module: serial_order)
+	{
+		index_of[module] = _nodes.size();
+		_nodes.push_back (Node { module, {}, {} });
+	}
+
+	// Direct every edge according to the serial order:
+	std::set<std::pair<std::size_t, std::size_t>> edges;
+
+	for (auto const& [source, target]: connections)
+	{
+		auto const a = index_of.at (source);
+		auto const b = index_of.at (target);
+		edges.emplace (std::min (a, b), std::max (a, b));
+	}
+
+	for (auto const& [from, to]: edges)
+	{
+		_nodes[from].successors.push_back (to);
+		_nodes[to].predecessors.push_back (from);
+	}
+
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+		if (_nodes[i].predecessors.empty())
+			_roots.push_back (i);
+
+	_remaining_predecessors = std::make_unique<std::atomic<std::size_t>[]> (_nodes.size());
+}
+
+
+void
+ProcessingGraph::execute (Cycle const& cycle, WorkPerformer& work_performer)
+{
+	if (_nodes.empty())
+		return;
+
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+		_remaining_predecessors[i].store (_nodes[i].predecessors.size(), std::memory_order_relaxed);
+
+	// Ordering is guaranteed by the graph, so prevent ModuleOuts from pulling their modules
+	// when fetched by ModuleIns. That also makes concurrent fetches of the same ModuleOut read-only.
+	for (auto& node: _nodes)
+		for (auto* output: Module::ModuleSocketAPI (*node.module).output_sockets())
+			output->mark_fetched (cycle);
+
+	_remaining_nodes.store (_nodes.size(), std::memory_order_relaxed);
+	// Worker threads must use the same socket timestamps as the calling thread:
+	_socket_timestamp = SocketClock::scoped_timestamp();
+	_done = std::promise<void>();
+	auto done = _done.get_future();
+
+	// Run first root on the calling thread, it would be waiting anyway:
+	for (std::size_t i = 1; i < _roots.size(); ++i)
+		work_performer.submit ([this, root = _roots[i], &cycle, &work_performer] { run (root, cycle, work_performer); });
+
+	run (_roots.front(), cycle, work_performer);
+	done.wait();
+
+	compute_critical_path();
+}
+
+
+void
+ProcessingGraph::run (std::size_t node_index, Cycle const& cycle, WorkPerformer& work_performer)
+{
+	SocketClock::TimestampScope socket_timestamp_scope (_socket_timestamp);
+	std::optional<std::size_t> current = node_index;
+
+	while (current)
+	{
+		auto& node = _nodes[*current];
+		current.reset();
+
+		node.processing_time = TimeHelper::measure ([&] {
+			Module::ProcessingLoopAPI (*node.module).fetch_and_process (cycle);
+		});
+
+		for (auto const successor: node.successors)
+		{
+			if (_remaining_predecessors[successor].fetch_sub (1, std::memory_order_acq_rel) == 1)
+			{
+				// Continue with the first ready successor on this thread:
+				if (!current)
+					current = successor;
+				else
+					work_performer.submit ([this, successor, &cycle, &work_performer] { run (successor, cycle, work_performer); });
+			}
+		}
+
+		if (_remaining_nodes.fetch_sub (1, std::memory_order_acq_rel) == 1)
+			_done.set_value();
+	}
+}
+
+
+void
+ProcessingGraph::compute_critical_path()
+{
+	std::vector<si::Time> finish_times (_nodes.size(), 0_s);
+	std::vector<std::optional<std::size_t>> longest_predecessor (_nodes.size());
+	std::size_t last = 0;
+
+	// Nodes are already in topological order:
+	for (std::size_t i = 0; i < _nodes.size(); ++i)
+	{
+		si::Time start_time = 0_s;
+
+		for (auto const predecessor: _nodes[i].predecessors)
+		{
+			if (finish_times[predecessor] > start_time || !longest_predecessor[i])
+			{
+				start_time = finish_times[predecessor];
+				longest_predecessor[i] = predecessor;
+			}
+		}
+
+		finish_times[i] = start_time + _nodes[i].processing_time;
+
+		if (finish_times[i] > finish_times[last])
+			last = i;
+	}
+
+	_critical_path_time = finish_times[last];
+	_critical_path.clear();
+
+	for (std::optional<std::size_t> i = last; i; i = longest_predecessor[*i])
+		_critical_path.push_back (_nodes[*i].module);
+
+	std::reverse (_critical_path.begin(), _critical_path.end());
+}
+
+} // namespace xf
+
@@ -0,0 +1,130 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__PROCESSING_GRAPH_H__INCLUDED
+#define XEFIS__CORE__PROCESSING_GRAPH_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle.h>
+#include <xefis/core/module.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+#include <neutrino/work_performer.h>
+
+// Standard:
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <optional>
+#include <vector>
+
+
+namespace xf {
+
+/**
+ * Dependency graph of modules built from ModuleIn → ModuleOut connections.
+ * Used to process independent modules concurrently.
+ *
+ * Nodes are kept in the order in which the serial ProcessingLoop would call
+ * Module::process() (depth-first, pull-based order). Every pair of connected modules
+ * gets an edge directed according to that order, so the graph is always acyclic and
+ * each module sees exactly the same input values as it would in serial mode. That also
+ * covers feedback loops: a consumer that would read the previous-cycle value of
+ * a producer is guaranteed to finish before the producer starts.
+ */
+class ProcessingGraph: private Noncopyable
+{
+  public:
+	class Node
+	{
+	  public:
+		Module*						module;
+		std::vector<std::size_t>	predecessors;
+		std::vector<std::size_t>	successors;
+		// Time spent in fetch_and_process() during last executed cycle:
+		si::Time					processing_time		{ 0_s };
+	};
+
+  public:
+	/**
+	 * Build graph for given modules.
+	 * Modules that are data sources for given modules, but are not listed,
+	 * are also added to the graph.
+	 */
+	explicit
+	ProcessingGraph (std::vector<Module*> const& modules);
+
+	/**
+	 * Call Module::ProcessingLoopAPI::fetch_and_process() on all modules, running
+	 * independent modules concurrently on given WorkPerformer.
+	 * Blocks until all modules are processed.
+	 */
+	void
+	execute (Cycle const&, WorkPerformer&);
+
+	/**
+	 * Return nodes in serial-processing order.
+	 */
+	[[nodiscard]]
+	std::vector<Node> const&
+	nodes() const noexcept
+		{ return _nodes; }
+
+	/**
+	 * Return length of the critical path (the longest chain of dependent modules,
+	 * measured by processing times) of the last executed cycle.
+	 */
+	[[nodiscard]]
+	si::Time
+	critical_path_time() const noexcept
+		{ return _critical_path_time; }
+
+	/**
+	 * Return modules on the critical path of the last executed cycle, in processing order.
+	 */
+	[[nodiscard]]
+	std::vector<Module*> const&
+	critical_path() const noexcept
+		{ return _critical_path; }
+
+  private:
+	/**
+	 * Process given node and then all successors that became ready, submitting
+	 * all but one of them to the WorkPerformer.
+	 */
+	void
+	run (std::size_t node_index, Cycle const&, WorkPerformer&);
+
+	/**
+	 * Compute critical path from measured processing times.
+	 */
+	void
+	compute_critical_path();
+
+  private:
+	std::vector<Node>							_nodes;
+	std::vector<std::size_t>					_roots;
+	std::unique_ptr<std::atomic<std::size_t>[]>	_remaining_predecessors;
+	std::atomic<std::size_t>					_remaining_nodes	{ 0 };
+	std::promise<void>							_done;
+	std::optional<si::Time>						_socket_timestamp;
+	si::Time									_critical_path_time	{ 0_s };
+	std::vector<Module*>						_critical_path;
+};
+
+} // namespace xf
+
+#endif
+
@@ -17,8 +17,12 @@
 // Xefis:
 #include <xefis/app/xefis.h>
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
+#include <xefis/core/components/data_recorder/flight_data_writer.h>
+#include <xefis/core/cycle_trace.h>
 #include <xefis/core/machine.h>
 #include <xefis/core/module.h>
+#include <xefis/core/sockets/socket_clock.h>
 
 // Neutrino:
 #include <neutrino/time_helper.h>
@@ -28,8 +32,13 @@
 #include <boost/format.hpp>
 
 // Standard:
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <functional>
+#include <mutex>
+#include <thread>
 
 
 namespace xf {
@@ -47,12 +56,25 @@ ProcessingLoop::ProcessingLoop (Machine& machine, std::string_view const& instan
 	_loop_timer->setInterval (_loop_period.in<si::Millisecond>());
 	QObject::connect (_loop_timer, &QTimer::timeout, this, &ProcessingLoop::execute_cycle);
 
+	_stats_timer = new QTimer (this);
+	_stats_timer->setSingleShot (false);
+	_stats_timer->setInterval ((1.0 / kStatsTransferRate).in<si::Millisecond>());
+	QObject::connect (_stats_timer, &QTimer::timeout, this, &ProcessingLoop::collect_cycle_stats);
+
+	_instruments_timer = new QTimer (this);
+	_instruments_timer->setSingleShot (false);
+	_instruments_timer->setTimerType (Qt::PreciseTimer);
+	_instruments_timer->setInterval (std::max (_loop_period, 1.0 / kMaxInstrumentsRate).in<si::Millisecond>());
+	QObject::connect (_instruments_timer, &QTimer::timeout, this, &ProcessingLoop::process_instruments);
+
 	_logger.set_logger_tag_provider (*this);
 }
 
 
 ProcessingLoop::~ProcessingLoop()
 {
+	stop();
+
 	// The only allowed registered module during destruction is this ProcessingLoop itself:
 	if (_modules_tracker.size() > 1 || (_modules_tracker.size() == 1 && &_modules_tracker.begin()->value() != this))
 	{
@@ -69,14 +91,29 @@ ProcessingLoop::~ProcessingLoop()
 void
 ProcessingLoop::start()
 {
-	for (auto* module: _uninitialized_modules)
-		Module::ModuleSocketAPI (*module).verify_settings();
+	initialize_modules();
 
-	for (auto* module: _uninitialized_modules)
-		module->initialize();
-
-	_uninitialized_modules.clear();
-	_loop_timer->start();
+	switch (_driver)
+	{
+		case Driver::QtTimer:
+			_loop_timer->start();
+			break;
+
+		case Driver::RealTimeThread:
+			// Instruments are read by Screens, so they're processed on this thread instead:
+			_instruments_on_qt_thread = true;
+			invalidate_processing_graph();
+
+			_loop_thread = std::make_unique<PeriodicThread> (_loop_period, [this] (si::Time wakeup_jitter) {
+				std::lock_guard lock (_cycle_mutex);
+				_pending_wakeup_jitter = wakeup_jitter;
+				execute_cycle();
+			}, _real_time_settings, _logger);
+			_loop_thread->start();
+			_stats_timer->start();
+			_instruments_timer->start();
+			break;
+	}
 }
 
 
@@ -84,50 +121,342 @@ void
 ProcessingLoop::stop()
 {
 	_loop_timer->stop();
+
+	if (_loop_thread)
+	{
+		_loop_thread->stop();
+		_loop_thread.reset();
+		_stats_timer->stop();
+		_instruments_timer->stop();
+		collect_cycle_stats();
+		// Process instruments with results of the last cycle:
+		process_instruments();
+		_instruments_on_qt_thread = false;
+		_instruments_timestamp.reset();
+		invalidate_processing_graph();
+	}
+}
+
+
+auto
+ProcessingLoop::run_virtual (si::Time const duration, std::optional<double> const speed_factor) -> VirtualRunStats
+{
+	if (_loop_timer->isActive() || _loop_thread)
+		throw InvalidCall ("ProcessingLoop::run_virtual() called while the loop is running");
+
+	if (speed_factor && *speed_factor <= 0.0)
+		throw InvalidArgument ("ProcessingLoop::run_virtual(): speed factor must be positive");
+
+	initialize_modules();
+
+	Clock::VirtualTimeScope virtual_time_scope (TimeHelper::now());
+	VirtualRunStats stats;
+	auto const wall_start = TimeHelper::now();
+	auto const simulated_start = Clock::now();
+
+	// Don't count the time between previous run and this one as a single long cycle:
+	_previous_timestamp = simulated_start;
+
+	// Count cycles upfront, since accumulated clock time has rounding errors that could add or lose a cycle:
+	auto const cycles = static_cast<Cycle::Number> (std::floor (duration / _loop_period + 1e-9));
+
+	while (stats.cycles < cycles)
+	{
+		Clock::advance (_loop_period);
+		execute_cycle();
+		++stats.cycles;
+		stats.simulated_time = static_cast<double> (stats.cycles) * _loop_period;
+
+		if (speed_factor)
+		{
+			auto const ahead = stats.simulated_time / *speed_factor - (TimeHelper::now() - wall_start);
+
+			if (ahead > 0_s)
+				std::this_thread::sleep_for (std::chrono::duration<double> (ahead.in<si::Second>()));
+		}
+	}
+
+	// Leave the loop ready to be continued by start() or another run_virtual():
+	_previous_timestamp.reset();
+
+	stats.wall_time = TimeHelper::now() - wall_start;
+	_logger << boost::format ("Virtual run: %d cycles, %.3f s of simulated time in %.3f s (%.1f× real time).\n")
+		% stats.cycles
+		% stats.simulated_time.in<si::Second>()
+		% stats.wall_time.in<si::Second>()
+		% stats.speed();
+
+	return stats;
+}
+
+
+void
+ProcessingLoop::set_driver (Driver driver, PeriodicThread::Settings const& real_time_settings)
+{
+	if (_loop_timer->isActive() || _loop_thread)
+		throw InvalidCall ("ProcessingLoop::set_driver() called while the loop is running");
+
+	_driver = driver;
+	_real_time_settings = real_time_settings;
+}
+
+
+void
+ProcessingLoop::set_flight_data_writer (FlightDataWriter* writer)
+{
+	// The new writer isn't used by the loop yet, so it can be filled without holding the mutex:
+	if (writer && writer != _flight_data_writer)
+		for (auto& module_details: _module_details_list)
+			writer->add_module (module_details.module());
+
+	// Once this returns, the loop thread no longer uses the previous writer:
+	std::lock_guard lock (_cycle_mutex);
+	_flight_data_writer = writer;
+}
+
+
+void
+ProcessingLoop::module_registered (Module& module)
+{
+	// The loop thread may be in the middle of FlightDataWriter::record_cycle():
+	std::lock_guard lock (_cycle_mutex);
+
+	if (_flight_data_writer)
+		_flight_data_writer->add_module (module);
+}
+
+
+void
+ProcessingLoop::set_execution_mode (ExecutionMode execution_mode, WorkPerformer* work_performer)
+{
+	if (execution_mode == ExecutionMode::Parallel && !work_performer)
+		throw InvalidArgument ("parallel execution mode requires a WorkPerformer");
+
+	_execution_mode = execution_mode;
+	_work_performer = work_performer;
+	invalidate_processing_graph();
+}
+
+
+void
+ProcessingLoop::initialize_modules()
+{
+	for (auto* module: _uninitialized_modules)
+		Module::ModuleSocketAPI (*module).verify_settings();
+
+	for (auto* module: _uninitialized_modules)
+		module->initialize();
+
+	_uninitialized_modules.clear();
+
+	for (auto& module_details: _module_details_list)
+		Module::ProcessingLoopAPI (module_details.module()).compile_fetch_plan();
 }
 
 
 void
 ProcessingLoop::execute_cycle()
 {
-	si::Time t = TimeHelper::now();
+	si::Time t = Clock::now();
 
 	if (_previous_timestamp)
 	{
 		si::Time dt = t - *_previous_timestamp;
 		si::Time latency = dt - _loop_period;
+		CycleStats stats;
 
 		_current_cycle = Cycle (_next_cycle_number++, t, dt, _loop_period, _logger);
-		_processing_latencies.push_back (latency);
+		CycleTrace::Scope trace_scope ("cycle", [&] { return instance() + " cycle " + std::to_string (_current_cycle->number()); });
+		stats.latency = latency;
+		stats.wakeup_jitter = _pending_wakeup_jitter.value_or (latency);
 		_io.latency = latency;
 		_io.actual_frequency = 1.0 / dt;
 
 		for (auto& module_details: _module_details_list)
-			Module::ProcessingLoopAPI (module_details.module()).reset_cache();
+			if (processed_in_cycle (module_details))
+				Module::ProcessingLoopAPI (module_details.module()).reset_cache();
+
+		std::optional<si::Time> socket_timestamp;
 
-		_communication_times.push_back (TimeHelper::measure ([this] {
+		if (_socket_timestamps == SocketTimestamps::CycleTime)
+			socket_timestamp = t;
+
+		SocketClock::TimestampScope socket_timestamp_scope (socket_timestamp);
+
+		stats.communication_time = TimeHelper::measure ([this] {
 			for (auto& module_details: _module_details_list)
+			{
+				if (!processed_in_cycle (module_details))
+					continue;
+
+				// Rates measured by Screens on the GUI thread are published here, so that all sockets
+				// are written on the processing thread:
+				if (auto* instrument = module_details.instrument())
+					Instrument::AccountingAPI (*instrument).publish_achieved_refresh_rate();
+
 				Module::ProcessingLoopAPI (module_details.module()).communicate (*_current_cycle);
-		}));
+			}
+		});
 
-		_processing_times.push_back (TimeHelper::measure ([this] {
-			for (auto& module_details: _module_details_list)
+		stats.processing_time = TimeHelper::measure ([&] {
+			switch (_execution_mode)
 			{
-				auto& module = module_details.module();
-				Module::AccountingAPI (module).set_cycle_time (period());
-				Module::ProcessingLoopAPI (module).fetch_and_process (*_current_cycle);
+				case ExecutionMode::Serial:
+					for (auto& module_details: _module_details_list)
+					{
+						if (!processed_in_cycle (module_details))
+							continue;
+
+						auto& module = module_details.module();
+						Module::AccountingAPI (module).set_cycle_time (period());
+						Module::ProcessingLoopAPI (module).fetch_and_process (*_current_cycle);
+					}
+					break;
+
+				case ExecutionMode::Parallel:
+					stats.critical_path_time = execute_parallel_processing();
+					break;
 			}
-		}));
+		});
+
+		if (_flight_data_writer)
+		{
+			Exception::catch_and_log (_logger, [&] {
+				_flight_data_writer->record_cycle (*_current_cycle);
+			});
+		}
+
+		publish_cycle_stats (stats);
 
 		if (latency > kLatencyFactorLogThreshold * _loop_period)
 			_logger << boost::format ("Latency! %.0f%% delay.\n") % (latency / _loop_period * 100.0);
 	}
 
 	_previous_timestamp = t;
+	_pending_wakeup_jitter.reset();
 	_current_cycle.reset();
 }
 
 
+si::Time
+ProcessingLoop::execute_parallel_processing()
+{
+	if (!_processing_graph)
+	{
+		std::vector<Module*> modules;
+		modules.reserve (_module_details_list.size());
+
+		for (auto& module_details: _module_details_list)
+			if (processed_in_cycle (module_details))
+				modules.push_back (&module_details.module());
+
+		_processing_graph = std::make_unique<ProcessingGraph> (modules);
+	}
+
+	for (auto& module_details: _module_details_list)
+		if (processed_in_cycle (module_details))
+			Module::AccountingAPI (module_details.module()).set_cycle_time (period());
+
+	_processing_graph->execute (*_current_cycle, *_work_performer);
+	return _processing_graph->critical_path_time();
+}
+
+
+bool
+ProcessingLoop::processed_in_cycle (ModuleDetails& module_details) const noexcept
+{
+	return !_instruments_on_qt_thread || !module_details.instrument();
+}
+
+
+void
+ProcessingLoop::process_instruments()
+{
+	// Don't block the GUI if the loop thread is in the middle of a cycle, just try again on next tick:
+	std::unique_lock lock (_cycle_mutex, std::try_to_lock);
+
+	if (!lock.owns_lock() || !_previous_timestamp)
+		return;
+
+	// Only process instruments once per finished loop cycle:
+	auto const cycle_number = _next_cycle_number - 1;
+
+	if (cycle_number == 0 || cycle_number == _instruments_cycle_number)
+		return;
+
+	si::Time const t = *_previous_timestamp;
+	si::Time const dt = _instruments_timestamp ? t - *_instruments_timestamp : _loop_period;
+	Cycle const cycle (cycle_number, t, dt, _loop_period, _logger);
+	_instruments_cycle_number = cycle_number;
+	_instruments_timestamp = t;
+
+	std::optional<si::Time> socket_timestamp;
+
+	if (_socket_timestamps == SocketTimestamps::CycleTime)
+		socket_timestamp = t;
+
+	SocketClock::TimestampScope socket_timestamp_scope (socket_timestamp);
+
+	for (auto& module_details: _module_details_list)
+		if (module_details.instrument())
+			Module::ProcessingLoopAPI (module_details.module()).reset_cache();
+
+	for (auto& module_details: _module_details_list)
+	{
+		if (auto* instrument = module_details.instrument())
+		{
+			Instrument::AccountingAPI (*instrument).publish_achieved_refresh_rate();
+			Module::ProcessingLoopAPI (*instrument).communicate (cycle);
+		}
+	}
+
+	for (auto& module_details: _module_details_list)
+	{
+		if (auto* instrument = module_details.instrument())
+		{
+			Module::AccountingAPI (*instrument).set_cycle_time (period());
+			Module::ProcessingLoopAPI (*instrument).fetch_and_process (cycle);
+		}
+	}
+}
+
+
+void
+ProcessingLoop::publish_cycle_stats (CycleStats const& stats)
+{
+	if (_loop_thread)
+	{
+		// Drop statistics if the GUI thread doesn't keep up:
+		_cycle_stats_queue.push (stats);
+	}
+	else
+	{
+		_communication_times.push_back (stats.communication_time);
+		_processing_times.push_back (stats.processing_time);
+		_processing_latencies.push_back (stats.latency);
+		_wakeup_jitters.push_back (stats.wakeup_jitter);
+
+		if (stats.critical_path_time)
+			_critical_path_times.push_back (*stats.critical_path_time);
+	}
+}
+
+
+void
+ProcessingLoop::collect_cycle_stats()
+{
+	_cycle_stats_queue.consume_all ([this] (CycleStats const& stats) {
+		_communication_times.push_back (stats.communication_time);
+		_processing_times.push_back (stats.processing_time);
+		_processing_latencies.push_back (stats.latency);
+		_wakeup_jitters.push_back (stats.wakeup_jitter);
+
+		if (stats.critical_path_time)
+			_critical_path_times.push_back (*stats.critical_path_time);
+	});
+}
+
+
 std::optional<std::string>
 ProcessingLoop::logger_tag() const
 {
@@ -16,7 +16,10 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/instrument.h>
+#include <xefis/core/processing_graph.h>
 #include <xefis/core/sockets/module_out.h>
+#include <xefis/utility/periodic_thread.h>
 
 // Neutrino:
 #include <neutrino/logger.h>
@@ -24,16 +27,25 @@
 #include <neutrino/sequence.h>
 #include <neutrino/time.h>
 #include <neutrino/tracker.h>
+#include <neutrino/work_performer.h>
 
 // Qt:
 #include <QTimer>
 
+// Lib:
+#include <boost/circular_buffer.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
 // Standard:
 #include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
 
 
 namespace xf {
 
+class FlightDataWriter;
 class Machine;
 class Xefis;
 
@@ -61,8 +73,35 @@ class ProcessingLoop:
 
 	static constexpr std::size_t	kMaxProcessingTimesBackLog	= 1000;
 	static constexpr float			kLatencyFactorLogThreshold	= 2.0f;
+	static constexpr si::Frequency	kStatsTransferRate			= 10_Hz;
+	// With the RealTimeThread driver instruments are processed on the Qt thread at most this often:
+	static constexpr si::Frequency	kMaxInstrumentsRate			= 120_Hz;
 
   public:
+	enum class Driver
+	{
+		// QTimer running in the Qt event loop:
+		QtTimer,
+		// Dedicated thread with absolute deadlines, see PeriodicThread:
+		RealTimeThread,
+	};
+
+	enum class ExecutionMode
+	{
+		// Process modules one by one on the thread running the loop:
+		Serial,
+		// Process independent modules concurrently on a WorkPerformer:
+		Parallel,
+	};
+
+	enum class SocketTimestamps
+	{
+		// Read the system clock on every socket modification:
+		SystemClock,
+		// Use the cycle time (Cycle::update_time()) for all socket modifications within a cycle:
+		CycleTime,
+	};
+
 	class ModuleDetails
 	{
 	  public:
@@ -76,12 +115,56 @@ class ProcessingLoop:
 		Module const&
 		module() const noexcept;
 
+		/**
+		 * Return the module as an Instrument, or nullptr if it's not an instrument.
+		 */
+		Instrument*
+		instrument() noexcept
+			{ return _instrument; }
+
 	  private:
-		Module* _module;
+		Module*		_module;
+		Instrument*	_instrument;
 	};
 
 	using ModuleDetailsList = std::vector<ModuleDetails>;
 
+	/**
+	 * Result of run_virtual().
+	 */
+	class VirtualRunStats
+	{
+	  public:
+		Cycle::Number	cycles			{ 0 };
+		si::Time		simulated_time	{ 0_s };
+		si::Time		wall_time		{ 0_s };
+
+	  public:
+		/**
+		 * Return throughput in simulated seconds per wall second.
+		 */
+		[[nodiscard]]
+		double
+		speed() const noexcept
+			{ return wall_time > 0_s ? simulated_time / wall_time : 0.0; }
+	};
+
+  private:
+	/**
+	 * Timing statistics of a single cycle, passed from the loop thread to the GUI thread.
+	 */
+	class CycleStats
+	{
+	  public:
+		si::Time					communication_time	{ 0_s };
+		si::Time					processing_time		{ 0_s };
+		si::Time					latency				{ 0_s };
+		si::Time					wakeup_jitter		{ 0_s };
+		std::optional<si::Time>		critical_path_time;
+	};
+
+	using CycleStatsQueue = boost::lockfree::spsc_queue<CycleStats, boost::lockfree::capacity<kMaxProcessingTimesBackLog>>;
+
   public:
 	// Ctor
 	explicit
@@ -118,10 +201,112 @@ class ProcessingLoop:
 
 	/**
 	 * Stop looping.
+	 * When using RealTimeThread driver, waits for the current cycle to finish.
 	 */
 	void
 	stop();
 
+	/**
+	 * Run the loop synchronously in the calling thread for given amount of simulated time, using the virtual Clock.
+	 * Doesn't need a running Qt event loop, so it can be used for headless batch simulations.
+	 *
+	 * Each cycle advances the Clock by exactly one loop period, so cycle times, socket timestamps, Temporals, etc.
+	 * all follow simulated time. If the Clock is not in virtual mode yet, it's switched to virtual mode starting at
+	 * current system time for the duration of the call. Otherwise the run continues from current virtual time, which
+	 * allows running multiple loops in lockstep with subsequent short calls.
+	 *
+	 * \param	speed_factor
+	 *			If set, cycles are paced to run at speed_factor × real time (but not faster than modules can process).
+	 *			Otherwise the loop runs as fast as possible.
+	 * \throw	InvalidCall
+	 *			When called while the loop is running.
+	 */
+	VirtualRunStats
+	run_virtual (si::Time duration, std::optional<double> speed_factor = std::nullopt);
+
+	/**
+	 * Select what drives the loop. Must be called when the loop is stopped.
+	 *
+	 * With the RealTimeThread driver communicate() and process() methods of modules are called
+	 * from the loop thread, not from the Qt thread, so use it only with modules that don't use Qt
+	 * objects that live in the Qt thread. Instruments are the exception: since their state is read
+	 * by Screens, they're processed on the Qt thread after each loop cycle, while the loop thread is
+	 * held off by a mutex. Therefore other modules must not use instruments' output sockets as inputs.
+	 * Loop timing statistics are passed to the Qt thread through a lock-free queue and per-module
+	 * timing statistics are guarded by a mutex in Module, so both can be safely read from the GUI.
+	 *
+	 * \throw	InvalidCall
+	 *			When called while the loop is running.
+	 */
+	void
+	set_driver (Driver, PeriodicThread::Settings const& = {});
+
+	/**
+	 * Return current driver.
+	 */
+	[[nodiscard]]
+	Driver
+	driver() const noexcept;
+
+	/**
+	 * Set the way modules are processed.
+	 * Parallel mode requires a WorkPerformer. Results are the same as in the serial mode.
+	 *
+	 * In Parallel mode Module::process() is called from the WorkPerformer's threads (communicate()
+	 * is still called serially from the loop's thread). Therefore modules whose process() uses Qt
+	 * objects (timers, sockets, serial ports, widgets) or other state shared with other threads
+	 * without synchronization must not be processed by a loop in Parallel mode. Currently these are:
+	 * comm/link (failsafe and reacquire timers), comm/udp (QUdpSocket), io/chr_um6 and io/xbee
+	 * (serial port writes) and io/gps (power-cycle timer). Put such modules into a separate
+	 * ProcessingLoop that uses ExecutionMode::Serial.
+	 *
+	 * \throw	InvalidArgument
+	 *			When Parallel mode is requested without a WorkPerformer.
+	 */
+	void
+	set_execution_mode (ExecutionMode, WorkPerformer* = nullptr);
+
+	/**
+	 * Return current execution mode.
+	 */
+	[[nodiscard]]
+	ExecutionMode
+	execution_mode() const noexcept;
+
+	/**
+	 * Set the source of modification timestamps for sockets modified during processing cycles.
+	 * CycleTime reads the clock once per cycle instead of once per modified socket, at the cost of
+	 * timestamps' resolution being limited to the loop period.
+	 * Timestamps provided by modules with SocketClock::TimestampScope always take precedence.
+	 */
+	void
+	set_socket_timestamps (SocketTimestamps) noexcept;
+
+	/**
+	 * Return current source of socket modification timestamps.
+	 */
+	[[nodiscard]]
+	SocketTimestamps
+	socket_timestamps() const noexcept;
+
+	/**
+	 * Record values of all modules' output sockets at the end of each cycle with given writer.
+	 * Modules registered later are added to the writer as well. Pass nullptr to stop recording.
+	 * Can be called while the loop is running, also in RealTimeThread mode: the writer is swapped
+	 * between cycles, so the previous writer can be destroyed as soon as this returns. Since the
+	 * writer refers to output sockets of the modules, registered modules must not be destroyed
+	 * while recording.
+	 */
+	void
+	set_flight_data_writer (FlightDataWriter*);
+
+	/**
+	 * Force rebuilding the module dependency graph used in the parallel mode.
+	 * Call it after reconnecting sockets when the loop is already running.
+	 */
+	void
+	invalidate_processing_graph() noexcept;
+
 	/**
 	 * Return current processing cycle, if called during a processing cycle.
 	 * Otherwise return nullptr.
@@ -172,13 +357,84 @@ class ProcessingLoop:
 	boost::circular_buffer<si::Time> const&
 	processing_latencies() const noexcept;
 
+	/**
+	 * Wake-up jitters buffer (difference between intended and actual start of a cycle).
+	 * With QtTimer driver it's the same as processing latency.
+	 */
+	[[nodiscard]]
+	boost::circular_buffer<si::Time> const&
+	wakeup_jitters() const noexcept;
+
+	/**
+	 * Critical path times buffer. Filled only in parallel mode.
+	 */
+	[[nodiscard]]
+	boost::circular_buffer<si::Time> const&
+	critical_path_times() const noexcept;
+
+	/**
+	 * Modules on the critical path of the last cycle, in processing order.
+	 * Empty if not in parallel mode.
+	 */
+	[[nodiscard]]
+	std::vector<Module*>
+	critical_path() const;
+
   protected:
+	/**
+	 * Initialize modules that were not initialized yet and prepare fetch plans.
+	 */
+	void
+	initialize_modules();
+
 	/**
 	 * Execute single loop cycle.
 	 */
 	virtual void
 	execute_cycle();
 
+	/**
+	 * Process all modules using the dependency graph and the WorkPerformer.
+	 * Return critical path time.
+	 */
+	si::Time
+	execute_parallel_processing();
+
+	/**
+	 * Store cycle statistics in buffers or pass them to the Qt thread if looping
+	 * in a separate thread.
+	 */
+	void
+	publish_cycle_stats (CycleStats const&);
+
+	/**
+	 * Move statistics passed from the loop thread into buffers.
+	 * Called in the Qt thread.
+	 */
+	void
+	collect_cycle_stats();
+
+	/**
+	 * Add newly registered module to the flight data writer, if any.
+	 */
+	void
+	module_registered (Module&);
+
+	/**
+	 * Return true if module is processed by execute_cycle(). With the RealTimeThread driver
+	 * instruments are processed by process_instruments() instead.
+	 */
+	[[nodiscard]]
+	bool
+	processed_in_cycle (ModuleDetails&) const noexcept;
+
+	/**
+	 * Communicate with and process instruments after a loop cycle finished in the loop thread.
+	 * Called in the Qt thread when using the RealTimeThread driver.
+	 */
+	void
+	process_instruments();
+
 	// LoggerTagProvider API
 	std::optional<std::string>
 	logger_tag() const override;
@@ -188,6 +444,19 @@ class ProcessingLoop:
 	Machine&							_machine;
 	Xefis&								_xefis;
 	QTimer*								_loop_timer;
+	QTimer*								_stats_timer;
+	QTimer*								_instruments_timer;
+	Driver								_driver					{ Driver::QtTimer };
+	PeriodicThread::Settings			_real_time_settings;
+	std::unique_ptr<PeriodicThread>		_loop_thread;
+	// Held by the loop thread during a cycle and by the Qt thread while processing instruments
+	// or changing the flight data writer:
+	std::mutex							_cycle_mutex;
+	bool								_instruments_on_qt_thread	{ false };
+	Cycle::Number						_instruments_cycle_number	{ 0 };
+	std::optional<si::Time>				_instruments_timestamp;
+	std::optional<si::Time>				_pending_wakeup_jitter;
+	CycleStatsQueue						_cycle_stats_queue;
 	si::Time							_loop_period;
 	std::optional<Timestamp>			_previous_timestamp;
 	std::vector<Module*>				_uninitialized_modules;
@@ -197,6 +466,13 @@ class ProcessingLoop:
 	boost::circular_buffer<si::Time>	_communication_times	{ kMaxProcessingTimesBackLog };
 	boost::circular_buffer<si::Time>	_processing_times		{ kMaxProcessingTimesBackLog };
 	boost::circular_buffer<si::Time>	_processing_latencies	{ kMaxProcessingTimesBackLog };
+	boost::circular_buffer<si::Time>	_wakeup_jitters			{ kMaxProcessingTimesBackLog };
+	boost::circular_buffer<si::Time>	_critical_path_times	{ kMaxProcessingTimesBackLog };
+	ExecutionMode						_execution_mode			{ ExecutionMode::Serial };
+	WorkPerformer*						_work_performer			{ nullptr };
+	SocketTimestamps					_socket_timestamps		{ SocketTimestamps::SystemClock };
+	std::unique_ptr<ProcessingGraph>	_processing_graph;
+	FlightDataWriter*					_flight_data_writer		{ nullptr };
 	Cycle::Number						_next_cycle_number		{ 1 };
 	Logger								_logger;
 };
@@ -209,12 +485,15 @@ template<class Compatible>
 		_modules_tracker.register_object (registrant);
 		_module_details_list.emplace_back (*registrant);
 		_uninitialized_modules.push_back (&*registrant);
+		invalidate_processing_graph();
+		module_registered (*registrant);
 	}
 
 
 inline
 ProcessingLoop::ModuleDetails::ModuleDetails (Module& module):
-	_module (&module)
+	_module (&module),
+	_instrument (dynamic_cast<Instrument*> (&module))
 { }
 
 
@@ -246,6 +525,41 @@ ProcessingLoop::xefis() const noexcept
 }
 
 
+inline auto
+ProcessingLoop::driver() const noexcept -> Driver
+{
+	return _driver;
+}
+
+
+inline auto
+ProcessingLoop::execution_mode() const noexcept -> ExecutionMode
+{
+	return _execution_mode;
+}
+
+
+inline void
+ProcessingLoop::set_socket_timestamps (SocketTimestamps socket_timestamps) noexcept
+{
+	_socket_timestamps = socket_timestamps;
+}
+
+
+inline auto
+ProcessingLoop::socket_timestamps() const noexcept -> SocketTimestamps
+{
+	return _socket_timestamps;
+}
+
+
+inline void
+ProcessingLoop::invalidate_processing_graph() noexcept
+{
+	_processing_graph.reset();
+}
+
+
 inline Cycle const*
 ProcessingLoop::current_cycle() const
 {
@@ -296,6 +610,30 @@ ProcessingLoop::processing_latencies() const noexcept
 	return _processing_latencies;
 }
 
+
+inline boost::circular_buffer<si::Time> const&
+ProcessingLoop::wakeup_jitters() const noexcept
+{
+	return _wakeup_jitters;
+}
+
+
+inline boost::circular_buffer<si::Time> const&
+ProcessingLoop::critical_path_times() const noexcept
+{
+	return _critical_path_times;
+}
+
+
+inline std::vector<Module*>
+ProcessingLoop::critical_path() const
+{
+	if (_processing_graph)
+		return _processing_graph->critical_path();
+	else
+		return {};
+}
+
 } // namespace xf
 
 #endif
@@ -16,7 +16,11 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/argb_blender.h>
+#include <xefis/core/cycle_trace.h>
 #include <xefis/core/module.h>
+#include <xefis/support/instrument/glyph_atlas.h>
+#include <xefis/support/instrument/instrument_aids.h>
 
 // Neutrino:
 #include <neutrino/time_helper.h>
@@ -30,8 +34,14 @@
 
 // Standard:
 #include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <exception>
 #include <functional>
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <span>
 #include <thread>
 
 
@@ -58,22 +68,231 @@ InstrumentDetails::compute_position (QSize const canvas_size)
 	this->instrument.mark_dirty();
 }
 
+
+/**
+ * State shared by the tasks painting layers of one instrument.
+ */
+class LayerGroup
+{
+  public:
+	std::vector<Instrument::PaintLayer>		layers;
+	std::vector<PaintRequest>				paint_requests;
+	std::vector<QImage const*>				layer_canvases;
+	QImage*									canvas;
+	ArgbBlender								blender;
+	std::string								trace_name;
+	si::Time								request_time;
+	std::vector<si::Time>					start_times;
+	std::vector<si::Time>					painting_times;
+	std::vector<std::exception_ptr>			exceptions;
+	std::atomic<std::size_t>				remaining;
+	std::promise<PaintPerformanceMetrics>	promise;
+
+  public:
+	/**
+	 * Paint given layer. The last task to finish composites the layers.
+	 */
+	void
+	paint_layer (std::size_t index) noexcept;
+
+  private:
+	/**
+	 * Composite layers onto the instrument canvas and fulfill the promise.
+	 */
+	void
+	finish() noexcept;
+};
+
+
+void
+LayerGroup::paint_layer (std::size_t const index) noexcept
+{
+	{
+		CycleTrace::Scope trace_scope ("paint", [&] { return trace_name + "/" + layers[index].name; });
+		start_times[index] = TimeHelper::now();
+
+		try {
+			painting_times[index] = TimeHelper::measure ([&] { layers[index].paint (paint_requests[index]); });
+		}
+		catch (...)
+		{
+			exceptions[index] = std::current_exception();
+		}
+	}
+
+	if (remaining.fetch_sub (1, std::memory_order_acq_rel) == 1)
+		finish();
+}
+
+
+void
+LayerGroup::finish() noexcept
+{
+	for (auto const& exception: exceptions)
+	{
+		if (exception)
+		{
+			promise.set_exception (exception);
+			return;
+		}
+	}
+
+	auto const composition_time = TimeHelper::measure ([&] {
+		for (auto const* layer_canvas: layer_canvases)
+			blender.blend (*canvas, QPoint (0, 0), *layer_canvas);
+	});
+
+	auto const start_time = *std::min_element (start_times.begin(), start_times.end());
+	PaintPerformanceMetrics metrics {
+		start_time - request_time,
+		TimeHelper::now() - start_time,
+		{},
+	};
+
+	for (std::size_t i = 0; i < layers.size(); ++i)
+		metrics.layer_painting_times.emplace_back (layers[i].name, painting_times[i]);
+
+	metrics.layer_painting_times.emplace_back ("composition", composition_time);
+	promise.set_value (std::move (metrics));
+}
+
+
+
+PaintScheduler::PaintScheduler (si::Frequency const screen_refresh_rate):
+	_screen_refresh_rate (screen_refresh_rate),
+	_frame_time (1 / screen_refresh_rate)
+{ }
+
+
+bool
+PaintScheduler::is_due (InstrumentDetails const& details, si::Time const now) const
+{
+	if (!details.last_painting_start || !details.refresh_rate_limit)
+		return true;
+
+	// Allow for some jitter of the refresh timer:
+	return now - *details.last_painting_start >= (1.0 - kRefreshJitterTolerance) / *details.refresh_rate_limit;
+}
+
+
+/**
+ * Return true if there's a low priority instrument that can still be slowed down.
+ */
+static bool
+has_low_priority_above_minimum (std::span<InstrumentDetails* const> const instruments)
+{
+	for (auto const* details: instruments)
+	{
+		auto const& policy = details->instrument.refresh_policy();
+		auto const& limit = details->refresh_rate_limit;
+
+		if (policy.priority == Instrument::RefreshPriority::Low && (!limit || *limit > policy.min_rate))
+			return true;
+	}
+
+	return false;
+}
+
+
+void
+PaintScheduler::schedule (std::vector<InstrumentDetails*>& candidates, std::span<InstrumentDetails* const> const all_instruments, std::map<WorkPerformer const*, si::Time>& busy_time, si::Time const now) const
+{
+	using Priority = Instrument::RefreshPriority;
+
+	// Most important first; among equal priorities the ones waiting the longest:
+	std::stable_sort (candidates.begin(), candidates.end(), [](auto const* a, auto const* b) {
+		auto const pa = a->instrument.refresh_policy().priority;
+		auto const pb = b->instrument.refresh_policy().priority;
+
+		if (pa != pb)
+			return pa > pb;
+
+		return a->last_painting_start.value_or (0_s) < b->last_painting_start.value_or (0_s);
+	});
+
+	// Each WorkPerformer may be busy for a part of a frame:
+	auto const budget = kPaintingBudgetFactor * _frame_time;
+	bool overloaded = false;
+
+	std::size_t chosen = 0;
+
+	for (std::size_t i = 0; i < candidates.size(); ++i)
+	{
+		auto* details = candidates[i];
+		auto const& policy = details->instrument.refresh_policy();
+		auto& busy = busy_time[details->work_performer];
+
+		if (policy.priority == Priority::High || busy == 0_s || busy + details->expected_painting_time <= budget)
+		{
+			busy += details->expected_painting_time;
+			details->last_painting_start = now;
+			candidates[chosen++] = details;
+		}
+		else
+			overloaded = true;
+	}
+
+	candidates.resize (chosen);
+
+	// Adapt refresh rates: under load slow down low-priority instruments first, otherwise
+	// let all instruments go back towards their maximum rates:
+	for (auto* details: all_instruments)
+	{
+		auto const& policy = details->instrument.refresh_policy();
+		auto const max_rate = std::min (policy.max_rate.value_or (_screen_refresh_rate), _screen_refresh_rate);
+		auto const min_rate = std::min (policy.min_rate, max_rate);
+		auto rate = details->refresh_rate_limit.value_or (max_rate);
+
+		if (policy.priority == Priority::High)
+			rate = max_rate;
+		else if (overloaded && (policy.priority == Priority::Low || !has_low_priority_above_minimum (all_instruments)))
+			rate = std::max (min_rate, rate * kRateDecreaseFactor);
+		else if (!overloaded)
+			rate = std::min (max_rate, rate * kRateIncreaseFactor);
+
+		details->refresh_rate_limit = rate;
+	}
+}
+
 } // namespace detail
 
 
-static constexpr char		kLogoPath[]			= "share/images/xefis.svg";
-static constexpr si::Time	kLogoDisplayTime	= 2_s;
+/**
+ * Set given rect of a premultiplied ARGB image to transparent.
+ */
+static void
+clear_rect (QImage& image, QRect rect)
+{
+	rect &= image.rect();
+
+	if (rect.isEmpty())
+		return;
+
+	auto const bytes_per_line = image.bytesPerLine();
+	auto* const bits = image.bits();
+
+	for (int y = rect.top(); y <= rect.bottom(); ++y)
+		std::memset (bits + y * bytes_per_line + rect.left() * sizeof (QRgb), 0, rect.width() * sizeof (QRgb));
+}
+
+
+static constexpr char		kLogoPath[]				= "share/images/xefis.svg";
+static constexpr si::Time	kLogoDisplayTime		= 2_s;
+static constexpr double		kBoundingBoxPenWidth	= 2.0;
 
 
 Screen::Screen (ScreenSpec const& spec, Graphics const& graphics, Machine& machine, std::string_view const& instance, Logger const& logger):
 	QWidget (nullptr),
 	NamedInstance (instance),
 	_machine (machine),
+	_graphics (graphics),
+	_canvas_pool (CanvasPool::shared()),
 	_logger (logger.with_scope ("<screen>")),
 	_instrument_tracker ([&](InstrumentTracker::Disclosure& disclosure) { instrument_registered (disclosure); },
 						 [&](InstrumentTracker::Disclosure& disclosure) { instrument_deregistered (disclosure); }),
 	_screen_spec (spec),
-	_frame_time (1 / spec.refresh_rate())
+	_frame_time (1 / spec.refresh_rate()),
+	_paint_scheduler (spec.refresh_rate())
 {
 	QRect rect = _screen_spec.position_and_size();
 
@@ -84,6 +303,7 @@ Screen::Screen (ScreenSpec const& spec, Graphics const& graphics, Machine& machi
 	setCursor (QCursor (Qt::CrossCursor));
 	setMouseTracking (true);
 	setAttribute (Qt::WA_TransparentForMouseEvents);
+	prewarm_glyph_atlas();
 
 	_hide_logo_timer = new QTimer (this);
 	_hide_logo_timer->setSingleShot (true);
@@ -149,10 +369,39 @@ Screen::set_z_index (Instrument const& instrument, int const new_z_index)
 }
 
 
+void
+Screen::set_layer_work_performers (Instrument const& instrument, std::vector<WorkPerformer*> work_performers)
+{
+	for (auto& disclosure: _instrument_tracker)
+	{
+		if (&disclosure.value() == &instrument)
+		{
+			disclosure.details().layer_work_performers = std::move (work_performers);
+			break;
+		}
+	}
+}
+
+
 void
 Screen::set_paint_bounding_boxes (bool enable)
 {
 	_paint_bounding_boxes = enable;
+	_compositor.invalidate();
+}
+
+
+void
+Screen::prewarm_glyph_atlas()
+{
+	// Font sizes depend only on pixel density and base font height, so screen size is as good as any:
+	PaintRequest::Metric const metric (_screen_spec.position_and_size().size(), _screen_spec.pixel_density(), _screen_spec.base_pen_width(), _screen_spec.base_font_height());
+	auto const stats_before = GlyphAtlas::shared().statistics();
+
+	InstrumentAids (metric, _graphics).prewarm_glyph_atlas (GlyphAtlas::shared());
+
+	auto const stats = GlyphAtlas::shared().statistics();
+	_logger << boost::format ("Prewarmed glyph atlas: %1% glyphs rendered, %2% pages, %3% KiB\n") % (stats.renders - stats_before.renders) % stats.pages % (stats.memory_usage / 1024);
 }
 
 
@@ -209,6 +458,7 @@ Screen::update_canvas (QSize size)
 	{
 		_canvas = allocate_image (size);
 		_canvas.fill (Qt::black);
+		_compositor.invalidate();
 
 		for (auto& disclosure: _instrument_tracker)
 			disclosure.details().computed_position.reset();
@@ -238,16 +488,27 @@ void
 Screen::update_instruments()
 {
 	QSize const canvas_size = _canvas.size();
+	auto const now = TimeHelper::now();
+	// Time of painting jobs that are still running on each WorkPerformer:
+	std::map<WorkPerformer const*, si::Time> busy_time;
+	std::vector<detail::InstrumentDetails*> all_instruments;
+	std::vector<detail::InstrumentDetails*> candidates;
+
+	all_instruments.reserve (_z_index_sorted_disclosures.size());
 
-	// Ask instruments to paint themselves:
+	// Collect results of finished paintings and find instruments that are due to be repainted:
 	for (auto* disclosure: _z_index_sorted_disclosures)
 	{
 		auto& instrument = disclosure->value();
 		auto& details = disclosure->details();
 
+		all_instruments.push_back (&details);
+
 		if (!details.computed_position)
 			details.compute_position (canvas_size);
 
+		busy_time.try_emplace (details.work_performer, 0_s);
+
 		if (details.computed_position->isValid())
 		{
 			if (details.result.valid() && is_ready (details.result))
@@ -259,51 +520,162 @@ Screen::update_instruments()
 						auto accounting_api = Instrument::AccountingAPI (instrument);
 						accounting_api.set_frame_time (_frame_time);
 						accounting_api.add_painting_time (perf_metrics.painting_time);
+
+						for (auto const& [layer_name, layer_painting_time]: perf_metrics.layer_painting_times)
+							accounting_api.add_layer_painting_time (layer_name, layer_painting_time);
 					}
 					// Update per-WorkPerformer metrics:
 					_work_performer_metrics[details.work_performer].start_latencies.push_back (perf_metrics.start_latency);
 					_work_performer_metrics[details.work_performer].total_latencies.push_back (perf_metrics.start_latency + perf_metrics.painting_time);
+					// Update scheduling data:
+					details.expected_painting_time = details.expected_painting_time == 0_s
+						? perf_metrics.painting_time
+						: (1.0 - kPaintingTimeSmoothing) * details.expected_painting_time + kPaintingTimeSmoothing * perf_metrics.painting_time;
 				});
 
 				std::swap (details.canvas, details.canvas_to_use);
+				std::swap (details.canvas_painted_rect, details.canvas_to_use_painted_rect);
+				details.canvas_swapped = true;
+				++details.painted_frames;
 			}
 
-			// Start new painting job:
-			if (!details.result.valid() && instrument.dirty_since_last_check())
-			{
-				prepare_canvas_for_instrument (details.canvas, details.computed_position->size());
+			if (details.result.valid())
+				busy_time[details.work_performer] += details.expected_painting_time;
+			else if (instrument.dirty() && _paint_scheduler.is_due (details, now))
+				candidates.push_back (&details);
+		}
+		else
+			std::clog << "Instrument " << identifier (instrument) << " has invalid size/position." << std::endl;
+	}
 
-				PaintRequest::Metric metric (details.computed_position->size(), _screen_spec.pixel_density(), _screen_spec.base_pen_width(), _screen_spec.base_font_height());
-				PaintRequest paint_request (*details.canvas, metric, details.previous_size);
+	_paint_scheduler.schedule (candidates, all_instruments, busy_time, now);
 
-				details.previous_size = details.computed_position->size();
+	for (auto* details: candidates)
+	{
+		details->instrument.dirty_since_last_check();
+		start_painting (*details);
+	}
 
-				auto task = instrument.paint (std::move (paint_request));
-				auto request_time = TimeHelper::now();
-				auto measured_task = [t = std::move (task), request_time]() mutable noexcept {
-					auto const start_time = TimeHelper::now();
-					auto const painting_time = TimeHelper::measure (t);
+	update_achieved_refresh_rates (now);
+}
 
-					return detail::PaintPerformanceMetrics {
-						start_time - request_time,
-						painting_time,
-					};
-				};
 
-				details.result = details.work_performer->submit (std::move (measured_task));
-			}
-		}
-		else
-			std::clog << "Instrument " << identifier (instrument) << " has invalid size/position." << std::endl;
+void
+Screen::start_painting (detail::InstrumentDetails& details)
+{
+	auto& instrument = details.instrument;
+
+	auto const canvas_clearing = instrument.canvas_clearing();
+
+	prepare_canvas_for_instrument (details.canvas, details.computed_position->size(), canvas_clearing, details.canvas_painted_rect);
+
+	// Start collecting the region painted in this frame:
+	if (canvas_clearing == Instrument::CanvasClearing::PaintedRegion)
+		details.canvas_painted_rect = QRect();
+	else
+		details.canvas_painted_rect.reset();
+
+	QRect* const painted_rect = details.canvas_painted_rect ? &*details.canvas_painted_rect : nullptr;
+	PaintRequest::Metric metric (details.computed_position->size(), _screen_spec.pixel_density(), _screen_spec.base_pen_width(), _screen_spec.base_font_height());
+	PaintRequest paint_request (*details.canvas, metric, details.previous_size, painted_rect);
+
+	std::vector<Instrument::PaintLayer> layers;
+
+	if (!details.layer_work_performers.empty())
+		layers = instrument.paint_layers (paint_request);
+
+	if (!layers.empty())
+	{
+		// Painted region is not tracked for layers, the whole canvas will be cleared next time:
+		details.canvas_painted_rect.reset();
+		details.result = submit_layers (details, metric, std::move (layers));
 	}
+	else
+	{
+		auto task = instrument.paint (std::move (paint_request));
+		auto request_time = TimeHelper::now();
+		auto trace_name = CycleTrace::enabled() ? identifier (instrument) : std::string();
+		auto measured_task = [t = std::move (task), request_time, trace_name = std::move (trace_name)]() mutable noexcept {
+			CycleTrace::Scope trace_scope ("paint", [&] { return std::move (trace_name); });
+			auto const start_time = TimeHelper::now();
+			auto const painting_time = TimeHelper::measure (t);
+
+			return detail::PaintPerformanceMetrics {
+				start_time - request_time,
+				painting_time,
+				{},
+			};
+		};
+
+		details.result = details.work_performer->submit (std::move (measured_task));
+	}
+
+	details.previous_size = details.computed_position->size();
 }
 
 
 void
+Screen::update_achieved_refresh_rates (si::Time const now)
+{
+	if (!_achieved_rate_window_start)
+		_achieved_rate_window_start = now;
+	else if (auto const elapsed = now - *_achieved_rate_window_start; elapsed >= kAchievedRateWindow)
+	{
+		for (auto* disclosure: _z_index_sorted_disclosures)
+		{
+			auto& details = disclosure->details();
+			Instrument::AccountingAPI (disclosure->value()).set_achieved_refresh_rate (static_cast<double> (details.painted_frames) / elapsed);
+			details.painted_frames = 0;
+		}
+
+		_achieved_rate_window_start = now;
+	}
+}
+
+
+std::future<detail::PaintPerformanceMetrics>
+Screen::submit_layers (detail::InstrumentDetails& details, PaintRequest::Metric const& metric, std::vector<Instrument::PaintLayer> layers)
+{
+	auto const n = layers.size();
+	auto group = std::make_shared<detail::LayerGroup>();
+
+	details.layer_canvases.resize (std::max (details.layer_canvases.size(), n));
+	group->paint_requests.reserve (n);
+
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		auto& layer_canvas = details.layer_canvases[i];
+		prepare_canvas_for_instrument (layer_canvas, metric.canvas_size());
+		group->paint_requests.emplace_back (*layer_canvas, metric, details.previous_size);
+		group->layer_canvases.push_back (layer_canvas.get());
+	}
+
+	group->layers = std::move (layers);
+	group->canvas = details.canvas.get();
+	group->trace_name = CycleTrace::enabled() ? identifier (details.instrument) : std::string();
+	group->request_time = TimeHelper::now();
+	group->start_times.resize (n);
+	group->painting_times.resize (n);
+	group->exceptions.resize (n);
+	group->remaining.store (n);
+
+	auto result = group->promise.get_future();
+
+	// Distribute layers round-robin, starting with the instrument's own WorkPerformer:
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		auto* work_performer = i == 0 ? details.work_performer : details.layer_work_performers[(i - 1) % details.layer_work_performers.size()];
+		work_performer->submit ([group, i]() noexcept { group->paint_layer (i); });
+	}
+
+	return result;
+}
+
+
+QRegion
 Screen::compose_instruments()
 {
-	_canvas.fill (Qt::black);
-	QPainter canvas_painter (&_canvas);
+	_layers.clear();
 
 	for (auto* disclosure: _z_index_sorted_disclosures)
 	{
@@ -311,21 +683,61 @@ Screen::compose_instruments()
 
 		if (details.computed_position && details.computed_position->isValid())
 		{
+			bool const moved = details.composed_position != details.computed_position;
+
+			// Old area needs to be cleared:
+			if (moved && details.composed_position)
+				damage_composed_position (*details.composed_position);
+
+			auto& layer = _layers.emplace_back();
+			layer.position = *details.computed_position;
+			layer.damaged = moved || details.canvas_swapped;
+
+			// Discard images that have different size than requested computed_position->size(), beacuse
+			// it means a resize happened during async painting of the instrument.
 			if (auto* painted_image = details.canvas_to_use.get())
-			{
-				// Discard images that have different size than requested computed_position->size(), beacuse
-				// it means a resize happened during async painting of the instrument.
 				if (details.computed_position->size() == painted_image->size())
-					canvas_painter.drawImage (*details.computed_position, *painted_image, QRect (QPoint (0, 0), details.computed_position->size()));
+					layer.image = painted_image;
 
-				if (_paint_bounding_boxes)
-				{
-					canvas_painter.setPen (QPen (QBrush (Qt::red), 2.0));
-					canvas_painter.drawRect (*details.computed_position);
-				}
-			}
+			details.canvas_swapped = false;
+			details.composed_position = details.computed_position;
+		}
+		else if (details.composed_position)
+		{
+			// Instrument is no longer visible, clear the area where it was:
+			damage_composed_position (*details.composed_position);
+			details.composed_position.reset();
 		}
 	}
+
+	auto const damage = _compositor.compose (_canvas, _layers);
+
+	if (_paint_bounding_boxes && !damage.isEmpty())
+	{
+		QPainter canvas_painter (&_canvas);
+		canvas_painter.setClipRegion (damage);
+		canvas_painter.setPen (QPen (QBrush (Qt::red), kBoundingBoxPenWidth));
+
+		for (auto const& layer: _layers)
+			if (layer.image)
+				canvas_painter.drawRect (layer.position);
+	}
+
+	return damage;
+}
+
+
+void
+Screen::damage_composed_position (QRect const& position)
+{
+	if (_paint_bounding_boxes)
+	{
+		// Bounding box line is centered on the position edges, so half of it lies outside:
+		int const margin = static_cast<int> (std::ceil (0.5 * kBoundingBoxPenWidth));
+		_compositor.damage (position.adjusted (-margin, -margin, +margin, +margin));
+	}
+	else
+		_compositor.damage (position);
 }
 
 
@@ -340,22 +752,58 @@ Screen::wait_for_async_paint (InstrumentTracker::Disclosure& disclosure)
 
 
 void
-Screen::prepare_canvas_for_instrument (std::unique_ptr<QImage>& canvas, QSize size)
+Screen::prepare_canvas_for_instrument (std::unique_ptr<QImage>& canvas, QSize size, Instrument::CanvasClearing clearing, std::optional<QRect> const& painted_rect)
 {
+	using Clearing = Instrument::CanvasClearing;
+
+	bool reused = true;
+
 	if (!canvas)
 		canvas = std::make_unique<QImage>();
 
 	if (canvas->isNull() || canvas->size() != size)
+	{
+		_canvas_pool.release (std::move (*canvas));
 		*canvas = allocate_image (size);
+		reused = false;
+	}
+
+	switch (clearing)
+	{
+		case Clearing::None:
+			break;
 
-	canvas->fill (Qt::transparent);
+		case Clearing::PaintedRegion:
+			// Content of a new image is unknown:
+			if (reused && painted_rect)
+			{
+				clear_rect (*canvas, *painted_rect);
+				break;
+			}
+			[[fallthrough]];
+
+		case Clearing::Full:
+			canvas->fill (Qt::transparent);
+			break;
+	}
+}
+
+
+void
+Screen::release_canvas (std::unique_ptr<QImage>& canvas)
+{
+	if (canvas)
+	{
+		_canvas_pool.release (std::move (*canvas));
+		canvas.reset();
+	}
 }
 
 
 QImage
 Screen::allocate_image (QSize size) const
 {
-	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+	QImage image = _canvas_pool.acquire (size, QImage::Format_ARGB32_Premultiplied);
 	int const dots_per_meter = _screen_spec.pixel_density().in<si::DotsPerMeter>();
 
 	image.setDotsPerMeterX (dots_per_meter);
@@ -377,6 +825,17 @@ void
 Screen::instrument_deregistered (InstrumentTracker::Disclosure& disclosure)
 {
 	wait_for_async_paint (disclosure);
+
+	auto& details = disclosure.details();
+	release_canvas (details.canvas);
+	release_canvas (details.canvas_to_use);
+
+	for (auto& layer_canvas: details.layer_canvases)
+		release_canvas (layer_canvas);
+
+	if (auto const& composed_position = details.composed_position)
+		damage_composed_position (*composed_position);
+
 	auto new_end = std::remove (_z_index_sorted_disclosures.begin(), _z_index_sorted_disclosures.end(), &disclosure);
 	_z_index_sorted_disclosures.resize (neutrino::to_unsigned (new_end - _z_index_sorted_disclosures.begin()));
 }
@@ -387,6 +846,7 @@ Screen::sort_by_z_index()
 {
 	std::stable_sort (_z_index_sorted_disclosures.begin(), _z_index_sorted_disclosures.end(),
 					  [](auto const* a, auto const* b) { return a->details().z_index < b->details().z_index; });
+	_compositor.invalidate();
 }
 
 
@@ -395,19 +855,34 @@ Screen::hide_logo()
 {
 	_displaying_logo = false;
 	_logo_image.reset();
+	_compositor.invalidate();
 }
 
 
 void
 Screen::refresh()
 {
-	update_instruments();
-	compose_instruments();
+	{
+		CycleTrace::Scope trace_scope ("screen", [&] { return instance() + " update instruments"; });
+		update_instruments();
+	}
+
+	QRegion damage;
+
+	{
+		CycleTrace::Scope trace_scope ("screen", [&] { return instance() + " compose"; });
+		damage = compose_instruments();
+	}
 
 	if (_displaying_logo)
+	{
 		paint_logo_to_buffer();
-
-	update();
+		// Logo is blended over the instruments, so next composition must start from scratch:
+		_compositor.invalidate();
+		update();
+	}
+	else if (!damage.isEmpty())
+		update (damage);
 }
 
 
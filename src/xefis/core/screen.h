@@ -16,9 +16,11 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/canvas_pool.h>
 #include <xefis/core/graphics.h>
 #include <xefis/core/instrument.h>
 #include <xefis/core/machine.h>
+#include <xefis/core/screen_compositor.h>
 #include <xefis/core/screen_spec.h>
 #include <xefis/utility/named_instance.h>
 
@@ -31,13 +33,19 @@
 // Qt:
 #include <QSize>
 #include <QImage>
+#include <QRegion>
 #include <QWidget>
 
 // Standard:
 #include <atomic>
 #include <cstddef>
+#include <future>
+#include <map>
 #include <optional>
+#include <span>
+#include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -52,6 +60,9 @@ class PaintPerformanceMetrics
   public:
 	si::Time	start_latency;
 	si::Time	painting_time;
+	// Set if instrument was painted in layers, in the layers' order:
+	std::vector<std::pair<std::string, si::Time>>
+				layer_painting_times;
 };
 
 
@@ -74,7 +85,28 @@ class InstrumentDetails
 	// since it's not known if std::swap() on QImages is fast or not.
 	std::unique_ptr<QImage>					canvas;
 	std::unique_ptr<QImage>					canvas_to_use;
+	// Regions painted on canvas and canvas_to_use in their last paintings, if tracked
+	// (see Instrument::CanvasClearing::PaintedRegion). Swapped together with canvases:
+	std::optional<QRect>					canvas_painted_rect;
+	std::optional<QRect>					canvas_to_use_painted_rect;
+	// Set when a new canvas_to_use was swapped in since the last composition:
+	bool									canvas_swapped	{ false };
+	// Position at which canvas_to_use was last composed onto the screen:
+	std::optional<QRect>					composed_position;
 	WorkPerformer*							work_performer;
+	// Additional WorkPerformers for painting layers of the instrument (see Instrument::paint_layers()).
+	// If empty, the instrument is painted as a whole with Instrument::paint():
+	std::vector<WorkPerformer*>				layer_work_performers;
+	// Buffers for the layers, reused between frames:
+	std::vector<std::unique_ptr<QImage>>	layer_canvases;
+	// Frame pacing (see Instrument::RefreshPolicy):
+	std::optional<si::Time>					last_painting_start;
+	// Current rate limit computed by the Screen, within the instrument's RefreshPolicy:
+	std::optional<si::Frequency>			refresh_rate_limit;
+	// Smoothed painting time, used to predict how long the next painting will take:
+	si::Time								expected_painting_time	{ 0_s };
+	// Number of frames painted since the start of current achieved-rate window:
+	std::size_t								painted_frames			{ 0 };
 
   public:
 	// Ctor
@@ -88,6 +120,53 @@ class InstrumentDetails
 	compute_position (QSize const canvas_size);
 };
 
+
+/**
+ * Decides which instruments get painted in a frame and adapts their refresh rate limits,
+ * according to their Instrument::RefreshPolicy and painting budget of WorkPerformers.
+ */
+class PaintScheduler
+{
+  public:
+	// Part of a frame time that a WorkPerformer may spend painting instruments:
+	static constexpr double		kPaintingBudgetFactor	= 0.8;
+	// Refresh rate adaptation factors:
+	static constexpr double		kRateDecreaseFactor		= 0.8;
+	static constexpr double		kRateIncreaseFactor		= 1.1;
+	// Accept refresh timer firing this much (relative to period) too early:
+	static constexpr double		kRefreshJitterTolerance	= 0.1;
+
+  public:
+	// Ctor
+	explicit
+	PaintScheduler (si::Frequency screen_refresh_rate);
+
+	/**
+	 * Return true if enough time has passed since last painting of the instrument,
+	 * according to its current refresh rate limit.
+	 */
+	[[nodiscard]]
+	bool
+	is_due (InstrumentDetails const&, si::Time now) const;
+
+	/**
+	 * Choose candidates to paint in order of priority as long as their WorkPerformers
+	 * have time left in the current frame, then adapt refresh rate limits of all instruments:
+	 * decrease them when some paintings had to be skipped, otherwise increase them back.
+	 * High priority instruments are always painted at full rate.
+	 *
+	 * Candidates that weren't chosen are removed from the vector; chosen ones are left in the order
+	 * in which they should be painted, with last_painting_start set to now and their expected painting
+	 * times added to busy_time.
+	 */
+	void
+	schedule (std::vector<InstrumentDetails*>& candidates, std::span<InstrumentDetails* const> all_instruments, std::map<WorkPerformer const*, si::Time>& busy_time, si::Time now) const;
+
+  private:
+	si::Frequency	_screen_refresh_rate;
+	si::Time		_frame_time;
+};
+
 } // namespace detail
 
 
@@ -123,6 +202,11 @@ class Screen:
   private:
 	using InstrumentTracker = Tracker<Instrument, detail::InstrumentDetails>;
 
+  public:
+	// Weight of the newest sample in the smoothed painting time:
+	static constexpr double		kPaintingTimeSmoothing	= 0.2;
+	static constexpr si::Time	kAchievedRateWindow		= 1_s;
+
   public:
 	// Ctor
 	explicit
@@ -157,6 +241,14 @@ class Screen:
 	void
 	set_z_index (Instrument const&, int z_index);
 
+	/**
+	 * Let the instrument be painted in parallel layers (see Instrument::paint_layers()).
+	 * Layers are distributed round-robin among the instrument's own WorkPerformer and the given ones.
+	 * Pass an empty vector to go back to painting the instrument as a whole.
+	 */
+	void
+	set_layer_work_performers (Instrument const&, std::vector<WorkPerformer*>);
+
 	/**
 	 * Enable/disable debug bounding boxes of instruments.
 	 */
@@ -210,6 +302,14 @@ class Screen:
 	void
 	update_canvas (QSize);
 
+	/**
+	 * Render glyphs commonly used by instruments on this screen into the shared GlyphAtlas,
+	 * to avoid slow first frames. Font sizes depend only on pixel density and base font height,
+	 * not on screen size, so it's done once, in the constructor.
+	 */
+	void
+	prewarm_glyph_atlas();
+
 	/**
 	 * Paint SVG logo.
 	 */
@@ -217,17 +317,46 @@ class Screen:
 	paint_logo_to_buffer();
 
 	/**
-	 * Request painting of all instruments on their own canvases.
+	 * Collect finished paintings and request painting of instruments that are dirty and due,
+	 * within the painting budget of their WorkPerformers.
 	 */
 	void
 	update_instruments();
 
 	/**
-	 * Paint all current instrument canvases onto the main screen canvas.
+	 * Submit painting of the instrument to its WorkPerformer(s).
 	 */
 	void
+	start_painting (detail::InstrumentDetails&);
+
+	/**
+	 * Periodically compute achieved refresh rates of instruments and pass them to instruments.
+	 */
+	void
+	update_achieved_refresh_rates (si::Time now);
+
+	/**
+	 * Submit layers of the instrument as a group of tasks. The last finished task composites
+	 * the layers onto the instrument canvas and fulfills the returned future.
+	 */
+	std::future<detail::PaintPerformanceMetrics>
+	submit_layers (detail::InstrumentDetails&, PaintRequest::Metric const&, std::vector<Instrument::PaintLayer>);
+
+	/**
+	 * Paint current instrument canvases onto the main screen canvas, recomposing only areas
+	 * of instruments that changed since last composition.
+	 * Return the region of the screen canvas that needs to be repainted.
+	 */
+	QRegion
 	compose_instruments();
 
+	/**
+	 * Damage area of the screen where an instrument was composed (and where its bounding box was
+	 * painted, if enabled), so that it gets recomposed after the instrument moved or disappeared.
+	 */
+	void
+	damage_composed_position (QRect const&);
+
 	/**
 	 * Wait for async paint to be done in an active loop.
 	 */
@@ -236,13 +365,21 @@ class Screen:
 
 	/**
 	 * Prepare canvas for an instrument.
-	 * Ensure it has requested size and set it to full alpha with color black.
+	 * Ensure it has requested size (taking images from the CanvasPool) and clear it according to the clearing mode.
+	 * If painted_rect is given, only that part of a reused canvas is cleared in CanvasClearing::PaintedRegion mode.
+	 */
+	void
+	prepare_canvas_for_instrument (std::unique_ptr<QImage>&, QSize, Instrument::CanvasClearing = Instrument::CanvasClearing::Full, std::optional<QRect> const& painted_rect = std::nullopt);
+
+	/**
+	 * Return image to the CanvasPool.
 	 */
 	void
-	prepare_canvas_for_instrument (std::unique_ptr<QImage>&, QSize);
+	release_canvas (std::unique_ptr<QImage>&);
 
 	/**
 	 * Create new image suitable for screen and instrument buffers.
+	 * Content of the image is undefined.
 	 */
 	QImage
 	allocate_image (QSize) const;
@@ -274,16 +411,23 @@ class Screen:
 
   private:
 	Machine&					_machine;
+	Graphics const&				_graphics;
+	CanvasPool&					_canvas_pool;
 	Logger						_logger;
 	InstrumentTracker			_instrument_tracker;
 	QTimer*						_hide_logo_timer;
 	QTimer*						_refresh_timer;
 	QImage						_canvas;
+	ScreenCompositor			_compositor;
+	std::vector<ScreenCompositor::Layer>
+								_layers;
 	std::optional<QImage>		_logo_image;
 	std::vector<InstrumentTracker::Disclosure*>
 								_z_index_sorted_disclosures;
 	ScreenSpec					_screen_spec;
 	si::Time const				_frame_time;
+	detail::PaintScheduler		_paint_scheduler;
+	std::optional<si::Time>		_achieved_rate_window_start;
 	bool						_displaying_logo		{ true };
 	bool						_paint_bounding_boxes	{ false };
 	std::unordered_map<WorkPerformer const*, WorkPerformerMetrics>
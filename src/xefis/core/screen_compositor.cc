@@ -0,0 +1,74 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "screen_compositor.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf {
+
+QRegion
+ScreenCompositor::compose (QImage& canvas, std::span<Layer const> layers)
+{
+	QRegion damage;
+
+	if (_full_damage || canvas.size() != _canvas_size)
+		damage = canvas.rect();
+	else
+	{
+		damage = _pending_damage;
+
+		for (auto const& layer: layers)
+			if (layer.damaged)
+				damage += layer.position;
+
+		damage &= canvas.rect();
+	}
+
+	_full_damage = false;
+	_canvas_size = canvas.size();
+	_pending_damage = QRegion();
+
+	if (damage.isEmpty())
+		return damage;
+
+	if (damage.rectCount() > kMaxDamageRects)
+		damage = damage.boundingRect();
+
+	for (auto const& rect: damage)
+		ArgbBlender::fill (canvas, rect, qRgb (0, 0, 0));
+
+	for (auto const& layer: layers)
+	{
+		if (layer.image && damage.intersects (layer.position))
+		{
+			// Blend only the damaged parts of the layer:
+			for (auto const& rect: damage)
+			{
+				if (auto const part = rect & layer.position; !part.isEmpty())
+					_blender.blend (canvas, part.topLeft(), *layer.image, part.translated (-layer.position.topLeft()));
+			}
+		}
+	}
+
+	return damage;
+}
+
+} // namespace xf
+
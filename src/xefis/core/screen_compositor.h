@@ -0,0 +1,100 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__SCREEN_COMPOSITOR_H__INCLUDED
+#define XEFIS__CORE__SCREEN_COMPOSITOR_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/argb_blender.h>
+
+// Qt:
+#include <QImage>
+#include <QRect>
+#include <QRegion>
+
+// Standard:
+#include <cstddef>
+#include <span>
+
+
+namespace xf {
+
+/**
+ * Composes instrument images onto the screen canvas, re-blending only damaged areas.
+ *
+ * A layer is damaged when its image changed or it moved since the last composition. Damaged areas
+ * are cleared and all layers intersecting them are blended again in z-order, so overlapping instruments
+ * stay correct. Areas that need to be recomposed for other reasons (eg. an instrument was removed) can be
+ * added with damage(); invalidate() forces recomposition of the whole canvas.
+ *
+ * Canvas and layer images must be in QImage::Format_ARGB32_Premultiplied format;
+ * blending is done by ArgbBlender.
+ */
+class ScreenCompositor
+{
+  public:
+	// When damage gets too fragmented, it's cheaper to recompose its bounding rect:
+	static constexpr int kMaxDamageRects = 16;
+
+	class Layer
+	{
+	  public:
+		QRect			position;
+		// May be nullptr if there's nothing to paint (area will be cleared):
+		QImage const*	image		{ nullptr };
+		bool			damaged		{ false };
+	};
+
+  public:
+	/**
+	 * Recompose whole canvas on next compose().
+	 */
+	void
+	invalidate() noexcept
+		{ _full_damage = true; }
+
+	/**
+	 * Recompose given area on next compose().
+	 */
+	void
+	damage (QRect const& rect)
+		{ _pending_damage += rect; }
+
+	/**
+	 * Compose damaged areas of layers onto the canvas.
+	 * Layers must be sorted by z-index, bottom-most first.
+	 * Return region of the canvas that has been modified; empty if nothing changed.
+	 */
+	QRegion
+	compose (QImage& canvas, std::span<Layer const> layers);
+
+	/**
+	 * Return blender used for composition.
+	 */
+	[[nodiscard]]
+	ArgbBlender const&
+	blender() const noexcept
+		{ return _blender; }
+
+  private:
+	ArgbBlender	_blender;
+	bool		_full_damage	{ true };
+	QSize		_canvas_size;
+	QRegion		_pending_damage;
+};
+
+} // namespace xf
+
+#endif
+
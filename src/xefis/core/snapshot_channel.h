@@ -0,0 +1,265 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__SNAPSHOT_CHANNEL_H__INCLUDED
+#define XEFIS__CORE__SNAPSHOT_CHANNEL_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+
+namespace xf {
+
+/**
+ * Lock-free channel that passes consistent snapshots of a value (usually a block of instrument parameters)
+ * from a single writer (a module's process()) to any number of concurrent readers (paint jobs).
+ *
+ * Values live in a fixed set of slots. The writer fills a slot that is neither current nor held by any reader
+ * and then publishes it as current. A reader pins the current slot with a reference counter and reads it in place
+ * for as long as it holds the Snapshot, so neither side copies the value or takes a mutex.
+ *
+ * If all non-current slots are held by readers, publish() gives up and returns false; the writer is never blocked.
+ * With the default number of slots this may only happen with more than Slots - 2 readers holding snapshots at once.
+ *
+ * Only one thread may publish at a time.
+ */
+template<class pValue, std::size_t pSlots = 8>
+	class SnapshotChannel: private Noncopyable
+	{
+		static_assert (pSlots >= 3, "SnapshotChannel needs at least 3 slots");
+
+	  public:
+		using Value = pValue;
+
+		static constexpr std::size_t kSlots = pSlots;
+
+	  private:
+		struct alignas (64) Slot
+		{
+			std::atomic<uint32_t>	readers	{ 0 };
+			Value					value	{ };
+		};
+
+	  public:
+		/**
+		 * RAII read handle. Keeps the slot pinned (not reused by the writer) until destroyed.
+		 */
+		class Snapshot
+		{
+			friend class SnapshotChannel;
+
+		  public:
+			// Ctor
+			Snapshot (Snapshot&&) noexcept;
+
+			// Dtor
+			~Snapshot();
+
+			Snapshot&
+			operator= (Snapshot&&) noexcept;
+
+			Value const&
+			operator*() const noexcept
+				{ return _slot->value; }
+
+			Value const*
+			operator->() const noexcept
+				{ return &_slot->value; }
+
+		  private:
+			// Ctor
+			explicit
+			Snapshot (Slot&) noexcept;
+
+		  private:
+			Slot*	_slot;
+		};
+
+	  public:
+		// Ctor
+		explicit
+		SnapshotChannel (Value const& initial_value = {});
+
+		/**
+		 * Publish new value by copy-assigning it into a free slot.
+		 * Copy-assignment reuses memory already held by the slot (eg. vector or string capacity).
+		 *
+		 * \returns	false if no free slot was available and the value was not published.
+		 */
+		bool
+		publish (Value const&);
+
+		/**
+		 * Publish new value by letting the callback update a free slot in place.
+		 * The slot contains some previously published value, not necessarily the most recent one.
+		 *
+		 * \returns	false if no free slot was available and the value was not published.
+		 */
+		template<class Updater>
+			bool
+			publish_with (Updater&&);
+
+		/**
+		 * Return snapshot of the most recently published value.
+		 * Lock-free, safe to call from any number of threads.
+		 */
+		[[nodiscard]]
+		Snapshot
+		read() const noexcept;
+
+		/**
+		 * Return number of publish() calls that failed because all slots were busy.
+		 */
+		[[nodiscard]]
+		std::size_t
+		failed_publishes() const noexcept
+			{ return _failed_publishes.load (std::memory_order_relaxed); }
+
+	  private:
+		/**
+		 * Return a slot that is neither current nor pinned by any reader, or nullptr.
+		 */
+		Slot*
+		find_free_slot() noexcept;
+
+	  private:
+		std::array<Slot, kSlots> mutable	_slots;
+		std::atomic<Slot*>					_current;
+		std::atomic<std::size_t>			_failed_publishes	{ 0 };
+	};
+
+
+template<class V, std::size_t S>
+	inline
+	SnapshotChannel<V, S>::Snapshot::Snapshot (Slot& slot) noexcept:
+		_slot (&slot)
+	{ }
+
+
+template<class V, std::size_t S>
+	inline
+	SnapshotChannel<V, S>::Snapshot::Snapshot (Snapshot&& other) noexcept:
+		_slot (std::exchange (other._slot, nullptr))
+	{ }
+
+
+template<class V, std::size_t S>
+	inline
+	SnapshotChannel<V, S>::Snapshot::~Snapshot()
+	{
+		if (_slot)
+			_slot->readers.fetch_sub (1, std::memory_order_release);
+	}
+
+
+template<class V, std::size_t S>
+	inline auto
+	SnapshotChannel<V, S>::Snapshot::operator= (Snapshot&& other) noexcept -> Snapshot&
+	{
+		if (this != &other)
+		{
+			if (_slot)
+				_slot->readers.fetch_sub (1, std::memory_order_release);
+
+			_slot = std::exchange (other._slot, nullptr);
+		}
+
+		return *this;
+	}
+
+
+template<class V, std::size_t S>
+	inline
+	SnapshotChannel<V, S>::SnapshotChannel (Value const& initial_value)
+	{
+		_slots[0].value = initial_value;
+		_current.store (&_slots[0], std::memory_order_release);
+	}
+
+
+template<class V, std::size_t S>
+	inline bool
+	SnapshotChannel<V, S>::publish (Value const& value)
+	{
+		return publish_with ([&value] (Value& slot_value) {
+			slot_value = value;
+		});
+	}
+
+
+template<class V, std::size_t S>
+	template<class Updater>
+		inline bool
+		SnapshotChannel<V, S>::publish_with (Updater&& updater)
+		{
+			if (auto* slot = find_free_slot())
+			{
+				updater (slot->value);
+				_current.store (slot, std::memory_order_seq_cst);
+				return true;
+			}
+			else
+			{
+				_failed_publishes.fetch_add (1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+
+template<class V, std::size_t S>
+	inline auto
+	SnapshotChannel<V, S>::read() const noexcept -> Snapshot
+	{
+		while (true)
+		{
+			auto* slot = _current.load (std::memory_order_seq_cst);
+			slot->readers.fetch_add (1, std::memory_order_seq_cst);
+
+			// The writer only writes to slots that are not current. If the slot is still current after pinning it,
+			// the writer will see it pinned and won't reuse it until the Snapshot is released:
+			if (_current.load (std::memory_order_seq_cst) == slot)
+				return Snapshot (*slot);
+
+			slot->readers.fetch_sub (1, std::memory_order_release);
+		}
+	}
+
+
+template<class V, std::size_t S>
+	inline auto
+	SnapshotChannel<V, S>::find_free_slot() noexcept -> Slot*
+	{
+		auto* const current = _current.load (std::memory_order_relaxed);
+
+		for (auto& slot: _slots)
+			if (&slot != current && slot.readers.load (std::memory_order_seq_cst) == 0)
+				return &slot;
+
+		return nullptr;
+	}
+
+} // namespace xf
+
+#endif
+
@@ -16,8 +16,10 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
 #include <xefis/core/cycle.h>
 #include <xefis/core/sockets/common.h>
+#include <xefis/core/sockets/fetch_plan.h>
 #include <xefis/core/sockets/socket_converter.h>
 
 // Neutrino:
@@ -28,6 +30,7 @@
 #include <neutrino/utility.h>
 
 // Standard:
+#include <span>
 #include <variant>
 
 
@@ -36,9 +39,8 @@ namespace xf {
 /**
  * A value holder.
  *
- * TODO Note: perhaps the *_age() methods should not use the timestamp of the set() call, but some timestamp provided from
- * outside, eg. some souce data sampling timestamp. That would be more proper from digital signal processing
- * perspective, but I guess it's OK enough as it is now.
+ * Modification timestamps are taken from SocketClock, so they're either the time of the set() call, the time
+ * of the current processing cycle or a data sampling timestamp provided by the module that sets the value.
  */
 class BasicSocket:
 	private Noncopyable,
@@ -50,6 +52,8 @@ class BasicSocket:
 	template<class Value, class AssignedValue>
 		friend class ConnectableSocket;
 
+	friend class FetchPlan;
+
   public:
 	// Used to tell if node value has changed:
 	typedef uint64_t Serial;
@@ -70,6 +74,32 @@ class BasicSocket:
 	void
 	fetch (Cycle const&);
 
+	/**
+	 * Mark the socket as already fetched in given cycle, so that subsequent fetch() calls
+	 * within the same cycle do nothing. Used by schedulers that take care of processing
+	 * order by themselves.
+	 */
+	void
+	mark_fetched (Cycle const& cycle) noexcept
+		{ _fetched_cycle_number = cycle.number(); }
+
+	/**
+	 * Append steps needed to fetch this socket to the plan.
+	 * Default implementation adds a generic step that calls do_fetch().
+	 */
+	virtual void
+	compile_fetch (FetchPlan& plan)
+		{ plan.add_generic_step (*this); }
+
+	/**
+	 * Return socket used as a data source for this socket or nullptr if there's no such socket
+	 * (eg. the socket is not connected, uses a constant value or gets its value from its Module).
+	 */
+	[[nodiscard]]
+	virtual BasicSocket*
+	data_source_socket() const noexcept
+		{ return nullptr; }
+
 	/**
 	 * Set no data source for this socket.
 	 */
@@ -129,7 +159,7 @@ class BasicSocket:
 	[[nodiscard]]
 	si::Time
 	modification_age() const noexcept
-		{ return TimeHelper::now() - modification_timestamp(); }
+		{ return Clock::now() - modification_timestamp(); }
 
 	/**
 	 * Return timestamp of the last non-nil value.
@@ -146,7 +176,7 @@ class BasicSocket:
 	[[nodiscard]]
 	si::Time
 	valid_age() const noexcept
-		{ return TimeHelper::now() - valid_timestamp(); }
+		{ return Clock::now() - valid_timestamp(); }
 
 	/**
 	 * Use-count for this socket.
@@ -194,6 +224,23 @@ class BasicSocket:
 	virtual Blob
 	to_blob() const = 0;
 
+	/**
+	 * Serializes socket's value, including nil-flag, into the provided buffer without allocating memory.
+	 * Return number of bytes written.
+	 *
+	 * \throw	InvalidBlobSize
+	 *			When buffer is smaller than blob_size().
+	 */
+	virtual size_t
+	to_blob (std::span<uint8_t>) const = 0;
+
+	/**
+	 * Return size of the Blob for the current value.
+	 */
+	[[nodiscard]]
+	virtual size_t
+	blob_size() const = 0;
+
 	/**
 	 * True if currently held nil value was caused by exception
 	 * thrown by source socket when fetching data from it.
@@ -230,6 +277,17 @@ class BasicSocket:
 	virtual void
 	protected_set_nil() = 0;
 
+	/**
+	 * Make outdated the FetchPlan this socket has been compiled into, if any.
+	 * Must be called whenever the socket's source changes.
+	 */
+	void
+	invalidate_fetch_plan() noexcept
+	{
+		if (_fetch_plan_generation)
+			FetchPlan::invalidate (*_fetch_plan_generation);
+	}
+
 	/**
 	 * Set the nil-by-fetch-exception flag.
 	 */
@@ -244,6 +302,9 @@ class BasicSocket:
 	Cycle::Number				_fetched_cycle_number	= 0;
 	std::vector<BasicSocket*>	_targets;
 	bool						_nil_by_fetch_exception = false;
+	// Generation counter of the plan that this socket has been compiled into:
+	FetchPlan::GenerationCounter*
+								_fetch_plan_generation	= nullptr;
 };
 
 
@@ -17,6 +17,7 @@
 // Xefis:
 #include <xefis/config/all.h>
 #include <xefis/core/sockets/constant_source.h>
+#include <xefis/core/sockets/fetch_plan.h>
 #include <xefis/core/sockets/socket.h>
 
 // Standard:
@@ -34,7 +35,9 @@ template<class pObservedValue, class pAssignedValue = pObservedValue>
 	  public:
 		using ObservedValue = pObservedValue;
 		using AssignedValue = pAssignedValue;
-		// Functions that transform assigned value before it's actually assigned:
+		// Functions that transform assigned value before it's actually assigned. They stay std::functions,
+		// since that's what the public operator<<() overloads accept and user lambdas are erased there
+		// anyway; compiled FetchPlan steps only skip the variant dispatch, not this indirect call:
 		using Transformer1 = std::function<ObservedValue (AssignedValue)>;
 		using Transformer2 = std::function<ObservedValue (std::optional<AssignedValue>)>;
 		using Transformer3 = std::function<std::optional<ObservedValue> (AssignedValue)>;
@@ -66,6 +69,15 @@ template<class pObservedValue, class pAssignedValue = pObservedValue>
 		// Dtor
 		~ConnectableSocket();
 
+		// BasicSocket API
+		void
+		compile_fetch (FetchPlan&) override;
+
+		// BasicSocket API
+		[[nodiscard]]
+		BasicSocket*
+		data_source_socket() const noexcept override;
+
 		// BasicSocket API
 		void
 		operator<< (NoDataSource) override;
@@ -159,6 +171,37 @@ template<class pObservedValue, class pAssignedValue = pObservedValue>
 		void
 		fetch_from_socket (Socket<AssignedValue>&, Cycle const&);
 
+		/**
+		 * Add a FetchPlan step that fetches data from given socket.
+		 */
+		void
+		compile_fetch_from_socket (FetchPlan&, Socket<AssignedValue>&);
+
+		/**
+		 * Store value fetched from the source socket.
+		 */
+		void
+		set_fetched (std::optional<ObservedValue> const& transformed_value, std::optional<AssignedValue> const& source_value, Socket<AssignedValue> const& source);
+
+		/**
+		 * FetchPlan step for sockets without data source.
+		 */
+		static void
+		nil_step (void* target, void* source, void const* transformer, Cycle const&);
+
+		/**
+		 * FetchPlan step for sockets connected to another socket without a transformer.
+		 */
+		static void
+		copy_step (void* target, void* source, void const* transformer, Cycle const&);
+
+		/**
+		 * FetchPlan step for sockets connected to another socket through a transformer.
+		 */
+		template<class SpecificTransformer>
+			static void
+			transform_step (void* target, void* source, void const* transformer, Cycle const&);
+
 	  private:
 		SourceVariant				_source;
 		std::optional<Transformer>	_transformer;
@@ -189,6 +232,41 @@ template<class OV, class AV>
 	}
 
 
+template<class OV, class AV>
+	inline void
+	ConnectableSocket<OV, AV>::compile_fetch (FetchPlan& plan)
+	{
+		std::visit (overload {
+			[&] (std::monostate) {
+				plan.add_step (*this, &nil_step, this);
+			},
+			[&] (ConstantSource<AssignedValue>&) {
+				plan.add_generic_step (*this);
+			},
+			[&] (Socket<AssignedValue>* socket) {
+				compile_fetch_from_socket (plan, *socket);
+			},
+			[&] (std::unique_ptr<Socket<AssignedValue>>& socket) {
+				socket->compile_fetch (plan);
+				compile_fetch_from_socket (plan, *socket);
+			}
+		}, _source);
+	}
+
+
+template<class OV, class AV>
+	inline BasicSocket*
+	ConnectableSocket<OV, AV>::data_source_socket() const noexcept
+	{
+		if (auto const* socket = std::get_if<Socket<AssignedValue>*> (&_source))
+			return *socket;
+		else if (auto const* owned_socket = std::get_if<std::unique_ptr<Socket<AssignedValue>>> (&_source))
+			return owned_socket->get();
+		else
+			return nullptr;
+	}
+
+
 template<class OV, class AV>
 	inline void
 	ConnectableSocket<OV, AV>::operator<< (NoDataSource const)
@@ -363,6 +441,8 @@ template<class OV, class AV>
 	inline void
 	ConnectableSocket<OV, AV>::inc_source_use_count()
 	{
+		this->invalidate_fetch_plan();
+
 		std::visit (overload {
 			[&] (std::monostate) noexcept {
 				// No action
@@ -384,6 +464,8 @@ template<class OV, class AV>
 	inline void
 	ConnectableSocket<OV, AV>::dec_source_use_count()
 	{
+		this->invalidate_fetch_plan();
+
 		std::visit (overload {
 			[&] (std::monostate) noexcept {
 				// No action
@@ -408,16 +490,93 @@ template<class OV, class AV>
 		socket.fetch (cycle);
 
 		auto const source_value = socket.get_optional();
-		auto const transformed_value = transform (source_value);
+		set_fetched (transform (source_value), source_value, socket);
+	}
 
+
+template<class OV, class AV>
+	inline void
+	ConnectableSocket<OV, AV>::compile_fetch_from_socket (FetchPlan& plan, Socket<AssignedValue>& socket)
+	{
+		if (_transformer)
+		{
+			std::visit ([&] (auto const& transformer) {
+				using SpecificTransformer = std::remove_cvref_t<decltype (transformer)>;
+				plan.add_step (*this, &transform_step<SpecificTransformer>, this, &socket, &transformer);
+			}, *_transformer);
+		}
+		else if constexpr (std::is_same_v<OV, AV>)
+			plan.add_step (*this, &copy_step, this, &socket);
+		else
+			plan.add_generic_step (*this);
+	}
+
+
+template<class OV, class AV>
+	inline void
+	ConnectableSocket<OV, AV>::set_fetched (std::optional<ObservedValue> const& transformed_value,
+											std::optional<AssignedValue> const& source_value,
+											Socket<AssignedValue> const& source)
+	{
 		this->protected_set (transformed_value);
 
 		// If both before and after transformation results are nil, then also
 		// propagate the nil-by-exception flag:
 		if (!source_value && !transformed_value)
-			this->set_nil_by_fetch_exception (socket.nil_by_fetch_exception());
+			this->set_nil_by_fetch_exception (source.nil_by_fetch_exception());
+	}
+
+
+template<class OV, class AV>
+	inline void
+	ConnectableSocket<OV, AV>::nil_step (void* target, void*, void const*, Cycle const&)
+	{
+		static_cast<ConnectableSocket*> (target)->protected_set_nil();
 	}
 
+
+template<class OV, class AV>
+	inline void
+	ConnectableSocket<OV, AV>::copy_step (void* target, void* source, void const*, Cycle const& cycle)
+	{
+		if constexpr (std::is_same_v<OV, AV>)
+		{
+			auto& self = *static_cast<ConnectableSocket*> (target);
+			auto& socket = *static_cast<Socket<AssignedValue>*> (source);
+
+			socket.fetch (cycle);
+
+			auto const source_value = socket.get_optional();
+			self.set_fetched (source_value, source_value, socket);
+		}
+	}
+
+
+template<class OV, class AV>
+	template<class SpecificTransformer>
+		inline void
+		ConnectableSocket<OV, AV>::transform_step (void* target, void* source, void const* transformer, Cycle const& cycle)
+		{
+			auto& self = *static_cast<ConnectableSocket*> (target);
+			auto& socket = *static_cast<Socket<AssignedValue>*> (source);
+			auto const& function = *static_cast<SpecificTransformer const*> (transformer);
+
+			socket.fetch (cycle);
+
+			auto const source_value = socket.get_optional();
+			std::optional<ObservedValue> transformed_value;
+
+			if constexpr (std::is_same_v<SpecificTransformer, Transformer1> || std::is_same_v<SpecificTransformer, Transformer3>)
+			{
+				if (source_value)
+					transformed_value = function (*source_value);
+			}
+			else
+				transformed_value = function (source_value);
+
+			self.set_fetched (transformed_value, source_value, socket);
+		}
+
 } // namespace xf
 
 #endif
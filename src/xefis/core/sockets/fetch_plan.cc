@@ -0,0 +1,86 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "fetch_plan.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/sockets/basic_socket.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf {
+
+FetchPlan::FetchPlan (GenerationCounter& generation_counter):
+	_generation_counter (generation_counter),
+	_generation (generation_counter.load (std::memory_order_relaxed))
+{ }
+
+
+void
+FetchPlan::add_step (BasicSocket& socket, StepFunction function, void* target, void* source, void const* transformer)
+{
+	socket._fetch_plan_generation = &_generation_counter;
+	_steps.push_back (Step { &socket, function, target, source, transformer });
+}
+
+
+void
+FetchPlan::add_generic_step (BasicSocket& socket)
+{
+	add_step (socket, &FetchPlan::generic_step, &socket);
+}
+
+
+void
+FetchPlan::execute (Cycle const& cycle)
+{
+	auto const cycle_number = cycle.number();
+	std::size_t i = 0;
+
+	while (i < _steps.size())
+	{
+		try {
+			for (; i < _steps.size(); ++i)
+			{
+				auto const& step = _steps[i];
+
+				if (step.socket->_fetched_cycle_number < cycle_number)
+				{
+					step.socket->_fetched_cycle_number = cycle_number;
+					step.socket->set_nil_by_fetch_exception (false);
+					step.function (step.target, step.source, step.transformer, cycle);
+				}
+			}
+		}
+		catch (...)
+		{
+			// Redo the failed step with per-socket exception handling:
+			_steps[i].socket->do_fetch (cycle);
+			++i;
+		}
+	}
+}
+
+
+void
+FetchPlan::generic_step (void* target, void*, void const*, Cycle const& cycle)
+{
+	static_cast<BasicSocket*> (target)->do_fetch (cycle);
+}
+
+} // namespace xf
+
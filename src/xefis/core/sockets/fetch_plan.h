@@ -0,0 +1,134 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__SOCKETS__FETCH_PLAN_H__INCLUDED
+#define XEFIS__CORE__SOCKETS__FETCH_PLAN_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace xf {
+
+class BasicSocket;
+
+
+/**
+ * A flattened list of steps needed to fetch a set of sockets (usually all input sockets of a module),
+ * created once by BasicSocket::compile_fetch() instead of walking socket chains on every fetch.
+ *
+ * Each step is a plain function pointer specialized for the socket type, its source kind and its
+ * transformer kind, so no std::visit is done at fetch time. Steps of owned source sockets (eg. transformers
+ * in chains) come before steps of sockets that use them.
+ *
+ * Exceptions are caught once for the whole plan. If a step throws, it's redone with the regular
+ * BasicSocket::do_fetch() that handles exceptions per socket (logs them and sets nil-by-fetch-exception flag),
+ * and execution continues with the next step.
+ *
+ * Each plan shares a generation counter with its owner (the Module). Sockets compiled into the plan keep
+ * a pointer to that counter and bump it when their connections change, which makes only that owner's plan
+ * outdated (see up_to_date()).
+ */
+class FetchPlan: private Noncopyable
+{
+  public:
+	using Generation		= uint64_t;
+	using GenerationCounter	= std::atomic<Generation>;
+
+	/**
+	 * Function that fetches data from source into target.
+	 * Pointers are passed as void* to avoid virtual-base casts at fetch time;
+	 * the function knows the actual types.
+	 */
+	using StepFunction = void (*) (void* target, void* source, void const* transformer, Cycle const&);
+
+	class Step
+	{
+	  public:
+		BasicSocket*	socket;
+		StepFunction	function;
+		void*			target;
+		void*			source;
+		void const*		transformer;
+	};
+
+  public:
+	// Ctor
+	explicit
+	FetchPlan (GenerationCounter&);
+
+	/**
+	 * Add new step. The socket will make this plan outdated when its connections change.
+	 */
+	void
+	add_step (BasicSocket&, StepFunction, void* target, void* source = nullptr, void const* transformer = nullptr);
+
+	/**
+	 * Add step that just calls BasicSocket::do_fetch() for sockets that can't be compiled.
+	 */
+	void
+	add_generic_step (BasicSocket&);
+
+	/**
+	 * Execute all steps.
+	 */
+	void
+	execute (Cycle const&);
+
+	/**
+	 * Return true if no connections of sockets in this plan changed since the plan was created.
+	 */
+	[[nodiscard]]
+	bool
+	up_to_date() const noexcept
+		{ return _generation == _generation_counter.load (std::memory_order_relaxed); }
+
+	/**
+	 * Return list of steps.
+	 */
+	[[nodiscard]]
+	std::vector<Step> const&
+	steps() const noexcept
+		{ return _steps; }
+
+	/**
+	 * Make plans using given counter outdated.
+	 */
+	static void
+	invalidate (GenerationCounter& generation_counter) noexcept
+		{ generation_counter.fetch_add (1, std::memory_order_relaxed); }
+
+  private:
+	static void
+	generic_step (void* target, void* source, void const* transformer, Cycle const&);
+
+  private:
+	GenerationCounter&	_generation_counter;
+	Generation			_generation;
+	std::vector<Step>	_steps;
+};
+
+} // namespace xf
+
+#endif
+
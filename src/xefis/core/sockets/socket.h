@@ -20,6 +20,7 @@
 #include <xefis/core/sockets/basic_socket.h>
 #include <xefis/core/sockets/common.h>
 #include <xefis/core/sockets/exception.h>
+#include <xefis/core/sockets/socket_clock.h>
 #include <xefis/core/sockets/socket_converter.h>
 
 // Neutrino:
@@ -30,6 +31,7 @@
 #include <neutrino/utility.h>
 
 // Standard:
+#include <span>
 #include <variant>
 
 
@@ -163,6 +165,15 @@ template<class pValue>
 		Blob
 		to_blob() const override;
 
+		// BasicSocket API
+		size_t
+		to_blob (std::span<uint8_t>) const override;
+
+		// BasicSocket API
+		[[nodiscard]]
+		size_t
+		blob_size() const override;
+
 	  protected:
 		// BasicSocket API
 		void
@@ -259,7 +270,7 @@ template<class V>
 	{
 		if (_fallback_value != fallback_value)
 		{
-			_modification_timestamp = TimeHelper::now();
+			_modification_timestamp = SocketClock::now();
 			_valid_timestamp = _modification_timestamp;
 			_fallback_value = fallback_value;
 			++_serial;
@@ -307,13 +318,32 @@ template<class V>
 	}
 
 
+template<class V>
+	inline size_t
+	Socket<V>::to_blob (std::span<uint8_t> buffer) const
+	{
+		return SocketTraits<Value>::to_blob (*this, buffer);
+	}
+
+
+template<class V>
+	inline size_t
+	Socket<V>::blob_size() const
+	{
+		if constexpr (requires { SocketTraits<Value>::blob_size (*this); })
+			return SocketTraits<Value>::blob_size (*this);
+		else
+			return SocketTraits<Value>::constant_blob_size();
+	}
+
+
 template<class V>
 	inline void
 	Socket<V>::protected_set_nil()
 	{
 		if (_value)
 		{
-			_modification_timestamp = TimeHelper::now();
+			_modification_timestamp = SocketClock::now();
 			_value.reset();
 			++_serial;
 		}
@@ -348,7 +378,7 @@ template<class V>
 	{
 		if (!_value || *_value != value)
 		{
-			_modification_timestamp = TimeHelper::now();
+			_modification_timestamp = SocketClock::now();
 			_valid_timestamp = _modification_timestamp;
 			_value = value;
 			++_serial;
@@ -0,0 +1,94 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__SOCKETS__SOCKET_CLOCK_H__INCLUDED
+#define XEFIS__CORE__SOCKETS__SOCKET_CLOCK_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/clock.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+#include <neutrino/nonmovable.h>
+
+// Standard:
+#include <cstddef>
+#include <optional>
+
+
+namespace xf {
+
+/**
+ * Source of modification timestamps for sockets.
+ *
+ * By default each socket modification reads the Clock (system time unless in virtual mode). Within a TimestampScope all modifications done by
+ * the current thread use the timestamp given to the scope instead. ProcessingLoop uses that to stamp all sockets
+ * with the cycle time (one clock read per cycle instead of one per assignment), and device modules can use it
+ * to stamp sockets with the time their data was actually sampled.
+ */
+class SocketClock
+{
+  public:
+	/**
+	 * Makes all socket modifications on the current thread use given timestamp
+	 * until the scope is destroyed. Scopes can be nested.
+	 * Passing std::nullopt makes the sockets use the system clock within the scope.
+	 */
+	class TimestampScope:
+		private Noncopyable,
+		private Nonmovable
+	{
+	  public:
+		// Ctor
+		explicit
+		TimestampScope (std::optional<si::Time> timestamp) noexcept:
+			_previous_timestamp (SocketClock::_timestamp)
+		{
+			SocketClock::_timestamp = timestamp;
+		}
+
+		// Dtor
+		~TimestampScope()
+			{ SocketClock::_timestamp = _previous_timestamp; }
+
+	  private:
+		std::optional<si::Time> _previous_timestamp;
+	};
+
+  public:
+	/**
+	 * Return timestamp to use for a socket modification.
+	 */
+	[[nodiscard]]
+	static si::Time
+	now() noexcept
+		{ return _timestamp ? *_timestamp : Clock::now(); }
+
+	/**
+	 * Return timestamp set by the innermost TimestampScope on the current thread, if any.
+	 * Useful for propagating the scope to worker threads.
+	 */
+	[[nodiscard]]
+	static std::optional<si::Time>
+	scoped_timestamp() noexcept
+		{ return _timestamp; }
+
+  private:
+	static inline thread_local std::optional<si::Time> _timestamp;
+};
+
+} // namespace xf
+
+#endif
+
@@ -24,10 +24,15 @@
 #include <neutrino/stdexcept.h>
 
 // Boost:
+#include <boost/endian/conversion.hpp>
 #include <boost/lexical_cast.hpp>
 
 // Standard:
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <span>
 #include <string>
 #include <utility>
 
@@ -58,24 +63,67 @@ template<class AssignableSocketType, class Value>
 	assign (AssignableSocketType& socket, Value&& value);
 
 
+/**
+ * Throw InvalidBlobSize if buffer is too small for the required blob size.
+ */
+inline void
+check_blob_buffer (std::span<uint8_t> const buffer, size_t required_size)
+{
+	if (buffer.size() < required_size)
+		throw InvalidBlobSize (buffer.size(), required_size);
+}
+
+
+/**
+ * Write arithmetic value (or a si::Quantity) into the buffer in place.
+ * Gives the same little-endian encoding as value_to_blob().
+ */
 template<class Value>
-	inline Blob
-	apply_generic_value_to_blob (Socket<Value> const& socket, size_t constant_blob_size)
+	inline void
+	value_to_span (Value value, std::span<uint8_t> const buffer)
 	{
-		Blob result (constant_blob_size, 0);
-		result[0] = socket ? not_nil : nil;
-
-		if (socket)
+		if constexpr (si::is_quantity_v<Value>)
+			value_to_span (value.value(), buffer);
+		else
 		{
-			Blob converted;
-			value_to_blob (*socket, converted);
-			std::copy (converted.begin(), converted.end(), std::next (result.begin()));
+			if constexpr (std::is_integral_v<Value>)
+				boost::endian::native_to_little_inplace (value);
+
+			std::memcpy (buffer.data(), &value, sizeof (value));
 		}
+	}
+
 
+/**
+ * Create Blob from the in-place serialization function.
+ * Allocates only the resulting Blob.
+ */
+template<class Traits, class Value>
+	inline Blob
+	to_blob_via_span (Socket<Value> const& socket, size_t blob_size)
+	{
+		Blob result (blob_size, 0);
+		Traits::to_blob (socket, std::span<uint8_t> (result.data(), result.size()));
 		return result;
 	}
 
 
+template<class Value>
+	inline size_t
+	apply_generic_value_to_span (Socket<Value> const& socket, std::span<uint8_t> const buffer, size_t constant_blob_size)
+	{
+		check_blob_buffer (buffer, constant_blob_size);
+		buffer[0] = socket ? not_nil : nil;
+
+		if (socket)
+			value_to_span (*socket, buffer.subspan (1));
+		else
+			std::fill (std::next (buffer.begin()), buffer.begin() + constant_blob_size, 0);
+
+		return constant_blob_size;
+	}
+
+
 template<class Value, template<class> class AnySocket>
 	inline void
 	apply_generic_blob_to_value (AnySocket<Value>& module_out, BlobView blob, size_t constant_blob_size)
@@ -186,28 +234,34 @@ template<class Enum>
 		static inline Blob
 		to_blob (Socket<Enum> const& socket)
 		{
-			Blob result (constant_blob_size(), 0);
+			return detail::to_blob_via_span<EnumSocketTraits> (socket, constant_blob_size());
+		}
+
+		static inline size_t
+		to_blob (Socket<Enum> const& socket, std::span<uint8_t> const buffer)
+		{
+			using Underlying = std::underlying_type_t<Enum>;
+
+			detail::check_blob_buffer (buffer, constant_blob_size());
 
 			if constexpr (EnumWithNilValue<Enum>)
 			{
 				if (socket)
-					value_to_blob (static_cast<std::underlying_type_t<Enum>> (*socket), result);
+					detail::value_to_span (static_cast<Underlying> (*socket), buffer);
 				else
-					value_to_blob (static_cast<std::underlying_type_t<Enum>> (Enum::xf_nil_value), result);
+					detail::value_to_span (static_cast<Underlying> (Enum::xf_nil_value), buffer);
 			}
 			else
 			{
-				result[0] = socket ? detail::not_nil : detail::nil;
+				buffer[0] = socket ? detail::not_nil : detail::nil;
 
 				if (socket)
-				{
-					Blob tmp;
-					value_to_blob (static_cast<std::underlying_type_t<Enum>> (*socket), tmp);
-					std::copy (tmp.begin(), tmp.end(), std::next (result.begin()));
-				}
+					detail::value_to_span (static_cast<Underlying> (*socket), buffer.subspan (1));
+				else
+					std::fill (std::next (buffer.begin()), buffer.begin() + constant_blob_size(), 0);
 			}
 
-			return result;
+			return constant_blob_size();
 		}
 
 		static inline void
@@ -277,7 +331,13 @@ template<class Integer>
 		static inline Blob
 		to_blob (Socket<Integer> const& socket)
 		{
-			return detail::apply_generic_value_to_blob (socket, constant_blob_size());
+			return detail::to_blob_via_span<IntegerSocketTraits> (socket, constant_blob_size());
+		}
+
+		static inline size_t
+		to_blob (Socket<Integer> const& socket, std::span<uint8_t> const buffer)
+		{
+			return detail::apply_generic_value_to_span (socket, buffer, constant_blob_size());
 		}
 
 		static inline void
@@ -331,14 +391,20 @@ template<class FloatingPoint>
 		static inline Blob
 		to_blob (Socket<FloatingPoint> const& socket)
 		{
-			Blob result;
+			return detail::to_blob_via_span<FloatingPointSocketTraits> (socket, constant_blob_size());
+		}
+
+		static inline size_t
+		to_blob (Socket<FloatingPoint> const& socket, std::span<uint8_t> const buffer)
+		{
+			detail::check_blob_buffer (buffer, constant_blob_size());
 
 			if (socket)
-				value_to_blob (*socket, result);
+				detail::value_to_span (*socket, buffer);
 			else
-				value_to_blob (std::numeric_limits<FloatingPoint>::quiet_NaN(), result);
+				detail::value_to_span (std::numeric_limits<FloatingPoint>::quiet_NaN(), buffer);
 
-			return result;
+			return constant_blob_size();
 		}
 
 		static inline void
@@ -382,6 +448,14 @@ template<class Value, class Enabled = void>
 		static inline Blob
 		to_blob (Socket<Value> const&);
 
+		/**
+		 * Serialize into caller-provided buffer without allocating memory.
+		 * Return number of bytes written.
+		 * Throw InvalidBlobSize if the buffer is too small.
+		 */
+		static inline size_t
+		to_blob (Socket<Value> const&, std::span<uint8_t>);
+
 		static inline void
 		from_blob (AssignableSocket<Value>&, BlobView);
 	};
@@ -437,6 +511,19 @@ template<>
 				return { 2 };
 		}
 
+		static inline size_t
+		to_blob (Socket<bool> const& socket, std::span<uint8_t> const buffer)
+		{
+			detail::check_blob_buffer (buffer, constant_blob_size());
+
+			if (socket)
+				buffer[0] = *socket ? 1 : 0;
+			else
+				buffer[0] = 2;
+
+			return constant_blob_size();
+		}
+
 		static inline void
 		from_blob (AssignableSocket<bool>& module_out, BlobView blob)
 		{
@@ -552,18 +639,36 @@ template<>
 			return std::nullopt;
 		}
 
+		/**
+		 * Return size of the blob for the current value.
+		 */
+		static inline size_t
+		blob_size (Socket<std::string> const& socket)
+		{
+			return socket ? 1 + socket->size() : 1;
+		}
+
 		static inline Blob
 		to_blob (Socket<std::string> const& socket)
 		{
+			return detail::to_blob_via_span<SocketTraits> (socket, blob_size (socket));
+		}
+
+		static inline size_t
+		to_blob (Socket<std::string> const& socket, std::span<uint8_t> const buffer)
+		{
+			auto const size = blob_size (socket);
+			detail::check_blob_buffer (buffer, size);
+
 			if (socket)
 			{
-				Blob result (1 + socket->size(), 0);
-				result[0] = detail::not_nil;
-				std::copy (socket->begin(), socket->end(), std::next (result.begin()));
-				return result;
+				buffer[0] = detail::not_nil;
+				std::copy (socket->begin(), socket->end(), std::next (buffer.begin()));
 			}
 			else
-				return { detail::nil };
+				buffer[0] = detail::nil;
+
+			return size;
 		}
 
 		static inline void
@@ -642,7 +747,13 @@ template<class Unit>
 		static inline Blob
 		to_blob (Socket<si::Quantity<Unit>> const& socket)
 		{
-			return detail::apply_generic_value_to_blob (socket, constant_blob_size());
+			return detail::to_blob_via_span<SocketTraits> (socket, constant_blob_size());
+		}
+
+		static inline size_t
+		to_blob (Socket<si::Quantity<Unit>> const& socket, std::span<uint8_t> const buffer)
+		{
+			return detail::apply_generic_value_to_span (socket, buffer, constant_blob_size());
 		}
 
 		static inline void
@@ -660,6 +771,14 @@ template<class Enum>
 	struct SocketTraits<Enum, std::enable_if_t<std::is_enum_v<Enum>>>: public EnumSocketTraits<Enum>
 	{ };
 
+
+/**
+ * Fixed-size buffer for in-place serialization of sockets with constant blob size.
+ */
+template<class Value>
+	requires (SocketTraits<Value>::has_constant_blob_size())
+	using SocketBlobArray = std::array<uint8_t, SocketTraits<Value>::constant_blob_size()>;
+
 } // namespace xf
 
 
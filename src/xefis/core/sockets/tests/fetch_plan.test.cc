@@ -0,0 +1,162 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/fetch_plan.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+class SinkModule: public Module
+{
+  public:
+	ModuleIn<int>			direct		{ this, "direct" };
+	ModuleIn<int>			transformed	{ this, "transformed" };
+	ModuleIn<std::string>	chained		{ this, "chained" };
+	ModuleIn<int>			constant	{ this, "constant" };
+	ModuleIn<int>			unconnected	{ this, "unconnected" };
+	ModuleIn<int>			throwing	{ this, "throwing" };
+	ModuleIn<int>			fallback	{ this, "fallback", 7 };
+
+  public:
+	using Module::Module;
+
+	/**
+	 * Return state of all inputs as strings.
+	 */
+	std::vector<std::string>
+	state() const
+	{
+		std::vector<std::string> result;
+
+		for (BasicSocket const* socket: std::initializer_list<BasicSocket const*> { &direct, &transformed, &chained, &constant, &unconnected, &throwing, &fallback })
+			result.push_back (socket->to_string() + (socket->nil_by_fetch_exception() ? "/exception" : ""));
+
+		return result;
+	}
+};
+
+
+class TestNetwork
+{
+  public:
+	Module			source_module;
+	ModuleOut<int>	out		{ &source_module, "out" };
+	SinkModule		sink;
+
+  public:
+	TestNetwork()
+	{
+		sink.direct << out;
+		sink.transformed << std::function<int (int)> ([](int value) { return value * 2; }) << out;
+		sink.chained
+			<< std::function<std::string (std::optional<int>)> ([](auto const value) { return value ? std::to_string (*value) + "!" : "nil"; })
+			<< std::function<std::optional<int> (int)> ([](int value) -> std::optional<int> { if (value % 2) return value + 1; else return std::nullopt; })
+			<< out;
+		sink.constant << 5;
+		sink.throwing << std::function<int (int)> ([](int value) -> int { if (value % 3 == 0) throw std::runtime_error ("test"); return value; }) << out;
+		sink.fallback << out;
+	}
+};
+
+
+AutoTest t1 ("xf::FetchPlan gives the same results as regular fetching", []{
+	TestNetwork regular;
+	TestNetwork compiled;
+	TestCycle cycle;
+
+	Module::ProcessingLoopAPI (compiled.sink).compile_fetch_plan();
+
+	for (int i = 0; i < 20; ++i)
+	{
+		cycle += 1_s;
+
+		for (auto* network: { &regular, &compiled })
+		{
+			if (i % 5 == 4)
+				network->out = xf::nil;
+			else
+				network->out = i;
+
+			Module::ProcessingLoopAPI (network->source_module).reset_cache();
+			Module::ProcessingLoopAPI (network->sink).reset_cache();
+			Module::ProcessingLoopAPI (network->sink).fetch_and_process (cycle);
+		}
+
+		test_asserts::verify ("compiled fetching gives the same results as regular fetching", regular.sink.state() == compiled.sink.state());
+	}
+});
+
+
+AutoTest t2 ("xf::FetchPlan gets recompiled after reconnecting sockets", []{
+	TestNetwork network;
+	ModuleOut<int> other_out { &network.source_module, "other-out" };
+	TestCycle cycle;
+
+	Module::ProcessingLoopAPI (network.sink).compile_fetch_plan();
+	network.out = 1;
+	other_out = 2;
+	cycle += 1_s;
+	Module::ProcessingLoopAPI (network.sink).fetch_and_process (cycle);
+	test_asserts::verify ("value from initial connection", *network.sink.direct == 1);
+
+	network.sink.direct << other_out;
+	Module::ProcessingLoopAPI (network.sink).reset_cache();
+	cycle += 1_s;
+	Module::ProcessingLoopAPI (network.sink).fetch_and_process (cycle);
+	test_asserts::verify ("value from new connection", *network.sink.direct == 2);
+});
+
+
+AutoTest t3 ("xf::FetchPlan gets outdated only by its own sockets", []{
+	// Must outlive sockets compiled into the plans:
+	FetchPlan::GenerationCounter counter_a { 0 };
+	FetchPlan::GenerationCounter counter_b { 0 };
+	TestNetwork network_a;
+	TestNetwork network_b;
+	FetchPlan plan_a (counter_a);
+	FetchPlan plan_b (counter_b);
+
+	for (auto* socket: { &network_a.sink.direct, &network_a.sink.transformed })
+		socket->compile_fetch (plan_a);
+
+	for (auto* socket: { &network_b.sink.direct, &network_b.sink.transformed })
+		socket->compile_fetch (plan_b);
+
+	network_a.sink.direct << 7;
+	test_asserts::verify ("reconnected socket outdates its plan", !plan_a.up_to_date());
+	test_asserts::verify ("reconnected socket doesn't outdate other plans", plan_b.up_to_date());
+
+	network_b.sink.constant << 8;
+	test_asserts::verify ("socket not compiled into plan doesn't outdate it", plan_b.up_to_date());
+});
+
+} // namespace
+} // namespace xf::test
+
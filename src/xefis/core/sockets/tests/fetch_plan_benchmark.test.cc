@@ -0,0 +1,127 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kSocketsPerModule	= 100;
+constexpr std::size_t kCycles			= 1000;
+
+
+/**
+ * Module with many inputs, every fourth one connected through a transformer.
+ */
+class SinkModule: public Module
+{
+  public:
+	std::deque<ModuleIn<double>> inputs;
+
+  public:
+	explicit
+	SinkModule (std::vector<ModuleOut<double>*> const& sources)
+	{
+		for (std::size_t i = 0; i < kSocketsPerModule; ++i)
+		{
+			auto& input = inputs.emplace_back (this, "input");
+			auto& source = *sources[i % sources.size()];
+
+			if (i % 4 == 0)
+				input << std::function<double (double)> ([](double value) { return 2.0 * value; }) << source;
+			else
+				input << source;
+		}
+	}
+};
+
+
+/**
+ * Return fetch time per socket.
+ */
+si::Time
+measure_fetch (std::size_t total_sockets, bool compiled)
+{
+	Module source_module;
+	std::deque<ModuleOut<double>> outputs;
+	std::vector<ModuleOut<double>*> sources;
+
+	for (std::size_t i = 0; i < 100; ++i)
+		sources.push_back (&outputs.emplace_back (&source_module, "output"));
+
+	std::vector<std::unique_ptr<SinkModule>> modules;
+
+	for (std::size_t i = 0; i < total_sockets / kSocketsPerModule; ++i)
+	{
+		auto& module = *modules.emplace_back (std::make_unique<SinkModule> (sources));
+
+		if (compiled)
+			Module::ProcessingLoopAPI (module).compile_fetch_plan();
+	}
+
+	TestCycle cycle;
+
+	auto const time = TimeHelper::measure ([&] {
+		for (std::size_t c = 0; c < kCycles; ++c)
+		{
+			cycle += 1_ms;
+
+			for (auto* output: sources)
+				*output = static_cast<double> (c);
+
+			Module::ProcessingLoopAPI (source_module).reset_cache();
+
+			for (auto& module: modules)
+			{
+				Module::ProcessingLoopAPI (*module).reset_cache();
+				Module::ProcessingLoopAPI (*module).fetch_and_process (cycle);
+			}
+		}
+	});
+
+	return time / (kCycles * total_sockets);
+}
+
+
+ManualTest t_1 ("xf::FetchPlan: fetch cost per socket, regular vs. compiled", []{
+	for (std::size_t total_sockets: { 1'000u, 10'000u })
+	{
+		auto const regular = measure_fetch (total_sockets, false);
+		auto const compiled = measure_fetch (total_sockets, true);
+
+		std::cout << total_sockets << " sockets: regular " << regular.in<si::Nanosecond>() << " ns/socket, "
+				  << "compiled " << compiled.in<si::Nanosecond>() << " ns/socket, "
+				  << "speedup " << regular / compiled << "×" << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,76 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/socket_clock.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <deque>
+#include <iostream>
+#include <optional>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kSockets	= 500;
+constexpr std::size_t kCycles	= 10'000;
+
+
+si::Time
+measure_assignments (std::optional<si::Time> cycle_timestamp)
+{
+	Module module;
+	std::deque<ModuleOut<double>> sockets;
+
+	for (std::size_t i = 0; i < kSockets; ++i)
+		sockets.emplace_back (&module, "out");
+
+	return TimeHelper::measure ([&] {
+		for (std::size_t c = 0; c < kCycles; ++c)
+		{
+			std::optional<si::Time> timestamp;
+
+			if (cycle_timestamp)
+				timestamp = *cycle_timestamp + 1_ms * c;
+
+			SocketClock::TimestampScope scope (timestamp);
+
+			for (auto& socket: sockets)
+				socket = static_cast<double> (c);
+		}
+	});
+}
+
+
+ManualTest t_1 ("xf::Socket: assignment throughput with system clock vs. cycle timestamps", []{
+	auto const assignments = static_cast<double> (kSockets * kCycles);
+	auto const system_clock_time = measure_assignments (std::nullopt);
+	auto const cycle_time = measure_assignments (TimeHelper::now());
+
+	std::cout << "Assignments: " << kSockets << " sockets × " << kCycles << " cycles" << std::endl;
+	std::cout << "System clock timestamps: " << (system_clock_time / assignments).in<si::Nanosecond>() << " ns/assignment" << std::endl;
+	std::cout << "Cycle timestamps:        " << (cycle_time / assignments).in<si::Nanosecond>() << " ns/assignment" << std::endl;
+});
+
+} // namespace
+} // namespace xf::test
+
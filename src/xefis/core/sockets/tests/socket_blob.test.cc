@@ -0,0 +1,165 @@
+/* vim:ts=4
+ *
+ * Copyleft 2021  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/tests/allocation_counter.h>
+
+// Neutrino:
+#include <neutrino/demangle.h>
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <typeinfo>
+
+
+namespace xf::test {
+namespace {
+
+using namespace si::units;
+
+enum class BlobTestEnum: uint16_t
+{
+	A,
+	B,
+};
+
+
+constexpr std::string_view
+to_string (BlobTestEnum value)
+{
+	return value == BlobTestEnum::A ? "A" : "B";
+}
+
+
+void
+parse (std::string_view const& str, BlobTestEnum& value)
+{
+	value = str == "A" ? BlobTestEnum::A : BlobTestEnum::B;
+}
+
+
+/**
+ * Check in-place serialization of value and of nil against expected bytes, which are the little-endian
+ * encoding given by value_to_blob() before in-place serialization was introduced.
+ */
+template<class Value>
+	void
+	test_in_place_serialization (Value const& value, Blob const& expected, Blob const& expected_nil)
+	{
+		std::string const type = demangle (typeid (Value).name());
+		Module module;
+		ModuleOut<Value> source { &module, "source" };
+		ModuleOut<Value> target { &module, "target" };
+
+		for (bool nil: { false, true })
+		{
+			if (nil)
+				source = xf::nil;
+			else
+				source = value;
+
+			std::string const what = type + (nil ? " (nil)" : "");
+			Blob const& reference = nil ? expected_nil : expected;
+			std::array<uint8_t, 64> buffer;
+			std::size_t written;
+			std::size_t to_blob_allocations;
+			std::size_t from_blob_allocations;
+
+			{
+				AllocationCounter counter;
+				written = source.to_blob (buffer);
+				to_blob_allocations = counter.allocations();
+			}
+
+			test_asserts::verify ("to_blob (span) doesn't allocate for " + what, to_blob_allocations == 0);
+			test_asserts::verify ("to_blob (span) gives expected size for " + what, written == reference.size() && written == source.blob_size());
+			test_asserts::verify ("to_blob (span) gives expected bytes for " + what, std::equal (reference.begin(), reference.end(), buffer.begin()));
+			test_asserts::verify ("to_blob() gives expected bytes for " + what, source.to_blob() == reference);
+
+			{
+				AllocationCounter counter;
+				target.from_blob (BlobView (buffer.data(), written));
+				from_blob_allocations = counter.allocations();
+			}
+
+			test_asserts::verify ("from_blob() doesn't allocate for " + what, from_blob_allocations == 0);
+			test_asserts::verify ("from_blob() restores the value for " + what, target.get_optional() == source.get_optional());
+		}
+	}
+
+
+AutoTest t1 ("xf::Socket: in-place blob serialization gives little-endian encoding and doesn't allocate", []{
+	test_in_place_serialization<bool> (true, { 0x01 }, { 0x02 });
+	test_in_place_serialization<int8_t> (-5, { 0x01, 0xfb }, { 0x00, 0x00 });
+	test_in_place_serialization<uint32_t> (0x12345678u, { 0x01, 0x78, 0x56, 0x34, 0x12 }, { 0x00, 0x00, 0x00, 0x00, 0x00 });
+	test_in_place_serialization<int64_t> (-0x123456789abcdefll,
+										  { 0x01, 0x11, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe },
+										  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 });
+	// Floating-point values have no nil-flag, nil is stored as quiet NaN:
+	test_in_place_serialization<float32_t> (1.25f, { 0x00, 0x00, 0xa0, 0x3f }, { 0x00, 0x00, 0xc0, 0x7f });
+	test_in_place_serialization<float64_t> (-3.5,
+											{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0xc0 },
+											{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8, 0x7f });
+	test_in_place_serialization<si::Length> (15_m,
+											 { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2e, 0x40 },
+											 { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 });
+	test_in_place_serialization<si::Velocity> (2_mps,
+											   { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40 },
+											   { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 });
+	test_in_place_serialization<BlobTestEnum> (BlobTestEnum::B, { 0x01, 0x01, 0x00 }, { 0x00, 0x00, 0x00 });
+});
+
+
+AutoTest t2 ("xf::Socket: compile-time blob sizes", []{
+	static_assert (std::tuple_size_v<SocketBlobArray<int32_t>> == 5);
+	static_assert (std::tuple_size_v<SocketBlobArray<float64_t>> == 8);
+	static_assert (std::tuple_size_v<SocketBlobArray<si::Length>> == 1 + sizeof (si::Length::Value));
+
+	Module module;
+	ModuleOut<int32_t> socket { &module, "socket" };
+	SocketBlobArray<int32_t> buffer;
+
+	socket = 7;
+	test_asserts::verify ("to_blob() into SocketBlobArray writes whole array", socket.to_blob (buffer) == buffer.size());
+});
+
+
+AutoTest t3 ("xf::Socket: to_blob (span) throws on too small buffer", []{
+	Module module;
+	ModuleOut<std::string> socket { &module, "socket" };
+	std::array<uint8_t, 4> buffer;
+	bool thrown = false;
+
+	socket = "too long string";
+
+	try {
+		static_cast<void> (socket.to_blob (buffer));
+	}
+	catch (InvalidBlobSize const&)
+	{
+		thrown = true;
+	}
+
+	test_asserts::verify ("InvalidBlobSize is thrown", thrown);
+});
+
+} // namespace
+} // namespace xf::test
+
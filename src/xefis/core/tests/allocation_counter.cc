@@ -0,0 +1,65 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "allocation_counter.h"
+
+// Standard:
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+
+// Replacements of global allocation functions that count allocations.
+// Array versions of the default library forward to these.
+
+void*
+operator new (std::size_t size)
+{
+	xf::test::AllocationCounter::count_allocation();
+
+	if (void* pointer = std::malloc (size > 0 ? size : 1))
+		return pointer;
+	else
+		throw std::bad_alloc();
+}
+
+
+void*
+operator new (std::size_t size, std::nothrow_t const&) noexcept
+{
+	xf::test::AllocationCounter::count_allocation();
+	return std::malloc (size > 0 ? size : 1);
+}
+
+
+void
+operator delete (void* pointer) noexcept
+{
+	std::free (pointer);
+}
+
+
+void
+operator delete (void* pointer, std::size_t) noexcept
+{
+	std::free (pointer);
+}
+
+
+void
+operator delete (void* pointer, std::nothrow_t const&) noexcept
+{
+	std::free (pointer);
+}
+
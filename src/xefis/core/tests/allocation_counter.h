@@ -0,0 +1,63 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__CORE__TESTS__ALLOCATION_COUNTER_H__INCLUDED
+#define XEFIS__CORE__TESTS__ALLOCATION_COUNTER_H__INCLUDED
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf::test {
+
+/**
+ * Counts heap allocations (global operator new calls) made by the current thread
+ * during the lifetime of the counter object. Counters can be nested.
+ * Works only in test executables, which replace global operator new (see allocation_counter.cc).
+ */
+class AllocationCounter: private Noncopyable
+{
+  public:
+	// Ctor
+	explicit
+	AllocationCounter() noexcept:
+		_start (s_allocations)
+	{ }
+
+	/**
+	 * Return number of allocations since construction.
+	 */
+	[[nodiscard]]
+	std::size_t
+	allocations() const noexcept
+		{ return s_allocations - _start; }
+
+	/**
+	 * Called by the replaced operator new.
+	 */
+	static void
+	count_allocation() noexcept
+		{ ++s_allocations; }
+
+  private:
+	std::size_t								_start;
+	static inline thread_local std::size_t	s_allocations	{ 0 };
+};
+
+} // namespace xf::test
+
+#endif
+
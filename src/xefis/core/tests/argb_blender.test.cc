@@ -0,0 +1,142 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/argb_blender.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Qt:
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+
+// Standard:
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+
+namespace xf::test {
+namespace {
+
+/**
+ * Image with transparent, opaque and translucent runs of random lengths, so that
+ * all span classes and unaligned tails are exercised.
+ */
+QImage
+make_source (QSize size, unsigned int seed)
+{
+	std::mt19937 rng (seed);
+	std::uniform_int_distribution<int> run_length (1, 40);
+	std::uniform_int_distribution<int> byte (0, 255);
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+
+	for (int y = 0; y < size.height(); ++y)
+	{
+		for (int x = 0; x < size.width(); )
+		{
+			int const kind = byte (rng) % 3;
+			int const alpha = kind == 0 ? 0 : kind == 1 ? 255 : byte (rng);
+			QColor const color = QColor (byte (rng), byte (rng), byte (rng), alpha);
+
+			for (int n = run_length (rng); n > 0 && x < size.width(); --n, ++x)
+				image.setPixel (x, y, qPremultiply (color.rgba()));
+		}
+	}
+
+	return image;
+}
+
+
+QImage
+make_target (QSize size)
+{
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+
+	for (int y = 0; y < size.height(); ++y)
+		for (int x = 0; x < size.width(); ++x)
+			image.setPixel (x, y, qRgba (x % 256, y % 256, (x + y) % 256, 255));
+
+	return image;
+}
+
+
+bool
+nearly_equal (QImage const& a, QImage const& b, int tolerance)
+{
+	for (int y = 0; y < a.height(); ++y)
+	{
+		for (int x = 0; x < a.width(); ++x)
+		{
+			QRgb const pa = a.pixel (x, y);
+			QRgb const pb = b.pixel (x, y);
+
+			for (int shift: { 0, 8, 16, 24 })
+				if (std::abs (static_cast<int> ((pa >> shift) & 0xff) - static_cast<int> ((pb >> shift) & 0xff)) > tolerance)
+					return false;
+		}
+	}
+
+	return true;
+}
+
+
+AutoTest t1 ("xf::ArgbBlender: all kernels give identical results", []{
+	QImage const source = make_source ({ 123, 45 }, 1);
+	QImage reference = make_target ({ 150, 60 });
+	ArgbBlender (ArgbBlender::Kernel::Scalar).blend (reference, { 7, 5 }, source);
+
+	for (auto const kernel: { ArgbBlender::Kernel::SSE4, ArgbBlender::Kernel::AVX2 })
+	{
+		if (ArgbBlender::supported (kernel))
+		{
+			QImage target = make_target ({ 150, 60 });
+			ArgbBlender (kernel).blend (target, { 7, 5 }, source);
+			test_asserts::verify (std::string (ArgbBlender::kernel_name (kernel)) + " kernel matches scalar kernel", target == reference);
+		}
+	}
+});
+
+
+AutoTest t2 ("xf::ArgbBlender: result matches QPainter", []{
+	QImage const source = make_source ({ 200, 100 }, 2);
+	QImage expected = make_target ({ 180, 120 });
+	QImage target = expected.copy();
+	QRect const source_rect (10, 10, 150, 80);
+	// Partially outside of the target, must be clipped:
+	QPoint const position (50, 60);
+
+	QPainter (&expected).drawImage (position, source, source_rect);
+	ArgbBlender().blend (target, position, source, source_rect);
+
+	test_asserts::verify ("blending is the same as QPainter's", nearly_equal (target, expected, 1));
+});
+
+
+AutoTest t3 ("xf::ArgbBlender: fill()", []{
+	QImage target = make_target ({ 20, 20 });
+	QImage expected = target.copy();
+
+	ArgbBlender::fill (target, QRect (-5, 5, 10, 30), qRgb (0, 0, 0));
+	QPainter (&expected).fillRect (QRect (0, 5, 5, 15), Qt::black);
+
+	test_asserts::verify ("fill() is clipped to the image", target == expected);
+});
+
+} // namespace
+} // namespace xf::test
+
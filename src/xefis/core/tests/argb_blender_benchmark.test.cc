@@ -0,0 +1,122 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/argb_blender.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kFrames = 50;
+
+
+/**
+ * Instrument-like image: mostly transparent, with an opaque area (like ADI background)
+ * and translucent shapes (like antialiased scales and labels).
+ */
+QImage
+make_instrument_image (QSize size)
+{
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+	image.fill (Qt::transparent);
+
+	QPainter painter (&image);
+	painter.setRenderHint (QPainter::Antialiasing, true);
+	painter.fillRect (QRect (size.width() / 4, size.height() / 4, size.width() / 2, size.height() / 2), QColor (0x00, 0x60, 0xc0));
+	painter.setPen (QPen (Qt::white, 3.0));
+
+	for (int i = 0; i < 40; ++i)
+		painter.drawEllipse (QPointF (size.width() / 2, size.height() / 2), 10.0 * i, 7.0 * i);
+
+	return image;
+}
+
+
+QImage
+make_translucent_image (QSize size)
+{
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+	image.fill (QColor (0x80, 0x40, 0x20, 0x80));
+	return image;
+}
+
+
+template<class Blend>
+	si::Time
+	measure (QImage& target, QImage const& source, Blend&& blend)
+	{
+		auto const total_time = TimeHelper::measure ([&] {
+			for (std::size_t frame = 0; frame < kFrames; ++frame)
+				blend (target, source);
+		});
+
+		return total_time / kFrames;
+	}
+
+
+void
+run (QSize size, char const* content_name, QImage (*make_image) (QSize))
+{
+	QImage const source = make_image (size);
+	QImage target (size, QImage::Format_ARGB32_Premultiplied);
+	target.fill (Qt::black);
+
+	auto const qpainter_time = measure (target, source, [](QImage& t, QImage const& s) {
+		QPainter (&t).drawImage (QPoint (0, 0), s);
+	});
+
+	std::cout << size.width() << "×" << size.height() << ", " << content_name << ":" << std::endl;
+	std::cout << "  QPainter:  " << qpainter_time.in<si::Millisecond>() << " ms/frame" << std::endl;
+
+	for (auto const kernel: { ArgbBlender::Kernel::Scalar, ArgbBlender::Kernel::SSE4, ArgbBlender::Kernel::AVX2 })
+	{
+		if (ArgbBlender::supported (kernel))
+		{
+			ArgbBlender const blender (kernel);
+			auto const time = measure (target, source, [&](QImage& t, QImage const& s) {
+				blender.blend (t, QPoint (0, 0), s);
+			});
+
+			std::cout << "  " << ArgbBlender::kernel_name (kernel) << ": " << time.in<si::Millisecond>() << " ms/frame"
+					  << " (" << qpainter_time / time << "× QPainter)" << std::endl;
+		}
+	}
+}
+
+
+ManualTest t_1 ("xf::ArgbBlender: kernels vs. QPainter::drawImage() at 1080p and 4K", []{
+	for (QSize const size: { QSize (1920, 1080), QSize (3840, 2160) })
+	{
+		run (size, "instrument-like", make_instrument_image);
+		run (size, "all translucent", make_translucent_image);
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
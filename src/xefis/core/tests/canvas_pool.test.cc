@@ -0,0 +1,115 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/canvas_pool.h>
+#include <xefis/core/paint_request.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf::test {
+namespace {
+
+AutoTest t1 ("xf::CanvasPool: reuses images of the same size and format", []{
+	CanvasPool pool;
+
+	QImage a = pool.acquire ({ 100, 50 });
+	auto const* const a_bits = a.constBits();
+	pool.release (std::move (a));
+
+	test_asserts::verify ("released image is pooled", pool.statistics().images == 1);
+
+	QImage b = pool.acquire ({ 50, 100 });
+	test_asserts::verify ("different size is not reused", pool.statistics().hits == 0);
+
+	QImage c = pool.acquire ({ 100, 50 });
+	test_asserts::verify ("same size is reused", pool.statistics().hits == 1);
+	test_asserts::verify ("reused image has the same buffer", c.constBits() == a_bits);
+	test_asserts::verify ("pool is empty", pool.statistics().images == 0 && pool.statistics().memory_usage == 0);
+
+	QImage d = pool.acquire ({ 100, 50 }, QImage::Format_RGB32);
+	test_asserts::verify ("reused image has requested format", d.format() == QImage::Format_RGB32 && c.format() == QImage::Format_ARGB32_Premultiplied);
+});
+
+
+AutoTest t2 ("xf::CanvasPool: keeps memory within budget", []{
+	std::size_t const image_bytes = 100 * 100 * 4;
+	CanvasPool pool (2 * image_bytes);
+
+	for (int i = 0; i < 3; ++i)
+		pool.release (QImage (100, 100, QImage::Format_ARGB32_Premultiplied));
+
+	test_asserts::verify ("oldest images are evicted to stay within budget", pool.statistics().images == 2 && pool.statistics().memory_usage == 2 * image_bytes);
+
+	pool.release (QImage (200, 200, QImage::Format_ARGB32_Premultiplied));
+	test_asserts::verify ("image larger than budget is dropped", pool.statistics().images == 2);
+
+	pool.set_memory_budget (image_bytes);
+	test_asserts::verify ("lowering budget frees images", pool.statistics().images == 1 && pool.statistics().memory_usage == image_bytes);
+
+	pool.clear();
+	test_asserts::verify ("clear() frees all images", pool.statistics().images == 0);
+});
+
+
+AutoTest t3 ("xf::PaintRequest: collects painted region", []{
+	QImage canvas (100, 100, QImage::Format_ARGB32_Premultiplied);
+	PaintRequest::Metric const metric (canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm);
+	QRect painted_rect;
+
+	PaintRequest untracked (canvas, metric, canvas.size());
+	untracked.mark_painted (QRect (0, 0, 10, 10));
+	test_asserts::verify ("untracked request ignores marks", !untracked.tracks_painted_region());
+
+	PaintRequest tracked (canvas, metric, canvas.size(), &painted_rect);
+	tracked.mark_painted (QRect (10, 10, 10, 10));
+	tracked.mark_painted (QRectF (30.5, 30.5, 10.0, 10.0));
+	tracked.mark_painted (QRect (90, 90, 50, 50));
+
+	test_asserts::verify ("painted region is bounding rect clipped to canvas", painted_rect == QRect (QPoint (10, 10), QPoint (99, 99)));
+});
+
+
+AutoTest t4 ("xf::CanvasPool: evicts least recently released images when sizes change", []{
+	std::size_t const old_image_bytes = 100 * 100 * 4;
+	std::size_t const new_image_bytes = 150 * 100 * 4;
+	CanvasPool pool (3 * old_image_bytes);
+
+	// Instrument canvases resized from 100×100 to 150×100:
+	pool.release (QImage (100, 100, QImage::Format_ARGB32_Premultiplied));
+	pool.release (QImage (100, 100, QImage::Format_ARGB32_Premultiplied));
+	pool.release (QImage (150, 100, QImage::Format_ARGB32_Premultiplied));
+	pool.release (QImage (150, 100, QImage::Format_ARGB32_Premultiplied));
+
+	test_asserts::verify ("images of new size are pooled", pool.statistics().images == 2 && pool.statistics().memory_usage == 2 * new_image_bytes);
+
+	QImage a = pool.acquire ({ 150, 100 });
+	QImage b = pool.acquire ({ 150, 100 });
+	test_asserts::verify ("new size is reused", pool.statistics().hits == 2 && pool.statistics().misses == 0);
+
+	QImage c = pool.acquire ({ 100, 100 });
+	test_asserts::verify ("images of old size were evicted", pool.statistics().misses == 1 && pool.statistics().images == 0);
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,191 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/app/xefis.h>
+#include <xefis/core/clock.h>
+#include <xefis/core/machine.h>
+#include <xefis/core/module.h>
+#include <xefis/core/processing_loop.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/socket_clock.h>
+#include <xefis/utility/temporal.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+
+// Qt:
+#include <QtCore/QtGlobal>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+class Sensors: public Module
+{
+  public:
+	ModuleOut<si::Length> altitude { this, "altitude" };
+
+  public:
+	using Module::Module;
+};
+
+
+/**
+ * Records virtual time and time delta of each cycle.
+ */
+class CycleRecorder: public Module
+{
+  public:
+	std::vector<si::Time>	update_times;
+	std::vector<si::Time>	update_dts;
+
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const& cycle) override
+	{
+		update_times.push_back (cycle.update_time());
+		update_dts.push_back (cycle.update_dt());
+	}
+};
+
+
+/**
+ * Minimal application needed to create a ProcessingLoop.
+ */
+class LoopEnvironment
+{
+  public:
+	// Ctor
+	LoopEnvironment()
+	{
+		if (!qEnvironmentVariableIsSet ("QT_QPA_PLATFORM"))
+			qputenv ("QT_QPA_PLATFORM", "offscreen");
+	}
+
+  public:
+	int				argc			{ 1 };
+	char			arg0[9]			{ "autotest" };
+	char*			argv[2]			{ arg0, nullptr };
+	Xefis			xefis			{ argc, argv };
+	Machine			machine			{ xefis };
+	LoggerOutput	logger_output	{ std::clog };
+	Logger			logger			{ logger_output };
+};
+
+
+bool
+about (si::Time const value, si::Time const expected)
+{
+	return value > expected - 0.001_ms && value < expected + 0.001_ms;
+}
+
+
+AutoTest t1 ("xf::Clock: virtual time scope", []{
+	test_asserts::verify ("clock uses system time by default", !Clock::is_virtual());
+
+	{
+		Clock::VirtualTimeScope scope (1000_s);
+
+		test_asserts::verify ("clock is virtual within scope", Clock::is_virtual());
+		test_asserts::verify ("virtual time is set", about (Clock::now(), 1000_s));
+
+		Clock::advance (10_ms);
+		test_asserts::verify ("virtual time advances", about (Clock::now(), 1000.01_s));
+
+		{
+			Clock::VirtualTimeScope nested_scope (5_s);
+			test_asserts::verify ("nested scope doesn't reset time", Clock::now() > 1000_s);
+		}
+
+		test_asserts::verify ("nested scope doesn't switch to system time", Clock::is_virtual());
+	}
+
+	test_asserts::verify ("system time is restored", !Clock::is_virtual());
+	test_asserts::verify ("system time is used", Clock::now() > 1000_s);
+});
+
+
+AutoTest t2 ("xf::Clock: sockets and temporals follow virtual time", []{
+	Clock::VirtualTimeScope scope (100_s);
+	Sensors sensors ("sensors");
+
+	test_asserts::verify ("SocketClock follows virtual time", about (SocketClock::now(), 100_s));
+
+	sensors.altitude = 1_m;
+	Temporal<int> temporal (1);
+
+	test_asserts::verify ("socket is stamped with virtual time", about (sensors.altitude.modification_timestamp(), 100_s));
+	test_asserts::verify ("temporal is stamped with virtual time", about (temporal.update_time(), 100_s));
+
+	Clock::advance (2_s);
+
+	test_asserts::verify ("modification age follows virtual time", about (sensors.altitude.modification_age(), 2_s));
+	test_asserts::verify ("valid age follows virtual time", about (sensors.altitude.valid_age(), 2_s));
+});
+
+
+
+AutoTest t3 ("xf::ProcessingLoop: run_virtual() advances virtual clock by loop period", []{
+	LoopEnvironment env;
+	ProcessingLoop loop (env.machine, "test loop", 100_Hz, env.logger);
+	Registrant<CycleRecorder> recorder ("recorder");
+	loop.register_module (recorder);
+
+	auto const stats = loop.run_virtual (1_s);
+
+	test_asserts::verify ("duration / period cycles were run", stats.cycles == 100 && recorder->update_times.size() == 100);
+	test_asserts::verify ("simulated time is reported", about (stats.simulated_time, 1_s));
+	test_asserts::verify ("clock is back to system time after the run", !Clock::is_virtual());
+
+	bool all_dts_equal_period = true;
+	bool all_times_advance_by_period = true;
+
+	for (std::size_t i = 1; i < recorder->update_times.size(); ++i)
+	{
+		all_dts_equal_period &= about (recorder->update_dts[i], 10_ms);
+		all_times_advance_by_period &= about (recorder->update_times[i] - recorder->update_times[i - 1], 10_ms);
+	}
+
+	test_asserts::verify ("each cycle has dt equal to the loop period", all_dts_equal_period);
+	test_asserts::verify ("virtual time advances by the loop period each cycle", all_times_advance_by_period);
+	test_asserts::verify ("unpaced run is faster than real time", stats.wall_time < 1_s);
+});
+
+
+AutoTest t4 ("xf::ProcessingLoop: run_virtual() honours speed factor", []{
+	LoopEnvironment env;
+	ProcessingLoop loop (env.machine, "test loop", 100_Hz, env.logger);
+	Registrant<CycleRecorder> recorder ("recorder");
+	loop.register_module (recorder);
+
+	// 0.2 s of simulated time at 4× real time should take at least 50 ms:
+	auto const stats = loop.run_virtual (0.2_s, 4.0);
+
+	test_asserts::verify ("duration / period cycles were run", stats.cycles == 20);
+	test_asserts::verify ("run is paced to speed factor", stats.wall_time >= 50_ms - 1_ms);
+	test_asserts::verify ("run is not faster than speed factor", stats.speed() <= 4.0 * 1.02);
+});
+
+} // namespace
+} // namespace xf::test
+
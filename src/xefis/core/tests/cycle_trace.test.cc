@@ -0,0 +1,94 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/cycle_trace.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <cstddef>
+#include <sstream>
+#include <thread>
+
+
+namespace xf::test {
+namespace {
+
+class TracedModule: public Module
+{
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const&) override
+	{ }
+};
+
+
+AutoTest t1 ("xf::CycleTrace: nothing is recorded when disabled", []{
+	CycleTrace::set_enabled (false);
+	CycleTrace::clear();
+
+	bool name_requested = false;
+
+	{
+		CycleTrace::Scope scope ("test", [&] {
+			name_requested = true;
+			return std::string ("event");
+		});
+	}
+
+	test_asserts::verify ("name provider is not called", !name_requested);
+	test_asserts::verify ("no events recorded", CycleTrace::events_count() == 0);
+});
+
+
+AutoTest t2 ("xf::CycleTrace: module process() calls and events from other threads are exported", []{
+	CycleTrace::clear();
+	CycleTrace::set_enabled (true);
+
+	TracedModule module ("traced-module");
+	TestCycle cycle;
+	cycle += 1_s;
+	Module::ProcessingLoopAPI (module).fetch_and_process (cycle);
+
+	std::thread ([]{
+		CycleTrace::set_thread_name ("painter \"1\"");
+		CycleTrace::Scope scope ("paint", []{ return std::string ("instrument"); });
+	}).join();
+
+	CycleTrace::set_enabled (false);
+
+	std::ostringstream json;
+	CycleTrace::export_chrome_trace (json);
+	auto const output = json.str();
+
+	test_asserts::verify ("two events recorded", CycleTrace::events_count() == 2);
+	test_asserts::verify ("output is trace-event JSON", output.starts_with ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	test_asserts::verify ("module event is exported", output.find ("traced-module") != std::string::npos);
+	test_asserts::verify ("module event has process category", output.find ("\"cat\":\"process\"") != std::string::npos);
+	test_asserts::verify ("paint event is exported", output.find ("\"name\":\"instrument\",\"cat\":\"paint\"") != std::string::npos);
+	test_asserts::verify ("thread name is escaped", output.find ("painter \\\"1\\\"") != std::string::npos);
+
+	CycleTrace::clear();
+	test_asserts::verify ("clear() removes events", CycleTrace::events_count() == 0);
+});
+
+} // namespace
+} // namespace xf::test
+
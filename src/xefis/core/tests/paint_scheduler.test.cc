@@ -0,0 +1,173 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/instrument.h>
+#include <xefis/core/screen.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/work_performer.h>
+
+// Standard:
+#include <cmath>
+#include <cstddef>
+#include <future>
+#include <map>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+using Priority = Instrument::RefreshPriority;
+
+xf::Logger g_null_logger;
+
+
+class TestInstrument: public Instrument
+{
+  public:
+	// Ctor
+	explicit
+	TestInstrument (RefreshPolicy const& policy)
+		{ set_refresh_policy (policy); }
+
+	std::packaged_task<void()>
+	paint (PaintRequest) const override
+		{ return {}; }
+};
+
+
+/**
+ * Three instruments of different priorities painted by one WorkPerformer on a 60 Hz screen.
+ */
+class SchedulerEnvironment
+{
+  public:
+	WorkPerformer							work_performer		{ 1, g_null_logger };
+	TestInstrument							high_instrument		{ { .priority = Priority::High } };
+	TestInstrument							normal_instrument	{ { .priority = Priority::Normal } };
+	TestInstrument							low_instrument		{ { .max_rate = 30_Hz, .min_rate = 5_Hz, .priority = Priority::Low } };
+	detail::InstrumentDetails				high				{ high_instrument, work_performer };
+	detail::InstrumentDetails				normal				{ normal_instrument, work_performer };
+	detail::InstrumentDetails				low					{ low_instrument, work_performer };
+	std::vector<detail::InstrumentDetails*>	all					{ &high, &normal, &low };
+	detail::PaintScheduler					scheduler			{ 60_Hz };
+
+  public:
+	// Ctor
+	SchedulerEnvironment()
+	{
+		for (auto* details: all)
+			details->expected_painting_time = 10_ms;
+	}
+
+	/**
+	 * Schedule given candidates with all WorkPerformers idle and return the chosen ones.
+	 */
+	std::vector<detail::InstrumentDetails*>
+	schedule (std::vector<detail::InstrumentDetails*> candidates, si::Time now = 1_s)
+	{
+		std::map<WorkPerformer const*, si::Time> busy_time;
+		scheduler.schedule (candidates, all, busy_time, now);
+		return candidates;
+	}
+};
+
+
+bool
+near (std::optional<si::Frequency> const rate, si::Frequency const expected)
+{
+	return rate && std::abs ((*rate - expected).in<si::Hertz>()) < 1e-9;
+}
+
+
+AutoTest t1 ("xf::detail::PaintScheduler: painting is due according to refresh rate limit", []{
+	SchedulerEnvironment env;
+	auto& details = env.normal;
+
+	test_asserts::verify ("never painted instrument is due", env.scheduler.is_due (details, 1_s));
+
+	details.last_painting_start = 1_s;
+	details.refresh_rate_limit = 10_Hz;
+
+	test_asserts::verify ("not due before the period passes", !env.scheduler.is_due (details, 1.05_s));
+	test_asserts::verify ("due slightly before the period passes because of jitter tolerance", env.scheduler.is_due (details, 1.095_s));
+	test_asserts::verify ("due after the period passes", env.scheduler.is_due (details, 1.1_s));
+});
+
+
+AutoTest t2 ("xf::detail::PaintScheduler: paints by priority within budget and slows down low priority first", []{
+	SchedulerEnvironment env;
+
+	// Budget is 0.8 × 16.7 ms, so only one 10 ms painting fits:
+	auto const chosen = env.schedule ({ &env.low, &env.normal, &env.high });
+
+	test_asserts::verify ("only the high priority instrument is painted", chosen == std::vector { &env.high });
+	test_asserts::verify ("painting start time is set", env.high.last_painting_start == 1_s && !env.normal.last_painting_start);
+	test_asserts::verify ("high priority stays at full rate", near (env.high.refresh_rate_limit, 60_Hz));
+	test_asserts::verify ("low priority is slowed down from its maximum rate", near (env.low.refresh_rate_limit, 30_Hz * detail::PaintScheduler::kRateDecreaseFactor));
+	test_asserts::verify ("normal priority isn't slowed down while low priority can be", near (env.normal.refresh_rate_limit, 60_Hz));
+
+	// Keep being overloaded until low priority instrument reaches its minimum rate:
+	for (int i = 0; i < 100; ++i)
+		env.schedule ({ &env.low, &env.normal, &env.high });
+
+	test_asserts::verify ("low priority isn't slowed down below its minimum rate", near (env.low.refresh_rate_limit, 5_Hz));
+	test_asserts::verify ("normal priority gets slowed down when low priority is at minimum", *env.normal.refresh_rate_limit < 60_Hz);
+	test_asserts::verify ("high priority is never slowed down", near (env.high.refresh_rate_limit, 60_Hz));
+});
+
+
+AutoTest t3 ("xf::detail::PaintScheduler: rates recover when there's enough time", []{
+	SchedulerEnvironment env;
+
+	env.low.refresh_rate_limit = 10_Hz;
+	env.normal.refresh_rate_limit = 59_Hz;
+
+	auto const chosen = env.schedule ({ &env.normal });
+
+	test_asserts::verify ("the only candidate is painted", chosen == std::vector { &env.normal });
+	test_asserts::verify ("low priority rate increases", near (env.low.refresh_rate_limit, 10_Hz * detail::PaintScheduler::kRateIncreaseFactor));
+	test_asserts::verify ("rate doesn't exceed screen refresh rate", near (env.normal.refresh_rate_limit, 60_Hz));
+
+	for (int i = 0; i < 100; ++i)
+		env.schedule ({});
+
+	test_asserts::verify ("rate doesn't exceed policy's maximum rate", near (env.low.refresh_rate_limit, 30_Hz));
+});
+
+
+AutoTest t4 ("xf::Instrument: achieved refresh rate is published without communicate()", []{
+	TestInstrument instrument ({});
+	TestCycle cycle;
+
+	Instrument::AccountingAPI (instrument).publish_achieved_refresh_rate();
+	test_asserts::verify ("nothing is published before rate is measured", !instrument.achieved_refresh_rate);
+
+	Instrument::AccountingAPI (instrument).set_achieved_refresh_rate (25_Hz);
+	Instrument::AccountingAPI (instrument).publish_achieved_refresh_rate();
+	test_asserts::verify ("measured rate is published", instrument.achieved_refresh_rate && *instrument.achieved_refresh_rate == 25_Hz);
+
+	Module::ProcessingLoopAPI (instrument).communicate (cycle);
+	test_asserts::verify ("instruments don't implement communicate()", !Module::ProcessingLoopAPI (instrument).implements_communicate_method());
+});
+
+} // namespace
+} // namespace xf::test
+
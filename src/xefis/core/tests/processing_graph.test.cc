@@ -0,0 +1,128 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/processing_graph.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/work_performer.h>
+
+// Standard:
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+xf::Logger g_null_logger;
+
+
+class Summer: public Module
+{
+  public:
+	ModuleIn<int64_t>	a	{ this, "a" };
+	ModuleIn<int64_t>	b	{ this, "b" };
+	ModuleOut<int64_t>	sum	{ this, "sum" };
+
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const&) override
+	{
+		sum = (2 * a.value_or (0) + b.value_or (0) + 1) % 1000;
+	}
+};
+
+
+/**
+ * Diamond, a feedback loop, an independent chain and a module listed
+ * before its dependencies.
+ */
+class TestNetwork
+{
+  public:
+	Summer	m1	{ "m1" };
+	Summer	m2	{ "m2" };
+	Summer	m3	{ "m3" };
+	Summer	m4	{ "m4" };
+	Summer	m5	{ "m5" };
+	Summer	m6	{ "m6" };
+
+  public:
+	TestNetwork()
+	{
+		m2.a << m1.sum;
+		m3.a << m1.sum;
+		m4.a << m2.sum;
+		m4.b << m3.sum;
+		m1.b << m4.sum;
+		m6.a << m5.sum;
+		m6.b << m4.sum;
+	}
+
+	std::vector<Module*>
+	modules()
+	{
+		return { &m6, &m1, &m2, &m3, &m4, &m5 };
+	}
+
+	std::vector<int64_t>
+	results() const
+	{
+		return { *m1.sum, *m2.sum, *m3.sum, *m4.sum, *m5.sum, *m6.sum };
+	}
+};
+
+
+AutoTest t1 ("xf::ProcessingGraph gives the same results as serial processing", []{
+	TestNetwork serial;
+	TestNetwork parallel;
+	ProcessingGraph graph (parallel.modules());
+	WorkPerformer work_performer (std::max (2u, std::thread::hardware_concurrency()), g_null_logger);
+	TestCycle cycle;
+
+	test_asserts::verify ("graph contains all modules", graph.nodes().size() == 6);
+
+	for (int i = 0; i < 100; ++i)
+	{
+		cycle += 1_s;
+
+		for (auto* module: serial.modules())
+			Module::ProcessingLoopAPI (*module).reset_cache();
+
+		for (auto* module: serial.modules())
+			Module::ProcessingLoopAPI (*module).fetch_and_process (cycle);
+
+		for (auto* module: parallel.modules())
+			Module::ProcessingLoopAPI (*module).reset_cache();
+
+		graph.execute (cycle, work_performer);
+
+		test_asserts::verify ("parallel results match serial results", serial.results() == parallel.results());
+	}
+
+	test_asserts::verify ("critical path is not empty", !graph.critical_path().empty());
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,133 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/utility/periodic_thread.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/dummy_qapplication.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QTimer>
+
+// Standard:
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr si::Frequency	kLoopFrequency	= 100_Hz;
+constexpr si::Time		kTestDuration	= 10_s;
+
+xf::Logger g_null_logger;
+
+
+void
+print_jitter_stats (std::string_view const& name, std::vector<si::Time> samples)
+{
+	if (samples.empty())
+		return;
+
+	std::sort (samples.begin(), samples.end());
+
+	si::Time sum = 0_s;
+
+	for (auto const& s: samples)
+		sum += s;
+
+	auto const percentile = [&samples] (double p) {
+		return samples[std::min<std::size_t> (samples.size() - 1, p * samples.size())].in<si::Millisecond>();
+	};
+
+	std::cout << name << ": samples=" << samples.size()
+			  << " min=" << samples.front().in<si::Millisecond>() << " ms"
+			  << " mean=" << (sum / samples.size()).in<si::Millisecond>() << " ms"
+			  << " p99=" << percentile (0.99) << " ms"
+			  << " p99.9=" << percentile (0.999) << " ms"
+			  << " max=" << samples.back().in<si::Millisecond>() << " ms" << std::endl;
+}
+
+
+/**
+ * Compare wake-up jitter of a QTimer-driven loop and a PeriodicThread-driven loop
+ * while the Qt event loop is loaded with synthetic GUI work (busy-waits of random length,
+ * imitating painting of instruments).
+ */
+ManualTest t_1 ("xf::ProcessingLoop: QTimer vs PeriodicThread wake-up jitter under GUI load", []{
+	neutrino::DummyQApplication app;
+
+	auto const period = 1 / kLoopFrequency;
+	std::vector<si::Time> timer_jitters;
+	std::vector<si::Time> thread_jitters;
+	std::optional<si::Time> previous_timer_tick;
+
+	timer_jitters.reserve (static_cast<std::size_t> (kTestDuration / period));
+	thread_jitters.reserve (static_cast<std::size_t> (kTestDuration / period));
+
+	QTimer loop_timer;
+	loop_timer.setTimerType (Qt::PreciseTimer);
+	loop_timer.setInterval (period.in<si::Millisecond>());
+	QObject::connect (&loop_timer, &QTimer::timeout, [&] {
+		auto const now = TimeHelper::now();
+
+		if (previous_timer_tick)
+			timer_jitters.push_back (std::max (0_s, now - *previous_timer_tick - period));
+
+		previous_timer_tick = now;
+	});
+
+	std::mt19937 random_generator (0);
+	std::uniform_real_distribution<double> load_distribution (0.0, 12.0);
+
+	QTimer gui_load_timer;
+	gui_load_timer.setInterval (16);
+	QObject::connect (&gui_load_timer, &QTimer::timeout, [&] {
+		auto const busy_until = TimeHelper::now() + 1_ms * load_distribution (random_generator);
+
+		while (TimeHelper::now() < busy_until)
+			continue;
+	});
+
+	PeriodicThread loop_thread (period, [&] (si::Time wakeup_jitter) {
+		thread_jitters.push_back (wakeup_jitter);
+	}, {}, g_null_logger);
+
+	QTimer::singleShot (kTestDuration.in<si::Millisecond>(), [&] {
+		loop_thread.stop();
+		app->quit();
+	});
+
+	loop_timer.start();
+	gui_load_timer.start();
+	loop_thread.start();
+	app->exec();
+
+	print_jitter_stats ("QTimer        ", timer_jitters);
+	print_jitter_stats ("PeriodicThread", thread_jitters);
+	std::cout << "PeriodicThread missed deadlines: " << loop_thread.missed_deadlines() << std::endl;
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,107 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/module.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf::test {
+namespace {
+
+class CountingModule: public Module
+{
+  public:
+	ModuleIn<int>	input			{ this, "input" };
+	int				process_calls	{ 0 };
+
+  public:
+	using Module::Module;
+
+	void
+	process (Cycle const&) override
+	{
+		++process_calls;
+	}
+};
+
+
+void
+run_cycle (TestCycle& cycle, Module& source, CountingModule& module)
+{
+	cycle += 1_s;
+	Module::ProcessingLoopAPI (source).reset_cache();
+	Module::ProcessingLoopAPI (module).reset_cache();
+	Module::ProcessingLoopAPI (module).fetch_and_process (cycle);
+}
+
+
+AutoTest t1 ("xf::Module: OnInputChange policy skips processing when inputs don't change", []{
+	Module source;
+	ModuleOut<int> out { &source, "out" };
+	CountingModule module;
+	TestCycle cycle;
+
+	module.input << out;
+	module.set_processing_policy (Module::ProcessingPolicy::OnInputChange);
+	out = 1;
+
+	run_cycle (cycle, source, module);
+	test_asserts::verify ("first cycle always processes", module.process_calls == 1);
+
+	run_cycle (cycle, source, module);
+	run_cycle (cycle, source, module);
+	test_asserts::verify ("unchanged input skips processing", module.process_calls == 1);
+
+	out = 2;
+	run_cycle (cycle, source, module);
+	test_asserts::verify ("changed input causes processing", module.process_calls == 2);
+
+	out = xf::nil;
+	run_cycle (cycle, source, module);
+	test_asserts::verify ("change to nil causes processing", module.process_calls == 3);
+
+	auto const accounting = Module::AccountingAPI (module);
+	test_asserts::verify ("skipped cycles are counted", accounting.skipped_cycles() == 2);
+	test_asserts::verify ("processed cycles are counted", accounting.processed_cycles() == 3);
+});
+
+
+AutoTest t2 ("xf::Module: OnInputChange policy respects maximum staleness", []{
+	Module source;
+	ModuleOut<int> out { &source, "out" };
+	CountingModule module;
+	TestCycle cycle;
+
+	module.input << out;
+	module.set_processing_policy (Module::ProcessingPolicy::OnInputChange, 3_s);
+	out = 1;
+
+	for (int i = 0; i < 7; ++i)
+		run_cycle (cycle, source, module);
+
+	// Processed at t=1 s, 4 s and 7 s:
+	test_asserts::verify ("module is processed at least every max-staleness period", module.process_calls == 3);
+});
+
+} // namespace
+} // namespace xf::test
+
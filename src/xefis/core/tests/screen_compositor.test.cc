@@ -0,0 +1,90 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/screen_compositor.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Qt:
+#include <QColor>
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+QImage
+make_image (QSize size, QColor color)
+{
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+	image.fill (color);
+	return image;
+}
+
+
+AutoTest t1 ("xf::ScreenCompositor: partial recomposition gives the same result as full recomposition", []{
+	QImage const a = make_image ({ 100, 100 }, QColor (255, 0, 0, 128));
+	QImage const b = make_image ({ 100, 100 }, QColor (0, 255, 0, 128));
+	QImage const c = make_image ({ 50, 50 }, QColor (0, 0, 255, 255));
+	QImage const b2 = make_image ({ 100, 100 }, QColor (0, 255, 255, 64));
+
+	// A and B overlap; C is separate:
+	std::vector<ScreenCompositor::Layer> layers {
+		{ QRect (0, 0, 100, 100), &a, false },
+		{ QRect (50, 50, 100, 100), &b, false },
+		{ QRect (200, 0, 50, 50), &c, false },
+	};
+
+	QImage partial_canvas = make_image ({ 300, 200 }, Qt::black);
+	ScreenCompositor partial;
+
+	auto const initial_damage = partial.compose (partial_canvas, layers);
+	test_asserts::verify ("first composition is full", initial_damage == QRegion (partial_canvas.rect()));
+	test_asserts::verify ("nothing damaged, nothing composed", partial.compose (partial_canvas, layers).isEmpty());
+
+	// Repaint B, which lies over A:
+	layers[1].image = &b2;
+	layers[1].damaged = true;
+
+	auto const damage = partial.compose (partial_canvas, layers);
+	test_asserts::verify ("only B area is damaged", damage == QRegion (layers[1].position));
+
+	QImage full_canvas = make_image ({ 300, 200 }, Qt::black);
+	ScreenCompositor full;
+	layers[1].damaged = false;
+	full.compose (full_canvas, layers);
+
+	test_asserts::verify ("overlapping layers are re-blended correctly", partial_canvas == full_canvas);
+
+	// Move C, old area must be cleared:
+	partial.damage (layers[2].position);
+	layers[2].position.moveTo (200, 100);
+	layers[2].damaged = true;
+	partial.compose (partial_canvas, layers);
+
+	full.invalidate();
+	full.compose (full_canvas, layers);
+
+	test_asserts::verify ("moved layer leaves no trace", partial_canvas == full_canvas);
+});
+
+} // namespace
+} // namespace xf::test
+
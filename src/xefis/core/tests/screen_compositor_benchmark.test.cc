@@ -0,0 +1,129 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/screen_compositor.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QColor>
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr QSize			kScreenSize		{ 1366, 768 };
+constexpr int			kColumns		= 5;
+constexpr int			kRows			= 4;
+constexpr std::size_t	kFrames			= 500;
+
+
+/**
+ * 20 instruments in a 5×4 grid. Each instrument is slightly larger than its grid cell,
+ * so neighbours overlap like on real screens.
+ */
+std::vector<QImage>
+make_images()
+{
+	std::vector<QImage> images;
+
+	for (int i = 0; i < kColumns * kRows; ++i)
+	{
+		QImage image (kScreenSize.width() / kColumns + 20, kScreenSize.height() / kRows + 20, QImage::Format_ARGB32_Premultiplied);
+		image.fill (QColor (10 * i, 255 - 10 * i, 128, 200));
+		images.push_back (std::move (image));
+	}
+
+	return images;
+}
+
+
+std::vector<ScreenCompositor::Layer>
+make_layers (std::vector<QImage> const& images)
+{
+	std::vector<ScreenCompositor::Layer> layers;
+
+	for (int i = 0; i < kColumns * kRows; ++i)
+	{
+		QPoint const top_left ((i % kColumns) * kScreenSize.width() / kColumns - 10,
+							   (i / kColumns) * kScreenSize.height() / kRows - 10);
+		layers.push_back ({ QRect (top_left, images[i].size()), &images[i], false });
+	}
+
+	return layers;
+}
+
+
+/**
+ * Return average composition time per frame.
+ * In each frame damaged_per_frame instruments are marked as repainted;
+ * if full is true, the whole screen is recomposed like before damage tracking.
+ */
+si::Time
+run (std::size_t damaged_per_frame, bool full)
+{
+	auto const images = make_images();
+	auto layers = make_layers (images);
+	QImage canvas (kScreenSize, QImage::Format_ARGB32_Premultiplied);
+	ScreenCompositor compositor;
+	std::size_t next_damaged = 0;
+
+	compositor.compose (canvas, layers);
+
+	auto const total_time = TimeHelper::measure ([&] {
+		for (std::size_t frame = 0; frame < kFrames; ++frame)
+		{
+			for (auto& layer: layers)
+				layer.damaged = false;
+
+			for (std::size_t d = 0; d < damaged_per_frame; ++d)
+				layers[next_damaged++ % layers.size()].damaged = true;
+
+			if (full)
+				compositor.invalidate();
+
+			compositor.compose (canvas, layers);
+		}
+	});
+
+	return total_time / kFrames;
+}
+
+
+ManualTest t_1 ("xf::ScreenCompositor: full vs. partial recomposition, 1366×768, 20 instruments", []{
+	auto const full_time = run (0, true);
+
+	std::cout << "Full recomposition:        " << full_time.in<si::Millisecond>() << " ms/frame" << std::endl;
+
+	for (std::size_t damaged: { 0u, 1u, 2u, 5u, 10u, 20u })
+	{
+		auto const partial_time = run (damaged, false);
+
+		std::cout << "Partial, " << damaged << " damaged instruments: " << partial_time.in<si::Millisecond>() << " ms/frame"
+				  << " (" << full_time / partial_time << "× faster)" << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
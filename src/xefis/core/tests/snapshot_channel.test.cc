@@ -0,0 +1,100 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/snapshot_channel.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+using Block = std::array<uint64_t, 32>;
+
+
+AutoTest t1 ("xf::SnapshotChannel: readers see the most recently published value", []{
+	SnapshotChannel<int> channel (5);
+
+	test_asserts::verify ("initial value is readable", *channel.read() == 5);
+
+	channel.publish (7);
+	test_asserts::verify ("published value is readable", *channel.read() == 7);
+
+	channel.publish_with ([](int& value) { value = 9; });
+	test_asserts::verify ("value published in place is readable", *channel.read() == 9);
+});
+
+
+AutoTest t2 ("xf::SnapshotChannel: pinned snapshots are not overwritten", []{
+	SnapshotChannel<int, 3> channel (0);
+
+	auto const first = channel.read();
+	channel.publish (1);
+	auto const second = channel.read();
+
+	test_asserts::verify ("no free slot when all non-current slots are pinned", !channel.publish (2));
+	test_asserts::verify ("failed publish is counted", channel.failed_publishes() == 1);
+	test_asserts::verify ("first snapshot unchanged", *first == 0);
+	test_asserts::verify ("second snapshot unchanged", *second == 1);
+	test_asserts::verify ("current value unchanged", *channel.read() == 1);
+});
+
+
+AutoTest t3 ("xf::SnapshotChannel: concurrent readers always see consistent blocks", []{
+	constexpr std::size_t kReaders = 4;
+	constexpr uint64_t kPublishes = 20'000;
+
+	SnapshotChannel<Block> channel;
+	std::atomic<bool> stop { false };
+	std::atomic<std::size_t> inconsistencies { 0 };
+	std::vector<std::thread> readers;
+
+	for (std::size_t r = 0; r < kReaders; ++r)
+	{
+		readers.emplace_back ([&] {
+			while (!stop.load (std::memory_order_relaxed))
+			{
+				auto const snapshot = channel.read();
+
+				for (auto const v: *snapshot)
+					if (v != (*snapshot)[0])
+						inconsistencies.fetch_add (1, std::memory_order_relaxed);
+			}
+		});
+	}
+
+	for (uint64_t i = 1; i <= kPublishes; ++i)
+		channel.publish_with ([i](Block& block) { block.fill (i); });
+
+	stop.store (true);
+
+	for (auto& reader: readers)
+		reader.join();
+
+	test_asserts::verify ("no torn reads", inconsistencies.load() == 0);
+	test_asserts::verify ("last value is current", (*channel.read())[0] == kPublishes || channel.failed_publishes() > 0);
+});
+
+} // namespace
+} // namespace xf::test
+
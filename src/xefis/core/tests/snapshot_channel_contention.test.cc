@@ -0,0 +1,141 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/snapshot_channel.h>
+
+// Neutrino:
+#include <neutrino/synchronized.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+// Roughly the size of ADI parameters:
+using Parameters = std::array<double, 128>;
+
+constexpr si::Time		kTestDuration	= 2_s;
+constexpr si::Frequency	kPublishRate	= 1_kHz;
+
+
+class Result
+{
+  public:
+	double	reads_per_second;
+	double	max_publish_time_us;
+};
+
+
+/**
+ * Simulate painting: read the whole parameter block.
+ */
+double
+paint (Parameters const& parameters)
+{
+	double sum = 0.0;
+
+	for (auto const v: parameters)
+		sum += v;
+
+	return sum;
+}
+
+
+template<class Publish, class Read>
+	Result
+	run (std::size_t screens, Publish&& publish, Read&& read)
+	{
+		std::atomic<bool> stop { false };
+		std::atomic<uint64_t> reads { 0 };
+		std::atomic<double> sink { 0.0 };
+		std::vector<std::thread> painters;
+
+		for (std::size_t s = 0; s < screens; ++s)
+		{
+			painters.emplace_back ([&] {
+				uint64_t local_reads = 0;
+				double local_sink = 0.0;
+
+				while (!stop.load (std::memory_order_relaxed))
+				{
+					local_sink += read();
+					++local_reads;
+				}
+
+				reads.fetch_add (local_reads);
+				sink.store (local_sink, std::memory_order_relaxed);
+			});
+		}
+
+		si::Time max_publish_time = 0_s;
+		auto const start = TimeHelper::now();
+		Parameters parameters {};
+
+		for (uint64_t cycle = 0; TimeHelper::now() - start < kTestDuration; ++cycle)
+		{
+			parameters.fill (static_cast<double> (cycle));
+			max_publish_time = std::max (max_publish_time, TimeHelper::measure ([&] { publish (parameters); }));
+			std::this_thread::sleep_for (std::chrono::microseconds (static_cast<int64_t> ((1 / kPublishRate).in<si::Microsecond>())));
+		}
+
+		stop.store (true);
+
+		for (auto& painter: painters)
+			painter.join();
+
+		return {
+			reads.load() / kTestDuration.in<si::Second>(),
+			max_publish_time.in<si::Microsecond>(),
+		};
+	}
+
+
+ManualTest t_1 ("xf::SnapshotChannel: contention with many screens vs. Synchronized<> copies", []{
+	for (std::size_t screens: { 1u, 2u, 4u, 8u, 16u })
+	{
+		Synchronized<Parameters> synchronized;
+		SnapshotChannel<Parameters> channel;
+
+		auto const sync_result = run (
+			screens,
+			[&] (Parameters const& p) { *synchronized.lock() = p; },
+			[&] { auto const copy = *synchronized.lock(); return paint (copy); }
+		);
+
+		auto const channel_result = run (
+			screens,
+			[&] (Parameters const& p) { channel.publish (p); },
+			[&] { auto const snapshot = channel.read(); return paint (*snapshot); }
+		);
+
+		std::cout << screens << " screens:" << std::endl;
+		std::cout << "  Synchronized<>:  " << sync_result.reads_per_second / 1e6 << " M reads/s, max publish time " << sync_result.max_publish_time_us << " µs" << std::endl;
+		std::cout << "  SnapshotChannel: " << channel_result.reads_per_second / 1e6 << " M reads/s, max publish time " << channel_result.max_publish_time_us << " µs"
+				  << ", failed publishes " << channel.failed_publishes() << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -16,6 +16,8 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
+#include <xefis/core/sockets/socket_clock.h>
 
 // Neutrino:
 #include <neutrino/numeric.h>
@@ -254,6 +256,8 @@ FlightGear::read_input()
 			_input_datagram.resize (datagram_size);
 
 		_input->readDatagram (_input_datagram.data(), datagram_size, nullptr, nullptr);
+		// All values from a single datagram share the timestamp of its reception:
+		xf::SocketClock::TimestampScope socket_timestamp_scope (xf::Clock::now());
 
 		if (!_io.input_enabled)
 			continue;
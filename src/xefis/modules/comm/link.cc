@@ -20,7 +20,6 @@
 #include <xefis/utility/hextable.h>
 
 // Neutrino:
-#include <neutrino/crypto/hmac.h>
 #include <neutrino/qt/qdom.h>
 #include <neutrino/qt/qdom_iterator.h>
 #include <neutrino/stdexcept.h>
@@ -29,9 +28,13 @@
 #include <boost/endian/conversion.hpp>
 
 // Standard:
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <memory>
 #include <random>
+#include <span>
 
 
 using namespace neutrino::si::literals;
@@ -62,11 +65,18 @@ LinkProtocol::Sequence::produce (Blob& blob)
 }
 
 
-Blob::const_iterator
+LinkProtocol::EatResult
 LinkProtocol::Sequence::eat (Blob::const_iterator begin, Blob::const_iterator end)
 {
 	for (auto const& packet: _packets)
-		begin = packet->eat (begin, end);
+	{
+		auto const result = packet->eat (begin, end);
+
+		if (!result)
+			return std::nullopt;
+
+		begin = *result;
+	}
 
 	return begin;
 }
@@ -88,14 +98,39 @@ LinkProtocol::Sequence::failsafe()
 }
 
 
+std::size_t
+LinkProtocol::Sequence::encoding_errors() const
+{
+	std::size_t errors = 0;
+
+	for (auto const& packet: _packets)
+		errors += packet->encoding_errors();
+
+	return errors;
+}
+
+
 LinkProtocol::Bitfield::Bitfield (std::initializer_list<SourceVariant> sources):
 	_bit_sources (sources)
 {
-	Blob::size_type total_bits = 0;
+	std::size_t total_bits = 0;
 
 	for (auto const& bsvariant: _bit_sources)
 	{
-		std::visit ([&total_bits] (auto&& bs) noexcept {
+		std::visit ([&] (auto&& bs) {
+			if (bs.bits > 64)
+				throw xf::InvalidArgument ("bitfield source can't have more than 64 bits");
+
+			auto const shift = static_cast<uint8_t> (total_bits % 64);
+
+			_positions.push_back ({
+				.word = total_bits / 64,
+				.shift = shift,
+				.mask = bs.bits == 64 ? ~uint64_t (0) : (uint64_t (1) << bs.bits) - 1,
+				.ends_word = shift + bs.bits >= 64,
+				.spans_words = shift + bs.bits > 64,
+			});
+
 			total_bits += bs.bits;
 		}, bsvariant);
 	}
@@ -114,65 +149,85 @@ LinkProtocol::Bitfield::size() const
 void
 LinkProtocol::Bitfield::produce (Blob& blob)
 {
-	std::vector<bool> bits;
-	bits.reserve (8 * size());
-
-	for (auto const& bsvariant: _bit_sources)
+	auto const offset = blob.size();
+	blob.resize (offset + _size);
+	uint8_t* output = blob.data() + offset;
+	uint8_t* const output_end = output + _size;
+	uint64_t word = 0;
+
+	auto store_word = [&output] (uint64_t const value, std::size_t const bytes) {
+		uint64_t const little = boost::endian::native_to_little (value);
+		std::memcpy (output, &little, bytes);
+		output += bytes;
+	};
+
+	for (std::size_t i = 0; i < _bit_sources.size(); ++i)
 	{
-		std::visit ([&bits] (auto&& bs) {
-			uint_least64_t v = bs.fallback_value;
+		auto const& position = _positions[i];
 
-			if (bs.socket && fits_in_bits (*bs.socket, Bits (bs.bits)))
-				v = *bs.socket;
-			// TODO signal error if doesn't fits_in_bits()?
-
-			for (uint8_t b = 0; b < bs.bits; ++b)
-				bits.push_back ((v >> b) & 1);
-		}, bsvariant);
-	}
+		uint64_t const value = std::visit ([this] (auto&& bs) -> uint64_t {
+			if (bs.socket)
+			{
+				if (fits_in_bits (*bs.socket, Bits (bs.bits)))
+					return *bs.socket;
 
-	bits.resize (8 * size(), 0);
+				++_encoding_errors;
+			}
 
-	for (std::vector<bool>::size_type b = 0; b < bits.size(); b += 8)
-	{
-		uint8_t byte = 0;
+			return bs.fallback_value;
+		}, _bit_sources[i]) & position.mask;
 
-		for (std::vector<bool>::size_type k = 0; k < 8; ++k)
-			if (bits[k + b])
-				byte |= 1u << k;
+		word |= value << position.shift;
 
-		blob.push_back (byte);
+		if (position.ends_word)
+		{
+			store_word (word, 8);
+			// Bits that didn't fit in the stored word:
+			word = position.spans_words ? value >> (64 - position.shift) : 0;
+		}
 	}
+
+	store_word (word, neutrino::to_unsigned (output_end - output));
 }
 
 
-Blob::const_iterator
+LinkProtocol::EatResult
 LinkProtocol::Bitfield::eat (Blob::const_iterator begin, Blob::const_iterator end)
 {
 	if (std::distance (begin, end) < static_cast<Blob::difference_type> (size()))
-		throw InsufficientDataError();
+		return std::nullopt;
 
-	std::vector<bool> bits;
-	bits.reserve (8 * size());
+	auto const* const input = std::to_address (begin);
 
-	for (Blob::const_iterator cur = begin; cur < begin + neutrino::to_signed (size()); ++cur)
-		for (uint8_t b = 0; b < 8; ++b)
-			bits.push_back ((*cur >> b) & 1);
+	auto load_word = [this, input] (std::size_t const index) -> uint64_t {
+		uint64_t little = 0;
+		std::memcpy (&little, input + 8 * index, std::min<std::size_t> (8, _size - 8 * index));
+		return boost::endian::little_to_native (little);
+	};
 
-	std::vector<bool>::iterator bit = bits.begin();
+	std::optional<std::size_t> loaded_index;
+	uint64_t word = 0;
 
-	for (auto& bsvariant: _bit_sources)
+	for (std::size_t i = 0; i < _bit_sources.size(); ++i)
 	{
-		std::visit ([&bit, &bits] (auto&& bs) {
-			uint_least64_t v = 0;
+		auto const& position = _positions[i];
+
+		if (loaded_index != position.word)
+		{
+			word = load_word (position.word);
+			loaded_index = position.word;
+		}
 
-			for (uint8_t b = 0; b < bs.bits; ++b)
-				if (*(bit + b))
-					v |= 1u << b;
+		uint64_t value = word >> position.shift;
 
-			bs.value = v;
-			std::advance (bit, bs.bits);
-		}, bsvariant);
+		if (position.spans_words)
+			value |= load_word (position.word + 1) << (64 - position.shift);
+
+		value &= position.mask;
+
+		std::visit ([value] (auto&& bs) {
+			bs.value = static_cast<std::remove_cvref_t<decltype (bs.value)>> (value);
+		}, _bit_sources[i]);
 	}
 
 	return begin + neutrino::to_signed (size());
@@ -206,13 +261,19 @@ LinkProtocol::Bitfield::failsafe()
 
 
 LinkProtocol::Signature::Signature (NonceBytes nonce_bytes, SignatureBytes signature_bytes, Key key, PacketList packets):
+	Signature (MACAlgorithm::HMAC_SHA3_256, nonce_bytes, signature_bytes, key, packets)
+{ }
+
+
+LinkProtocol::Signature::Signature (MACAlgorithm mac_algorithm, NonceBytes nonce_bytes, SignatureBytes signature_bytes, Key key, PacketList packets):
 	Sequence (packets),
 	_nonce_bytes (*nonce_bytes),
 	_signature_bytes (*signature_bytes),
-	_key (*key),
+	_mac (mac_algorithm, *key),
 	_rng (std::random_device{}())
 {
-	_temp.reserve (size());
+	if (_signature_bytes > _mac.size())
+		throw xf::InvalidArgument ("signature can't be longer than result of the MAC algorithm");
 }
 
 
@@ -226,53 +287,46 @@ LinkProtocol::Signature::size() const
 void
 LinkProtocol::Signature::produce (Blob& blob)
 {
-	_temp.clear();
+	auto const data_begin = blob.size();
 
 	// Add data:
-	Sequence::produce (_temp);
+	Sequence::produce (blob);
 
 	// Append nonce:
 	std::uniform_int_distribution<uint8_t> distribution;
 
 	for (unsigned int i = 0; i < _nonce_bytes; ++i)
-		_temp.push_back (distribution (_rng));
+		blob.push_back (distribution (_rng));
 
-	auto const hmac = xf::calculate_hmac<xf::Hash::SHA3_256> ({ .data = _temp, .key = _key });
-	// Add some of the bytes of HMAC signature:
-	size_t hmac_bytes = std::min<size_t> (_signature_bytes, hmac.size());
-	_temp += hmac.substr (0, hmac_bytes);
-
-	// Output:
-	blob += _temp;
+	// Append first bytes of the MAC of data and nonce:
+	auto const signature_begin = blob.size();
+	blob.resize (signature_begin + _signature_bytes);
+	_mac.calculate ({ BlobView (blob.data() + data_begin, signature_begin - data_begin) },
+					std::span (blob.data() + signature_begin, _signature_bytes));
 }
 
 
-Blob::const_iterator
+LinkProtocol::EatResult
 LinkProtocol::Signature::eat (Blob::const_iterator begin, Blob::const_iterator end)
 {
 	auto const data_size = Sequence::size();
 	auto const whole_size = size();
 
 	if (std::distance (begin, end) < static_cast<Blob::difference_type> (whole_size))
-		throw InsufficientDataError();
-
-	auto const sign_begin = begin + neutrino::to_signed (data_size + _nonce_bytes);
-	auto const sign_end = begin + neutrino::to_signed (whole_size);
-
-	// Make a temporary copy of the data:
-	_temp.resize (data_size + _nonce_bytes);
-	std::copy (begin, sign_begin, _temp.begin());
+		return std::nullopt;
 
-	auto const hmac = xf::calculate_hmac<xf::Hash::SHA3_256> ({ .data = _temp, .key = _key });
+	// Verify directly in the input buffer:
+	auto const signed_data = BlobView (std::to_address (begin), data_size + _nonce_bytes);
+	auto const signature = BlobView (std::to_address (begin) + signed_data.size(), _signature_bytes);
 
-	// If HMACs differ, it's a parsing error:
-	if (!std::equal (sign_begin, sign_end, hmac.begin()))
-		throw ParseError();
+	// If signatures differ, it's a parsing error:
+	if (!_mac.verify ({ signed_data }, signature))
+		return std::nullopt;
 
 	auto const eating_end = begin + neutrino::to_signed (data_size);
 
 	if (Sequence::eat (begin, eating_end) != eating_end)
-		throw ParseError();
+		return std::nullopt;
 
 	return begin + neutrino::to_signed (whole_size);
 }
@@ -319,6 +373,109 @@ LinkProtocol::Envelope::produce (Blob& blob)
 }
 
 
+LinkProtocol::MagicTable::MagicTable (std::vector<std::shared_ptr<Envelope>> const& envelopes, Blob::size_type const magic_size):
+	_magic_size (magic_size)
+{
+	if (envelopes.empty())
+		return;
+
+	// Find a seed for which no two different magics fall into the same slot. With table at least
+	// twice as large as number of envelopes, a few attempts are usually enough; grow the table if not:
+	for (std::size_t table_bits = 1; ; ++table_bits)
+	{
+		if ((std::size_t (1) << table_bits) < 2 * envelopes.size())
+			continue;
+
+		_shift = 64 - table_bits;
+
+		for (uint64_t attempt = 0; attempt < 64; ++attempt)
+		{
+			uint64_t const seed = 0xcbf29ce484222325 + attempt * 0x9e3779b97f4a7c15;
+			std::vector<Envelope*> slots (std::size_t (1) << table_bits, nullptr);
+			bool collision = false;
+
+			for (auto const& envelope: envelopes)
+			{
+				auto const& magic = envelope->magic();
+				auto& slot_envelope = slots[slot (magic.data(), seed)];
+
+				// Same magic used twice: the last envelope wins.
+				if (slot_envelope && slot_envelope->magic() != magic)
+				{
+					collision = true;
+					break;
+				}
+
+				slot_envelope = envelope.get();
+			}
+
+			if (!collision)
+			{
+				_seed = seed;
+				_slots = std::move (slots);
+				break;
+			}
+		}
+
+		if (!_slots.empty())
+			break;
+	}
+
+	if (_magic_size > 0)
+	{
+		for (auto const& envelope: envelopes)
+			_first_bytes[envelope->magic()[0]] = true;
+
+		if (std::count (_first_bytes.begin(), _first_bytes.end(), true) == 1)
+			_common_first_byte = envelopes[0]->magic()[0];
+	}
+}
+
+
+LinkProtocol::Envelope*
+LinkProtocol::MagicTable::find (uint8_t const* magic) const noexcept
+{
+	if (_slots.empty())
+		return nullptr;
+
+	auto* const envelope = _slots[slot (magic, _seed)];
+
+	if (envelope && std::equal (magic, magic + _magic_size, envelope->magic().data()))
+		return envelope;
+	else
+		return nullptr;
+}
+
+
+uint8_t const*
+LinkProtocol::MagicTable::find_candidate (uint8_t const* begin, uint8_t const* end) const noexcept
+{
+	// Empty magic matches at every position:
+	if (_magic_size == 0)
+		return begin;
+
+	if (_common_first_byte)
+	{
+		// memchr() is vectorized by the C library:
+		auto const* found = std::memchr (begin, *_common_first_byte, neutrino::to_unsigned (end - begin));
+		return found ? static_cast<uint8_t const*> (found) : end;
+	}
+	else
+		return std::find_if (begin, end, [this] (uint8_t byte) { return _first_bytes[byte]; });
+}
+
+
+inline std::size_t
+LinkProtocol::MagicTable::slot (uint8_t const* magic, uint64_t hash) const noexcept
+{
+	// FNV-1a with given seed as the offset basis, then a multiplicative hash to take the top bits:
+	for (Blob::size_type i = 0; i < _magic_size; ++i)
+		hash = (hash ^ magic[i]) * 0x100000001b3;
+
+	return static_cast<std::size_t> ((hash * 0x9e3779b97f4a7c15) >> _shift);
+}
+
+
 LinkProtocol::LinkProtocol (EnvelopeList envelopes):
 	_envelopes (envelopes)
 {
@@ -327,13 +484,11 @@ LinkProtocol::LinkProtocol (EnvelopeList envelopes):
 		_magic_size = _envelopes[0]->magic().size();
 
 		for (auto const& e: _envelopes)
-		{
 			if (e->magic().size() != _magic_size)
 				throw InvalidMagicSize();
-
-			_envelope_magics[e->magic()] = e;
-		}
 	}
+
+	_magic_table = MagicTable (_envelopes, _magic_size);
 }
 
 
@@ -350,60 +505,39 @@ LinkProtocol::produce (Blob& blob, [[maybe_unused]] xf::Logger const& logger)
 
 
 Blob::const_iterator
-LinkProtocol::eat (Blob::const_iterator begin, Blob::const_iterator end, Link* link, QTimer* reacquire_timer, QTimer* failsafe_timer, xf::Logger const& logger)
+LinkProtocol::eat (Blob::const_iterator begin, Blob::const_iterator end, Link* link, QTimer* reacquire_timer, QTimer* failsafe_timer, [[maybe_unused]] xf::Logger const& logger)
 {
 #if XEFIS_LINK_RECV_DEBUG
 	logger << "Recv: " << to_string (Blob (begin, end)) << std::endl;
 #endif
 
-	_aux_magic_buffer.resize (_magic_size);
-
-	while (std::distance (begin, end) > static_cast<Blob::difference_type> (_magic_size + 1))
-	{
-		auto skip_byte_and_retry = [&]() {
-			// Skip one byte and try again:
-			if (std::distance (begin, end) >= 1)
-				++begin;
+	auto skip_bytes = [&] (Blob::const_iterator const new_begin) {
+		auto const skipped = std::distance (begin, new_begin);
+		begin = new_begin;
 
+		if (skipped > 0)
+		{
 			if (link)
-				link->link_error_bytes = link->link_error_bytes.value_or (0) + 1;
+				link->link_error_bytes = link->link_error_bytes.value_or (0) + skipped;
 
 			// Since there was an error, stop the reacquire timer:
 			if (reacquire_timer)
 				reacquire_timer->stop();
-		};
-
-		bool return_from_outer_function = false;
-		Blob::const_iterator outer_result = begin;
-
-		xf::Exception::catch_and_log (logger, [&] {
-			try {
-				// Find the right magic and envelope:
-				std::copy (begin, begin + neutrino::to_signed (_magic_size), _aux_magic_buffer.begin());
-				auto envelope_and_magic = _envelope_magics.find (_aux_magic_buffer);
-
-				// If not found, retry starting with next byte:
-				if (envelope_and_magic == _envelope_magics.end())
-					throw LinkProtocol::ParseError();
-
-				auto envelope = envelope_and_magic->second;
-				// Now see if we have enough data in input buffer for this envelope type.
-				// If not, return and retry when enough data is read.
-				if (neutrino::to_unsigned (std::distance (begin, end)) - _magic_size < envelope->size())
-				{
-					return_from_outer_function = true;
-					outer_result = begin;
-					return;
-				}
+		}
+	};
 
-				auto e = envelope->eat (begin + neutrino::to_signed (_magic_size), end);
+	while (begin != end)
+	{
+		// Skip bytes that can't start any magic string at once:
+		auto const* const data = std::to_address (begin);
+		skip_bytes (begin + (_magic_table.find_candidate (data, std::to_address (end)) - data));
 
-				if (e != begin)
-				{
-					envelope->apply();
-					begin = e;
-				}
+		if (neutrino::to_unsigned (std::distance (begin, end)) < _magic_size)
+			break;
 
+		switch (eat_envelope (begin, end))
+		{
+			case EnvelopeResult::Valid:
 				if (link)
 					link->link_valid_envelopes = link->link_valid_envelopes.value_or (0) + 1;
 
@@ -416,26 +550,49 @@ LinkProtocol::eat (Blob::const_iterator begin, Blob::const_iterator end, Link* l
 				if (reacquire_timer && link)
 					if (!link->link_valid.value_or (false) && !reacquire_timer->isActive())
 						reacquire_timer->start();
-			}
-			catch (LinkProtocol::ParseError&)
-			{
-				skip_byte_and_retry();
-			}
-			catch (...)
-			{
-				skip_byte_and_retry();
-				throw;
-			}
-		});
 
-		if (return_from_outer_function)
-			return outer_result;
+				break;
+
+			case EnvelopeResult::Incomplete:
+				// Retry when more data is read:
+				return begin;
+
+			case EnvelopeResult::UnknownMagic:
+			case EnvelopeResult::Invalid:
+				// Retry starting with next byte:
+				skip_bytes (std::next (begin));
+				break;
+		}
 	}
 
 	return begin;
 }
 
 
+LinkProtocol::EnvelopeResult
+LinkProtocol::eat_envelope (Blob::const_iterator& begin, Blob::const_iterator const end)
+{
+	auto* const envelope = _magic_table.find (std::to_address (begin));
+
+	if (!envelope)
+		return EnvelopeResult::UnknownMagic;
+
+	auto const data_begin = begin + neutrino::to_signed (_magic_size);
+
+	if (neutrino::to_unsigned (std::distance (data_begin, end)) < envelope->size())
+		return EnvelopeResult::Incomplete;
+
+	auto const result = envelope->eat (data_begin, end);
+
+	if (!result)
+		return EnvelopeResult::Invalid;
+
+	envelope->apply();
+	begin = *result;
+	return EnvelopeResult::Valid;
+}
+
+
 Blob::size_type
 LinkProtocol::size() const
 {
@@ -456,6 +613,18 @@ LinkProtocol::failsafe()
 }
 
 
+std::size_t
+LinkProtocol::encoding_errors() const
+{
+	std::size_t errors = 0;
+
+	for (auto const& e: _envelopes)
+		errors += e->encoding_errors();
+
+	return errors;
+}
+
+
 std::string
 LinkProtocol::to_string (Blob const& blob)
 {
@@ -519,19 +688,13 @@ Link::verify_settings()
 void
 Link::process (xf::Cycle const& cycle)
 {
-	try {
-		if (_io.link_input && _input_changed.serial_changed())
-		{
-			_input_blob.insert (_input_blob.end(), _io.link_input->begin(), _io.link_input->end());
-			auto e = _protocol->eat (_input_blob.begin(), _input_blob.end(), this, _reacquire_timer, _failsafe_timer, cycle.logger() + _logger);
-			auto valid_bytes = std::distance (_input_blob.cbegin(), e);
-			_io.link_valid_bytes = _io.link_valid_bytes.value_or (0) + valid_bytes;
-			_input_blob.erase (_input_blob.begin(), e);
-		}
-	}
-	catch (LinkProtocol::ParseError const&)
+	if (_io.link_input && _input_changed.serial_changed())
 	{
-		(cycle.logger() + _logger) << "Packet parse error. Couldn't synchronize." << std::endl;
+		_input_blob.insert (_input_blob.end(), _io.link_input->begin(), _io.link_input->end());
+		auto e = _protocol->eat (_input_blob.begin(), _input_blob.end(), this, _reacquire_timer, _failsafe_timer, cycle.logger() + _logger);
+		auto valid_bytes = std::distance (_input_blob.cbegin(), e);
+		_io.link_valid_bytes = _io.link_valid_bytes.value_or (0) + valid_bytes;
+		_input_blob.erase (_input_blob.begin(), e);
 	}
 }
 
@@ -542,6 +705,7 @@ Link::send_output()
 	_output_blob.clear();
 	_protocol->produce (_output_blob, _logger);
 	_io.link_output = std::string (_output_blob.begin(), _output_blob.end());
+	_io.link_encoding_errors = neutrino::to_signed (_protocol->encoding_errors());
 }
 
 
@@ -19,6 +19,7 @@
 #include <xefis/core/module.h>
 #include <xefis/core/setting.h>
 #include <xefis/core/sockets/module_socket.h>
+#include <xefis/support/crypto/mac.h>
 #include <xefis/support/sockets/socket_changed.h>
 #include <xefis/utility/types.h>
 
@@ -33,12 +34,18 @@
 #include <QtCore/QTimer>
 
 // Standard:
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <random>
+#include <tuple>
 #include <type_traits>
 #include <variant>
 #include <vector>
@@ -65,20 +72,26 @@ class LinkProtocol
 	using Retained			= xf::StrongType<bool, struct RetainedType>;
 	using NonceBytes		= xf::StrongType<uint8_t, struct NonceBytesType>;
 	using SignatureBytes	= xf::StrongType<uint8_t, struct SignatureBytesType>;
+	using MACAlgorithm		= crypto::MAC::Algorithm;
 
 	/**
-	 * Thrown on known parse errors.
+	 * Result of parsing a packet: position just after the parsed data or nothing if the data is invalid
+	 * (eg. wrong signature or not enough input data).
+	 * Note that each Envelope's eat() is called when it's known for sure that there's enough data in the input buffer
+	 * to cover whole Envelope.
 	 */
-	class ParseError
-	{ };
+	using EatResult			= std::optional<Blob::const_iterator>;
 
 	/**
-	 * Thrown by sub-packets when there's no enough input data
-	 * Note that each Envelope's eat() is called when it's known for sure that there's enough data in the input buffer
-	 * to cover whole Envelope.
+	 * Result of trying to parse an envelope at some position of the input.
 	 */
-	class InsufficientDataError
-	{ };
+	enum class EnvelopeResult
+	{
+		Valid,			// Envelope parsed and applied.
+		UnknownMagic,	// No envelope starts with bytes at this position.
+		Incomplete,		// Magic is known, but there's not enough input data for the whole envelope yet.
+		Invalid,		// Magic is known, but data is corrupted (eg. wrong signature).
+	};
 
 	/**
 	 * Thrown when one of Envelopes has different magic string size than the others.
@@ -118,7 +131,7 @@ class LinkProtocol
 		 * Parse data and set temporary variables.
 		 * Data will be output when apply() is called.
 		 */
-		virtual Blob::const_iterator
+		virtual EatResult
 		eat (Blob::const_iterator, Blob::const_iterator) = 0;
 
 		/**
@@ -132,6 +145,14 @@ class LinkProtocol
 		 */
 		virtual void
 		failsafe() = 0;
+
+		/**
+		 * Return number of values that couldn't be encoded so far (eg. integers that don't fit in given
+		 * number of bits) and were sent as fallback values instead.
+		 */
+		virtual std::size_t
+		encoding_errors() const
+			{ return 0; }
 	};
 
 	using PacketList = std::initializer_list<std::shared_ptr<Packet>>;
@@ -152,7 +173,7 @@ class LinkProtocol
 		void
 		produce (Blob&) override;
 
-		Blob::const_iterator
+		EatResult
 		eat (Blob::const_iterator, Blob::const_iterator) override;
 
 		void
@@ -161,6 +182,9 @@ class LinkProtocol
 		void
 		failsafe() override;
 
+		std::size_t
+		encoding_errors() const override;
+
 	  private:
 		std::vector<std::shared_ptr<Packet>> _packets;
 	};
@@ -252,7 +276,7 @@ class LinkProtocol
 			produce (Blob& blob) override
 				{ _produce (blob); }
 
-			Blob::const_iterator
+			EatResult
 			eat (Blob::const_iterator const begin, Blob::const_iterator const end) override
 				{ return _eat (begin, end); }
 
@@ -275,7 +299,7 @@ class LinkProtocol
 			 */
 			template<class CastType, class SourceType>
 				[[nodiscard]]
-				static Blob::const_iterator
+				static EatResult
 				unserialize (Blob::const_iterator begin, Blob::const_iterator end, SourceType&);
 
 		  private:
@@ -287,7 +311,7 @@ class LinkProtocol
 			bool							_retained;
 			std::optional<Value>			_offset;
 			std::function<void (Blob&)>		_produce;
-			std::function<Blob::const_iterator (Blob::const_iterator, Blob::const_iterator)>
+			std::function<EatResult (Blob::const_iterator, Blob::const_iterator)>
 											_eat;
 		};
 
@@ -323,7 +347,7 @@ class LinkProtocol
 		void
 		produce (Blob&) override;
 
-		Blob::const_iterator
+		EatResult
 		eat (Blob::const_iterator, Blob::const_iterator) override;
 
 		void
@@ -332,17 +356,246 @@ class LinkProtocol
 		void
 		failsafe() override;
 
+		std::size_t
+		encoding_errors() const override
+			{ return _encoding_errors; }
+
+	  private:
+		/**
+		 * Position of a source in the bitfield, seen as a sequence of little-endian 64-bit words.
+		 */
+		struct SourcePosition
+		{
+			// Index of the word containing the least significant bit of the source:
+			std::size_t	word;
+			// Position of the least significant bit in the word:
+			uint8_t		shift;
+			uint64_t	mask;
+			// True if the source fills the word up to its last bit:
+			bool		ends_word;
+			// True if the source continues in the next word:
+			bool		spans_words;
+		};
+
 	  private:
 		std::vector<SourceVariant>	_bit_sources;
+		std::vector<SourcePosition>	_positions;
 		Blob::size_type				_size;
+		std::size_t					_encoding_errors	{ 0 };
 	};
 
+	/**
+	 * Field of a Layout that transmits value of a single socket.
+	 * Same wire format as the Socket packet.
+	 */
+	template<uint8_t pBytes, class pValue>
+		class LayoutSocket
+		{
+		  public:
+			using Value = pValue;
+
+			static constexpr Blob::size_type kSize { pBytes };
+
+			static_assert ((std::integral<Value> && (kSize == 1 || kSize == 2 || kSize == 4 || kSize == 8)) ||
+						   (si::FloatingPointOrQuantity<Value> && (kSize == 2 || kSize == 4 || kSize == 8)));
+
+		  public:
+			/**
+			 * Ctor for integrals
+			 * See Socket for the meaning of parameters.
+			 */
+			explicit
+			LayoutSocket (xf::Socket<Value>&, xf::AssignableSocket<Value>*, Retained, Value fallback_value)
+				requires (std::is_integral_v<Value>);
+
+			/**
+			 * Ctor for floating-point values and SI values
+			 * See Socket for the meaning of parameters.
+			 */
+			explicit
+			LayoutSocket (xf::Socket<Value>&, xf::AssignableSocket<Value>*, Retained, std::optional<Value> offset)
+				requires si::FloatingPointOrQuantity<Value>;
+
+			/**
+			 * Serialize value into kSize bytes at output.
+			 */
+			void
+			produce (uint8_t* output) const;
+
+			/**
+			 * Unserialize value from kSize bytes at input.
+			 */
+			void
+			eat (uint8_t const* input);
+
+			void
+			apply();
+
+			void
+			failsafe();
+
+		  private:
+			template<class CastType, class SourceType>
+				static void
+				store (uint8_t* output, SourceType);
+
+			template<class CastType>
+				[[nodiscard]]
+				static CastType
+				load (uint8_t const* input);
+
+		  private:
+			xf::Socket<Value>&				_socket;
+			xf::AssignableSocket<Value>*	_assignable_socket;
+			si::decay_quantity_t<Value>		_fallback_value {};
+			std::optional<Value>			_value;
+			bool							_retained;
+			std::optional<Value>			_offset;
+		};
+
+	/**
+	 * Boolean or limited-width integer in a LayoutBitfield.
+	 */
+	template<uint8_t pBits, class pValue>
+		class LayoutBit
+		{
+		  public:
+			using Value = pValue;
+
+			static constexpr uint8_t kBits { pBits };
+
+			static_assert ((std::is_same_v<Value, bool> && kBits == 1) ||
+						   (std::is_unsigned_v<Value> && !std::is_same_v<Value, bool> && kBits >= 1 && kBits <= 64));
+
+		  public:
+			// Ctor
+			explicit
+			LayoutBit (xf::Socket<Value>&, xf::AssignableSocket<Value>*, Retained, Value fallback_value);
+
+			/**
+			 * Return bits to send.
+			 */
+			[[nodiscard]]
+			uint64_t
+			produce();
+
+			/**
+			 * Set received bits.
+			 */
+			void
+			eat (uint64_t bits);
+
+			void
+			apply();
+
+			void
+			failsafe();
+
+			[[nodiscard]]
+			std::size_t
+			encoding_errors() const noexcept
+				{ return _encoding_errors; }
+
+		  private:
+			xf::Socket<Value>&				_socket;
+			xf::AssignableSocket<Value>*	_assignable_socket;
+			Value							_fallback_value;
+			Value							_value				{};
+			bool							_retained;
+			std::size_t						_encoding_errors	{ 0 };
+		};
+
+	/**
+	 * Field of a Layout with booleans and limited-width integers packed together.
+	 * Same wire format as the Bitfield packet.
+	 */
+	template<class... pBits>
+		class LayoutBitfield
+		{
+		  public:
+			static constexpr std::size_t		kBits { (pBits::kBits + ... + 0) };
+			static constexpr Blob::size_type	kSize { (kBits + 7) / 8 };
+
+		  public:
+			// Ctor
+			explicit
+			LayoutBitfield (pBits... bits):
+				_bits (std::move (bits)...)
+			{ }
+
+			void
+			produce (uint8_t* output);
+
+			void
+			eat (uint8_t const* input);
+
+			void
+			apply()
+				{ std::apply ([](auto&... bit) { (bit.apply(), ...); }, _bits); }
+
+			void
+			failsafe()
+				{ std::apply ([](auto&... bit) { (bit.failsafe(), ...); }, _bits); }
+
+			[[nodiscard]]
+			std::size_t
+			encoding_errors() const noexcept
+				{ return std::apply ([](auto const&... bit) { return (bit.encoding_errors() + ... + 0); }, _bits); }
+
+		  private:
+			std::tuple<pBits...> _bits;
+		};
+
+	/**
+	 * Packet with fields known at compile time (LayoutSocket, LayoutBitfield). Has the same wire format
+	 * as a Sequence of equivalent Socket and Bitfield packets, but encoding and decoding is done by a single
+	 * straight-line function with precomputed offsets, into/from a buffer resized only once.
+	 */
+	template<class... pFields>
+		class Layout: public Packet
+		{
+		  public:
+			static constexpr Blob::size_type kSize { (pFields::kSize + ... + 0) };
+
+		  public:
+			// Ctor
+			explicit
+			Layout (pFields... fields):
+				_fields (std::move (fields)...)
+			{ }
+
+			Blob::size_type
+			size() const override
+				{ return kSize; }
+
+			void
+			produce (Blob&) override;
+
+			EatResult
+			eat (Blob::const_iterator, Blob::const_iterator) override;
+
+			void
+			apply() override
+				{ std::apply ([](auto&... field) { (field.apply(), ...); }, _fields); }
+
+			void
+			failsafe() override
+				{ std::apply ([](auto&... field) { (field.failsafe(), ...); }, _fields); }
+
+			std::size_t
+			encoding_errors() const override;
+
+		  private:
+			std::tuple<pFields...> _fields;
+		};
+
 	/**
 	 * A packet that adds or verifies simple digital signature of the contained
-	 * packets.
-	 * HMAC is not required since the Signature packets have fixed size, so
-	 * length-extension attacks are not possible. Each Signature must use
-	 * different Key.
+	 * packets. Each Signature must use different Key.
+	 *
+	 * The MAC algorithm is part of the protocol definition, so both ends must use
+	 * the same one. The key is absorbed once at construction, and received data is
+	 * verified in place, so signing and verification don't allocate memory.
 	 */
 	class Signature: public Sequence
 	{
@@ -350,21 +603,28 @@ class LinkProtocol
 		explicit
 		Signature (NonceBytes, SignatureBytes, Key, PacketList);
 
+		/**
+		 * \throw	xf::InvalidArgument
+		 *			If SignatureBytes is larger than result of the MAC algorithm or if key
+		 *			is not valid for the algorithm.
+		 */
+		explicit
+		Signature (MACAlgorithm, NonceBytes, SignatureBytes, Key, PacketList);
+
 		Blob::size_type
 		size() const override;
 
 		void
 		produce (Blob&) override;
 
-		Blob::const_iterator
+		EatResult
 		eat (Blob::const_iterator, Blob::const_iterator) override;
 
 	  private:
 		uint8_t			_nonce_bytes		{ 0 };
 		uint8_t			_signature_bytes	{ 0 };
-		Blob			_key;
+		crypto::MAC		_mac;
 		std::mt19937	_rng;
-		Blob			_temp;
 	};
 
 	/**
@@ -412,12 +672,30 @@ class LinkProtocol
 	void
 	produce (Blob&, xf::Logger const&);
 
+	/**
+	 * Parse all envelopes from the input and apply them. Garbage between envelopes is skipped.
+	 * Return position of the first byte that hasn't been consumed (start of an incomplete envelope).
+	 */
 	Blob::const_iterator
 	eat (Blob::const_iterator begin, Blob::const_iterator end, Link*, QTimer* reacquire_timer, QTimer* failsafe_timer, xf::Logger const&);
 
+	/**
+	 * Try to parse and apply single envelope starting at begin. If result is Valid, begin is advanced
+	 * past the envelope.
+	 */
+	EnvelopeResult
+	eat_envelope (Blob::const_iterator& begin, Blob::const_iterator end);
+
 	void
 	failsafe();
 
+	/**
+	 * Return number of values that couldn't be encoded so far. See Packet::encoding_errors().
+	 */
+	[[nodiscard]]
+	std::size_t
+	encoding_errors() const;
+
   protected:
 	/*
 	 * Protocol building functions.
@@ -513,12 +791,126 @@ class LinkProtocol
 			return { assignable_socket, &assignable_socket, *bits, *retained, fallback_value, 0 };
 		}
 
+	/*
+	 * Compile-time layouts. Use them like socket() and bitfield() above, eg.:
+	 *
+	 *   layout (
+	 *       layout_socket<2> (io.speed, Retained (false)),
+	 *       layout_bitfield (
+	 *           layout_bit (io.flag, Retained (false), false),
+	 *           layout_bit<4> (io.mode, Retained (true), 0UL)
+	 *       )
+	 *   )
+	 */
+
+	template<class... Fields>
+		static auto
+		layout (Fields&&... fields)
+		{
+			return std::make_shared<Layout<std::remove_cvref_t<Fields>...>> (std::forward<Fields> (fields)...);
+		}
+
+	template<size_t Bytes, std::integral Value>
+		static auto
+		layout_socket (xf::Socket<Value>& socket, Retained retained, Value fallback_value)
+		{
+			return LayoutSocket<Bytes, Value> (socket, nullptr, retained, fallback_value);
+		}
+
+	template<size_t Bytes, std::integral Value>
+		static auto
+		layout_socket (xf::AssignableSocket<Value>& assignable_socket, Retained retained, Value fallback_value)
+		{
+			return LayoutSocket<Bytes, Value> (assignable_socket, &assignable_socket, retained, fallback_value);
+		}
+
+	template<size_t Bytes, si::FloatingPointOrQuantity Value>
+		static auto
+		layout_socket (xf::Socket<Value>& socket, Retained retained)
+		{
+			return LayoutSocket<Bytes, Value> (socket, nullptr, retained, std::nullopt);
+		}
+
+	template<size_t Bytes, si::FloatingPointOrQuantity Value>
+		static auto
+		layout_socket (xf::AssignableSocket<Value>& assignable_socket, Retained retained)
+		{
+			return LayoutSocket<Bytes, Value> (assignable_socket, &assignable_socket, retained, std::nullopt);
+		}
+
+	template<size_t Bytes, si::FloatingPointOrQuantity Value, class Offset>
+		static auto
+		layout_socket (xf::Socket<Value>& socket, Retained retained, Offset offset)
+		{
+			return LayoutSocket<Bytes, Value> (socket, nullptr, retained, std::optional<Value> (offset));
+		}
+
+	template<size_t Bytes, si::FloatingPointOrQuantity Value, class Offset>
+		static auto
+		layout_socket (xf::AssignableSocket<Value>& assignable_socket, Retained retained, Offset offset)
+		{
+			return LayoutSocket<Bytes, Value> (assignable_socket, &assignable_socket, retained, std::optional<Value> (offset));
+		}
+
+	template<class... LayoutBits>
+		static auto
+		layout_bitfield (LayoutBits&&... bits)
+		{
+			return LayoutBitfield<std::remove_cvref_t<LayoutBits>...> (std::forward<LayoutBits> (bits)...);
+		}
+
+	static LayoutBit<1, bool>
+	layout_bit (xf::Socket<bool>& socket, Retained retained, bool fallback_value)
+	{
+		return LayoutBit<1, bool> (socket, nullptr, retained, fallback_value);
+	}
+
+	static LayoutBit<1, bool>
+	layout_bit (xf::AssignableSocket<bool>& assignable_socket, Retained retained, bool fallback_value)
+	{
+		return LayoutBit<1, bool> (assignable_socket, &assignable_socket, retained, fallback_value);
+	}
+
+	/**
+	 * Note that fallback_value will be used not only when socket is nil, but also be used when integer value doesn't
+	 * fit in given number of bits.
+	 */
+	template<uint8_t BitsNumber, class Unsigned>
+		static LayoutBit<BitsNumber, Unsigned>
+		layout_bit (xf::Socket<Unsigned>& socket, Retained retained, Unsigned fallback_value)
+		{
+			if (!fits_in_bits (fallback_value, Bits (BitsNumber)))
+				throw xf::InvalidArgument ("fallback_value doesn't fit in given number of bits");
+
+			return LayoutBit<BitsNumber, Unsigned> (socket, nullptr, retained, fallback_value);
+		}
+
+	/**
+	 * Note that fallback_value will be used not only when socket is nil, but also be used when integer value doesn't
+	 * fit in given number of bits.
+	 */
+	template<uint8_t BitsNumber, class Unsigned>
+		static LayoutBit<BitsNumber, Unsigned>
+		layout_bit (xf::AssignableSocket<Unsigned>& assignable_socket, Retained retained, Unsigned fallback_value)
+		{
+			if (!fits_in_bits (fallback_value, Bits (BitsNumber)))
+				throw xf::InvalidArgument ("fallback_value doesn't fit in given number of bits");
+
+			return LayoutBit<BitsNumber, Unsigned> (assignable_socket, &assignable_socket, retained, fallback_value);
+		}
+
 	static auto
 	signature (NonceBytes nonce_bytes, SignatureBytes signature_bytes, Key key, PacketList&& packets)
 	{
 		return std::make_shared<Signature> (nonce_bytes, signature_bytes, key, std::forward<PacketList> (packets));
 	}
 
+	static auto
+	signature (MACAlgorithm mac_algorithm, NonceBytes nonce_bytes, SignatureBytes signature_bytes, Key key, PacketList&& packets)
+	{
+		return std::make_shared<Signature> (mac_algorithm, nonce_bytes, signature_bytes, key, std::forward<PacketList> (packets));
+	}
+
 	static auto
 	envelope (Magic magic, PacketList&& packets)
 	{
@@ -531,6 +923,51 @@ class LinkProtocol
 		return std::make_shared<Envelope> (magic, send_every, send_offset, std::forward<PacketList> (packets));
 	}
 
+  private:
+	/**
+	 * Maps magic strings to envelopes with a perfect hash built when the protocol is constructed,
+	 * so that checking a magic candidate costs one hash and one comparison, without allocations.
+	 */
+	class MagicTable
+	{
+	  public:
+		// Ctor
+		MagicTable() = default;
+
+		// Ctor
+		explicit
+		MagicTable (std::vector<std::shared_ptr<Envelope>> const&, Blob::size_type magic_size);
+
+		/**
+		 * Return envelope whose magic starts at given position or nullptr.
+		 * There must be at least magic-size bytes available.
+		 */
+		[[nodiscard]]
+		Envelope*
+		find (uint8_t const* magic) const noexcept;
+
+		/**
+		 * Return first position in [begin, end) where a magic string may start, or end.
+		 */
+		[[nodiscard]]
+		uint8_t const*
+		find_candidate (uint8_t const* begin, uint8_t const* end) const noexcept;
+
+	  private:
+		[[nodiscard]]
+		std::size_t
+		slot (uint8_t const* magic, uint64_t seed) const noexcept;
+
+	  private:
+		Blob::size_type				_magic_size			{ 0 };
+		uint64_t					_seed				{ 0 };
+		unsigned int				_shift				{ 63 };
+		std::vector<Envelope*>		_slots;
+		std::array<bool, 256>		_first_bytes		{};
+		// Set if all magics start with the same byte, so that memchr() can be used for scanning:
+		std::optional<uint8_t>		_common_first_byte;
+	};
+
   private:
 	/**
 	 * Convert to user-readable string.
@@ -541,14 +978,13 @@ class LinkProtocol
 
 	static constexpr bool
 	fits_in_bits (uint_least64_t value, Bits bits)
-		{ return value < xf::static_pow (2U, *bits); }
+		{ return *bits >= 64 || value < (uint_least64_t (1) << *bits); }
 
   private:
 	Link*										_link				{ nullptr };
 	std::vector<std::shared_ptr<Envelope>>		_envelopes;
-	std::map<Blob, std::shared_ptr<Envelope>>	_envelope_magics;
+	MagicTable									_magic_table;
 	Blob::size_type								_magic_size			{ 0 };
-	Blob										_aux_magic_buffer;
 };
 
 
@@ -578,6 +1014,7 @@ class LinkIO: public xf::Module
 	xf::ModuleOut<int64_t>		link_failsafes			{ this, "failsafes" };
 	xf::ModuleOut<int64_t>		link_reacquires			{ this, "reacquires" };
 	xf::ModuleOut<int64_t>		link_error_bytes		{ this, "error-bytes" };
+	xf::ModuleOut<int64_t>		link_encoding_errors	{ this, "encoding-errors" };
 	xf::ModuleOut<int64_t>		link_valid_bytes		{ this, "valid-bytes" };
 	xf::ModuleOut<int64_t>		link_valid_envelopes	{ this, "valid-envelopes" };
 
@@ -656,10 +1093,13 @@ template<uint8_t B, class V>
 				serialize<xf::int_for_width_t<kBytes>> (blob, int_value);
 			};
 
-			_eat = [this](Blob::const_iterator begin, Blob::const_iterator end) -> Blob::const_iterator {
+			_eat = [this](Blob::const_iterator begin, Blob::const_iterator end) -> EatResult {
 				Value value;
 				auto result = unserialize<xf::int_for_width_t<kBytes>> (begin, end, value);
-				_value = value;
+
+				if (result)
+					_value = value;
+
 				return result;
 			};
 		}
@@ -699,11 +1139,14 @@ template<uint8_t B, class V>
 				}
 			};
 
-			_eat = [this](Blob::const_iterator begin, Blob::const_iterator end) -> Blob::const_iterator {
+			_eat = [this](Blob::const_iterator begin, Blob::const_iterator end) -> EatResult {
 				neutrino::float_for_width_t<kBytes> float_value;
 
 				auto result = unserialize<neutrino::float_for_width_t<kBytes>> (begin, end, float_value);
 
+				if (!result)
+					return result;
+
 				if (std::isnan (float_value))
 					_value.reset();
 				else
@@ -772,11 +1215,11 @@ template<uint8_t B, class V>
 
 template<uint8_t B, class V>
 	template<class CastType, class SourceType>
-		inline Blob::const_iterator
+		inline LinkProtocol::EatResult
 		LinkProtocol::Socket<B, V>::unserialize (Blob::const_iterator begin, Blob::const_iterator end, SourceType& src)
 		{
 			if (neutrino::to_unsigned (std::distance (begin, end)) < sizeof (CastType))
-				throw ParseError();
+				return std::nullopt;
 
 			std::size_t size = sizeof (CastType);
 			auto const work_end = begin + neutrino::to_signed (size);
@@ -787,5 +1230,275 @@ template<uint8_t B, class V>
 			return work_end;
 		}
 
+
+template<uint8_t B, class V>
+	inline
+	LinkProtocol::LayoutSocket<B, V>::LayoutSocket (xf::Socket<Value>& socket, xf::AssignableSocket<Value>* assignable_socket, Retained retained, Value fallback_value)
+		requires (std::is_integral_v<Value>):
+		_socket (socket),
+		_assignable_socket (assignable_socket),
+		_fallback_value (fallback_value),
+		_retained (*retained)
+	{ }
+
+
+template<uint8_t B, class V>
+	inline
+	LinkProtocol::LayoutSocket<B, V>::LayoutSocket (xf::Socket<Value>& socket, xf::AssignableSocket<Value>* assignable_socket, Retained retained, std::optional<Value> offset)
+		requires si::FloatingPointOrQuantity<Value>:
+		_socket (socket),
+		_assignable_socket (assignable_socket),
+		_fallback_value (std::numeric_limits<decltype (_fallback_value)>::quiet_NaN()),
+		_retained (*retained),
+		_offset (offset)
+	{ }
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutSocket<B, V>::produce (uint8_t* const output) const
+	{
+		if constexpr (std::is_integral<Value>())
+		{
+			int64_t const int_value = _socket
+				? *_socket
+				: _fallback_value;
+
+			store<xf::int_for_width_t<kSize>> (output, int_value);
+		}
+		else if constexpr (si::is_quantity<Value>())
+		{
+			typename Value::Value const value = _socket
+				? _offset
+					? (*_socket - *_offset).base_value()
+					: (*_socket).base_value()
+				: _fallback_value;
+
+			store<neutrino::float_for_width_t<kSize>> (output, value);
+		}
+		else
+		{
+			Value const value = _socket
+				? _offset
+					? *_socket - *_offset
+					: *_socket
+				: _fallback_value;
+
+			store<neutrino::float_for_width_t<kSize>> (output, value);
+		}
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutSocket<B, V>::eat (uint8_t const* const input)
+	{
+		if constexpr (std::is_integral<Value>())
+			_value = static_cast<Value> (load<xf::int_for_width_t<kSize>> (input));
+		else
+		{
+			auto const float_value = load<neutrino::float_for_width_t<kSize>> (input);
+
+			if (std::isnan (float_value))
+				_value.reset();
+			else if constexpr (si::is_quantity<Value>())
+				_value = Value { float_value };
+			else
+				_value = float_value;
+		}
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutSocket<B, V>::apply()
+	{
+		if (_assignable_socket)
+		{
+			if (_value)
+			{
+				if constexpr (std::is_integral<Value>())
+					*_assignable_socket = _value;
+				else
+				{
+					*_assignable_socket = _offset
+						? *_value + *_offset
+						: *_value;
+				}
+			}
+			else if (!_retained)
+				*_assignable_socket = xf::nil;
+		}
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutSocket<B, V>::failsafe()
+	{
+		if (_assignable_socket && !_retained)
+			*_assignable_socket = xf::nil;
+	}
+
+
+template<uint8_t B, class V>
+	template<class CastType, class SourceType>
+		inline void
+		LinkProtocol::LayoutSocket<B, V>::store (uint8_t* const output, SourceType const src)
+		{
+			CastType casted (src);
+			neutrino::perhaps_native_to_little_inplace (casted);
+			std::memcpy (output, &casted, sizeof (casted));
+		}
+
+
+template<uint8_t B, class V>
+	template<class CastType>
+		inline CastType
+		LinkProtocol::LayoutSocket<B, V>::load (uint8_t const* const input)
+		{
+			CastType casted;
+			std::memcpy (&casted, input, sizeof (casted));
+			neutrino::perhaps_little_to_native_inplace (casted);
+			return casted;
+		}
+
+
+template<uint8_t B, class V>
+	inline
+	LinkProtocol::LayoutBit<B, V>::LayoutBit (xf::Socket<Value>& socket, xf::AssignableSocket<Value>* assignable_socket, Retained retained, Value fallback_value):
+		_socket (socket),
+		_assignable_socket (assignable_socket),
+		_fallback_value (fallback_value),
+		_retained (*retained)
+	{ }
+
+
+template<uint8_t B, class V>
+	inline uint64_t
+	LinkProtocol::LayoutBit<B, V>::produce()
+	{
+		if (_socket)
+		{
+			if (fits_in_bits (*_socket, Bits (kBits)))
+				return *_socket;
+
+			++_encoding_errors;
+		}
+
+		return _fallback_value;
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutBit<B, V>::eat (uint64_t const bits)
+	{
+		_value = static_cast<Value> (bits);
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutBit<B, V>::apply()
+	{
+		if (_assignable_socket)
+			*_assignable_socket = _value;
+	}
+
+
+template<uint8_t B, class V>
+	inline void
+	LinkProtocol::LayoutBit<B, V>::failsafe()
+	{
+		if (_assignable_socket && !_retained)
+			*_assignable_socket = xf::nil;
+	}
+
+
+template<class... B>
+	inline void
+	LinkProtocol::LayoutBitfield<B...>::produce (uint8_t* const output)
+	{
+		std::fill_n (output, kSize, 0);
+		std::size_t offset = 0;
+
+		std::apply ([&](auto&... bit) {
+			([&] {
+				uint64_t const value = bit.produce();
+
+				for (uint8_t b = 0; b < bit.kBits; ++b, ++offset)
+					if ((value >> b) & 1)
+						output[offset / 8] |= static_cast<uint8_t> (1u << (offset % 8));
+			}(), ...);
+		}, _bits);
+	}
+
+
+template<class... B>
+	inline void
+	LinkProtocol::LayoutBitfield<B...>::eat (uint8_t const* const input)
+	{
+		std::size_t offset = 0;
+
+		std::apply ([&](auto&... bit) {
+			([&] {
+				uint64_t value = 0;
+
+				for (uint8_t b = 0; b < bit.kBits; ++b, ++offset)
+					if ((input[offset / 8] >> (offset % 8)) & 1)
+						value |= uint64_t (1) << b;
+
+				bit.eat (value);
+			}(), ...);
+		}, _bits);
+	}
+
+
+template<class... F>
+	inline void
+	LinkProtocol::Layout<F...>::produce (Blob& blob)
+	{
+		auto const offset = blob.size();
+		blob.resize (offset + kSize);
+		uint8_t* output = blob.data() + offset;
+
+		std::apply ([&output](auto&... field) {
+			((field.produce (output), output += field.kSize), ...);
+		}, _fields);
+	}
+
+
+template<class... F>
+	inline std::size_t
+	LinkProtocol::Layout<F...>::encoding_errors() const
+	{
+		return std::apply ([](auto const&... field) {
+			return ([&field] {
+				if constexpr (requires { field.encoding_errors(); })
+					return field.encoding_errors();
+				else
+					return std::size_t (0);
+			}() + ... + 0);
+		}, _fields);
+	}
+
+
+template<class... F>
+	inline LinkProtocol::EatResult
+	LinkProtocol::Layout<F...>::eat (Blob::const_iterator const begin, Blob::const_iterator const end)
+	{
+		if (neutrino::to_unsigned (std::distance (begin, end)) < kSize)
+			return std::nullopt;
+
+		uint8_t const* input = std::to_address (begin);
+
+		std::apply ([&input](auto&... field) {
+			((field.eat (input), input += field.kSize), ...);
+		}, _fields);
+
+		return begin + neutrino::to_signed (kSize);
+	}
+
 #endif
 
@@ -139,6 +139,186 @@ class GCS_Rx_LinkProtocol: public LinkProtocol
 };
 
 
+/**
+ * Same protocol as GCS_Tx_LinkProtocol, but made of compile-time layouts.
+ */
+class GCS_Tx_LayoutLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	template<class IO>
+		explicit
+		GCS_Tx_LayoutLinkProtocol (IO* io):
+			LinkProtocol ({
+				envelope (Magic ({ 0xe4, 0x40 }), {
+					signature (NonceBytes (8), SignatureBytes (12), Key ({ 0x88, 0x99, 0xaa, 0xbb }), {
+						layout (
+							layout_socket<8> (io->nil_si_prop,				Retained (false)),
+							layout_socket<8> (io->angle_prop,				Retained (false)),
+							layout_socket<8> (io->angle_prop_r,				Retained (true)),
+							layout_socket<2> (io->velocity_prop,			Retained (false)),
+							layout_socket<2> (io->velocity_prop_r,			Retained (true)),
+							layout_socket<2> (io->velocity_prop_offset,		Retained (false),	1000_kph),
+							layout_socket<2> (io->velocity_prop_offset_r,	Retained (true),	1000_kph),
+							layout_socket<2> (io->int_prop,					Retained (false),	0L),
+							layout_socket<2> (io->int_prop_r,				Retained (true),	0L)
+						),
+					}),
+				}),
+				envelope (Magic ({ 0xa3, 0x80 }), {
+					signature (NonceBytes (8), SignatureBytes (8), Key ({ 0x55, 0x37, 0x12, 0xf9 }), {
+						layout (
+							layout_bitfield (
+								layout_bit (io->bool_prop,			Retained (false),	kFallbackBool),
+								layout_bit (io->bool_prop_r,		Retained (true),	kFallbackBool),
+								layout_bit<4> (io->uint_prop,		Retained (true),	kFallbackInt),
+								layout_bit<4> (io->uint_prop_r,		Retained (true),	kFallbackInt)
+							)
+						),
+					}),
+				}),
+				envelope (Magic ({ 0x01, 0x02 }), SendEvery (10), SendOffset (8), {
+					layout (
+						layout_socket<4> (io->dummy, Retained (false), 0L)
+					),
+				}),
+			})
+		{ }
+};
+
+
+/**
+ * Unsigned protocol, so that produced bytes can be compared directly.
+ */
+class UnsignedLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	template<class IO>
+		explicit
+		UnsignedLinkProtocol (IO* io):
+			LinkProtocol ({
+				envelope (Magic ({ 0x01, 0x02 }), {
+					socket<8> (io->angle_prop,				Retained (false)),
+					socket<2> (io->velocity_prop_offset,	Retained (false),	1000_kph),
+					socket<4> (io->int_prop,				Retained (false),	0L),
+					bitfield ({
+						bitfield_socket (io->bool_prop,					Retained (false),	kFallbackBool),
+						bitfield_socket (io->uint_prop,		Bits (4),	Retained (true),	kFallbackInt),
+					}),
+					socket<2> (io->velocity_prop,			Retained (false)),
+				}),
+			})
+		{ }
+};
+
+
+/**
+ * Same protocol as UnsignedLinkProtocol, but made of compile-time layouts.
+ */
+class UnsignedLayoutLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	template<class IO>
+		explicit
+		UnsignedLayoutLinkProtocol (IO* io):
+			LinkProtocol ({
+				envelope (Magic ({ 0x01, 0x02 }), {
+					layout (
+						layout_socket<8> (io->angle_prop,			Retained (false)),
+						layout_socket<2> (io->velocity_prop_offset,	Retained (false),	1000_kph),
+						layout_socket<4> (io->int_prop,				Retained (false),	0L),
+						layout_bitfield (
+							layout_bit (io->bool_prop,				Retained (false),	kFallbackBool),
+							layout_bit<4> (io->uint_prop,			Retained (true),	kFallbackInt)
+						),
+						layout_socket<2> (io->velocity_prop,		Retained (false))
+					),
+				}),
+			})
+		{ }
+};
+
+
+class WideBitfieldIO: public Module
+{
+  public:
+	ModuleOut<bool>			flag	{ this, "flag" };
+	ModuleOut<uint64_t>		a		{ this, "a" };
+	ModuleOut<uint64_t>		b		{ this, "b" };
+	ModuleOut<uint64_t>		c		{ this, "c" };
+	ModuleOut<uint64_t>		d		{ this, "d" };
+};
+
+
+/**
+ * Bitfield with sources spanning bytes and 64-bit words.
+ */
+class WideBitfieldLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	explicit
+	WideBitfieldLinkProtocol (WideBitfieldIO& io):
+		LinkProtocol ({
+			envelope (Magic ({ 0x5a }), {
+				bitfield ({
+					bitfield_socket (io.flag,				Retained (false),	false),
+					bitfield_socket (io.a,		Bits (7),	Retained (false),	1UL),
+					bitfield_socket (io.b,		Bits (33),	Retained (false),	2UL),
+					bitfield_socket (io.c,		Bits (64),	Retained (false),	3UL),
+					bitfield_socket (io.d,		Bits (13),	Retained (false),	4UL),
+				}),
+			}),
+		})
+	{ }
+};
+
+
+/**
+ * Bitfield protocol signed with given MAC algorithm.
+ */
+class SignedLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	explicit
+	SignedLinkProtocol (WideBitfieldIO& io, MACAlgorithm mac_algorithm, Key key, SignatureBytes signature_bytes = SignatureBytes (12)):
+		LinkProtocol ({
+			envelope (Magic ({ 0x5b }), {
+				signature (mac_algorithm, NonceBytes (4), signature_bytes, key, {
+					bitfield ({
+						bitfield_socket (io.a,		Bits (7),	Retained (false),	1UL),
+						bitfield_socket (io.b,		Bits (33),	Retained (false),	2UL),
+					}),
+				}),
+			}),
+		})
+	{ }
+};
+
+
+/**
+ * Protocol with a single envelope without magic.
+ */
+class MagiclessLinkProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	explicit
+	MagiclessLinkProtocol (WideBitfieldIO& io):
+		LinkProtocol ({
+			envelope (Magic (Blob()), {
+				bitfield ({
+					bitfield_socket (io.a,		Bits (7),	Retained (false),	1UL),
+				}),
+			}),
+		})
+	{ }
+};
+
+
 void transmit (LinkProtocol& tx_protocol, LinkProtocol& rx_protocol)
 {
 	Blob blob;
@@ -239,6 +419,7 @@ AutoTest t2 ("modules/io/link: protocol: nils and out-of range values transmissi
 	tx.fetch_all (cycle += 1_s);
 	transmit (tx_protocol, rx_protocol);
 	test_asserts::verify ("out-of-range bit-int set to fall-back value", *rx.uint_prop == kFallbackInt);
+	test_asserts::verify ("out-of-range bit-int is counted as encoding error", tx_protocol.encoding_errors() == 1);
 
 	tx.uint_prop << 15u;
 	tx.fetch_all (cycle += 1_s);
@@ -396,6 +577,239 @@ AutoTest t5 ("modules/io/link: protocol: send-every/send-offset", []{
 	test_asserts::verify ("last envelope sent for the second time", *rx.dummy == kSecondInt);
 });
 
+
+AutoTest t6 ("modules/io/link: protocol: resynchronization after garbage", []{
+	GCS_Tx_Link tx;
+	Aircraft_Rx_Link rx;
+	GCS_Tx_LinkProtocol tx_protocol (&tx);
+	GCS_Tx_LinkProtocol rx_protocol (&rx);
+	TestCycle cycle;
+
+	tx.angle_prop << 2_rad;
+	tx.int_prop << 7;
+	tx.fetch_all (cycle += 1_s);
+
+	Blob envelopes;
+	tx_protocol.produce (envelopes, g_logger);
+
+	// Contains first bytes of magics not followed by the rest of magic, and ends with a possible start of magic:
+	Blob const garbage = { 0x00, 0xe4, 0x41, 0x13, 0xa3, 0x00, 0x7f, 0x01 };
+
+	auto const garbage_end = rx_protocol.eat (garbage.begin(), garbage.end(), nullptr, nullptr, nullptr, g_logger);
+	test_asserts::verify ("possible start of magic at the end of input is not consumed", garbage_end == garbage.end() - 1);
+
+	Blob input = garbage + envelopes + garbage;
+	auto const incomplete_position = input.size();
+	// Magic and a few bytes of the first envelope:
+	input += envelopes.substr (0, 5);
+
+	auto const end = rx_protocol.eat (input.begin(), input.end(), nullptr, nullptr, nullptr, g_logger);
+	test_asserts::verify ("all bytes up to incomplete envelope were consumed", end == input.begin() + neutrino::to_signed (incomplete_position));
+	test_asserts::verify ("angle_prop transmitted properly through garbage", *rx.angle_prop == 2_rad);
+	test_asserts::verify ("int_prop transmitted properly through garbage", *rx.int_prop == 7);
+});
+
+
+AutoTest t7 ("modules/io/link: protocol: layouts have the same wire format as packets", []{
+	GCS_Tx_Link tx;
+	Aircraft_Rx_Link rx;
+	Aircraft_Rx_Link layout_rx;
+	UnsignedLinkProtocol tx_protocol (&tx);
+	UnsignedLayoutLinkProtocol layout_tx_protocol (&tx);
+	UnsignedLinkProtocol rx_protocol (&rx);
+	UnsignedLayoutLinkProtocol layout_rx_protocol (&layout_rx);
+	TestCycle cycle;
+
+	test_asserts::verify ("layout size is the same as size of packets", layout_tx_protocol.size() == tx_protocol.size());
+
+	auto test = [&] {
+		tx.fetch_all (cycle += 1_s);
+
+		Blob blob;
+		Blob layout_blob;
+		tx_protocol.produce (blob, g_logger);
+		layout_tx_protocol.produce (layout_blob, g_logger);
+		test_asserts::verify ("layout produces the same bytes", blob == layout_blob);
+
+		transmit (tx_protocol, layout_rx_protocol);
+		transmit (layout_tx_protocol, rx_protocol);
+
+		// Both directions decode the same bytes:
+		test_asserts::verify ("angle_prop transmitted properly", rx.angle_prop == tx.angle_prop && layout_rx.angle_prop == tx.angle_prop);
+		test_asserts::verify ("velocity_prop decoded the same way", rx.velocity_prop == layout_rx.velocity_prop);
+		test_asserts::verify ("velocity_prop_offset decoded the same way", rx.velocity_prop_offset == layout_rx.velocity_prop_offset);
+		test_asserts::verify ("int_prop transmitted properly", rx.int_prop == tx.int_prop && layout_rx.int_prop == tx.int_prop);
+		test_asserts::verify ("bool_prop decoded the same way", rx.bool_prop == layout_rx.bool_prop);
+		test_asserts::verify ("uint_prop decoded the same way", rx.uint_prop == layout_rx.uint_prop);
+	};
+
+	tx.angle_prop << 1.99_rad;
+	tx.velocity_prop << 101_kph;
+	tx.velocity_prop_offset << 1001_kph;
+	tx.int_prop << -2;
+	tx.bool_prop << true;
+	tx.uint_prop << 3u;
+	test();
+
+	tx.angle_prop << xf::no_data_source;
+	tx.velocity_prop << xf::no_data_source;
+	tx.int_prop << 65537;
+	tx.bool_prop << xf::no_data_source;
+	tx.uint_prop << 17u;
+	test();
+	test_asserts::verify ("out-of-range bit-int set to fall-back value", *layout_rx.uint_prop == kFallbackInt);
+});
+
+
+AutoTest t8 ("modules/io/link: protocol: layouts and packets interoperate in signed envelopes", []{
+	GCS_Tx_Link tx;
+	Aircraft_Rx_Link rx;
+	Aircraft_Rx_Link layout_rx;
+	GCS_Tx_LayoutLinkProtocol layout_tx_protocol (&tx);
+	GCS_Tx_LinkProtocol tx_protocol (&tx);
+	GCS_Tx_LinkProtocol rx_protocol (&rx);
+	GCS_Tx_LayoutLinkProtocol layout_rx_protocol (&layout_rx);
+	TestCycle cycle;
+
+	tx.angle_prop << 1.59_rad;
+	tx.velocity_prop_offset << 1001_kph;
+	tx.bool_prop << true;
+	tx.int_prop << -9;
+	tx.uint_prop << 11u;
+	tx.fetch_all (cycle += 1_s);
+
+	transmit (layout_tx_protocol, rx_protocol);
+	transmit (tx_protocol, layout_rx_protocol);
+
+	for (auto* r: { &rx, &layout_rx })
+	{
+		test_asserts::verify ("nil_si_prop transmitted properly", !r->nil_si_prop);
+		test_asserts::verify ("angle_prop transmitted properly", *r->angle_prop == *tx.angle_prop);
+		test_asserts::verify_equal_with_epsilon ("velocity prop with offset transmitted properly", *r->velocity_prop_offset, *tx.velocity_prop_offset, 0.1_mps);
+		test_asserts::verify ("bool_prop transmitted properly", *r->bool_prop == *tx.bool_prop);
+		test_asserts::verify ("int_prop transmitted properly", *r->int_prop == *tx.int_prop);
+		test_asserts::verify ("uint_prop transmitted properly", *r->uint_prop == *tx.uint_prop);
+	}
+
+	layout_rx_protocol.failsafe();
+	test_asserts::verify ("failsafe sets non-retained values to nil", !layout_rx.angle_prop && !layout_rx.int_prop);
+	test_asserts::verify ("failsafe retains retained values", !!layout_rx.uint_prop);
+});
+
+
+AutoTest t9 ("modules/io/link: protocol: bitfields spanning bytes and words", []{
+	WideBitfieldIO tx;
+	WideBitfieldIO rx;
+	WideBitfieldLinkProtocol tx_protocol (tx);
+	WideBitfieldLinkProtocol rx_protocol (rx);
+
+	test_asserts::verify ("bitfield size is rounded up to bytes", tx_protocol.size() == (1 + 7 + 33 + 64 + 13 + 7) / 8);
+
+	tx.flag = true;
+	tx.a = 0x55u;
+	tx.b = 0x1'2345'6789u;
+	tx.c = 0xfedc'ba98'7654'3210u;
+	tx.d = 0x1abcu;
+	transmit (tx_protocol, rx_protocol);
+	test_asserts::verify ("1-bit source transmitted properly", *rx.flag == true);
+	test_asserts::verify ("7-bit source transmitted properly", *rx.a == *tx.a);
+	test_asserts::verify ("33-bit source transmitted properly", *rx.b == *tx.b);
+	test_asserts::verify ("64-bit source spanning two words transmitted properly", *rx.c == *tx.c);
+	test_asserts::verify ("13-bit source transmitted properly", *rx.d == *tx.d);
+	test_asserts::verify ("no encoding errors", tx_protocol.encoding_errors() == 0);
+
+	tx.a = 0x80u;
+	tx.b = 0x2'0000'0000u;
+	transmit (tx_protocol, rx_protocol);
+	test_asserts::verify ("out-of-range values set to fall-back values", *rx.a == 1u && *rx.b == 2u);
+	test_asserts::verify ("other values not affected", *rx.c == *tx.c && *rx.d == *tx.d);
+	test_asserts::verify ("out-of-range values counted as encoding errors", tx_protocol.encoding_errors() == 2);
+});
+
+
+AutoTest t10 ("modules/io/link: protocol: signature MAC algorithms", []{
+	using MACAlgorithm = LinkProtocol::MACAlgorithm;
+
+	LinkProtocol::Key const key ({ 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff });
+	LinkProtocol::Key const other_key ({ 0xff, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x00 });
+
+	for (auto const mac_algorithm: { MACAlgorithm::HMAC_SHA3_256, MACAlgorithm::BLAKE2b_256, MACAlgorithm::SipHash_2_4 })
+	{
+		WideBitfieldIO tx;
+		WideBitfieldIO rx;
+		WideBitfieldIO other_rx;
+		SignedLinkProtocol tx_protocol (tx, mac_algorithm, key);
+		SignedLinkProtocol rx_protocol (rx, mac_algorithm, key);
+		SignedLinkProtocol other_key_rx_protocol (other_rx, mac_algorithm, other_key);
+
+		tx.a = 0x55u;
+		tx.b = 0x1'2345'6789u;
+
+		Blob blob;
+		tx_protocol.produce (blob, g_logger);
+		test_asserts::verify ("envelope has magic, data, nonce and signature", blob.size() == 1 + 5 + 4 + 12);
+
+		auto const end = rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, g_logger);
+		test_asserts::verify ("signed envelope is accepted", end == blob.end());
+		test_asserts::verify ("values transmitted properly", *rx.a == *tx.a && *rx.b == *tx.b);
+
+		other_key_rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, g_logger);
+		test_asserts::verify ("envelope signed with different key is rejected", !other_rx.a && !other_rx.b);
+
+		blob[3] ^= 0x01;
+		rx.a = xf::nil;
+		rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, g_logger);
+		test_asserts::verify ("corrupted envelope is rejected", !rx.a);
+	}
+
+	WideBitfieldIO io;
+	Blob blob;
+	SignedLinkProtocol (io, MACAlgorithm::HMAC_SHA3_256, key).produce (blob, g_logger);
+	SignedLinkProtocol blake_rx_protocol (io, MACAlgorithm::BLAKE2b_256, key);
+	blake_rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, g_logger);
+	test_asserts::verify ("envelope signed with different MAC algorithm is rejected", !io.a);
+
+	auto const throws_invalid_argument = [&] (auto&& construct) {
+		try {
+			construct();
+			return false;
+		}
+		catch (xf::InvalidArgument const&)
+		{
+			return true;
+		}
+	};
+
+	test_asserts::verify ("SipHash requires 16-byte key", throws_invalid_argument ([&] {
+		SignedLinkProtocol protocol (io, MACAlgorithm::SipHash_2_4, LinkProtocol::Key ({ 0x01, 0x02 }));
+	}));
+	test_asserts::verify ("signature can't be longer than SipHash result", throws_invalid_argument ([&] {
+		SignedLinkProtocol protocol (io, MACAlgorithm::SipHash_2_4, key, LinkProtocol::SignatureBytes (17));
+	}));
+	test_asserts::verify ("signature can't be longer than HMAC-SHA3-256 result", throws_invalid_argument ([&] {
+		SignedLinkProtocol protocol (io, MACAlgorithm::HMAC_SHA3_256, key, LinkProtocol::SignatureBytes (33));
+	}));
+});
+
+
+AutoTest t11 ("modules/io/link: protocol: envelope without magic", []{
+	WideBitfieldIO tx;
+	WideBitfieldIO rx;
+	MagiclessLinkProtocol tx_protocol (tx);
+	MagiclessLinkProtocol rx_protocol (rx);
+
+	tx.a = 0x55u;
+
+	Blob blob;
+	tx_protocol.produce (blob, g_logger);
+	tx_protocol.produce (blob, g_logger);
+	test_asserts::verify ("envelopes contain only data", blob.size() == 2);
+
+	auto const end = rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, g_logger);
+	test_asserts::verify ("all envelopes accepted", end == blob.end());
+	test_asserts::verify ("value transmitted properly", *rx.a == *tx.a);
+});
+
 } // namespace
 } // namespace xf::test
 
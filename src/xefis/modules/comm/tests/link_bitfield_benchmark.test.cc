@@ -0,0 +1,113 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/modules/comm/link.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kIterations = 1'000'000;
+
+
+class BenchmarkIO: public Module
+{
+  public:
+	std::vector<std::unique_ptr<ModuleOut<uint64_t>>> sockets;
+
+  public:
+	/**
+	 * Return bitfield source for a new socket with given number of bits.
+	 */
+	LinkProtocol::Bitfield::SourceVariant
+	source (uint8_t bits)
+	{
+		auto& socket = *sockets.emplace_back (std::make_unique<ModuleOut<uint64_t>> (this, "socket-" + std::to_string (sockets.size())));
+		// Highest and lowest bits set:
+		socket = (uint64_t (1) << (bits - 1)) | 1u;
+		return LinkProtocol::Bitfield::BitSource<uint64_t> { socket, &socket, bits, false, 0, 0 };
+	}
+};
+
+
+/**
+ * Measure produce() and eat() of given bitfield.
+ */
+void
+run (LinkProtocol::Bitfield& bitfield)
+{
+	Blob blob;
+	blob.reserve (bitfield.size());
+
+	auto const produce_time = TimeHelper::measure ([&] {
+		for (std::size_t i = 0; i < kIterations; ++i)
+		{
+			blob.clear();
+			bitfield.produce (blob);
+		}
+	});
+
+	auto const eat_time = TimeHelper::measure ([&] {
+		for (std::size_t i = 0; i < kIterations; ++i)
+			(void) bitfield.eat (blob.begin(), blob.end());
+	});
+
+	std::cout << 8 * bitfield.size() << "-bit bitfield: "
+			  << "produce " << (produce_time / kIterations).in<si::Nanosecond>() << " ns, "
+			  << "eat " << (eat_time / kIterations).in<si::Nanosecond>() << " ns" << std::endl;
+}
+
+
+ManualTest t_1 ("modules/io/link: Bitfield produce()/eat() time", []{
+	BenchmarkIO io;
+
+	// 8 booleans:
+	LinkProtocol::Bitfield bitfield_8 ({
+		io.source (1), io.source (1), io.source (1), io.source (1),
+		io.source (1), io.source (1), io.source (1), io.source (1),
+	});
+
+	// Typical mix of flags and small integers:
+	LinkProtocol::Bitfield bitfield_32 ({
+		io.source (1), io.source (1), io.source (1), io.source (1), io.source (2), io.source (2),
+		io.source (3), io.source (3), io.source (4), io.source (4), io.source (5), io.source (5),
+	});
+
+	// Wide integers crossing byte and word boundaries:
+	LinkProtocol::Bitfield bitfield_200 ({
+		io.source (7), io.source (9), io.source (11), io.source (13), io.source (17),
+		io.source (3), io.source (5), io.source (15), io.source (1), io.source (2),
+		io.source (6), io.source (10), io.source (14), io.source (18), io.source (20),
+		io.source (12), io.source (8), io.source (4), io.source (19), io.source (6),
+	});
+
+	for (auto* bitfield: { &bitfield_8, &bitfield_32, &bitfield_200 })
+		run (*bitfield);
+});
+
+} // namespace
+} // namespace xf::test
+
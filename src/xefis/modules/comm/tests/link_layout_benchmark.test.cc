@@ -0,0 +1,168 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/modules/comm/link.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kEnvelopes = 200'000;
+
+
+class BenchmarkIO: public Module
+{
+  public:
+	ModuleOut<si::Angle>		angle_1			{ this, "angle-1" };
+	ModuleOut<si::Angle>		angle_2			{ this, "angle-2" };
+	ModuleOut<si::Velocity>		velocity_1		{ this, "velocity-1" };
+	ModuleOut<si::Velocity>		velocity_2		{ this, "velocity-2" };
+	ModuleOut<si::Length>		altitude		{ this, "altitude" };
+	ModuleOut<double>			factor			{ this, "factor" };
+	ModuleOut<int64_t>			integer_1		{ this, "integer-1" };
+	ModuleOut<int64_t>			integer_2		{ this, "integer-2" };
+	ModuleOut<bool>				flag_1			{ this, "flag-1" };
+	ModuleOut<bool>				flag_2			{ this, "flag-2" };
+	ModuleOut<uint64_t>			mode			{ this, "mode" };
+};
+
+
+/**
+ * Typical telemetry envelope made of Socket and Bitfield packets.
+ */
+class PacketsProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	explicit
+	PacketsProtocol (BenchmarkIO& io):
+		LinkProtocol ({
+			envelope (Magic ({ 0x01, 0x02 }), {
+				socket<4> (io.angle_1,		Retained (false)),
+				socket<4> (io.angle_2,		Retained (false)),
+				socket<2> (io.velocity_1,	Retained (false)),
+				socket<2> (io.velocity_2,	Retained (false),	100_kt),
+				socket<4> (io.altitude,		Retained (true)),
+				socket<8> (io.factor,		Retained (false)),
+				socket<2> (io.integer_1,	Retained (false),	0L),
+				socket<4> (io.integer_2,	Retained (false),	0L),
+				bitfield ({
+					bitfield_socket (io.flag_1,				Retained (false),	false),
+					bitfield_socket (io.flag_2,				Retained (false),	false),
+					bitfield_socket (io.mode,	Bits (4),	Retained (true),	0UL),
+				}),
+			}),
+		})
+	{ }
+};
+
+
+/**
+ * The same envelope made of a compile-time Layout.
+ */
+class LayoutProtocol: public LinkProtocol
+{
+  public:
+	// Ctor
+	explicit
+	LayoutProtocol (BenchmarkIO& io):
+		LinkProtocol ({
+			envelope (Magic ({ 0x01, 0x02 }), {
+				layout (
+					layout_socket<4> (io.angle_1,		Retained (false)),
+					layout_socket<4> (io.angle_2,		Retained (false)),
+					layout_socket<2> (io.velocity_1,	Retained (false)),
+					layout_socket<2> (io.velocity_2,	Retained (false),	100_kt),
+					layout_socket<4> (io.altitude,		Retained (true)),
+					layout_socket<8> (io.factor,		Retained (false)),
+					layout_socket<2> (io.integer_1,		Retained (false),	0L),
+					layout_socket<4> (io.integer_2,		Retained (false),	0L),
+					layout_bitfield (
+						layout_bit (io.flag_1,			Retained (false),	false),
+						layout_bit (io.flag_2,			Retained (false),	false),
+						layout_bit<4> (io.mode,			Retained (true),	0UL)
+					)
+				),
+			}),
+		})
+	{ }
+};
+
+
+void
+run (char const* name, LinkProtocol& tx_protocol, LinkProtocol& rx_protocol, xf::Logger const& logger)
+{
+	Blob blob;
+	blob.reserve (kEnvelopes * (tx_protocol.size() + 2));
+
+	auto const encode_time = TimeHelper::measure ([&] {
+		for (std::size_t i = 0; i < kEnvelopes; ++i)
+			tx_protocol.produce (blob, logger);
+	});
+
+	Blob::const_iterator end;
+
+	auto const decode_time = TimeHelper::measure ([&] {
+		end = rx_protocol.eat (blob.begin(), blob.end(), nullptr, nullptr, nullptr, logger);
+	});
+
+	if (end != blob.end())
+		std::cout << name << ": not all envelopes were decoded" << std::endl;
+
+	std::cout << name << ": "
+			  << "encode " << static_cast<std::size_t> (kEnvelopes / encode_time.in<si::Second>()) << " envelopes/s, "
+			  << "decode " << static_cast<std::size_t> (kEnvelopes / decode_time.in<si::Second>()) << " envelopes/s" << std::endl;
+}
+
+
+ManualTest t_1 ("modules/io/link: encode/decode throughput of packets vs. layouts", []{
+	LoggerOutput logger_output { std::clog };
+	Logger logger { logger_output };
+	BenchmarkIO tx;
+	BenchmarkIO rx;
+
+	tx.angle_1 = 0.5_rad;
+	tx.angle_2 = -1.5_rad;
+	tx.velocity_1 = 120_kt;
+	tx.velocity_2 = 95_kt;
+	tx.altitude = 1500_ft;
+	tx.factor = 0.25;
+	tx.integer_1 = -1000;
+	tx.integer_2 = 100000;
+	tx.flag_1 = true;
+	tx.flag_2 = false;
+	tx.mode = 5u;
+
+	PacketsProtocol packets_tx (tx);
+	PacketsProtocol packets_rx (rx);
+	LayoutProtocol layout_tx (tx);
+	LayoutProtocol layout_rx (rx);
+
+	run ("packets", packets_tx, packets_rx, logger);
+	run ("layout ", layout_tx, layout_rx, logger);
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,246 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/modules/comm/link.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kTrafficSize = 1024 * 1024;
+
+
+class BenchmarkIO: public Module
+{
+  public:
+	ModuleOut<si::Angle>		angle			{ this, "angle" };
+	ModuleOut<si::Velocity>		velocity		{ this, "velocity" };
+	ModuleOut<int64_t>			integer			{ this, "integer" };
+	ModuleOut<bool>				flag			{ this, "flag" };
+	ModuleOut<uint64_t>			bits			{ this, "bits" };
+};
+
+
+class BenchmarkProtocol: public LinkProtocol
+{
+  public:
+	using Envelopes = std::vector<std::shared_ptr<Envelope>>;
+
+  public:
+	// Ctor
+	explicit
+	BenchmarkProtocol (BenchmarkIO& io):
+		BenchmarkProtocol (make_envelopes (io))
+	{ }
+
+	Envelopes const&
+	envelopes() const noexcept
+		{ return _envelope_list; }
+
+  private:
+	// Ctor
+	explicit
+	BenchmarkProtocol (Envelopes envelopes):
+		LinkProtocol ({ envelopes[0], envelopes[1], envelopes[2] }),
+		_envelope_list (std::move (envelopes))
+	{ }
+
+	static Envelopes
+	make_envelopes (BenchmarkIO& io)
+	{
+		return {
+			envelope (Magic ({ 0xe4, 0x40 }), {
+				signature (NonceBytes (8), SignatureBytes (12), Key ({ 0x88, 0x99, 0xaa, 0xbb }), {
+					socket<4> (io.angle,	Retained (false)),
+					socket<2> (io.velocity,	Retained (false)),
+					socket<4> (io.integer,	Retained (false),	0L),
+				}),
+			}),
+			envelope (Magic ({ 0xa3, 0x80 }), {
+				bitfield ({
+					bitfield_socket (io.flag,				Retained (false),	false),
+					bitfield_socket (io.bits,	Bits (4),	Retained (true),	0UL),
+				}),
+			}),
+			envelope (Magic ({ 0x01, 0x02 }), {
+				socket<8> (io.angle,	Retained (false)),
+				socket<8> (io.integer,	Retained (false),	0L),
+			}),
+		};
+	}
+
+  private:
+	Envelopes _envelope_list;
+};
+
+
+/**
+ * Receiver working like LinkProtocol::eat() used to: look up each candidate magic in a std::map
+ * and resynchronize by throwing and catching an exception for every garbage byte.
+ */
+class LegacyReceiver
+{
+	class ParseError
+	{ };
+
+  public:
+	// Ctor
+	explicit
+	LegacyReceiver (BenchmarkProtocol::Envelopes const& envelopes)
+	{
+		_magic_size = envelopes[0]->magic().size();
+
+		for (auto const& e: envelopes)
+			_envelope_magics[e->magic()] = e;
+	}
+
+	Blob::const_iterator
+	eat (Blob::const_iterator begin, Blob::const_iterator end, xf::Logger const& logger)
+	{
+		_aux_magic_buffer.resize (_magic_size);
+
+		while (std::distance (begin, end) > static_cast<Blob::difference_type> (_magic_size + 1))
+		{
+			bool return_from_outer_function = false;
+
+			Exception::catch_and_log (logger, [&] {
+				try {
+					std::copy (begin, begin + neutrino::to_signed (_magic_size), _aux_magic_buffer.begin());
+					auto envelope_and_magic = _envelope_magics.find (_aux_magic_buffer);
+
+					if (envelope_and_magic == _envelope_magics.end())
+						throw ParseError();
+
+					auto envelope = envelope_and_magic->second;
+
+					if (neutrino::to_unsigned (std::distance (begin, end)) - _magic_size < envelope->size())
+					{
+						return_from_outer_function = true;
+						return;
+					}
+
+					auto const e = envelope->eat (begin + neutrino::to_signed (_magic_size), end);
+
+					if (!e)
+						throw ParseError();
+
+					envelope->apply();
+					begin = *e;
+				}
+				catch (ParseError&)
+				{
+					++begin;
+				}
+			});
+
+			if (return_from_outer_function)
+				break;
+		}
+
+		return begin;
+	}
+
+  private:
+	std::map<Blob, std::shared_ptr<LinkProtocol::Envelope>>	_envelope_magics;
+	Blob::size_type											_magic_size		{ 0 };
+	Blob													_aux_magic_buffer;
+};
+
+
+/**
+ * Generate about kTrafficSize bytes of valid envelopes interleaved with random garbage
+ * and randomly corrupted envelopes.
+ */
+Blob
+make_traffic (BenchmarkIO& io, BenchmarkProtocol& protocol, double garbage_ratio, xf::Logger const& logger)
+{
+	std::mt19937 rng (1);
+	std::uniform_int_distribution<int> byte (0, 255);
+	std::uniform_real_distribution<double> unit (0.0, 1.0);
+	Blob traffic;
+	Blob frame;
+
+	while (traffic.size() < kTrafficSize)
+	{
+		io.angle = 1_rad * unit (rng);
+		io.velocity = 100_kph * unit (rng);
+		io.integer = byte (rng);
+		io.flag = unit (rng) < 0.5;
+		io.bits = static_cast<uint64_t> (byte (rng) % 16);
+
+		frame.clear();
+		protocol.produce (frame, logger);
+
+		// Sometimes corrupt one byte of the frame:
+		if (unit (rng) < garbage_ratio / 2)
+			frame[static_cast<std::size_t> (byte (rng)) % frame.size()] ^= 0x5a;
+
+		traffic += frame;
+
+		// Garbage between frames, on average garbage_ratio of all data:
+		auto const garbage_bytes = static_cast<std::size_t> (2.0 * unit (rng) * frame.size() * garbage_ratio / (1.0 - garbage_ratio));
+
+		for (std::size_t i = 0; i < garbage_bytes; ++i)
+			traffic.push_back (static_cast<uint8_t> (byte (rng)));
+	}
+
+	return traffic;
+}
+
+
+ManualTest t_1 ("modules/io/link: receiver throughput on noisy link", []{
+	LoggerOutput logger_output { std::clog };
+	Logger logger { logger_output };
+	BenchmarkIO tx;
+	BenchmarkIO rx;
+	BenchmarkProtocol tx_protocol (tx);
+	BenchmarkProtocol rx_protocol (rx);
+	LegacyReceiver legacy_receiver (rx_protocol.envelopes());
+
+	for (double garbage_ratio: { 0.0, 0.1, 0.5, 0.9 })
+	{
+		auto const traffic = make_traffic (tx, tx_protocol, garbage_ratio, logger);
+		auto const mib = traffic.size() / (1024.0 * 1024.0);
+
+		auto const legacy_time = TimeHelper::measure ([&] {
+			legacy_receiver.eat (traffic.begin(), traffic.end(), logger);
+		});
+
+		auto const new_time = TimeHelper::measure ([&] {
+			rx_protocol.eat (traffic.begin(), traffic.end(), nullptr, nullptr, nullptr, logger);
+		});
+
+		std::cout << "garbage " << static_cast<int> (100 * garbage_ratio) << "%: "
+				  << "legacy " << mib / legacy_time.in<si::Second>() << " MiB/s, "
+				  << "new " << mib / new_time.in<si::Second>() << " MiB/s" << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -16,6 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/support/instrument/raster_shadow.h>
 #include <xefis/support/instrument/text_layout.h>
 
 // Neutrino:
@@ -25,10 +26,37 @@
 // Standard:
 #include <cstddef>
 #include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
 
 
 namespace adi_detail {
 
+// Margin of the cached heading tape beyond 0°…360°; must be larger than the visible part of the tape:
+static constexpr si::Angle kHeadingLayerMargin = 50_deg;
+
+
+/**
+ * Ladder scale tapes cover three consecutive windows around the current value, each at least as large as the
+ * ladder extent, so they need to be repainted only when the value moves to another window.
+ */
+static int
+tape_window_size (double const extent, int const line_every)
+{
+	auto const step = std::max (line_every, 1);
+	return static_cast<int> (std::ceil (extent / step)) * step;
+}
+
+
+static int
+floor_to_multiple (int const value, int const multiple)
+{
+	auto const step = std::max (multiple, 1);
+	return static_cast<int> (std::floor (static_cast<double> (value) / step)) * step;
+}
+
+
 void
 Parameters::sanitize()
 {
@@ -121,6 +149,37 @@ Parameters::sanitize()
 }
 
 
+bool
+Parameters::speed_warning() const noexcept
+{
+	return speed &&
+		((speed_minimum && *speed < *speed_minimum) ||
+		 (speed_maximum && *speed > *speed_maximum));
+}
+
+
+bool
+Parameters::decision_height_warning() const noexcept
+{
+	return altitude_amsl && decision_height_amsl &&
+		*altitude_amsl < *decision_height_amsl &&
+		decision_height_focus_short;
+}
+
+
+QString const&
+LabelCache::operator() (std::string_view const source)
+{
+	if (source != _source)
+	{
+		_source = source;
+		_label = QString::fromUtf8 (source.data(), static_cast<int> (source.size()));
+	}
+
+	return _label;
+}
+
+
 Blinker::Blinker (si::Time period):
 	_period (period)
 { }
@@ -178,6 +237,7 @@ Blinker::update_current_time (si::Time now)
 
 AdiPaintRequest::AdiPaintRequest (xf::PaintRequest const& paint_request, xf::InstrumentSupport const& instrument_support, Parameters const& params, Precomputed const& precomputed, Blinker const& speed_warning_blinker, Blinker const& decision_height_warning_blinker):
 	paint_request (paint_request),
+	instrument_support (instrument_support),
 	params (params),
 	precomputed (precomputed),
 	painter (instrument_support.get_painter (paint_request)),
@@ -209,42 +269,28 @@ AdiPaintRequest::heading_to_px (si::Angle const degrees) const
 
 
 void
-AdiPaintRequest::paint_rotating_value (QRectF const& rect, float position, float height_scale,
-									   QString const& next, QString const& curr, QString const& prev)
+AdiPaintRequest::update_drum_strip (xf::DigitStrip& strip, QFont const& font, QRectF const& box, float const height_scale, int const step, QString const& suffix)
 {
-	QColor red (255, 0, 0);
-	QColor green (0, 255, 0);
-
-	QFont const font = painter.font();
-	QFontMetricsF const font_metrics (font);
-	float height = height_scale * font_metrics.height();
-
-	// A little bit father to ensure next/prev are hidden beyond clipping area:
-	auto const a_little_bit_farther = 1.0f;
-	QRectF box_next = rect.translated (0.f, -a_little_bit_farther * height);
-	QRectF box_prev = rect.translated (0.f, +a_little_bit_farther * height);
-
-	painter.save_context ([&] {
-		painter.setClipRect (rect);
-		painter.translate (0.f, -height * position);
+	xf::DigitStrip::Key key;
+	key.font = font;
+	key.color = Qt::white;
+	key.cell_size = QSizeF (box.width(), height_scale * QFontMetricsF (font).height());
+	key.step = step;
+	key.suffix = suffix;
+	// Order must match kDrumGreenZone and kDrumMinus:
+	key.extra_symbols = QStringList { "G", "-" };
 
-		for (std::pair<QRectF, QString> x: { std::make_pair (box_next, next),
-											 std::make_pair (rect, curr),
-											 std::make_pair (box_prev, prev) })
-		{
-			if (x.second == "G" || x.second == "R")
-				paint_dashed_zone (x.second == "G" ? green : red, x.first);
-			else if (x.second == " ")
-				; // Paint nothing.
-			else
-				painter.fast_draw_text (x.first, Qt::AlignVCenter | Qt::AlignLeft, x.second);
-		}
+	strip.update (key, paint_request, instrument_support, [&] (xf::InstrumentPainter& strip_painter, QRectF const& cell, QString const& symbol) {
+		if (symbol == key.extra_symbols[kDrumGreenZone])
+			paint_dashed_zone (strip_painter, QColor (0, 255, 0), cell);
+		else
+			strip_painter.fast_draw_text (cell, Qt::AlignVCenter | Qt::AlignLeft, symbol);
 	});
 }
 
 
 void
-AdiPaintRequest::paint_rotating_digit (QRectF const& box, float const value, int const round_target, float const height_scale, float const delta, float const phase,
+AdiPaintRequest::paint_rotating_digit (xf::DigitStrip const& strip, QRectF const& box, float const value, int const round_target, float const delta, float const phase,
 									   bool const two_zeros, bool const zero_mark, bool const black_zero)
 {
 	auto round_to = [](float v, int to) -> float
@@ -265,21 +311,24 @@ AdiPaintRequest::paint_rotating_digit (QRectF const& box, float const value, int
 	int b = static_cast<int> (std::abs (xb));
 	int c = static_cast<int> (std::abs (xc));
 
-	QString sa = zero_mark && a == 0 ? (black_zero ? " " : (xa >= 0.f ? "G" : "-")) : QString::number (a);
-	QString sb = zero_mark && b == 0 ? (black_zero ? " " : (xb >= 0.f ? "G" : "-")) : QString::number (b);
-	QString sc = zero_mark && c == 0 ? (black_zero ? " " : (xc >= 0.f ? "G" : "-")) : QString::number (c);
+	auto cell = [&] (int digit, float x) {
+		if (zero_mark && digit == 0)
+			return black_zero ? xf::DigitStrip::kBlank : strip.symbol_cell (x >= 0.f ? kDrumGreenZone : kDrumMinus);
+		else
+			return strip.digit_cell (digit);
+	};
 
 	if (std::abs (dtr) < delta && (two_zeros || std::abs (value) >= round_target / 2))
 		pos = xf::floored_mod (-dtr * (0.5f / delta), 1.f) - 0.5f;
 
-	paint_rotating_value (box, pos, height_scale, sa, sb, sc);
+	strip.draw (painter, box, pos, cell (a, xa), cell (b, xb), cell (c, xc));
 }
 
 
 void
-AdiPaintRequest::paint_dashed_zone (QColor const& color, QRectF const& target)
+AdiPaintRequest::paint_dashed_zone (xf::InstrumentPainter& zone_painter, QColor const& color, QRectF const& target)
 {
-	QFontMetricsF const metrics (painter.font());
+	QFontMetricsF const metrics (zone_painter.font());
 	float const w = 0.7f * metrics.width ("0");
 	float const h = 0.55f * metrics.height();
 	QPointF const center = target.center();
@@ -288,13 +337,13 @@ AdiPaintRequest::paint_dashed_zone (QColor const& color, QRectF const& target)
 	QPointF const difx (box.width() / 2.5f, 0.f);
 	QPointF const dify (0.f, box.height() / 2.5f);
 	pen.setCapStyle (Qt::RoundCap);
-	painter.save_context ([&] {
-		painter.setPen (pen);
-		painter.drawLine (box.topLeft(), box.bottomRight());
-		painter.drawLine (box.topLeft() + difx, box.bottomRight() - dify);
-		painter.drawLine (box.topLeft() + dify, box.bottomRight() - difx);
-		painter.drawLine (box.topLeft() + 2.f * difx, box.bottomRight() - 2.f * dify);
-		painter.drawLine (box.topLeft() + 2.f * dify, box.bottomRight() - 2.f * difx);
+	zone_painter.save_context ([&] {
+		zone_painter.setPen (pen);
+		zone_painter.drawLine (box.topLeft(), box.bottomRight());
+		zone_painter.drawLine (box.topLeft() + difx, box.bottomRight() - dify);
+		zone_painter.drawLine (box.topLeft() + dify, box.bottomRight() - difx);
+		zone_painter.drawLine (box.topLeft() + 2.f * difx, box.bottomRight() - 2.f * dify);
+		zone_painter.drawLine (box.topLeft() + 2.f * dify, box.bottomRight() - 2.f * difx);
 	});
 }
 
@@ -467,6 +516,42 @@ ArtificialHorizon::precompute (AdiPaintRequest& pr)
 			_pitch_scale_clipping_path = clip_path;
 		}
 	}
+
+	ViewLayerKey const view_layer_key { pr.paint_request.metric(), pr.params.fov };
+	float const lesser_dimension = pr.aids.lesser_dimension();
+	float const fpxs = pr.aids.font_1.font.pixelSize();
+
+	// Pitch scale:
+	{
+		float const x = lesser_dimension / 9.f + 5.25f * fpxs;
+		float const top = pr.pitch_to_px (+90_deg) - fpxs;
+		float const bottom = pr.pitch_to_px (-90_deg) + fpxs;
+
+		_pitch_scale_layer.update (view_layer_key, QRectF (-x, top, 2.f * x, bottom - top), pr.paint_request, pr.instrument_support, [&] (xf::InstrumentPainter& painter) {
+			paint_pitch_scale_layer (pr, painter);
+		});
+	}
+
+	// Heading tape:
+	{
+		float const w = lesser_dimension * 2.25f / 9.f;
+		float const left = pr.heading_to_px (-kHeadingLayerMargin) - 2.f * fpxs;
+		float const right = pr.heading_to_px (360_deg + kHeadingLayerMargin) + 2.f * fpxs;
+		float const top = -w / 18.f - fpxs;
+
+		_heading_layer.update (view_layer_key, QRectF (left, top, right - left, 2.f * fpxs - top), pr.paint_request, pr.instrument_support, [&] (xf::InstrumentPainter& painter) {
+			paint_heading_layer (pr, painter);
+		});
+	}
+
+	// Roll scale:
+	{
+		float const w = lesser_dimension * 3.f / 9.f;
+
+		_roll_scale_layer.update (pr.paint_request.metric(), QRectF (-w, -w, 2.f * w, 2.25f * w), pr.paint_request, pr.instrument_support, [&] (xf::InstrumentPainter& painter) {
+			paint_roll_scale_layer (pr, painter);
+		});
+	}
 }
 
 
@@ -513,10 +598,8 @@ ArtificialHorizon::paint_pitch_scale (AdiPaintRequest& pr) const
 {
 	if (pr.params.orientation_pitch)
 	{
-		float const lesser_dimension = pr.aids.lesser_dimension();
-		float const w = lesser_dimension * (2.0f / 9.0f);
+		float const w = pr.aids.lesser_dimension() * (2.0f / 9.0f);
 		float const z = 0.5f * w;
-		float const fpxs = pr.aids.font_1.font.pixelSize();
 
 		// Clip rectangle before and after rotation:
 		pr.painter.setTransform (pr.precomputed.center_transform);
@@ -528,71 +611,9 @@ ArtificialHorizon::paint_pitch_scale (AdiPaintRequest& pr) const
 		pr.painter.setTransform (_roll_transform * pr.precomputed.center_transform);
 		pr.painter.setClipRect (QRectF (-w, -1.f * w, 2.f * w, 2.2f * w), Qt::IntersectClip);
 		pr.painter.setTransform (_horizon_transform);
-		pr.painter.setFont (pr.aids.scaled_default_font (1.2f));
-
-		// Pitch scale is clipped to small rectangle, so narrow it even more:
-		float const clipped_pitch_factor = 0.45f;
-		xf::Range<si::Angle> deg_range (*pr.params.orientation_pitch - clipped_pitch_factor * 0.485f * pr.params.fov,
-										*pr.params.orientation_pitch + clipped_pitch_factor * 0.365f * pr.params.fov);
-
-		pr.painter.setPen (pr.aids.get_pen (Qt::white, 1.f));
-
-		// 10° lines, exclude +/-90°:
-		for (int deg = -90; deg <= 90; deg += 10)
-		{
-			if (deg_range.includes (1_deg * deg) && deg != 0)
-			{
-				float const d = pr.pitch_to_px (1_deg * deg);
-				pr.painter.paint (get_shadow (pr, deg), [&] {
-					pr.painter.drawLine (QPointF (-z, d), QPointF (z, d));
-				});
-				// Degs number:
-				int const abs_deg = std::abs (deg);
-				QString const deg_t = QString::number (abs_deg > 90 ? 180 - abs_deg : abs_deg);
-				//// Text:
-				QRectF const lbox (-z - 4.25f * fpxs, d - 0.5f * fpxs, 4.f * fpxs, fpxs);
-				QRectF const rbox (+z + 0.25f * fpxs, d - 0.5f * fpxs, 4.f * fpxs, fpxs);
-				pr.painter.fast_draw_text (lbox, Qt::AlignVCenter | Qt::AlignRight, deg_t, pr.default_shadow);
-				pr.painter.fast_draw_text (rbox, Qt::AlignVCenter | Qt::AlignLeft, deg_t, pr.default_shadow);
-			}
-		}
-
-		// 5° lines:
-		for (int deg = -90; deg <= 90; deg += 5)
-		{
-			if (deg_range.includes (1_deg * deg) && deg % 10 != 0)
-			{
-				float const d = pr.pitch_to_px (1_deg * deg);
-				pr.painter.paint (get_shadow (pr, deg), [&] {
-					pr.painter.drawLine (QPointF (-z / 2.f, d), QPointF (z / 2.f, d));
-				});
-			}
-		}
 
-		// 2.5° lines:
-		for (int deg = -900; deg <= 900; deg += 25)
-		{
-			if (deg_range.includes (1_deg * deg / 10) && deg % 50 != 0)
-			{
-				float const d = pr.pitch_to_px (1_deg * deg / 10.f);
-				pr.painter.paint (get_shadow (pr, deg), [&] {
-					pr.painter.drawLine (QPointF (-z / 4.f, d), QPointF (z / 4.f, d));
-				});
-			}
-		}
-
-		// -90°, 90° lines:
-		if (deg_range.includes (-90_deg) || deg_range.includes (+90_deg))
-		{
-			for (float deg: { -90.f, 90.f })
-			{
-				float const d = pr.pitch_to_px (1_deg * deg);
-				pr.painter.setPen (pr.aids.get_pen (Qt::white, 1.75f));
-				pr.painter.paint (get_shadow (pr, deg), [&] {
-					pr.painter.drawLine (QPointF (-z, d), QPointF (z, d));
-				});
-			}
-		}
+		// Lines and numbers are painted once into the cached layer:
+		_pitch_scale_layer.draw (pr.painter);
 
 		// FPA bug:
 		if (pr.params.cmd_fpa)
@@ -614,6 +635,73 @@ ArtificialHorizon::paint_pitch_scale (AdiPaintRequest& pr) const
 }
 
 
+void
+ArtificialHorizon::paint_pitch_scale_layer (AdiPaintRequest& pr, xf::InstrumentPainter& painter) const
+{
+	float const lesser_dimension = pr.aids.lesser_dimension();
+	float const w = lesser_dimension * (2.0f / 9.0f);
+	float const z = 0.5f * w;
+	float const fpxs = pr.aids.font_1.font.pixelSize();
+
+	painter.setFont (pr.aids.scaled_default_font (1.2f));
+	painter.setPen (pr.aids.get_pen (Qt::white, 1.f));
+
+	// 10° lines, exclude 0°:
+	for (int deg = -90; deg <= 90; deg += 10)
+	{
+		if (deg != 0)
+		{
+			float const d = pr.pitch_to_px (1_deg * deg);
+			painter.paint (get_shadow (pr, deg), [&] {
+				painter.drawLine (QPointF (-z, d), QPointF (z, d));
+			});
+			// Degs number:
+			QString const deg_t = QString::number (std::abs (deg));
+			//// Text:
+			QRectF const lbox (-z - 4.25f * fpxs, d - 0.5f * fpxs, 4.f * fpxs, fpxs);
+			QRectF const rbox (+z + 0.25f * fpxs, d - 0.5f * fpxs, 4.f * fpxs, fpxs);
+			painter.fast_draw_text (lbox, Qt::AlignVCenter | Qt::AlignRight, deg_t, pr.default_shadow);
+			painter.fast_draw_text (rbox, Qt::AlignVCenter | Qt::AlignLeft, deg_t, pr.default_shadow);
+		}
+	}
+
+	// 5° lines:
+	for (int deg = -90; deg <= 90; deg += 5)
+	{
+		if (deg % 10 != 0)
+		{
+			float const d = pr.pitch_to_px (1_deg * deg);
+			painter.paint (get_shadow (pr, deg), [&] {
+				painter.drawLine (QPointF (-z / 2.f, d), QPointF (z / 2.f, d));
+			});
+		}
+	}
+
+	// 2.5° lines:
+	for (int deg = -900; deg <= 900; deg += 25)
+	{
+		if (deg % 50 != 0)
+		{
+			float const d = pr.pitch_to_px (1_deg * deg / 10.f);
+			painter.paint (get_shadow (pr, deg), [&] {
+				painter.drawLine (QPointF (-z / 4.f, d), QPointF (z / 4.f, d));
+			});
+		}
+	}
+
+	// -90°, 90° lines:
+	painter.setPen (pr.aids.get_pen (Qt::white, 1.75f));
+
+	for (float deg: { -90.f, 90.f })
+	{
+		float const d = pr.pitch_to_px (1_deg * deg);
+		painter.paint (get_shadow (pr, deg), [&] {
+			painter.drawLine (QPointF (-z, d), QPointF (z, d));
+		});
+	}
+}
+
+
 void
 ArtificialHorizon::paint_roll_scale (AdiPaintRequest& pr) const
 {
@@ -629,38 +717,8 @@ ArtificialHorizon::paint_roll_scale (AdiPaintRequest& pr) const
 	pr.painter.setTransform (pr.precomputed.center_transform);
 	pr.painter.setClipRect (QRectF (-w, -w, 2.f * w, 2.25f * w));
 
-	for (float deg: { -60.f, -45.f, -30.f, -20.f, -10.f, 0.f, +10.f, +20.f, +30.f, +45.f, +60.f })
-	{
-		pr.painter.setTransform (pr.precomputed.center_transform);
-		pr.painter.rotate (1.f * deg);
-		pr.painter.translate (0.f, -0.795f * w);
-
-		if (deg == 0.f)
-		{
-			// Triangle:
-			QPointF const p0 (0.f, 0.f);
-			QPointF const px (0.025f * w, 0.f);
-			QPointF const py (0.f, 0.05f * w);
-			QPolygonF const poly ({ p0, p0 - px - py, p0 + px - py });
-
-			pr.painter.paint (pr.default_shadow, [&] {
-				pr.painter.drawPolygon (poly);
-			});
-		}
-		else
-		{
-			float length = -0.05f * w;
-
-			if (std::abs (std::fmod (deg, 60.f)) < 1.f)
-				length *= 1.6f;
-			else if (std::abs (std::fmod (deg, 30.f)) < 1.f)
-				length *= 2.2f;
-
-			pr.painter.paint (get_shadow (pr, deg), [&] {
-				pr.painter.drawLine (QPointF (0.f, 0.f), QPointF (0.f, length));
-			});
-		}
-	}
+	// Scale marks are painted once into the cached layer:
+	_roll_scale_layer.draw (pr.painter);
 
 	if (pr.params.orientation_roll)
 	{
@@ -727,11 +785,54 @@ ArtificialHorizon::paint_roll_scale (AdiPaintRequest& pr) const
 }
 
 
+void
+ArtificialHorizon::paint_roll_scale_layer (AdiPaintRequest& pr, xf::InstrumentPainter& painter) const
+{
+	float const w = pr.aids.lesser_dimension() * 3.f / 9.f;
+	QTransform const base_transform = painter.transform();
+
+	painter.setPen (pr.aids.get_pen (Qt::white, 1.f));
+	painter.setBrush (QBrush (Qt::white));
+
+	for (float deg: { -60.f, -45.f, -30.f, -20.f, -10.f, 0.f, +10.f, +20.f, +30.f, +45.f, +60.f })
+	{
+		painter.setTransform (base_transform);
+		painter.rotate (1.f * deg);
+		painter.translate (0.f, -0.795f * w);
+
+		if (deg == 0.f)
+		{
+			// Triangle:
+			QPointF const p0 (0.f, 0.f);
+			QPointF const px (0.025f * w, 0.f);
+			QPointF const py (0.f, 0.05f * w);
+			QPolygonF const poly ({ p0, p0 - px - py, p0 + px - py });
+
+			painter.paint (pr.default_shadow, [&] {
+				painter.drawPolygon (poly);
+			});
+		}
+		else
+		{
+			float length = -0.05f * w;
+
+			if (std::abs (std::fmod (deg, 60.f)) < 1.f)
+				length *= 1.6f;
+			else if (std::abs (std::fmod (deg, 30.f)) < 1.f)
+				length *= 2.2f;
+
+			painter.paint (get_shadow (pr, deg), [&] {
+				painter.drawLine (QPointF (0.f, 0.f), QPointF (0.f, length));
+			});
+		}
+	}
+}
+
+
 void
 ArtificialHorizon::paint_heading (AdiPaintRequest& pr) const
 {
 	float const w = pr.aids.lesser_dimension() * 2.25f / 9.f;
-	float const fpxs = pr.aids.font_1.font.pixelSize();
 
 	if (pr.params.orientation_pitch && pr.params.orientation_roll)
 	{
@@ -745,49 +846,11 @@ ArtificialHorizon::paint_heading (AdiPaintRequest& pr) const
 		pr.painter.setTransform (_roll_transform * pr.precomputed.center_transform);
 		pr.painter.setClipRect (QRectF (-1.1f * w, -0.8f * w, 2.2f * w, 1.9f * w), Qt::IntersectClip);
 
-		QPen p = pr.aids.get_pen (Qt::white, 1.f);
-		p.setCapStyle (Qt::FlatCap);
-		pr.painter.setPen (p);
-		pr.painter.setFont (pr.aids.font_1.font);
-
-		if (pr.params.orientation_heading)
+		// Heading tape is painted once into the cached layer (heading is sanitized to 0°…360°):
+		if (pr.params.orientation_heading && pr.params.orientation_heading_numbers_visible)
 		{
-			float clipped_pitch_factor = 0.5f;
-			xf::Range<si::Angle> deg_range (*pr.params.orientation_heading - clipped_pitch_factor * 0.485f * pr.params.fov,
-											*pr.params.orientation_heading + clipped_pitch_factor * 0.350f * pr.params.fov);
-
 			pr.painter.setTransform (_heading_transform * _horizon_transform);
-			if (pr.params.orientation_heading_numbers_visible)
-			{
-				for (int deg = -180; deg < 540; deg += 10)
-				{
-					if (!deg_range.includes (1_deg * deg))
-						continue;
-
-					float const d10 = pr.heading_to_px (1_deg * deg);
-					float const d05 = pr.heading_to_px (1_deg * deg + 5_deg);
-					// 10° lines:
-					pr.painter.paint (pr.default_shadow, [&] {
-						pr.painter.drawLine (QPointF (d10, -w / 18.f), QPointF (d10, 0.f));
-					});
-					// 5° lines:
-					pr.painter.paint (pr.default_shadow, [&] {
-						pr.painter.drawLine (QPointF (d05, -w / 36.f), QPointF (d05, 0.f));
-					});
-
-					QString text = QString::fromStdString ((boost::format ("%02d") % (xf::floored_mod (1.f * deg, 360.f) / 10)).str());
-					if (text == "00")
-						text = "N";
-					else if (text == "09")
-						text = "E";
-					else if (text == "18")
-						text = "S";
-					else if (text == "27")
-						text = "W";
-					pr.painter.fast_draw_text (QRectF (d10 - 2.f * fpxs, 0.f, 4.f * fpxs, fpxs),
-											   Qt::AlignVCenter | Qt::AlignHCenter, text, pr.default_shadow);
-				}
-			}
+			_heading_layer.draw (pr.painter);
 		}
 
 		// Main horizon line:
@@ -800,6 +863,49 @@ ArtificialHorizon::paint_heading (AdiPaintRequest& pr) const
 }
 
 
+void
+ArtificialHorizon::paint_heading_layer (AdiPaintRequest& pr, xf::InstrumentPainter& painter) const
+{
+	float const w = pr.aids.lesser_dimension() * 2.25f / 9.f;
+	float const fpxs = pr.aids.font_1.font.pixelSize();
+	xf::Range<si::Angle> const deg_range (-kHeadingLayerMargin, 360_deg + kHeadingLayerMargin);
+
+	QPen p = pr.aids.get_pen (Qt::white, 1.f);
+	p.setCapStyle (Qt::FlatCap);
+	painter.setPen (p);
+	painter.setFont (pr.aids.font_1.font);
+
+	for (int deg = -180; deg < 540; deg += 10)
+	{
+		if (!deg_range.includes (1_deg * deg))
+			continue;
+
+		float const d10 = pr.heading_to_px (1_deg * deg);
+		float const d05 = pr.heading_to_px (1_deg * deg + 5_deg);
+		// 10° lines:
+		painter.paint (pr.default_shadow, [&] {
+			painter.drawLine (QPointF (d10, -w / 18.f), QPointF (d10, 0.f));
+		});
+		// 5° lines:
+		painter.paint (pr.default_shadow, [&] {
+			painter.drawLine (QPointF (d05, -w / 36.f), QPointF (d05, 0.f));
+		});
+
+		QString text = QString::fromStdString ((boost::format ("%02d") % (xf::floored_mod (1.f * deg, 360.f) / 10)).str());
+		if (text == "00")
+			text = "N";
+		else if (text == "09")
+			text = "E";
+		else if (text == "18")
+			text = "S";
+		else if (text == "27")
+			text = "W";
+		painter.fast_draw_text (QRectF (d10 - 2.f * fpxs, 0.f, 4.f * fpxs, fpxs),
+								Qt::AlignVCenter | Qt::AlignHCenter, text, pr.default_shadow);
+	}
+}
+
+
 void
 ArtificialHorizon::paint_tcas_ra (AdiPaintRequest& pr) const
 {
@@ -1002,6 +1108,25 @@ VelocityLadder::precompute (AdiPaintRequest& pr)
 		_black_box_rect = QRectF (-_digits * digit_width - 2.f * _margin, -0.5f * box_height_factor * digit_height,
 								  +_digits * digit_width + 2.f * _margin, box_height_factor * digit_height);
 
+		// Digit drums:
+		{
+			QFont const& font = pr.aids.font_5.font;
+			QRectF const box_1000 = _black_box_rect.adjusted (_margin, _margin, -_margin, -_margin);
+			QRectF const box_0100 =
+				_digits == 3
+					? box_1000
+					: box_1000.adjusted (digit_width, 0.f, 0.f, 0.f);
+			QRectF const box_0010 = box_0100.adjusted (digit_width, 0.f, 0.f, 0.f);
+			QRectF const box_0001 = box_0010.adjusted (digit_width, 0.f, 0.f, 0.f);
+
+			_drum_boxes = { box_1000, box_0100, box_0010, box_0001 };
+
+			for (std::size_t i = 0; i < 3; ++i)
+				pr.update_drum_strip (_drums[i], font, _drum_boxes[i], 1.25f);
+
+			pr.update_drum_strip (_drums[3], font, _drum_boxes[3], 0.7f);
+		}
+
 		_transform = pr.precomputed.center_transform;
 		_transform.translate (-0.4f * ld, 0.f);
 
@@ -1026,6 +1151,33 @@ VelocityLadder::precompute (AdiPaintRequest& pr)
 		_ladder_clip_path.addRect (_ladder_rect);
 		_ladder_clip_path -= black_box_clearance_path;
 	}
+
+	// Scale tape:
+	{
+		auto const& p = pr.params;
+		int const window_size = tape_window_size (p.vl_extent.in<si::Knot>(), p.vl_line_every);
+		auto const window = static_cast<int64_t> (std::floor (speed.in<si::Knot>() / window_size));
+		int const anchor = static_cast<int> (window) * window_size;
+		int const min_kt = anchor - window_size - p.vl_line_every;
+		int const max_kt = anchor + 2 * window_size + p.vl_line_every;
+		float const px_per_kt = _ladder_rect.height() / p.vl_extent.in<si::Knot>();
+		float const x = _ladder_rect.width() / 4.0f;
+		float const digit_height = pr.aids.font_2.digit_height;
+		float const left = -4.f * pr.aids.font_2.digit_width - 2.f * x;
+		float const top = -px_per_kt * (max_kt - anchor) - digit_height;
+		float const bottom = -px_per_kt * (min_kt - anchor) + digit_height;
+		LadderTapeKey<si::Velocity> const key {
+			pr.paint_request.metric(),
+			p.vl_extent,
+			{ p.vl_minimum, p.vl_maximum, p.vl_line_every, p.vl_number_every },
+			window,
+		};
+
+		_scale_tape_anchor = anchor;
+		_scale_tape.update (key, QRectF (left, top, x - left, bottom - top), pr.paint_request, pr.instrument_support, [&] (xf::InstrumentPainter& painter) {
+			paint_scale_tape (pr, painter, min_kt, max_kt);
+		});
+	}
 }
 
 
@@ -1034,9 +1186,6 @@ VelocityLadder::paint_black_box (AdiPaintRequest& pr, float const x) const
 {
 	if (pr.params.speed)
 	{
-		QFont const& actual_speed_font = pr.aids.font_5.font;
-		float const digit_width = pr.aids.font_5.digit_width;
-
 		pr.painter.setClipping (false);
 		pr.painter.setTransform (_transform);
 		pr.painter.translate (+0.75f * x, 0.f);
@@ -1071,29 +1220,23 @@ VelocityLadder::paint_black_box (AdiPaintRequest& pr, float const x) const
 			pr.painter.drawPolygon (black_box_polygon);
 		});
 
-		QRectF box_1000 = _black_box_rect.adjusted (_margin, _margin, -_margin, -_margin);
-		QRectF box_0100 =
-			_digits == 3
-				? box_1000
-				: box_1000.adjusted (digit_width, 0.f, 0.f, 0.f);
-		QRectF box_0010 = box_0100.adjusted (digit_width, 0.f, 0.f, 0.f);
-		QRectF box_0001 = box_0010.adjusted (digit_width, 0.f, 0.f, 0.f);
-
-		pr.painter.setPen (QPen (Qt::white, 1.f, Qt::SolidLine, Qt::RoundCap));
-		pr.painter.setFont (actual_speed_font);
+		auto const speed = pr.params.speed->in<si::Knot>();
 
+		// Digits are blitted from pre-rendered strips:
 		if (_digits == 4)
-			pr.paint_rotating_digit (box_1000, pr.params.speed->in<si::Knot>(), 1000, 1.25f, 0.0005f, 0.5f, false, true);
+			pr.paint_rotating_digit (_drums[0], _drum_boxes[0], speed, 1000, 0.0005f, 0.5f, false, true);
 
-		pr.paint_rotating_digit (box_0100, pr.params.speed->in<si::Knot>(), 100, 1.25f, 0.005f, 0.5f, false, true, true);
-		pr.paint_rotating_digit (box_0010, pr.params.speed->in<si::Knot>(), 10, 1.25f, 0.05f, 0.5f, false, false);
-		float pos_0001 = _rounded_speed - pr.params.speed->in<si::Knot>();
-		pr.paint_rotating_value (box_0001, pos_0001, 0.7f,
-								 QString::number (static_cast<int> (std::abs (std::fmod (1.f * _rounded_speed + 1.f, 10.f)))),
-								 QString::number (static_cast<int> (std::abs (std::fmod (1.f * _rounded_speed, 10.f)))),
-								 *pr.params.speed > (1_kt * pr.params.vl_minimum + 0.5_kt)
-									? QString::number (static_cast<int> (xf::floored_mod (1.f * _rounded_speed - 1.f, 10.f)))
-									: " ");
+		pr.paint_rotating_digit (_drums[1], _drum_boxes[1], speed, 100, 0.005f, 0.5f, false, true, true);
+		pr.paint_rotating_digit (_drums[2], _drum_boxes[2], speed, 10, 0.05f, 0.5f, false, false);
+
+		auto const& drum_0001 = _drums[3];
+		float pos_0001 = _rounded_speed - speed;
+		drum_0001.draw (pr.painter, _drum_boxes[3], pos_0001,
+						drum_0001.digit_cell (static_cast<int> (std::abs (std::fmod (1.f * _rounded_speed + 1.f, 10.f)))),
+						drum_0001.digit_cell (static_cast<int> (std::abs (std::fmod (1.f * _rounded_speed, 10.f)))),
+						*pr.params.speed > (1_kt * pr.params.vl_minimum + 0.5_kt)
+							? drum_0001.digit_cell (static_cast<int> (xf::floored_mod (1.f * _rounded_speed - 1.f, 10.f)))
+							: xf::DigitStrip::kBlank);
 	}
 }
 
@@ -1123,37 +1266,43 @@ VelocityLadder::paint_ladder_scale (AdiPaintRequest& pr, float const x) const
 {
 	if (pr.params.speed)
 	{
-		QFont const& ladder_font = pr.aids.font_2.font;
-		float const ladder_digit_width = pr.aids.font_2.digit_width;
-		float const ladder_digit_height = pr.aids.font_2.digit_height;
-
-		pr.painter.setFont (ladder_font);
-
 		pr.painter.setTransform (_transform);
 		pr.painter.setClipPath (_ladder_clip_path, Qt::IntersectClip);
-		pr.painter.translate (2.f * x, 0.f);
+		pr.painter.translate (2.f * x, kt_to_px (pr, 1_kt * _scale_tape_anchor));
 
-		pr.painter.setPen (_scale_pen);
-		// -+line_every is to have drawn also numbers that barely fit the scale.
-		for (int kt = (static_cast<int> (_min_shown.in<si::Knot>()) / pr.params.vl_line_every) * pr.params.vl_line_every - pr.params.vl_line_every;
-			 kt <= _max_shown.in<si::Knot>() + pr.params.vl_line_every;
-			 kt += pr.params.vl_line_every)
-		{
-			if (kt < pr.params.vl_minimum || kt > pr.params.vl_maximum)
-				continue;
+		// Lines and numbers are painted into the cached tape:
+		_scale_tape.draw (pr.painter);
+	}
+}
 
-			float posy = kt_to_px (pr, 1_kt * kt);
-			pr.painter.paint (pr.default_shadow, [&] {
-				pr.painter.drawLine (QPointF (-0.8f * x, posy), QPointF (0.f, posy));
-			});
 
-			if ((kt - pr.params.vl_minimum) % pr.params.vl_number_every == 0)
-			{
-				pr.painter.fast_draw_text (QRectF (-4.f * ladder_digit_width - 1.25f * x, -0.5f * ladder_digit_height + posy,
-												   +4.f * ladder_digit_width, ladder_digit_height),
-										   Qt::AlignVCenter | Qt::AlignRight, QString::number (kt),
-										   pr.default_shadow);
-			}
+void
+VelocityLadder::paint_scale_tape (AdiPaintRequest& pr, xf::InstrumentPainter& painter, int const min_kt, int const max_kt) const
+{
+	float const x = _ladder_rect.width() / 4.0f;
+	float const px_per_kt = _ladder_rect.height() / pr.params.vl_extent.in<si::Knot>();
+	float const ladder_digit_width = pr.aids.font_2.digit_width;
+	float const ladder_digit_height = pr.aids.font_2.digit_height;
+
+	painter.setFont (pr.aids.font_2.font);
+	painter.setPen (_scale_pen);
+
+	for (int kt = floor_to_multiple (min_kt, pr.params.vl_line_every); kt <= max_kt; kt += pr.params.vl_line_every)
+	{
+		if (kt < pr.params.vl_minimum || kt > pr.params.vl_maximum)
+			continue;
+
+		float const posy = -px_per_kt * (kt - _scale_tape_anchor);
+		painter.paint (pr.default_shadow, [&] {
+			painter.drawLine (QPointF (-0.8f * x, posy), QPointF (0.f, posy));
+		});
+
+		if ((kt - pr.params.vl_minimum) % pr.params.vl_number_every == 0)
+		{
+			painter.fast_draw_text (QRectF (-4.f * ladder_digit_width - 1.25f * x, -0.5f * ladder_digit_height + posy,
+											+4.f * ladder_digit_width, ladder_digit_height),
+									Qt::AlignVCenter | Qt::AlignRight, QString::number (kt),
+									pr.default_shadow);
 		}
 	}
 }
@@ -1284,9 +1433,9 @@ VelocityLadder::paint_bugs (AdiPaintRequest& pr, float const x) const
 
 		for (auto const& bug: pr.params.speed_bugs)
 		{
-			if (bug.second > _min_shown && bug.second < _max_shown)
+			if (bug.value > _min_shown && bug.value < _max_shown)
 			{
-				float posy = kt_to_px (pr, bug.second);
+				float posy = kt_to_px (pr, bug.value);
 				pr.painter.setPen (_speed_bug_pen);
 				pr.painter.setClipRect (_ladder_rect.translated (x, 0.f));
 				pr.painter.paint (pr.default_shadow, [&] {
@@ -1295,7 +1444,7 @@ VelocityLadder::paint_bugs (AdiPaintRequest& pr, float const x) const
 				pr.painter.setClipping (false);
 				pr.painter.fast_draw_text (QRectF (2.5f * x, posy - 0.5f * speed_bug_digit_height,
 												   2.f * x, speed_bug_digit_height),
-										   Qt::AlignVCenter | Qt::AlignLeft, bug.first, pr.default_shadow);
+										   Qt::AlignVCenter | Qt::AlignLeft, bug.label, pr.default_shadow);
 			}
 		}
 
@@ -1546,6 +1695,26 @@ AltitudeLadder::precompute (AdiPaintRequest& pr)
 		_b_digits_box.translate (_margin, -0.5f * _b_digits_box.height());
 		_s_digits_box.translate (_margin + _b_digits_box.width(), -0.5f * _s_digits_box.height());
 
+		// Digit drums:
+		{
+			QFont const& b_font = pr.aids.font_5.font;
+			QFont const& s_font = pr.aids.font_3.font;
+			float const s_digit_height = pr.aids.font_3.digit_height;
+			float const b_height_scale = 1.25f * s_digit_height / b_digit_height;
+			QRectF const box_10000 = QRectF (_b_digits_box.topLeft(), QSizeF (b_digit_width, _b_digits_box.height()));
+			QRectF const box_01000 = box_10000.translated (b_digit_width, 0.f);
+			QRectF const box_00100 = QRectF (_s_digits_box.topLeft(), QSizeF (s_digit_width, _b_digits_box.height()));
+			QRectF const box_00011 = box_00100.translated (s_digit_width, 0.f).adjusted (0.f, 0.f, s_digit_width, 0.f);
+
+			_drum_boxes = { box_10000, box_01000, box_00100, box_00011 };
+
+			pr.update_drum_strip (_drums[0], b_font, box_10000, b_height_scale);
+			pr.update_drum_strip (_drums[1], b_font, box_01000, b_height_scale);
+			pr.update_drum_strip (_drums[2], s_font, box_00100, 1.25f);
+			// Tens of feet go in 20-ft steps:
+			pr.update_drum_strip (_drums[3], s_font, box_00011, 0.75f, 2, "0");
+		}
+
 		float const x = _ladder_rect.width() / 4.0f;
 
 		// Special clipping that leaves some margin around black indicator:
@@ -1565,23 +1734,41 @@ AltitudeLadder::precompute (AdiPaintRequest& pr)
 		_decision_height_clip_path.addRect (_ladder_rect.adjusted (-2.5f * x, 0.f, 0.f, 0.f));
 		_decision_height_clip_path -= black_box_clearance_path;
 	}
+
+	// Scale tape:
+	{
+		auto const& p = pr.params;
+		int const window_size = tape_window_size (p.al_extent.in<si::Foot>(), p.al_line_every);
+		auto const window = static_cast<int64_t> (std::floor (altitude_amsl.in<si::Foot>() / window_size));
+		int const anchor = static_cast<int> (window) * window_size;
+		int const min_ft = anchor - window_size - p.al_line_every;
+		int const max_ft = anchor + 2 * window_size + p.al_line_every;
+		float const px_per_ft = _ladder_rect.height() / p.al_extent.in<si::Foot>();
+		float const x = _ladder_rect.width() / 4.0f;
+		float const digit_height = pr.aids.font_2.digit_height;
+		float const left = -x;
+		float const right = 6.f * x + 2.1f * pr.aids.font_2.digit_width + 3.f * pr.aids.font_1.digit_width;
+		float const top = -px_per_ft * (max_ft - anchor) - 1.5f * digit_height;
+		float const bottom = -px_per_ft * (min_ft - anchor) + 1.5f * digit_height;
+		LadderTapeKey<si::Length> const key {
+			pr.paint_request.metric(),
+			p.al_extent,
+			{ p.al_emphasis_every, p.al_bold_every, p.al_number_every, p.al_line_every },
+			window,
+		};
+
+		_scale_tape_anchor = anchor;
+		_scale_tape.update (key, QRectF (left, top, right - left, bottom - top), pr.paint_request, pr.instrument_support, [&] (xf::InstrumentPainter& painter) {
+			paint_scale_tape (pr, painter, min_ft, max_ft);
+		});
+	}
 }
 
 
 void
 AltitudeLadder::paint_black_box (AdiPaintRequest& pr, float const x) const
 {
-	QFont const& b_font = pr.aids.font_5.font;
-	float const b_digit_width = pr.aids.font_5.digit_width;
-	float const b_digit_height = pr.aids.font_5.digit_height;
-
-	QFont const& s_font = pr.aids.font_3.font;
-	float const s_digit_width = pr.aids.font_3.digit_width;
-	float const s_digit_height = pr.aids.font_3.digit_height;
-
 	QFont const& m_font = pr.aids.font_2.font;
-
-	QFontMetricsF const s_metrics (s_font);
 	QFontMetricsF const m_metrics (m_font);
 
 	if (pr.params.altitude_amsl)
@@ -1629,25 +1816,22 @@ AltitudeLadder::paint_black_box (AdiPaintRequest& pr, float const x) const
 			pr.painter.drawPolygon (black_box_polygon);
 		});
 
-		// Feet value:
-		QRectF box_10000 = QRectF (_b_digits_box.topLeft(), QSizeF (b_digit_width, _b_digits_box.height()));
-		QRectF box_01000 = box_10000.translated (b_digit_width, 0.f);
-		QRectF box_00100 = QRectF (_s_digits_box.topLeft(), QSizeF (s_digit_width, _b_digits_box.height()));
-		QRectF box_00011 = box_00100.translated (s_digit_width, 0.f).adjusted (0.f, 0.f, s_digit_width, 0.f);
+		// Feet value, blitted from pre-rendered strips:
+		auto const altitude = pr.params.altitude_amsl->in<si::Foot>();
 
 		// 11100 part:
-		pr.painter.setFont (b_font);
-		pr.paint_rotating_digit (box_10000, pr.params.altitude_amsl->in<si::Foot>(), 10000, 1.25f * s_digit_height / b_digit_height, 0.0005f, 5.f, true, true);
-		pr.paint_rotating_digit (box_01000, pr.params.altitude_amsl->in<si::Foot>(), 1000, 1.25f * s_digit_height / b_digit_height, 0.005f, 5.f, false, false);
-		pr.painter.setFont (s_font);
-		pr.paint_rotating_digit (box_00100, pr.params.altitude_amsl->in<si::Foot>(), 100, 1.25f, 0.05f, 5.f, false, false);
+		pr.paint_rotating_digit (_drums[0], _drum_boxes[0], altitude, 10000, 0.0005f, 5.f, true, true);
+		pr.paint_rotating_digit (_drums[1], _drum_boxes[1], altitude, 1000, 0.005f, 5.f, false, false);
+		pr.paint_rotating_digit (_drums[2], _drum_boxes[2], altitude, 100, 0.05f, 5.f, false, false);
 
 		// 00011 part:
-		float pos_00011 = (_rounded_altitude - pr.params.altitude_amsl->in<si::Foot>()) / 20.f;
-		pr.paint_rotating_value (box_00011, pos_00011, 0.75f,
-								 QString::number (static_cast<int> (std::abs (std::fmod (_rounded_altitude / 10.f + 2.f, 10.f)))) + "0",
-								 QString::number (static_cast<int> (std::abs (std::fmod (_rounded_altitude / 10.f + 0.f, 10.f)))) + "0",
-								 QString::number (static_cast<int> (std::abs (std::fmod (_rounded_altitude / 10.f - 2.f, 10.f)))) + "0");
+		auto const& drum_00011 = _drums[3];
+		auto const tens_cell = [&] (float offset) {
+			return drum_00011.digit_cell (static_cast<int> (std::abs (std::fmod (_rounded_altitude / 10.f + offset, 10.f))));
+		};
+
+		float pos_00011 = (_rounded_altitude - altitude) / 20.f;
+		drum_00011.draw (pr.painter, _drum_boxes[3], pos_00011, tens_cell (+2.f), tens_cell (0.f), tens_cell (-2.f));
 	}
 }
 
@@ -1677,74 +1861,82 @@ AltitudeLadder::paint_ladder_scale (AdiPaintRequest& pr, float const x) const
 {
 	if (pr.params.altitude_amsl)
 	{
-		QFont const& b_ladder_font = pr.aids.font_2.font;
-		float const b_ladder_digit_width = pr.aids.font_2.digit_width;
-		float const b_ladder_digit_height = pr.aids.font_2.digit_height;
-
-		QFont const& s_ladder_font = pr.aids.font_1.font;
-		float const s_ladder_digit_width = pr.aids.font_1.digit_width;
-		float const s_ladder_digit_height = pr.aids.font_1.digit_height;
-
 		pr.painter.setTransform (_transform);
 		pr.painter.setClipPath (_ladder_clip_path, Qt::IntersectClip);
-		pr.painter.translate (-2.f * x, 0.f);
+		pr.painter.translate (-2.f * x, ft_to_px (pr, 1_ft * _scale_tape_anchor));
 
-		// -+line_every is to have drawn also numbers that barely fit the scale.
-		for (int ft = (static_cast<int> (_min_shown.in<si::Foot>()) / pr.params.al_line_every) * pr.params.al_line_every - pr.params.al_line_every;
-			 ft <= _max_shown.in<si::Foot>() + pr.params.al_line_every;
-			 ft += pr.params.al_line_every)
-		{
-			if (ft > 100000.f)
-				continue;
+		// Lines and numbers are painted into the cached tape:
+		_scale_tape.draw (pr.painter);
+	}
+}
 
-			float posy = ft_to_px (pr, 1_ft * ft);
 
-			pr.painter.setPen (ft % pr.params.al_bold_every == 0 ? _scale_pen_2 : _scale_pen_1);
-			pr.painter.paint (pr.default_shadow, [&] {
-				pr.painter.drawLine (QPointF (0.f, posy), QPointF (0.8f * x, posy));
-			});
+void
+AltitudeLadder::paint_scale_tape (AdiPaintRequest& pr, xf::InstrumentPainter& painter, int const min_ft, int const max_ft) const
+{
+	float const x = _ladder_rect.width() / 4.0f;
+	float const px_per_ft = _ladder_rect.height() / pr.params.al_extent.in<si::Foot>();
 
-			if (ft % pr.params.al_number_every == 0)
+	QFont const& b_ladder_font = pr.aids.font_2.font;
+	float const b_ladder_digit_width = pr.aids.font_2.digit_width;
+	float const b_ladder_digit_height = pr.aids.font_2.digit_height;
+
+	QFont const& s_ladder_font = pr.aids.font_1.font;
+	float const s_ladder_digit_width = pr.aids.font_1.digit_width;
+	float const s_ladder_digit_height = pr.aids.font_1.digit_height;
+
+	for (int ft = floor_to_multiple (min_ft, pr.params.al_line_every); ft <= max_ft; ft += pr.params.al_line_every)
+	{
+		if (ft > 100000.f)
+			continue;
+
+		float const posy = -px_per_ft * (ft - _scale_tape_anchor);
+
+		painter.setPen (ft % pr.params.al_bold_every == 0 ? _scale_pen_2 : _scale_pen_1);
+		painter.paint (pr.default_shadow, [&] {
+			painter.drawLine (QPointF (0.f, posy), QPointF (0.8f * x, posy));
+		});
+
+		if (ft % pr.params.al_number_every == 0)
+		{
+			QRectF big_text_box (1.1f * x, -0.5f * b_ladder_digit_height + posy,
+								 2.f * b_ladder_digit_width, b_ladder_digit_height);
+			if (std::abs (ft) / 1000 > 0)
 			{
-				QRectF big_text_box (1.1f * x, -0.5f * b_ladder_digit_height + posy,
-									 2.f * b_ladder_digit_width, b_ladder_digit_height);
-				if (std::abs (ft) / 1000 > 0)
-				{
-					QString big_text = QString::number (ft / 1000);
-					pr.painter.setFont (b_ladder_font);
-					pr.painter.fast_draw_text (big_text_box, Qt::AlignVCenter | Qt::AlignRight, big_text, pr.default_shadow);
-				}
+				QString big_text = QString::number (ft / 1000);
+				painter.setFont (b_ladder_font);
+				painter.fast_draw_text (big_text_box, Qt::AlignVCenter | Qt::AlignRight, big_text, pr.default_shadow);
+			}
 
-				QString small_text = QString ("%1").arg (QString::number (std::abs (ft % 1000)), 3, '0');
-				if (ft == 0)
-					small_text = "0";
-				pr.painter.setFont (s_ladder_font);
-				QRectF small_text_box (1.1f * x + 2.1f * b_ladder_digit_width, -0.5f * s_ladder_digit_height + posy,
-									   3.f * s_ladder_digit_width, s_ladder_digit_height);
-				pr.painter.fast_draw_text (small_text_box, Qt::AlignVCenter | Qt::AlignRight, small_text, pr.default_shadow);
-				// Minus sign?
-				if (ft < 0)
-				{
-					if (ft > -1000)
-						pr.painter.fast_draw_text (small_text_box.adjusted (-s_ladder_digit_width, 0.f, 0.f, 0.f),
-												   Qt::AlignVCenter | Qt::AlignLeft, pr.aids.kMinusSignStrUTF8, pr.default_shadow);
-				}
+			QString small_text = QString ("%1").arg (QString::number (std::abs (ft % 1000)), 3, '0');
+			if (ft == 0)
+				small_text = "0";
+			painter.setFont (s_ladder_font);
+			QRectF small_text_box (1.1f * x + 2.1f * b_ladder_digit_width, -0.5f * s_ladder_digit_height + posy,
+								   3.f * s_ladder_digit_width, s_ladder_digit_height);
+			painter.fast_draw_text (small_text_box, Qt::AlignVCenter | Qt::AlignRight, small_text, pr.default_shadow);
+			// Minus sign?
+			if (ft < 0)
+			{
+				if (ft > -1000)
+					painter.fast_draw_text (small_text_box.adjusted (-s_ladder_digit_width, 0.f, 0.f, 0.f),
+											Qt::AlignVCenter | Qt::AlignLeft, pr.aids.kMinusSignStrUTF8, pr.default_shadow);
+			}
 
-				// Additional lines above/below every 1000 ft:
-				if (ft % pr.params.al_emphasis_every == 0)
-				{
-					pr.painter.setPen (pr.aids.get_pen (Qt::white, 1.0));
-					float r, y;
-					r = big_text_box.left() + 4.0 * x;
-					y = posy - 0.75f * big_text_box.height();
-					pr.painter.paint (pr.default_shadow, [&] {
-						pr.painter.drawLine (QPointF (big_text_box.left(), y), QPointF (r, y));
-					});
-					y = posy + 0.75f * big_text_box.height();
-					pr.painter.paint (pr.default_shadow, [&] {
-						pr.painter.drawLine (QPointF (big_text_box.left(), y), QPointF (r, y));
-					});
-				}
+			// Additional lines above/below every 1000 ft:
+			if (ft % pr.params.al_emphasis_every == 0)
+			{
+				painter.setPen (pr.aids.get_pen (Qt::white, 1.0));
+				float r, y;
+				r = big_text_box.left() + 4.0 * x;
+				y = posy - 0.75f * big_text_box.height();
+				painter.paint (pr.default_shadow, [&] {
+					painter.drawLine (QPointF (big_text_box.left(), y), QPointF (r, y));
+				});
+				y = posy + 0.75f * big_text_box.height();
+				painter.paint (pr.default_shadow, [&] {
+					painter.drawLine (QPointF (big_text_box.left(), y), QPointF (r, y));
+				});
 			}
 		}
 	}
@@ -1800,11 +1992,11 @@ AltitudeLadder::paint_bugs (AdiPaintRequest& pr, float const x) const
 		pr.painter.setTransform (_transform);
 		pr.painter.setFont (altitude_bug_font);
 
-		for (auto& bug: pr.params.altitude_bugs)
+		for (auto const& bug: pr.params.altitude_bugs)
 		{
-			if (bug.second > _min_shown && bug.second < _max_shown)
+			if (bug.value > _min_shown && bug.value < _max_shown)
 			{
-				float posy = ft_to_px (pr, bug.second);
+				float posy = ft_to_px (pr, bug.value);
 				QRectF text_rect (-4.5f * x, posy - 0.5f * altitude_bug_digit_height,
 								  +2.f * x, altitude_bug_digit_height);
 				pr.painter.setClipRect (_ladder_rect.adjusted (-x, 0.f, 0.f, 0.f));
@@ -1815,7 +2007,7 @@ AltitudeLadder::paint_bugs (AdiPaintRequest& pr, float const x) const
 				});
 
 				pr.painter.setClipping (false);
-				pr.painter.fast_draw_text (text_rect, Qt::AlignVCenter | Qt::AlignRight, bug.first, pr.default_shadow);
+				pr.painter.fast_draw_text (text_rect, Qt::AlignVCenter | Qt::AlignRight, bug.label, pr.default_shadow);
 			}
 		}
 
@@ -2306,64 +2498,123 @@ PaintingWork::PaintingWork (xf::Graphics const& graphics):
 void
 PaintingWork::paint (xf::PaintRequest const& paint_request, Parameters const& params) const
 {
-	AdiPaintRequest pr (paint_request, _instrument_support, _parameters, _precomputed, _speed_warning_blinker, _decision_height_warning_blinker);
+	precompute (paint_request, params);
 
-	precompute (pr, params);
+	AdiPaintRequest pr (paint_request, _instrument_support, params, _precomputed, _speed_warning_blinker, _decision_height_warning_blinker);
 
-	if (_parameters.input_alert_visible)
-		paint_input_alert (pr);
-	else
-	{
-		_artificial_horizon.paint (pr);
+	for (auto const& layer: kLayers)
+		paint_layer (layer.first, pr);
+}
 
-		paint_nav (pr);
-		paint_center_cross (pr, false, true);
-		paint_flight_director (pr);
-		paint_control_surfaces (pr);
-		paint_center_cross (pr, true, false);
 
-		if (pr.params.altitude_agl_failure)
-			paint_radar_altimeter_failure (pr);
-		else
-			paint_altitude_agl (pr);
+void
+PaintingWork::precompute (xf::PaintRequest const& paint_request, Parameters const& params) const
+{
+	(*_mutable_this.lock())->precompute (paint_request, params);
+}
 
-		paint_decision_height_setting (pr);
-		paint_hints (pr);
-		paint_critical_aoa (pr);
 
-		_velocity_ladder.paint (pr);
-		_altitude_ladder.paint (pr);
+void
+PaintingWork::paint_layer (Layer const layer, xf::PaintRequest const& paint_request, Parameters const& params) const
+{
+	// Artificial horizon is opaque, so shadows there must be painted per primitive:
+	auto* const raster_image = params.raster_shadows && layer != Layer::ArtificialHorizon
+		? dynamic_cast<QImage*> (&paint_request.canvas())
+		: nullptr;
+	xf::Shadow shadow;
+
+	{
+		AdiPaintRequest pr (paint_request, _instrument_support, params, _precomputed, _speed_warning_blinker, _decision_height_warning_blinker);
+
+		if (raster_image)
+			pr.painter.set_deferred_shadow (pr.default_shadow);
+
+		paint_layer (layer, pr);
+		shadow = pr.default_shadow;
 	}
+
+	// Painter is gone now, image can be modified:
+	if (raster_image)
+		xf::RasterShadow::apply (*raster_image, shadow);
 }
 
 
 void
-PaintingWork::precompute (AdiPaintRequest& pr, Parameters const& params) const
+PaintingWork::invalidate_cached_layers() noexcept
 {
-	(*_mutable_this.lock())->precompute (pr, params);
+	_artificial_horizon.invalidate_cached_layers();
+	_velocity_ladder.invalidate_cached_layers();
+	_altitude_ladder.invalidate_cached_layers();
 }
 
 
 void
-PaintingWork::precompute (AdiPaintRequest& pr, Parameters const& params)
+PaintingWork::precompute (xf::PaintRequest const& paint_request, Parameters const& params)
 {
-	_parameters = params;
-	_parameters.sanitize();
-
-	if (pr.paint_request.size_changed())
+	if (paint_request.size_changed())
 	{
+		auto const aids = _instrument_support.get_aids (paint_request);
 		_precomputed.center_transform.reset();
-		_precomputed.center_transform.translate (0.5f * pr.aids.width(), 0.5f * pr.aids.height());
+		_precomputed.center_transform.translate (0.5f * aids->width(), 0.5f * aids->height());
+	}
+
+	_speed_warning_blinker.update_current_time (params.timestamp);
+	_speed_warning_blinker.update (params.speed_warning());
+	_decision_height_warning_blinker.update_current_time (params.timestamp);
+	_decision_height_warning_blinker.update (params.decision_height_warning());
+}
+
+
+void
+PaintingWork::paint_layer (Layer const layer, AdiPaintRequest& pr) const
+{
+	// Input alert replaces the whole instrument:
+	if (pr.params.input_alert_visible)
+	{
+		if (layer == Layer::ArtificialHorizon)
+			paint_input_alert (pr);
+
+		return;
+	}
+
+	switch (layer)
+	{
+		case Layer::ArtificialHorizon:
+			_artificial_horizon.paint (pr);
+			break;
+
+		case Layer::Overlays:
+			paint_overlays (pr);
+			break;
+
+		case Layer::VelocityLadder:
+			_velocity_ladder.paint (pr);
+			break;
+
+		case Layer::AltitudeLadder:
+			_altitude_ladder.paint (pr);
+			break;
 	}
+}
+
+
+void
+PaintingWork::paint_overlays (AdiPaintRequest& pr) const
+{
+	paint_nav (pr);
+	paint_center_cross (pr, false, true);
+	paint_flight_director (pr);
+	paint_control_surfaces (pr);
+	paint_center_cross (pr, true, false);
 
-	_speed_warning_blinker.update_current_time (_parameters.timestamp);
-	_speed_warning_blinker.update (_parameters.speed &&
-								   ((_parameters.speed_minimum && *_parameters.speed < *_parameters.speed_minimum) ||
-									(_parameters.speed_maximum && *_parameters.speed > *_parameters.speed_maximum)));
-	_decision_height_warning_blinker.update_current_time (_parameters.timestamp);
-	_decision_height_warning_blinker.update (_parameters.altitude_amsl && _parameters.decision_height_amsl &&
-											 *_parameters.altitude_amsl < *_parameters.decision_height_amsl &&
-											 _parameters.decision_height_focus_short);
+	if (pr.params.altitude_agl_failure)
+		paint_radar_altimeter_failure (pr);
+	else
+		paint_altitude_agl (pr);
+
+	paint_decision_height_setting (pr);
+	paint_hints (pr);
+	paint_critical_aoa (pr);
 }
 
 
@@ -2473,7 +2724,7 @@ PaintingWork::paint_flight_director (AdiPaintRequest& pr) const
 		pr.painter.setFont (pr.aids.font_2.font);
 		pr.painter.fast_draw_text (QPointF (2.95 * pr.q, 4.385 * pr.q),
 								   Qt::AlignRight | Qt::AlignBottom,
-								   QString::fromStdString (*pr.params.flight_director_active_name),
+								   *pr.params.flight_director_active_name,
 								   pr.default_shadow);
 	}
 }
@@ -3015,7 +3266,8 @@ PaintingWork::paint_input_alert (AdiPaintRequest& pr) const
 
 	pr.painter.setClipping (false);
 
-	pr.painter.setTransform (pr.precomputed.center_transform);
+	// Canvas isn't cleared between frames, so the background must cover all of it:
+	pr.painter.resetTransform();
 	pr.painter.setPen (Qt::NoPen);
 	pr.painter.setBrush (Qt::black);
 	pr.painter.drawRect (QRect (QPoint (0, 0), pr.paint_request.metric().canvas_size()));
@@ -3046,10 +3298,28 @@ PaintingWork::paint_radar_altimeter_failure (AdiPaintRequest& pr) const
 } // namespace adi_detail
 
 
+static QString const kV1Label	= QStringLiteral ("V1");
+static QString const kVRLabel	= QStringLiteral ("VR");
+static QString const kVRefLabel	= QStringLiteral ("REF");
+
+
+/**
+ * Return socket's string without copying it, or empty string if socket is nil.
+ */
+static std::string_view
+string_or_empty (xf::Socket<std::string> const& socket)
+{
+	return socket ? std::string_view (*socket) : std::string_view();
+}
+
+
 ADI::ADI (xf::Graphics const& graphics, std::string_view const& instance):
 	ADI_IO (instance),
 	_painting_work (graphics)
 {
+	// Either the artificial horizon or the input alert background covers whole canvas:
+	set_canvas_clearing (CanvasClearing::None);
+
 	_fpv_computer.set_callback (std::bind (&ADI::compute_fpv, this));
 	_fpv_computer.observe ({
 		&_io.orientation_heading_magnetic,
@@ -3070,8 +3340,9 @@ ADI::process (xf::Cycle const& cycle)
 {
 	_fpv_computer.process (cycle.update_time());
 
-	adi_detail::Parameters params;
-	params.timestamp = cycle.update_time();
+	// Rebuild parameters in place; timestamp is set only when publishing, so that
+	// the comparison with the published parameters below ignores it:
+	auto& params = _next_parameters;
 	params.fov = *_io.field_of_view;
 	params.show_vertical_speed_ladder = *_io.show_vertical_speed_ladder;
 	params.focus_duration = *_io.focus_duration;
@@ -3109,50 +3380,26 @@ ADI::process (xf::Cycle const& cycle)
 			: std::nullopt;
 	params.speed_ground = _io.speed_ground.get_optional();
 
-	// V1
+	// Speed bugs:
+	params.speed_bugs.clear();
+
 	if (_io.speed_v1)
-		params.speed_bugs["V1"] = *_io.speed_v1;
-	else
-		params.speed_bugs.erase ("V1");
+		params.speed_bugs.set (kV1Label, *_io.speed_v1);
 
-	// Vr
 	if (_io.speed_vr)
-		params.speed_bugs["VR"] = *_io.speed_vr;
-	else
-		params.speed_bugs.erase ("VR");
+		params.speed_bugs.set (kVRLabel, *_io.speed_vr);
 
-	// Vref
 	if (_io.speed_vref)
-		params.speed_bugs["REF"] = *_io.speed_vref;
-	else
-		params.speed_bugs.erase ("REF");
+		params.speed_bugs.set (kVRefLabel, *_io.speed_vref);
 
-	// Flaps UP bug:
 	if (_io.speed_flaps_up_speed && _io.speed_flaps_up_label)
-	{
-		_speed_flaps_up_current_label = QString::fromStdString (*_io.speed_flaps_up_label);
-		params.speed_bugs[_speed_flaps_up_current_label] = *_io.speed_flaps_up_speed;
-	}
-	else
-		params.speed_bugs.erase (_speed_flaps_up_current_label);
+		params.speed_bugs.set (_labels.speed_flaps_up (*_io.speed_flaps_up_label), *_io.speed_flaps_up_speed);
 
-	// Flaps "a" bug:
 	if (_io.speed_flaps_a_speed && _io.speed_flaps_a_label)
-	{
-		_speed_flaps_a_current_label = QString::fromStdString (*_io.speed_flaps_a_label);
-		params.speed_bugs[_speed_flaps_a_current_label] = *_io.speed_flaps_a_speed;
-	}
-	else
-		params.speed_bugs.erase (_speed_flaps_a_current_label);
+		params.speed_bugs.set (_labels.speed_flaps_a (*_io.speed_flaps_a_label), *_io.speed_flaps_a_speed);
 
-	// Flaps "b" bug:
 	if (_io.speed_flaps_b_speed && _io.speed_flaps_b_label)
-	{
-		_speed_flaps_b_current_label = QString::fromStdString (*_io.speed_flaps_b_label);
-		params.speed_bugs[_speed_flaps_b_current_label] = *_io.speed_flaps_b_speed;
-	}
-	else
-		params.speed_bugs.erase (_speed_flaps_b_current_label);
+		params.speed_bugs.set (_labels.speed_flaps_b (*_io.speed_flaps_b_label), *_io.speed_flaps_b_speed);
 
 	// Orientation
 	params.orientation_failure = !is_sane (_io.orientation_pitch) || !is_sane (_io.orientation_roll);
@@ -3201,7 +3448,7 @@ ADI::process (xf::Cycle const& cycle)
 	params.altitude_landing_warning_hi = *_io.altitude_landing_warning_hi;
 	params.altitude_landing_warning_lo = *_io.altitude_landing_warning_lo;
 	// Decision height
-	params.decision_height_type = QString::fromStdString (_io.decision_height_type.value_or (""));
+	params.decision_height_type = _labels.decision_height_type (string_or_empty (_io.decision_height_type));
 	params.decision_height_amsl =
 		_io.decision_height_setting
 			? _io.decision_height_amsl.get_optional()
@@ -3252,7 +3499,11 @@ ADI::process (xf::Cycle const& cycle)
 	// Flight director
 	bool guidance_visible = _io.flight_director_guidance_visible.value_or (false);
 	params.flight_director_guidance_visible = guidance_visible;
-	params.flight_director_active_name = _io.flight_director_active_name.get_optional();
+	if (_io.flight_director_active_name)
+		params.flight_director_active_name = _labels.flight_director_active_name (*_io.flight_director_active_name);
+	else
+		params.flight_director_active_name.reset();
+
 	params.flight_director_failure =
 		guidance_visible &&
 		(!_io.flight_director_serviceable.value_or (true) ||
@@ -3276,8 +3527,8 @@ ADI::process (xf::Cycle const& cycle)
 	params.navaid_reference_visible = _io.navaid_reference_visible.value_or (false);
 	params.navaid_course_magnetic = _io.navaid_course_magnetic.get_optional();
 	params.navaid_distance = _io.navaid_distance.get_optional();
-	params.navaid_hint = QString::fromStdString (_io.navaid_type_hint.value_or (""));
-	params.navaid_identifier = QString::fromStdString (_io.navaid_identifier.value_or (""));
+	params.navaid_hint = _labels.navaid_hint (string_or_empty (_io.navaid_type_hint));
+	params.navaid_identifier = _labels.navaid_identifier (string_or_empty (_io.navaid_identifier));
 	// Approach, flight path deviations
 	params.deviation_vertical_failure =
 		!_io.flight_path_deviation_vertical_serviceable.value_or (true) ||
@@ -3311,24 +3562,24 @@ ADI::process (xf::Cycle const& cycle)
 		params.raising_runway_position.reset();
 	// Control hint
 	if (_io.flight_mode_hint_visible.value_or (false))
-		params.control_hint = QString::fromStdString (_io.flight_mode_hint.value_or (""));
+		params.control_hint = _labels.control_hint (string_or_empty (_io.flight_mode_hint));
 	else
 		params.control_hint.reset();
 
 	params.control_hint_focus = _io.flight_mode_hint_visible.modification_age() < *_io.focus_duration || _io.flight_mode_hint.modification_age() < *_io.focus_duration;
 	// FMA
 	params.fma_visible = _io.flight_mode_fma_visible.value_or (false);
-	params.fma_speed_hint = QString::fromStdString (_io.flight_mode_fma_speed_hint.value_or (""));
+	params.fma_speed_hint = _labels.fma_speed_hint (string_or_empty (_io.flight_mode_fma_speed_hint));
 	params.fma_speed_focus = _io.flight_mode_fma_speed_hint.modification_age() < *_io.focus_duration;
-	params.fma_speed_armed_hint = QString::fromStdString (_io.flight_mode_fma_speed_armed_hint.value_or (""));
+	params.fma_speed_armed_hint = _labels.fma_speed_armed_hint (string_or_empty (_io.flight_mode_fma_speed_armed_hint));
 	params.fma_speed_armed_focus = _io.flight_mode_fma_speed_armed_hint.modification_age() < *_io.focus_duration;
-	params.fma_lateral_hint = QString::fromStdString (_io.flight_mode_fma_lateral_hint.value_or (""));
+	params.fma_lateral_hint = _labels.fma_lateral_hint (string_or_empty (_io.flight_mode_fma_lateral_hint));
 	params.fma_lateral_focus = _io.flight_mode_fma_lateral_hint.modification_age() < *_io.focus_duration;
-	params.fma_lateral_armed_hint = QString::fromStdString (_io.flight_mode_fma_lateral_armed_hint.value_or (""));
+	params.fma_lateral_armed_hint = _labels.fma_lateral_armed_hint (string_or_empty (_io.flight_mode_fma_lateral_armed_hint));
 	params.fma_lateral_armed_focus = _io.flight_mode_fma_lateral_armed_hint.modification_age() < *_io.focus_duration;
-	params.fma_vertical_hint = QString::fromStdString (_io.flight_mode_fma_vertical_hint.value_or (""));
+	params.fma_vertical_hint = _labels.fma_vertical_hint (string_or_empty (_io.flight_mode_fma_vertical_hint));
 	params.fma_vertical_focus = _io.flight_mode_fma_vertical_hint.modification_age() < *_io.focus_duration;
-	params.fma_vertical_armed_hint = QString::fromStdString (_io.flight_mode_fma_vertical_armed_hint.value_or (""));
+	params.fma_vertical_armed_hint = _labels.fma_vertical_armed_hint (string_or_empty (_io.flight_mode_fma_vertical_armed_hint));
 	params.fma_vertical_armed_focus = _io.flight_mode_fma_vertical_armed_hint.modification_age() < *_io.focus_duration;
 	// TCAS
 	params.tcas_ra_pitch_minimum = _io.tcas_resolution_advisory_pitch_minimum.get_optional();
@@ -3363,21 +3614,52 @@ ADI::process (xf::Cycle const& cycle)
 	params.al_bold_every = *_io.altitude_ladder_bold_every;
 	params.al_line_every = *_io.altitude_ladder_line_every;
 	params.al_number_every = *_io.altitude_ladder_number_every;
+	params.raster_shadows = *_io.raster_shadows;
+
+	params.sanitize();
 
-	*_parameters.lock() = params;
-	mark_dirty();
+	// Don't bother painters if nothing changed. Blinking elements need repainting anyway.
+	// If publishing fails (all slots held by painters), published parameters stay different
+	// from params and publishing is retried on the next cycle:
+	if (params.blinking() || !(params == *_parameters.read()))
+	{
+		params.timestamp = cycle.update_time();
+
+		if (_parameters.publish (params))
+			mark_dirty();
+	}
 }
 
 
 std::packaged_task<void()>
 ADI::paint (xf::PaintRequest paint_request) const
 {
-	return std::packaged_task<void()> ([this, pr = std::move (paint_request), pp = *_parameters.lock()] {
-		_painting_work.paint (pr, pp);
+	return std::packaged_task<void()> ([this, pr = std::move (paint_request), snapshot = _parameters.read()] {
+		_painting_work.paint (pr, *snapshot);
 	});
 }
 
 
+std::vector<xf::Instrument::PaintLayer>
+ADI::paint_layers (xf::PaintRequest const& paint_request) const
+{
+	// All layers must see the same parameters:
+	auto const snapshot = std::make_shared<decltype (_parameters)::Snapshot> (_parameters.read());
+	_painting_work.precompute (paint_request, **snapshot);
+
+	std::vector<PaintLayer> layers;
+
+	for (auto const& [layer, name]: adi_detail::PaintingWork::kLayers)
+	{
+		layers.push_back ({ name, [this, layer, snapshot] (xf::PaintRequest const& layer_paint_request) {
+			_painting_work.paint_layer (layer, layer_paint_request, **snapshot);
+		} });
+	}
+
+	return layers;
+}
+
+
 void
 ADI::compute_fpv()
 {
@@ -19,7 +19,10 @@
 #include <xefis/core/graphics.h>
 #include <xefis/core/instrument.h>
 #include <xefis/core/setting.h>
+#include <xefis/core/snapshot_channel.h>
 #include <xefis/core/sockets/socket.h>
+#include <xefis/support/instrument/cached_layer.h>
+#include <xefis/support/instrument/digit_strip.h>
 #include <xefis/support/instrument/instrument_support.h>
 #include <xefis/support/sockets/socket_observer.h>
 #include <xefis/utility/event_timestamper.h>
@@ -32,8 +35,15 @@
 #include <QtGui/QPainterPath>
 
 // Standard:
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 
 namespace si = neutrino::si;
@@ -42,19 +52,118 @@ using namespace neutrino::si::literals;
 
 namespace adi_detail {
 
+/**
+ * Fixed-capacity list of labelled bugs (like V1 or VR) stored inline, so that it can be refilled
+ * on every cycle without touching the heap. Bugs are kept in insertion order.
+ * Bugs set over the capacity are ignored.
+ */
+template<class pValue, std::size_t pCapacity>
+	class InlineBugs
+	{
+	  public:
+		using Value = pValue;
+
+		static constexpr std::size_t kCapacity = pCapacity;
+
+		class Bug
+		{
+		  public:
+			QString	label;
+			Value	value;
+
+		  public:
+			[[nodiscard]]
+			bool
+			operator== (Bug const&) const = default;
+		};
+
+	  public:
+		/**
+		 * Set value of the bug with given label, add the bug if needed.
+		 */
+		void
+		set (QString const& label, Value value);
+
+		/**
+		 * Remove all bugs.
+		 */
+		void
+		clear() noexcept
+			{ _size = 0; }
+
+		[[nodiscard]]
+		std::size_t
+		size() const noexcept
+			{ return _size; }
+
+		[[nodiscard]]
+		Bug const*
+		begin() const noexcept
+			{ return _bugs.data(); }
+
+		[[nodiscard]]
+		Bug const*
+		end() const noexcept
+			{ return _bugs.data() + _size; }
+
+		[[nodiscard]]
+		bool
+		operator== (InlineBugs const& other) const
+			{ return std::equal (begin(), end(), other.begin(), other.end()); }
+
+	  private:
+		std::array<Bug, kCapacity>	_bugs;
+		std::size_t					_size	{ 0 };
+	};
+
+
+template<class V, std::size_t C>
+	inline void
+	InlineBugs<V, C>::set (QString const& label, Value const value)
+	{
+		auto const end = _bugs.begin() + _size;
+
+		if (auto bug = std::find_if (_bugs.begin(), end, [&] (Bug const& b) { return b.label == label; }); bug != end)
+			bug->value = value;
+		else if (_size < kCapacity)
+			_bugs[_size++] = { label, value };
+	}
+
+
+/**
+ * Converts std::string into QString only when the string changes.
+ * Unchanged labels reuse the same QString data, so they neither allocate nor
+ * make Parameters compare unequal.
+ */
+class LabelCache
+{
+  public:
+	[[nodiscard]]
+	QString const&
+	operator() (std::string_view);
+
+  private:
+	std::string	_source;
+	QString		_label;
+};
+
+
 // TODO For booleans use bitfields (:1) when C++ supports bitfields and in-class initialization (to save cache memory).
 // TODO Handle nans
+/**
+ * All data needed to paint the ADI. Doesn't use heap memory on its own (QStrings are shared with LabelCaches),
+ * so it can be rebuilt and published on every cycle without allocations.
+ */
 class Parameters
 {
   private:
-	// TODO change to vector<> for speed
-	using VelocityBugs	= std::map<QString, si::Velocity>;
-	using AltitudeBugs	= std::map<QString, si::Length>;
+	using VelocityBugs	= InlineBugs<si::Velocity, 8>;
+	using AltitudeBugs	= InlineBugs<si::Length, 8>;
 
   public:
-	si::Time					timestamp;
-	si::Time					focus_duration;
-	si::Time					focus_short_duration;
+	si::Time					timestamp							= 0_s;
+	si::Time					focus_duration						= 0_s;
+	si::Time					focus_short_duration				= 0_s;
 	bool						old_style							= false;
 	bool						show_metric							= false;
 	si::Angle					fov									= 120_deg;
@@ -119,7 +228,7 @@ class Parameters
 	bool						pressure_display_hpa				= false;
 	bool						use_standard_pressure				= false;
 	// Command settings:
-	std::optional<std::string>	flight_director_active_name;
+	std::optional<QString>		flight_director_active_name;
 	std::optional<si::Velocity>	cmd_speed;
 	std::optional<double>		cmd_mach;
 	std::optional<si::Length>	cmd_altitude;
@@ -199,6 +308,8 @@ class Parameters
 	int							al_bold_every						= 500;
 	int							al_number_every						= 200;
 	int							al_line_every						= 100;
+	// Style:
+	bool						raster_shadows						= false;
 
   public:
 	/**
@@ -206,6 +317,55 @@ class Parameters
 	 */
 	void
 	sanitize();
+
+	/**
+	 * True if speed is outside of the minimum/maximum range (speed warning blinks).
+	 */
+	[[nodiscard]]
+	bool
+	speed_warning() const noexcept;
+
+	/**
+	 * True if aircraft is below decision height (decision height warning blinks).
+	 */
+	[[nodiscard]]
+	bool
+	decision_height_warning() const noexcept;
+
+	/**
+	 * True if something blinks, so that the instrument needs repainting even if parameters don't change.
+	 */
+	[[nodiscard]]
+	bool
+	blinking() const noexcept
+		{ return speed_warning() || decision_height_warning(); }
+
+	[[nodiscard]]
+	bool
+	operator== (Parameters const&) const = default;
+};
+
+
+/**
+ * Label caches for all string inputs of the ADI.
+ */
+class ParameterLabels
+{
+  public:
+	LabelCache	speed_flaps_up;
+	LabelCache	speed_flaps_a;
+	LabelCache	speed_flaps_b;
+	LabelCache	decision_height_type;
+	LabelCache	flight_director_active_name;
+	LabelCache	navaid_hint;
+	LabelCache	navaid_identifier;
+	LabelCache	control_hint;
+	LabelCache	fma_speed_hint;
+	LabelCache	fma_speed_armed_hint;
+	LabelCache	fma_lateral_hint;
+	LabelCache	fma_lateral_armed_hint;
+	LabelCache	fma_vertical_hint;
+	LabelCache	fma_vertical_armed_hint;
 };
 
 
@@ -220,6 +380,18 @@ class Precomputed
 };
 
 
+/**
+ * Key for cached layers that depend only on canvas metric and the field of view.
+ */
+using ViewLayerKey = std::tuple<xf::PaintRequest::Metric, si::Angle>;
+
+/**
+ * Key for cached ladder scale tapes: canvas metric, ladder extent, ladder settings and index of the tape window.
+ */
+template<class Value>
+	using LadderTapeKey = std::tuple<xf::PaintRequest::Metric, Value, std::array<int, 4>, int64_t>;
+
+
 class Blinker
 {
   public:
@@ -273,10 +445,14 @@ class AdiPaintRequest
 
   public:
 	static inline QColor const				kLadderColor		{ 64, 51, 108, 0x80 };
+	// Indices of extra symbols on drum strips:
+	static constexpr int					kDrumGreenZone		= 0;
+	static constexpr int					kDrumMinus			= 1;
 	static inline QColor const				kLadderBorderColor	{ kLadderColor.darker (120) };
 
   public:
 	xf::PaintRequest const&					paint_request;
+	xf::InstrumentSupport const&			instrument_support;
 	Parameters const&						params;
 	Precomputed const&						precomputed;
 	xf::InstrumentPainter					painter;
@@ -296,34 +472,33 @@ class AdiPaintRequest
 	heading_to_px (si::Angle degrees) const;
 
 	/**
-	 * Render 'rotatable' value on speed/altitude black box.
+	 * Update digit strip for a rotating value on speed/altitude black box.
 	 *
-	 * \param	painter
-	 *			Painter to use.
-	 * \param	position
-	 *			Text position, [-0.5, 0.5].
-	 * \param	next, curr, prev
-	 *			Texts to render. Special value "G" paints green dashed zone, "R" paints red dashed zone.
+	 * \param	box
+	 *			Drum window; digits are aligned to its left edge.
+	 * \param	height_scale
+	 *			Drum pitch relative to font height.
+	 * \param	step, suffix
+	 *			See xf::DigitStrip::Key.
 	 */
 	void
-	paint_rotating_value (QRectF const& rect, float position, float height_scale,
-						  QString const& next, QString const& curr, QString const& prev);
+	update_drum_strip (xf::DigitStrip&, QFont const&, QRectF const& box, float height_scale, int step = 1, QString const& suffix = {});
 
 	/**
 	 * \param	two_zeros
 	 *			Two separate zeros, for positive and negative values.
 	 * \param	zero_mark
-	 *			Draw red/green/blank mark instead of zero.
+	 *			Draw green/minus/blank mark instead of zero.
 	 */
 	void
-	paint_rotating_digit (QRectF const& box, float value, int round_target, float const height_scale, float const delta, float const phase,
+	paint_rotating_digit (xf::DigitStrip const&, QRectF const& box, float value, int round_target, float const delta, float const phase,
 						  bool two_zeros, bool zero_mark, bool black_zero = false);
 
 	/**
-	 * Used by paint_rotating_value().
+	 * Used for zero marks on drum strips.
 	 */
 	void
-	paint_dashed_zone (QColor const&, QRectF const& target);
+	paint_dashed_zone (xf::InstrumentPainter&, QColor const&, QRectF const& target);
 
 	/**
 	 * Paint horizontal failure flag.
@@ -351,6 +526,17 @@ class ArtificialHorizon
 	void
 	paint (AdiPaintRequest&) const;
 
+	/**
+	 * Force repainting of cached layers on next precompute.
+	 */
+	void
+	invalidate_cached_layers() noexcept
+	{
+		_pitch_scale_layer.invalidate();
+		_heading_layer.invalidate();
+		_roll_scale_layer.invalidate();
+	}
+
   private:
 	void
 	precompute (AdiPaintRequest&) const;
@@ -367,15 +553,33 @@ class ArtificialHorizon
 	void
 	paint_pitch_scale (AdiPaintRequest&) const;
 
+	/**
+	 * Paint pitch scale lines and numbers for the whole -90°…+90° range onto the cached layer.
+	 */
+	void
+	paint_pitch_scale_layer (AdiPaintRequest&, xf::InstrumentPainter&) const;
+
 	void
 	paint_heading (AdiPaintRequest&) const;
 
+	/**
+	 * Paint heading tape for headings 0°…360° (with margins) onto the cached layer.
+	 */
+	void
+	paint_heading_layer (AdiPaintRequest&, xf::InstrumentPainter&) const;
+
 	void
 	paint_tcas_ra (AdiPaintRequest&) const;
 
 	void
 	paint_roll_scale (AdiPaintRequest&) const;
 
+	/**
+	 * Paint static roll scale marks onto the cached layer.
+	 */
+	void
+	paint_roll_scale_layer (AdiPaintRequest&, xf::InstrumentPainter&) const;
+
 	void
 	paint_pitch_disagree (AdiPaintRequest&) const;
 
@@ -427,6 +631,12 @@ class ArtificialHorizon
 	QPointF			_flight_path_marker_position;
 	QPainterPath	_old_horizon_clip;
 	QPainterPath	_pitch_scale_clipping_path;
+	xf::CachedLayer<ViewLayerKey>
+					_pitch_scale_layer;
+	xf::CachedLayer<ViewLayerKey>
+					_heading_layer;
+	xf::CachedLayer<xf::PaintRequest::Metric>
+					_roll_scale_layer;
 };
 
 
@@ -436,6 +646,13 @@ class VelocityLadder
 	void
 	paint (AdiPaintRequest&) const;
 
+	/**
+	 * Force repainting of the cached scale tape on next precompute.
+	 */
+	void
+	invalidate_cached_layers() noexcept
+		{ _scale_tape.invalidate(); }
+
   private:
 	void
 	precompute (AdiPaintRequest&) const;
@@ -452,6 +669,13 @@ class VelocityLadder
 	void
 	paint_ladder_scale (AdiPaintRequest&, float x) const;
 
+	/**
+	 * Paint scale lines and numbers for speeds min_kt…max_kt onto the cached tape.
+	 * Position 0 on the tape corresponds to _scale_tape_anchor.
+	 */
+	void
+	paint_scale_tape (AdiPaintRequest&, xf::InstrumentPainter&, int min_kt, int max_kt) const;
+
 	void
 	paint_speed_limits (AdiPaintRequest&, float x) const;
 
@@ -492,6 +716,14 @@ class VelocityLadder
 	float			_margin;
 	int				_digits;
 	QPolygonF		_bug_shape;
+	int				_scale_tape_anchor	{ 0 };
+	xf::CachedLayer<LadderTapeKey<si::Velocity>>
+					_scale_tape;
+	// Drums for 1000s, 100s, 10s and 1s of the black box:
+	std::array<QRectF, 4>
+					_drum_boxes;
+	std::array<xf::DigitStrip, 4>
+					_drums;
 };
 
 
@@ -501,6 +733,13 @@ class AltitudeLadder
 	void
 	paint (AdiPaintRequest&) const;
 
+	/**
+	 * Force repainting of the cached scale tape on next precompute.
+	 */
+	void
+	invalidate_cached_layers() noexcept
+		{ _scale_tape.invalidate(); }
+
   private:
 	void
 	precompute (AdiPaintRequest&) const;
@@ -517,6 +756,13 @@ class AltitudeLadder
 	void
 	paint_ladder_scale (AdiPaintRequest&, float x) const;
 
+	/**
+	 * Paint scale lines and numbers for altitudes min_ft…max_ft onto the cached tape.
+	 * Position 0 on the tape corresponds to _scale_tape_anchor.
+	 */
+	void
+	paint_scale_tape (AdiPaintRequest&, xf::InstrumentPainter&, int min_ft, int max_ft) const;
+
 	void
 	paint_altitude_tendency (AdiPaintRequest&, float x) const;
 
@@ -575,25 +821,78 @@ class AltitudeLadder
 	QRectF				_s_digits_box;
 	float				_margin;
 	std::optional<bool>	_previous_show_metric;
+	int					_scale_tape_anchor	{ 0 };
+	xf::CachedLayer<LadderTapeKey<si::Length>>
+						_scale_tape;
+	// Drums for 10000s, 1000s, 100s and 10s+1s of the black box:
+	std::array<QRectF, 4>
+						_drum_boxes;
+	std::array<xf::DigitStrip, 4>
+						_drums;
 };
 
 
 class PaintingWork
 {
+  public:
+	/**
+	 * Independently paintable layers, bottom-most first.
+	 */
+	enum class Layer
+	{
+		ArtificialHorizon,
+		Overlays,
+		VelocityLadder,
+		AltitudeLadder,
+	};
+
+	static constexpr std::array<std::pair<Layer, char const*>, 4> kLayers {{
+		{ Layer::ArtificialHorizon,	"artificial horizon" },
+		{ Layer::Overlays,			"center/FD overlays" },
+		{ Layer::VelocityLadder,	"velocity ladder" },
+		{ Layer::AltitudeLadder,	"altitude ladder" },
+	}};
+
   public:
 	// Ctor
 	explicit
 	PaintingWork (xf::Graphics const&);
 
+	/**
+	 * Paint all layers.
+	 */
 	void
 	paint (xf::PaintRequest const&, Parameters const& parameters) const;
 
+	/**
+	 * Update state shared by all layers. Must be called once per frame before paint_layer()
+	 * is called for the layers (paint() calls it itself).
+	 */
+	void
+	precompute (xf::PaintRequest const&, Parameters const&) const;
+
+	/**
+	 * Paint single layer. Different layers can be painted concurrently.
+	 */
+	void
+	paint_layer (Layer, xf::PaintRequest const&, Parameters const&) const;
+
+	/**
+	 * Force repainting of all cached layers (scales, tapes) on next painting.
+	 * Must not be called concurrently with painting.
+	 */
+	void
+	invalidate_cached_layers() noexcept;
+
   private:
 	void
-	precompute (AdiPaintRequest&, Parameters const&) const;
+	precompute (xf::PaintRequest const&, Parameters const&);
+
+	void
+	paint_layer (Layer, AdiPaintRequest&) const;
 
 	void
-	precompute (AdiPaintRequest&, Parameters const&);
+	paint_overlays (AdiPaintRequest&) const;
 
 	void
 	paint_center_cross (AdiPaintRequest&, bool center_box, bool rest) const;
@@ -629,7 +928,6 @@ class PaintingWork
 	xf::Synchronized<PaintingWork*>	mutable
 							_mutable_this						{ this };
 
-	Parameters				_parameters;
 	Precomputed				_precomputed;
 	xf::InstrumentSupport	_instrument_support;
 
@@ -686,6 +984,8 @@ class ADI_IO: public xf::Instrument
 	xf::Setting<bool>			show_vertical_speed_ladder							{ this, "show_vertical_speed_ladder", true };
 	xf::Setting<si::Time>		focus_duration										{ this, "focus_duration", 10_s };
 	xf::Setting<si::Time>		focus_short_duration								{ this, "focus_short_duration", 5_s };
+	// Compute shadows from painted layers instead of painting each primitive twice. Used only when painting in layers:
+	xf::Setting<bool>			raster_shadows										{ this, "raster_shadows", false };
 
 	/*
 	 * Input
@@ -846,6 +1146,10 @@ class ADI: public ADI_IO
 	std::packaged_task<void()>
 	paint (xf::PaintRequest) const override;
 
+	// Instrument API
+	std::vector<PaintLayer>
+	paint_layers (xf::PaintRequest const&) const override;
+
   private:
 	void
 	compute_fpv();
@@ -868,7 +1172,7 @@ class ADI: public ADI_IO
 	ADI_IO&										_io { *this };
 	xf::SocketObserver							_fpv_computer;
 	adi_detail::PaintingWork					_painting_work;
-	xf::Synchronized<adi_detail::Parameters>	_parameters;
+	xf::SnapshotChannel<adi_detail::Parameters>	_parameters;
 	xf::EventTimestamper						_decision_height_became_visible;
 	xf::EventTimestamper						_altitude_agl_became_visible;
 	xf::EventTimestamper						_speed_failure_timestamp;
@@ -886,9 +1190,9 @@ class ADI: public ADI_IO
 	bool										_computed_fpv_visible	{ false };
 	std::optional<si::Angle>					_computed_fpv_alpha;
 	std::optional<si::Angle>					_computed_fpv_beta;
-	QString										_speed_flaps_up_current_label;
-	QString										_speed_flaps_a_current_label;
-	QString										_speed_flaps_b_current_label;
+	// Reused on every cycle, so that process() doesn't allocate:
+	adi_detail::Parameters						_next_parameters;
+	adi_detail::ParameterLabels					_labels;
 };
 
 #endif
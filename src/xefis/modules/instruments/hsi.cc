@@ -18,6 +18,7 @@
 #include <xefis/config/all.h>
 #include <xefis/support/earth/earth.h>
 #include <xefis/support/earth/navigation/wind_triangle.h>
+#include <xefis/support/instrument/raster_shadow.h>
 #include <xefis/support/instrument/text_layout.h>
 
 // Neutrino:
@@ -178,7 +179,12 @@ PaintingWork::PaintingWork (xf::PaintRequest const& paint_request, xf::Instrumen
 	_navaid_right_visible =
 		!_p.navaid_right_reference.isEmpty() || !_p.navaid_right_identifier.isEmpty() ||
 		_p.navaid_right_distance || _p.navaid_right_initial_bearing_magnetic;
+}
+
 
+void
+PaintingWork::update_caches()
+{
 	if (_p.display_mode != _mutable.prev_display_mode || _paint_request.size_changed())
 	{
 		auto const size = _paint_request.metric().canvas_size();
@@ -368,26 +374,70 @@ PaintingWork::PaintingWork (xf::PaintRequest const& paint_request, xf::Instrumen
 void
 PaintingWork::paint()
 {
-	paint_radio_range_map();
-	paint_navaids();
-	paint_flight_ranges();
-	paint_altitude_reach();
-	paint_track (false);
-	paint_directions();
-	paint_track (true);
-	paint_ap_settings();
-	paint_speeds_and_wind();
-	paint_home_direction();
-	paint_range();
-	paint_hints();
-	paint_trend_vector();
-	paint_tcas();
-	paint_course();
-	paint_selected_navaid_info();
-	paint_tcas_and_navaid_info();
-	paint_pointers();
-	paint_aircraft();
-	paint_navperf();
+	update_caches();
+
+	// All layers share one canvas here, so raster shadows can't be used (they'd also be applied
+	// to the layers painted before); paint per-primitive shadows instead:
+	for (auto const& layer: kLayers)
+		paint_layer_content (layer.first);
+}
+
+
+void
+PaintingWork::paint_layer (Layer const layer)
+{
+	// Radio range heat map covers large areas of the map layer, keep per-primitive shadows there:
+	auto* const raster_image = _p.raster_shadows && layer != Layer::Map
+		? dynamic_cast<QImage*> (&_paint_request.canvas())
+		: nullptr;
+
+	if (raster_image)
+		_painter.set_deferred_shadow (_c.black_shadow);
+
+	paint_layer_content (layer);
+
+	if (raster_image)
+	{
+		_painter.end();
+		xf::RasterShadow::apply (*raster_image, _c.black_shadow);
+	}
+}
+
+
+void
+PaintingWork::paint_layer_content (Layer const layer)
+{
+	switch (layer)
+	{
+		case Layer::Map:
+			paint_radio_range_map();
+			paint_navaids();
+			paint_flight_ranges();
+			paint_altitude_reach();
+			break;
+
+		case Layer::CompassRose:
+			paint_track (false);
+			paint_directions();
+			paint_track (true);
+			paint_ap_settings();
+			paint_home_direction();
+			paint_trend_vector();
+			paint_tcas();
+			paint_course();
+			paint_pointers();
+			paint_aircraft();
+			break;
+
+		case Layer::InfoBoxes:
+			paint_speeds_and_wind();
+			paint_range();
+			paint_hints();
+			paint_selected_navaid_info();
+			paint_tcas_and_navaid_info();
+			paint_navperf();
+			break;
+	}
 }
 
 
@@ -2190,6 +2240,7 @@ HSI::process (xf::Cycle const& cycle)
 	params.trend_vector_min_ranges = *_io.trend_vector_min_ranges;
 	params.trend_vector_max_range = *_io.trend_vector_max_range;
 	params.radio_range_pattern_scale = *_io.radio_range_pattern_scale;
+	params.raster_shadows = *_io.raster_shadows;
 	params.round_clip = false;
 
 	if (_io.flight_range_warning_longitude && _io.flight_range_warning_latitude && _io.flight_range_warning_radius)
@@ -2223,23 +2274,60 @@ HSI::process (xf::Cycle const& cycle)
 		params.radio_range_critical = _io.radio_range_critical.get_optional();
 	}
 
-	*_parameters.lock() = params;
-	mark_dirty();
+	params.sanitize();
+
+	// Parameters are published on every cycle, so if all slots are held by painters now,
+	// it'll be retried on the next one:
+	if (_parameters.publish (params))
+		mark_dirty();
 }
 
 
 std::packaged_task<void()>
 HSI::paint (xf::PaintRequest paint_request) const
 {
-	auto parameters = *_parameters.lock();
-	auto current_navaids = *_current_navaids.lock();
+	auto current_navaids_lock = _current_navaids.lock();
 	auto mutable_lock = _mutable.lock();
 	auto resize_cache_lock = _resize_cache.lock();
 
-	parameters.sanitize();
-
-	return std::packaged_task<void()> ([this, pr = std::move (paint_request), pp = parameters, rc_lock = std::move (resize_cache_lock), cn = current_navaids, mu_lock = std::move (mutable_lock)]() mutable {
-		hsi_detail::PaintingWork (pr, _instrument_support, _navaid_storage, pp, *rc_lock, cn, *mu_lock, _logger).paint();
+	return std::packaged_task<void()> ([this, pr = std::move (paint_request), snapshot = _parameters.read(), rc_lock = std::move (resize_cache_lock), cn_lock = std::move (current_navaids_lock), mu_lock = std::move (mutable_lock)]() mutable {
+		hsi_detail::PaintingWork (pr, _instrument_support, _navaid_storage, *snapshot, *rc_lock, *cn_lock, *mu_lock, _logger).paint();
 	});
 }
 
+
+std::vector<xf::Instrument::PaintLayer>
+HSI::paint_layers (xf::PaintRequest const& paint_request) const
+{
+	using Snapshot = decltype (_parameters)::Snapshot;
+	using CurrentNavaidsLock = decltype (_current_navaids.lock());
+	using MutableLock = decltype (_mutable.lock());
+	using ResizeCacheLock = decltype (_resize_cache.lock());
+
+	// Snapshot and locks are shared by all layers and released when the last one is done:
+	struct Shared
+	{
+		Snapshot			snapshot;
+		CurrentNavaidsLock	current_navaids;
+		MutableLock			mutable_;
+		ResizeCacheLock		resize_cache;
+	};
+
+	auto shared = std::make_shared<Shared> (Shared { _parameters.read(), _current_navaids.lock(), _mutable.lock(), _resize_cache.lock() });
+
+	// Update caches used by all layers before they're painted concurrently:
+	hsi_detail::PaintingWork (paint_request, _instrument_support, _navaid_storage, *shared->snapshot, *shared->resize_cache, *shared->current_navaids, *shared->mutable_, _logger).update_caches();
+
+	std::vector<PaintLayer> layers;
+
+	for (auto const& [layer, name]: hsi_detail::PaintingWork::kLayers)
+	{
+		layers.push_back ({ name, [this, layer, shared] (xf::PaintRequest const& layer_paint_request) {
+			// Only the map layer modifies current navaids, other layers only read the shared state:
+			hsi_detail::PaintingWork (layer_paint_request, _instrument_support, _navaid_storage, *shared->snapshot, *shared->resize_cache, *shared->current_navaids, *shared->mutable_, _logger).paint_layer (layer);
+		} });
+	}
+
+	return layers;
+}
+
@@ -19,6 +19,7 @@
 #include <xefis/core/graphics.h>
 #include <xefis/core/instrument.h>
 #include <xefis/core/setting.h>
+#include <xefis/core/snapshot_channel.h>
 #include <xefis/core/sockets/socket.h>
 #include <xefis/support/earth/navigation/navaid_storage.h>
 #include <xefis/support/instrument/instrument_support.h>
@@ -35,6 +36,9 @@
 #include <array>
 #include <cstddef>
 #include <future>
+#include <memory>
+#include <utility>
+#include <vector>
 
 
 namespace si = neutrino::si;
@@ -250,6 +254,7 @@ class Parameters
 	std::array<si::Length, 3>				trend_vector_min_ranges;
 	si::Length								trend_vector_max_range;
 	double									radio_range_pattern_scale;
+	bool									raster_shadows							{ false };
 	bool									round_clip								{ false };
 	std::optional<CircularArea>				flight_range_warning;
 	std::optional<CircularArea>				flight_range_critical;
@@ -327,15 +332,53 @@ struct Mutable
 
 class PaintingWork
 {
+  public:
+	/**
+	 * Independently paintable layers, bottom-most first.
+	 */
+	enum class Layer
+	{
+		Map,
+		CompassRose,
+		InfoBoxes,
+	};
+
+	static constexpr std::array<std::pair<Layer, char const*>, 3> kLayers {{
+		{ Layer::Map,			"map and navaids" },
+		{ Layer::CompassRose,	"compass rose" },
+		{ Layer::InfoBoxes,		"info boxes" },
+	}};
+
   public:
 	// Ctor
 	explicit
 	PaintingWork (xf::PaintRequest const&, xf::InstrumentSupport const&, xf::NavaidStorage const&, Parameters const&, ResizeCache&, CurrentNavaids&, Mutable&, xf::Logger const&);
 
+	/**
+	 * Update caches and paint all layers.
+	 */
 	void
 	paint();
 
+	/**
+	 * Update ResizeCache and Mutable state shared by all layers.
+	 * Must be called once per frame before layers are painted with paint_layer().
+	 */
+	void
+	update_caches();
+
+	/**
+	 * Paint single layer onto its own canvas. Different layers may be painted concurrently by separate
+	 * PaintingWork objects. With raster shadows enabled this ends the painter, so it must be the only
+	 * painting done by this PaintingWork.
+	 */
+	void
+	paint_layer (Layer);
+
   private:
+	void
+	paint_layer_content (Layer);
+
 	void
 	paint_aircraft();
 
@@ -496,6 +539,8 @@ class HSI_IO: public xf::Instrument
 	xf::Setting<si::Length>					trend_vector_max_range					{ this, "trend_vector_max_range", 30_nmi };
 	// How big should be dots on the radio range heat map? 1.0 means 1x1 hardware pixel. Value 2…3 is recommended.
 	xf::Setting<double>						radio_range_pattern_scale				{ this, "radio_range_pattern_scale", 2.5 };
+	// Compute shadows from painted layers instead of painting each primitive twice. Used only when painting in layers:
+	xf::Setting<bool>						raster_shadows							{ this, "raster_shadows", false };
 
 	/*
 	 * Input
@@ -593,12 +638,16 @@ class HSI: public HSI_IO
 	std::packaged_task<void()>
 	paint (xf::PaintRequest) const override;
 
+	// Instrument API
+	std::vector<PaintLayer>
+	paint_layers (xf::PaintRequest const&) const override;
+
   private:
 	HSI_IO&													_io { *this };
 	xf::Logger												_logger;
 	xf::NavaidStorage const&								_navaid_storage;
 	xf::InstrumentSupport									_instrument_support;
-	xf::Synchronized<hsi_detail::Parameters> mutable		_parameters;
+	xf::SnapshotChannel<hsi_detail::Parameters>			_parameters;
 	xf::Synchronized<hsi_detail::ResizeCache> mutable		_resize_cache;
 	xf::Synchronized<hsi_detail::CurrentNavaids> mutable	_current_navaids;
 	xf::Synchronized<hsi_detail::Mutable> mutable			_mutable;
@@ -18,6 +18,7 @@
 #include <xefis/config/all.h>
 
 // Qt:
+#include <QtGui/QFontMetricsF>
 #include <QtWidgets/QLayout>
 
 // Standard:
@@ -27,7 +28,10 @@
 Label::Label (xf::Graphics const& graphics, std::string_view const& instance):
 	LabelIO (instance),
 	InstrumentSupport (graphics)
-{ }
+{
+	// Label covers only a small part of its canvas, so don't clear the rest every frame:
+	set_canvas_clearing (CanvasClearing::PaintedRegion);
+}
 
 
 std::packaged_task<void()>
@@ -50,12 +54,35 @@ Label::async_paint (xf::PaintRequest const& paint_request, PaintingParams const&
 {
 	auto aids = get_aids (paint_request);
 	auto painter = get_painter (paint_request);
+	QRectF const canvas_rect = paint_request.metric().canvas_rect();
 
 	QFont font (aids->font_1);
 	font.setPixelSize (aids->font_pixel_size (pp.font_scale));
 
 	painter.setFont (font);
 	painter.setPen (pp.color);
-	painter.fast_draw_text (paint_request.metric().canvas_rect(), pp.alignment, pp.label);
+	painter.fast_draw_text (canvas_rect, pp.alignment, pp.label);
+
+	// Same text box as computed by fast_draw_text(), with margins for antialiasing and glyphs
+	// extending beyond font metrics:
+	QFontMetricsF const metrics (font);
+	QRectF text_box (0.0, 0.0, metrics.width (pp.label), metrics.height());
+
+	if (pp.alignment & Qt::AlignHCenter)
+		text_box.moveLeft (canvas_rect.center().x() - 0.5 * text_box.width());
+	else if (pp.alignment & Qt::AlignRight)
+		text_box.moveRight (canvas_rect.right());
+	else
+		text_box.moveLeft (canvas_rect.left());
+
+	if (pp.alignment & Qt::AlignVCenter)
+		text_box.moveTop (canvas_rect.center().y() - 0.5 * text_box.height());
+	else if (pp.alignment & Qt::AlignBottom)
+		text_box.moveBottom (canvas_rect.bottom());
+	else
+		text_box.moveTop (canvas_rect.top());
+
+	auto const margin = 0.25 * metrics.height();
+	paint_request.mark_painted (text_box.adjusted (-margin, -margin, +margin, +margin));
 }
 
@@ -22,6 +22,7 @@
 #include <xefis/core/graphics.h>
 #include <xefis/core/instrument.h>
 #include <xefis/core/setting.h>
+#include <xefis/core/snapshot_channel.h>
 #include <xefis/core/sockets/socket.h>
 #include <xefis/support/instrument/instrument_support.h>
 #include <xefis/support/sockets/socket_observer.h>
@@ -80,11 +81,11 @@ template<class Value>
 
 		struct GaugeValues: public Gauge<Value>::GaugeValues
 		{
-			bool					mirrored_style;
-			bool					line_hidden;
-			float					font_scale;
+			bool					mirrored_style	{ false };
+			bool					line_hidden		{ false };
+			float					font_scale		{ 1.0f };
 			std::string				note_str;
-			bool					inbound;
+			bool					inbound			{ false };
 		};
 
 	  public:
@@ -101,6 +102,19 @@ template<class Value>
 		paint (xf::PaintRequest) const override;
 
 	  private:
+		/**
+		 * Compute values for painting from sockets and settings.
+		 */
+		GaugeValues
+		compute_values() const;
+
+		/**
+		 * Publish computed values for painting. If publishing fails because all snapshot slots
+		 * are held by painters, it's retried on the next process().
+		 */
+		void
+		publish_values();
+
 		void
 		async_paint (xf::PaintRequest const&, GaugeValues const&) const;
 
@@ -114,6 +128,8 @@ template<class Value>
 		LinearGauge<Value>&									_io { *this };
 		xf::SocketObserver									_inputs_observer;
 		Converter											_converter;
+		xf::SnapshotChannel<GaugeValues>					_values;
+		bool												_publish_pending	{ false };
 		// Cached stuff:
 		xf::Synchronized<std::vector<PointInfo>> mutable	_point_infos;
 	};
@@ -127,11 +143,13 @@ template<class Value>
 		_converter (converter)
 	{
 		_inputs_observer.set_callback ([&]{
-			this->mark_dirty();
+			publish_values();
 		});
 		_inputs_observer.observe ({
 			&_io.value,
 		});
+		// Publish values on the first process() even if all inputs stay nil:
+		_inputs_observer.touch();
 	}
 
 
@@ -139,13 +157,17 @@ template<class Value>
 	inline void
 	LinearGauge<Value>::process (xf::Cycle const& cycle)
 	{
+		// Retry publishing that failed in previous cycle even if inputs haven't changed:
+		if (_publish_pending)
+			_inputs_observer.touch();
+
 		_inputs_observer.process (cycle.update_time());
 	}
 
 
 template<class Value>
-	inline std::packaged_task<void()>
-	LinearGauge<Value>::paint (xf::PaintRequest paint_request) const
+	inline auto
+	LinearGauge<Value>::compute_values() const -> GaugeValues
 	{
 		xf::Range const range { *_io.value_minimum, *_io.value_maximum };
 
@@ -159,8 +181,27 @@ template<class Value>
 		if (_io.value)
 			values.inbound = xf::Range { 0.0f, 1.0f }.includes (xf::renormalize (*_io.value, range, BasicGauge::kNormalizedRange));
 
-		return std::packaged_task<void()> ([this, pr = std::move (paint_request), gv = std::move (values)] {
-			async_paint (pr, gv);
+		return values;
+	}
+
+
+template<class Value>
+	inline void
+	LinearGauge<Value>::publish_values()
+	{
+		_publish_pending = !_values.publish (compute_values());
+
+		if (!_publish_pending)
+			this->mark_dirty();
+	}
+
+
+template<class Value>
+	inline std::packaged_task<void()>
+	LinearGauge<Value>::paint (xf::PaintRequest paint_request) const
+	{
+		return std::packaged_task<void()> ([this, pr = std::move (paint_request), snapshot = _values.read()] {
+			async_paint (pr, *snapshot);
 		});
 	}
 
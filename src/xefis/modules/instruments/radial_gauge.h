@@ -21,6 +21,7 @@
 #include <xefis/config/all.h>
 #include <xefis/core/graphics.h>
 #include <xefis/core/instrument.h>
+#include <xefis/core/snapshot_channel.h>
 #include <xefis/core/sockets/socket.h>
 #include <xefis/support/instrument/instrument_support.h>
 #include <xefis/support/sockets/socket_observer.h>
@@ -103,6 +104,19 @@ template<class Value>
 		paint (xf::PaintRequest) const override;
 
 	  private:
+		/**
+		 * Compute values for painting from sockets and settings.
+		 */
+		GaugeValues
+		compute_values() const;
+
+		/**
+		 * Publish computed values for painting. If publishing fails because all snapshot slots
+		 * are held by painters, it's retried on the next process().
+		 */
+		void
+		publish_values();
+
 		void
 		async_paint (xf::PaintRequest const&, GaugeValues const&) const;
 
@@ -116,6 +130,8 @@ template<class Value>
 		RadialGauge<Value>&									_io { *this };
 		xf::SocketObserver									_inputs_observer;
 		Converter											_converter;
+		xf::SnapshotChannel<GaugeValues>					_values;
+		bool												_publish_pending	{ false };
 		// Cached struff, to prevent allocation on heap on every repaint:
 		xf::Synchronized<std::optional<float>> mutable		_box_text_width;
 		xf::Synchronized<std::vector<PointInfo>> mutable	_point_infos;
@@ -130,7 +146,7 @@ template<class Value>
 		_converter (converter)
 	{
 		_inputs_observer.set_callback ([&]{
-			this->mark_dirty();
+			publish_values();
 		});
 		_inputs_observer.observe ({
 			&_io.value,
@@ -138,6 +154,8 @@ template<class Value>
 			&_io.reference,
 			&_io.automatic,
 		});
+		// Publish values on the first process() even if all inputs stay nil:
+		_inputs_observer.touch();
 	}
 
 
@@ -145,13 +163,17 @@ template<class Value>
 	inline void
 	RadialGauge<Value>::process (xf::Cycle const& cycle)
 	{
+		// Retry publishing that failed in previous cycle even if inputs haven't changed:
+		if (_publish_pending)
+			_inputs_observer.touch();
+
 		_inputs_observer.process (cycle.update_time());
 	}
 
 
 template<class Value>
-	inline std::packaged_task<void()>
-	RadialGauge<Value>::paint (xf::PaintRequest paint_request) const
+	inline auto
+	RadialGauge<Value>::compute_values() const -> GaugeValues
 	{
 		xf::Range const range { *_io.value_minimum, *_io.value_maximum };
 
@@ -172,8 +194,27 @@ template<class Value>
 		if (_io.automatic)
 			values.normalized_automatic = xf::renormalize (xf::clamped (*_io.automatic, range), range, BasicGauge::kNormalizedRange);
 
-		return std::packaged_task<void()> ([this, pr = std::move (paint_request), gv = std::move (values)] {
-			async_paint (pr, gv);
+		return values;
+	}
+
+
+template<class Value>
+	inline void
+	RadialGauge<Value>::publish_values()
+	{
+		_publish_pending = !_values.publish (compute_values());
+
+		if (!_publish_pending)
+			this->mark_dirty();
+	}
+
+
+template<class Value>
+	inline std::packaged_task<void()>
+	RadialGauge<Value>::paint (xf::PaintRequest paint_request) const
+	{
+		return std::packaged_task<void()> ([this, pr = std::move (paint_request), snapshot = _values.read()] {
+			async_paint (pr, *snapshot);
 		});
 	}
 
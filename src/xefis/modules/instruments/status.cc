@@ -16,9 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
-
-// Neutrino:
-#include <neutrino/time_helper.h>
+#include <xefis/core/clock.h>
 
 // Standard:
 #include <cstddef>
@@ -162,7 +160,7 @@ Status::process (xf::Cycle const& cycle)
 
 	// Update timestamp if there was anything new to show:
 	if (to_show < _hidden_messages.end())
-		_last_message_timestamp = xf::TimeHelper::now();
+		_last_message_timestamp = xf::Clock::now();
 
 	std::copy (to_show, _hidden_messages.end(), std::back_inserter (_visible_messages));
 	_hidden_messages.resize (neutrino::to_unsigned (std::distance (_hidden_messages.begin(), to_show)));
@@ -350,7 +348,7 @@ Status::recall()
 void
 Status::clear()
 {
-	if (xf::TimeHelper::now() - _last_message_timestamp > *_io.status_minimum_display_time)
+	if (xf::Clock::now() - _last_message_timestamp > *_io.status_minimum_display_time)
 	{
 		_hidden_messages.insert (_hidden_messages.end(), _visible_messages.begin(), _visible_messages.end());
 		_visible_messages.clear();
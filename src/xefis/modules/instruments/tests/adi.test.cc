@@ -0,0 +1,212 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/core/module.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/core/sockets/module_socket.h>
+#include <xefis/core/sockets/tests/test_cycle.h>
+#include <xefis/core/tests/allocation_counter.h>
+#include <xefis/modules/instruments/adi.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+
+namespace xf::test {
+namespace {
+
+/**
+ * ADI connected to a source module with a typical set of inputs, including labels
+ * longer than std::string's small-string buffer.
+ */
+class AdiEnvironment
+{
+  public:
+	neutrino::DummyQApplication	app;
+	LoggerOutput				logger_output	{ std::clog };
+	Logger						logger			{ logger_output };
+	Graphics					graphics		{ logger };
+	ADI							adi				{ graphics, "adi" };
+	Module						source;
+	ModuleOut<si::Velocity>		speed			{ &source, "speed" };
+	ModuleOut<si::Velocity>		speed_v1		{ &source, "speed-v1" };
+	ModuleOut<si::Velocity>		speed_flaps_up	{ &source, "speed-flaps-up" };
+	ModuleOut<std::string>		flaps_up_label	{ &source, "flaps-up-label" };
+	ModuleOut<si::Angle>		pitch			{ &source, "pitch" };
+	ModuleOut<si::Angle>		roll			{ &source, "roll" };
+	ModuleOut<si::Length>		altitude		{ &source, "altitude" };
+	ModuleOut<std::string>		fma_hint		{ &source, "fma-hint" };
+	TestCycle					cycle;
+
+  public:
+	// Ctor
+	AdiEnvironment()
+	{
+		adi.speed_ias << speed;
+		adi.speed_v1 << speed_v1;
+		adi.speed_flaps_up_speed << speed_flaps_up;
+		adi.speed_flaps_up_label << flaps_up_label;
+		adi.orientation_pitch << pitch;
+		adi.orientation_roll << roll;
+		adi.altitude_amsl << altitude;
+		adi.flight_mode_fma_lateral_hint << fma_hint;
+
+		speed = 120_kt;
+		speed_v1 = 110_kt;
+		speed_flaps_up = 150_kt;
+		flaps_up_label = "FLAPS UP, LONG LABEL";
+		pitch = 2_deg;
+		roll = 0_deg;
+		altitude = 1000_ft;
+		fma_hint = "LATERAL NAVIGATION MODE";
+	}
+
+	/**
+	 * Set time-varying inputs for given cycle index.
+	 */
+	void
+	vary (int i)
+	{
+		speed = (120.0 + 0.1 * i) * 1_kt;
+		pitch = (2.0 + 0.01 * i) * 1_deg;
+		altitude = (1000.0 + i) * 1_ft;
+	}
+
+	/**
+	 * Advance cycle and reset module caches. Must be called before process().
+	 */
+	void
+	next_cycle()
+	{
+		cycle += 10_ms;
+		Module::ProcessingLoopAPI (source).reset_cache();
+		Module::ProcessingLoopAPI (adi).reset_cache();
+	}
+
+	void
+	process()
+	{
+		Module::ProcessingLoopAPI (adi).fetch_and_process (cycle);
+	}
+};
+
+
+AutoTest t1 ("ADI: steady-state processing doesn't allocate", []{
+	AdiEnvironment env;
+
+	// Warm up: first cycles convert labels, compile fetch plan, fill SnapshotChannel slots, etc:
+	for (int i = 0; i < 20; ++i)
+	{
+		env.vary (i);
+		env.next_cycle();
+		env.process();
+	}
+
+	std::size_t allocations = 0;
+
+	for (int i = 20; i < 120; ++i)
+	{
+		env.vary (i);
+		env.next_cycle();
+
+		AllocationCounter counter;
+		env.process();
+		allocations += counter.allocations();
+	}
+
+	test_asserts::verify ("no heap allocations in steady-state cycles", allocations == 0);
+});
+
+
+AutoTest t2 ("ADI: unchanged parameters don't mark instrument dirty", []{
+	AdiEnvironment env;
+
+	env.next_cycle();
+	env.process();
+	test_asserts::verify ("changed parameters mark instrument dirty", env.adi.dirty_since_last_check());
+
+	env.next_cycle();
+	env.process();
+	test_asserts::verify ("unchanged parameters don't mark instrument dirty", !env.adi.dirty());
+
+	env.vary (1);
+	env.next_cycle();
+	env.process();
+	test_asserts::verify ("changed input marks instrument dirty", env.adi.dirty());
+});
+
+
+/**
+ * Paint valid frame and then input-alert frame onto the same uncleared canvas (ADI uses
+ * CanvasClearing::None) and return true if no pixel of the valid frame remains in the corners.
+ */
+bool
+input_alert_covers_corners (std::function<void (adi_detail::PaintingWork const&, PaintRequest const&, adi_detail::Parameters const&)> const paint)
+{
+	neutrino::DummyQApplication app;
+	LoggerOutput logger_output (std::clog);
+	Logger logger (logger_output);
+	Graphics graphics (logger);
+	adi_detail::PaintingWork painting_work (graphics);
+	QImage canvas (300, 200, QImage::Format_ARGB32_Premultiplied);
+	PaintRequest::Metric const metric (canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm);
+
+	adi_detail::Parameters params;
+	params.speed = 120_kt;
+	params.sanitize();
+
+	canvas.fill (Qt::transparent);
+	paint (painting_work, PaintRequest (canvas, metric, QSize()), params);
+
+	params.input_alert_visible = true;
+	paint (painting_work, PaintRequest (canvas, metric, canvas.size()), params);
+
+	auto const black = qRgb (0, 0, 0);
+	auto const w = canvas.width() - 1;
+	auto const h = canvas.height() - 1;
+
+	return canvas.pixel (0, 0) == black && canvas.pixel (w, 0) == black && canvas.pixel (0, h) == black && canvas.pixel (w, h) == black;
+}
+
+
+AutoTest t3 ("ADI: input alert covers whole canvas", []{
+	test_asserts::verify ("no stale pixels in corners after paint()", input_alert_covers_corners ([](auto const& work, auto const& paint_request, auto const& params) {
+		work.paint (paint_request, params);
+	}));
+
+	// Layers painted on top of each other, like when they're composited:
+	test_asserts::verify ("no stale pixels in corners after paint_layer()", input_alert_covers_corners ([](auto const& work, auto const& paint_request, auto const& params) {
+		work.precompute (paint_request, params);
+
+		for (auto const& layer: adi_detail::PaintingWork::kLayers)
+			work.paint_layer (layer.first, paint_request, params);
+	}));
+});
+
+} // namespace
+} // namespace xf::test
+
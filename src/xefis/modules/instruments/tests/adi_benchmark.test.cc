@@ -0,0 +1,115 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/modules/instruments/adi.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/dummy_qapplication.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kFrames = 200;
+
+
+/**
+ * Return ADI parameters for given frame of a gentle climbing turn, so that the pitch scale,
+ * heading tape and ladders move every frame.
+ */
+adi_detail::Parameters
+flight_parameters (std::size_t const frame)
+{
+	double const i = frame;
+
+	adi_detail::Parameters params;
+	params.timestamp = i * 10_ms;
+	params.speed = (120.0 + 0.05 * i) * 1_kt;
+	params.orientation_pitch = (2.0 + 0.01 * i) * 1_deg;
+	params.orientation_roll = 15_deg;
+	params.orientation_heading = 0.2 * i * 1_deg;
+	params.orientation_heading_numbers_visible = true;
+	params.altitude_amsl = (1000.0 + i) * 1_ft;
+	params.vertical_speed = 500_fpm;
+	params.sanitize();
+	return params;
+}
+
+
+/**
+ * Paint kFrames frames onto canvas and return time per frame. If cached is false,
+ * the cached layers are invalidated before each frame, like before they were introduced.
+ */
+si::Time
+measure (adi_detail::PaintingWork& painting_work, QImage& canvas, PaintRequest::Metric const& metric, bool const cached)
+{
+	auto const time = TimeHelper::measure ([&] {
+		for (std::size_t frame = 0; frame < kFrames; ++frame)
+		{
+			if (!cached)
+				painting_work.invalidate_cached_layers();
+
+			painting_work.paint (PaintRequest (canvas, metric, canvas.size()), flight_parameters (frame));
+		}
+	});
+
+	return time / kFrames;
+}
+
+
+ManualTest t_1 ("ADI: paint time with and without cached layers", []{
+	neutrino::DummyQApplication app;
+	LoggerOutput logger_output { std::clog };
+	Logger logger { logger_output };
+	Graphics graphics { logger };
+
+	// Sizes of instruments on the test_instruments screens and on a bigger display:
+	for (QSize size: { QSize (480, 480), QSize (800, 800), QSize (1200, 1200) })
+	{
+		adi_detail::PaintingWork painting_work (graphics);
+		QImage canvas (size, QImage::Format_ARGB32_Premultiplied);
+		PaintRequest::Metric const metric (canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm);
+		canvas.fill (Qt::black);
+
+		// First frame with size change, then warm up glyph caches and fill the cached layers:
+		painting_work.paint (PaintRequest (canvas, metric, QSize()), flight_parameters (0));
+		measure (painting_work, canvas, metric, true);
+
+		auto const uncached_time = measure (painting_work, canvas, metric, false);
+		auto const cached_time = measure (painting_work, canvas, metric, true);
+
+		std::cout << size.width() << "×" << size.height() << ": "
+				  << "without cached layers " << uncached_time.in<si::Millisecond>() << " ms/frame, "
+				  << "with cached layers " << cached_time.in<si::Millisecond>() << " ms/frame, "
+				  << "speed-up " << uncached_time / cached_time << "×" << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,91 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/modules/instruments/hsi.h>
+#include <xefis/support/earth/navigation/navaid_storage.h>
+#include <xefis/support/instrument/instrument_support.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+/**
+ * Paint HSI with all layers on one canvas, the way it's done when there are no layer work performers.
+ */
+QImage
+paint_hsi (bool raster_shadows)
+{
+	neutrino::DummyQApplication app;
+	LoggerOutput logger_output (std::clog);
+	Logger logger (logger_output);
+	Graphics graphics (logger);
+	InstrumentSupport instrument_support (graphics);
+	NavaidStorage navaid_storage (logger, "", "", "");
+	QImage canvas (300, 300, QImage::Format_ARGB32_Premultiplied);
+	PaintRequest::Metric const metric (canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm);
+
+	hsi_detail::Parameters params;
+	params.range = 5_nmi;
+	params.heading_magnetic = 30_deg;
+	params.heading_true = 32_deg;
+	params.track_visible = true;
+	params.track_magnetic = 35_deg;
+	params.ground_speed = 100_kt;
+	params.true_air_speed = 110_kt;
+	params.arpt_runways_range_threshold = 2_nmi;
+	params.arpt_map_range_threshold = 1_nmi;
+	params.arpt_runway_extension_length = 10_km;
+	params.trend_vector_durations = { 30_s, 60_s, 90_s };
+	params.trend_vector_min_ranges = { 5_nmi, 10_nmi, 15_nmi };
+	params.trend_vector_max_range = 30_nmi;
+	params.radio_range_pattern_scale = 2.5;
+	params.raster_shadows = raster_shadows;
+	params.sanitize();
+
+	hsi_detail::ResizeCache resize_cache;
+	hsi_detail::CurrentNavaids current_navaids;
+	hsi_detail::Mutable mutable_;
+
+	canvas.fill (Qt::transparent);
+	hsi_detail::PaintingWork (PaintRequest (canvas, metric, QSize()), instrument_support, navaid_storage, params, resize_cache, current_navaids, mutable_, logger).paint();
+
+	return canvas;
+}
+
+
+AutoTest t1 ("HSI: raster shadows setting doesn't affect painting without layers", []{
+	// Raster shadows need a separate canvas for each layer, so all layers must be painted with
+	// per-primitive shadows when they share one canvas:
+	test_asserts::verify ("all layers are painted", paint_hsi (true) == paint_hsi (false));
+});
+
+} // namespace
+} // namespace xf::test
+
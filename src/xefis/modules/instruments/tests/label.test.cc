@@ -0,0 +1,80 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/modules/instruments/label.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+/**
+ * Return true if all non-transparent pixels of the canvas lie within rect.
+ */
+bool
+painted_within (QImage const& canvas, QRect const& rect)
+{
+	for (int y = 0; y < canvas.height(); ++y)
+		for (int x = 0; x < canvas.width(); ++x)
+			if (qAlpha (canvas.pixel (x, y)) != 0 && !rect.contains (x, y))
+				return false;
+
+	return true;
+}
+
+
+AutoTest t1 ("Label: reports painted region for partial canvas clearing", []{
+	neutrino::DummyQApplication app;
+	LoggerOutput logger_output (std::clog);
+	Logger logger (logger_output);
+	Graphics graphics (logger);
+	Label label (graphics, "label");
+	QImage canvas (400, 100, QImage::Format_ARGB32_Premultiplied);
+	PaintRequest::Metric const metric (canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm);
+
+	label.label = "FLAPS";
+
+	test_asserts::verify ("label uses painted-region clearing", label.canvas_clearing() == Instrument::CanvasClearing::PaintedRegion);
+
+	for (Qt::Alignment const alignment: { Qt::AlignLeft | Qt::AlignTop, Qt::AlignHCenter | Qt::AlignVCenter, Qt::AlignRight | Qt::AlignBottom })
+	{
+		QRect painted_rect;
+		label.alignment = alignment;
+		canvas.fill (Qt::transparent);
+		label.paint (PaintRequest (canvas, metric, QSize(), &painted_rect))();
+
+		test_asserts::verify ("painted region is reported", !painted_rect.isEmpty());
+		test_asserts::verify ("painted region is smaller than canvas", painted_rect.width() < canvas.width());
+		test_asserts::verify ("all painted pixels are within reported region", painted_within (canvas, painted_rect));
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
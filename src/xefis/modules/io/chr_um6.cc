@@ -16,6 +16,8 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
+#include <xefis/core/sockets/socket_clock.h>
 #include <xefis/core/system.h>
 #include <xefis/utility/string.h>
 
@@ -361,6 +363,9 @@ CHRUM6::communication_failure()
 void
 CHRUM6::process_message (xf::CHRUM6::Read req)
 {
+	// All values from a single message share the sampling timestamp:
+	xf::SocketClock::TimestampScope socket_timestamp_scope (xf::Clock::now());
+
 	switch (req.address())
 	{
 		case static_cast<uint32_t> (DataAddress::Temperature):
@@ -16,6 +16,8 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
+#include <xefis/core/sockets/socket_clock.h>
 #include <xefis/support/protocols/nmea/parser.h>
 #include <xefis/support/protocols/nmea/mtk.h>
 
@@ -159,6 +161,9 @@ GPS::Connection::failure (std::string_view const& reason)
 void
 GPS::Connection::serial_data_ready()
 {
+	// Stamp all sockets with the time the data arrived:
+	xf::SocketClock::TimestampScope socket_timestamp_scope (xf::Clock::now());
+
 	_nmea_parser.feed (_serial_port->input_buffer());
 	_serial_port->input_buffer().clear();
 
@@ -227,7 +232,7 @@ GPS::Connection::process_nmea_sentence (xf::nmea::GPGGA const& sentence)
 	_gps_module._io.geoid_height = sentence.geoid_height;
 	_gps_module._io.dgps_station_id = sentence.dgps_station_id;
 	// Use system time as reference:
-	_gps_module._io.fix_system_timestamp = xf::TimeHelper::now();
+	_gps_module._io.fix_system_timestamp = xf::SocketClock::now();
 	_gps_module._reliable_fix_quality = sentence.reliable_fix_quality();
 }
 
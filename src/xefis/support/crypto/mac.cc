@@ -0,0 +1,226 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "mac.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/stdexcept.h>
+
+// Lib:
+#include <cryptopp/blake2.h>
+#include <cryptopp/misc.h>
+#include <cryptopp/sha3.h>
+#include <cryptopp/siphash.h>
+
+// Standard:
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+
+namespace xf::crypto {
+
+class MAC::State
+{
+  public:
+	// Dtor
+	virtual
+	~State() = default;
+
+	[[nodiscard]]
+	virtual std::size_t
+	size() const noexcept = 0;
+
+	virtual void
+	calculate (std::initializer_list<BlobView> parts, uint8_t* result, std::size_t result_size) = 0;
+};
+
+
+namespace {
+
+/**
+ * HMAC with the key already absorbed into inner and outer hash states.
+ * Per message this saves hashing two key blocks compared to computing HMAC from scratch.
+ */
+class HMAC_SHA3_256_State: public MAC::State
+{
+	using Hash = CryptoPP::SHA3_256;
+
+	static constexpr std::size_t kBlockSize = Hash::BLOCKSIZE;
+
+  public:
+	// Ctor
+	explicit
+	HMAC_SHA3_256_State (BlobView key)
+	{
+		std::array<uint8_t, kBlockSize> block_key {};
+
+		if (key.size() > kBlockSize)
+			Hash().CalculateDigest (block_key.data(), key.data(), key.size());
+		else
+			std::copy (key.begin(), key.end(), block_key.begin());
+
+		std::array<uint8_t, kBlockSize> pad;
+
+		for (std::size_t i = 0; i < kBlockSize; ++i)
+			pad[i] = block_key[i] ^ 0x36;
+
+		_inner_keyed.Update (pad.data(), pad.size());
+
+		for (std::size_t i = 0; i < kBlockSize; ++i)
+			pad[i] = block_key[i] ^ 0x5c;
+
+		_outer_keyed.Update (pad.data(), pad.size());
+
+		CryptoPP::SecureWipeBuffer (block_key.data(), block_key.size());
+		CryptoPP::SecureWipeBuffer (pad.data(), pad.size());
+	}
+
+	std::size_t
+	size() const noexcept override
+		{ return Hash::DIGESTSIZE; }
+
+	void
+	calculate (std::initializer_list<BlobView> parts, uint8_t* result, std::size_t result_size) override
+	{
+		std::array<uint8_t, Hash::DIGESTSIZE> inner_digest;
+
+		_hash = _inner_keyed;
+
+		for (auto const& part: parts)
+			_hash.Update (part.data(), part.size());
+
+		_hash.Final (inner_digest.data());
+
+		_hash = _outer_keyed;
+		_hash.Update (inner_digest.data(), inner_digest.size());
+		_hash.TruncatedFinal (result, result_size);
+	}
+
+  private:
+	Hash	_inner_keyed;
+	Hash	_outer_keyed;
+	Hash	_hash;
+};
+
+
+/**
+ * Wrapper for Crypto++ keyed hashes that reset themselves to the keyed state after each result.
+ */
+template<class pHash>
+	class KeyedHashState: public MAC::State
+	{
+	  public:
+		// Ctor
+		template<class ...Args>
+			explicit
+			KeyedHashState (Args&& ...args):
+				_hash (std::forward<Args> (args)...)
+			{ }
+
+		std::size_t
+		size() const noexcept override
+			{ return _hash.DigestSize(); }
+
+		void
+		calculate (std::initializer_list<BlobView> parts, uint8_t* result, std::size_t result_size) override
+		{
+			for (auto const& part: parts)
+				_hash.Update (part.data(), part.size());
+
+			_hash.TruncatedFinal (result, result_size);
+		}
+
+	  private:
+		pHash _hash;
+	};
+
+
+std::unique_ptr<MAC::State>
+make_state (MAC::Algorithm const algorithm, BlobView const key)
+{
+	switch (algorithm)
+	{
+		case MAC::Algorithm::HMAC_SHA3_256:
+			return std::make_unique<HMAC_SHA3_256_State> (key);
+
+		case MAC::Algorithm::BLAKE2b_256:
+			if (key.size() > CryptoPP::BLAKE2b::MAX_KEYLENGTH)
+				throw InvalidArgument ("MAC: BLAKE2b key must not be longer than 64 bytes");
+
+			return std::make_unique<KeyedHashState<CryptoPP::BLAKE2b>> (key.data(), key.size(), nullptr, 0, nullptr, 0, false, 32);
+
+		case MAC::Algorithm::SipHash_2_4:
+			if (key.size() != CryptoPP::SipHash<2, 4, true>::KEYLENGTH)
+				throw InvalidArgument ("MAC: SipHash key must be exactly 16 bytes long");
+
+			return std::make_unique<KeyedHashState<CryptoPP::SipHash<2, 4, true>>> (key.data(), static_cast<unsigned int> (key.size()));
+	}
+
+	throw InvalidArgument ("MAC: unknown algorithm");
+}
+
+} // namespace
+
+
+MAC::MAC (Algorithm const algorithm, BlobView const key):
+	_algorithm (algorithm),
+	_state (make_state (algorithm, key))
+{ }
+
+
+MAC::MAC (MAC&&) noexcept = default;
+
+
+MAC::~MAC() = default;
+
+
+MAC&
+MAC::operator= (MAC&&) noexcept = default;
+
+
+std::size_t
+MAC::size() const noexcept
+{
+	return _state->size();
+}
+
+
+void
+MAC::calculate (std::initializer_list<BlobView> const parts, std::span<uint8_t> const result)
+{
+	if (result.size() > size())
+		throw InvalidArgument ("MAC::calculate(): result is larger than MAC size");
+
+	_state->calculate (parts, result.data(), result.size());
+}
+
+
+bool
+MAC::verify (std::initializer_list<BlobView> const parts, BlobView const expected)
+{
+	if (expected.size() > size())
+		return false;
+
+	std::array<uint8_t, kMaxSize> result;
+	_state->calculate (parts, result.data(), expected.size());
+	return CryptoPP::VerifyBufsEqual (result.data(), expected.data(), expected.size());
+}
+
+} // namespace xf::crypto
+
@@ -0,0 +1,110 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__SUPPORT__CRYPTO__MAC_H__INCLUDED
+#define XEFIS__SUPPORT__CRYPTO__MAC_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <span>
+
+
+namespace xf::crypto {
+
+/**
+ * Message authentication code calculator for many short messages authenticated with the same key.
+ *
+ * The key is absorbed once in the constructor; each message starts from a copy of that keyed state,
+ * so the per-message cost is only hashing the message itself. Messages are given as a list of parts,
+ * so that they don't have to be copied into one buffer first. No memory is allocated per message.
+ *
+ * Not thread-safe, since hashing is done in member scratch state.
+ */
+class MAC
+{
+  public:
+	enum class Algorithm
+	{
+		// Standard HMAC (RFC 2104) with SHA3-256. Any key length. Result is the same as neutrino's
+		// calculate_hmac<Hash::SHA3_256>().
+		HMAC_SHA3_256,
+		// Keyed BLAKE2b with 256-bit result. Key must not be longer than 64 bytes.
+		BLAKE2b_256,
+		// SipHash-2-4 with 128-bit result. Key must be exactly 16 bytes. Much faster than others on
+		// short messages, but only 128-bit security.
+		SipHash_2_4,
+	};
+
+	// Largest result size of all algorithms:
+	static constexpr std::size_t kMaxSize = 32;
+
+	// Keyed state of given algorithm, defined in mac.cc:
+	class State;
+
+  public:
+	// Ctor
+	explicit
+	MAC (Algorithm, BlobView key);
+
+	// Move ctor
+	MAC (MAC&&) noexcept;
+
+	// Dtor
+	~MAC();
+
+	// Move operator
+	MAC&
+	operator= (MAC&&) noexcept;
+
+	[[nodiscard]]
+	Algorithm
+	algorithm() const noexcept
+		{ return _algorithm; }
+
+	/**
+	 * Return size of the full (not truncated) result in bytes.
+	 */
+	[[nodiscard]]
+	std::size_t
+	size() const noexcept;
+
+	/**
+	 * Calculate MAC of concatenation of given parts and write first result.size() bytes of it into result.
+	 * result.size() must not be greater than size().
+	 */
+	void
+	calculate (std::initializer_list<BlobView> parts, std::span<uint8_t> result);
+
+	/**
+	 * Return true if the expected bytes are equal to the first expected.size() bytes of MAC of concatenation
+	 * of given parts. Comparison is done in constant time. Returns false if expected is longer than size().
+	 */
+	[[nodiscard]]
+	bool
+	verify (std::initializer_list<BlobView> parts, BlobView expected);
+
+  private:
+	Algorithm				_algorithm;
+	std::unique_ptr<State>	_state;
+};
+
+} // namespace xf::crypto
+
+#endif
+
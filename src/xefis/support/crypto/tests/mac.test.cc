@@ -0,0 +1,90 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/crypto/mac.h>
+
+// Neutrino:
+#include <neutrino/crypto/hmac.h>
+#include <neutrino/test/auto_test.h>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf::test {
+namespace {
+
+using MAC = xf::crypto::MAC;
+
+
+Blob
+calculate (MAC& mac, std::initializer_list<BlobView> parts, std::size_t size)
+{
+	Blob result (size, 0);
+	mac.calculate (parts, result);
+	return result;
+}
+
+
+AutoTest t1 ("xf::crypto::MAC: HMAC-SHA3-256 is compatible with calculate_hmac()", []{
+	Blob const message = value_to_blob ("some message that is authenticated");
+	Blob const short_key = value_to_blob ("key");
+	// Longer than SHA3-256 block (136 bytes), so that it gets hashed first:
+	Blob const long_key (200, 0xa5);
+
+	for (auto const& key: { short_key, long_key })
+	{
+		MAC mac (MAC::Algorithm::HMAC_SHA3_256, key);
+		auto const expected = xf::calculate_hmac<xf::Hash::SHA3_256> ({ .data = message, .key = key });
+
+		test_asserts::verify ("result is the same as from calculate_hmac()", calculate (mac, { message }, mac.size()) == expected);
+		test_asserts::verify ("keyed state is reused properly for the next message", calculate (mac, { message }, mac.size()) == expected);
+	}
+});
+
+
+AutoTest t2 ("xf::crypto::MAC: parts, truncation and verification", []{
+	Blob const key = value_to_blob ("0123456789abcdef");
+	Blob const message = value_to_blob ("some message that is authenticated");
+	BlobView const view = message;
+
+	for (auto const algorithm: { MAC::Algorithm::HMAC_SHA3_256, MAC::Algorithm::BLAKE2b_256, MAC::Algorithm::SipHash_2_4 })
+	{
+		MAC mac (algorithm, key);
+		auto const whole = calculate (mac, { message }, mac.size());
+
+		test_asserts::verify ("MAC of parts is the same as MAC of their concatenation",
+							  calculate (mac, { view.substr (0, 5), view.substr (5, 10), view.substr (15) }, mac.size()) == whole);
+		test_asserts::verify ("truncated result is a prefix of full result", calculate (mac, { message }, 8) == whole.substr (0, 8));
+		test_asserts::verify ("correct MAC is verified", mac.verify ({ message }, whole));
+		test_asserts::verify ("truncated MAC is verified", mac.verify ({ message }, BlobView (whole).substr (0, 12)));
+
+		Blob wrong = whole;
+		wrong[3] ^= 0x10;
+		test_asserts::verify ("wrong MAC is rejected", !mac.verify ({ message }, wrong));
+		test_asserts::verify ("MAC longer than result is rejected", !mac.verify ({ message }, whole + Blob (1, 0)));
+
+		MAC other_key_mac (algorithm, value_to_blob ("fedcba9876543210"));
+		test_asserts::verify ("MAC depends on key", calculate (other_key_mac, { message }, other_key_mac.size()) != whole);
+	}
+
+	test_asserts::verify ("HMAC-SHA3-256 result has 32 bytes", MAC (MAC::Algorithm::HMAC_SHA3_256, key).size() == 32);
+	test_asserts::verify ("BLAKE2b-256 result has 32 bytes", MAC (MAC::Algorithm::BLAKE2b_256, key).size() == 32);
+	test_asserts::verify ("SipHash-2-4 result has 16 bytes", MAC (MAC::Algorithm::SipHash_2_4, key).size() == 16);
+});
+
+} // namespace
+} // namespace xf::test
+
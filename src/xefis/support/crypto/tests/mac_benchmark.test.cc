@@ -0,0 +1,85 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/crypto/mac.h>
+
+// Neutrino:
+#include <neutrino/crypto/hmac.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+#include <utility>
+
+
+namespace xf::test {
+namespace {
+
+using MAC = xf::crypto::MAC;
+
+constexpr std::size_t kIterations = 200'000;
+// Typical signed link envelope, large telemetry envelope and a bulk message:
+constexpr std::size_t kMessageSizes[] = { 32, 256, 1500 };
+
+
+void
+report (std::string_view const name, std::size_t const message_size, si::Time const time)
+{
+	auto const per_message = time / kIterations;
+
+	std::cout << name << ", " << message_size << " B: "
+			  << per_message.in<si::Nanosecond>() << " ns/message, "
+			  << (kIterations * message_size / time.in<si::Second>() / 1e6) << " MB/s" << std::endl;
+}
+
+
+ManualTest t_1 ("xf::crypto::MAC: throughput of each algorithm", []{
+	Blob const key = value_to_blob ("0123456789abcdef");
+
+	for (auto const message_size: kMessageSizes)
+	{
+		Blob const message (message_size, 0x5a);
+		Blob result (12, 0);
+
+		// Reference: HMAC computed from scratch for each message:
+		auto const from_scratch_time = TimeHelper::measure ([&] {
+			for (std::size_t i = 0; i < kIterations; ++i)
+				result = xf::calculate_hmac<xf::Hash::SHA3_256> ({ .data = message, .key = key }).substr (0, 12);
+		});
+
+		report ("calculate_hmac<SHA3_256>()", message_size, from_scratch_time);
+
+		for (auto const& [algorithm, name]: { std::pair { MAC::Algorithm::HMAC_SHA3_256, "HMAC-SHA3-256" },
+											  std::pair { MAC::Algorithm::BLAKE2b_256, "BLAKE2b-256" },
+											  std::pair { MAC::Algorithm::SipHash_2_4, "SipHash-2-4" } })
+		{
+			MAC mac (algorithm, key);
+
+			auto const time = TimeHelper::measure ([&] {
+				for (std::size_t i = 0; i < kIterations; ++i)
+					mac.calculate ({ message }, result);
+			});
+
+			report (name, message_size, time);
+		}
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -15,18 +15,96 @@
 #include <xefis/support/crypto/xle/transport.h>
 
 // Neutrino:
+#include <neutrino/crypto/aes.h>
+#include <neutrino/crypto/hash.h>
+#include <neutrino/crypto/hkdf.h>
+#include <neutrino/crypto/hmac.h>
 #include <neutrino/test/auto_test.h>
 
 // Boost:
 #include <boost/random/random_device.hpp>
 
 // Standard:
+#include <array>
 #include <cstddef>
+#include <optional>
 
 
 namespace xf::test {
 namespace {
 
+using Transport = xf::crypto::xle::Transport;
+
+
+/**
+ * Keys derived the same way as in Transport (without salt and user info).
+ */
+struct LegacyKeys
+{
+	Blob	hmac;
+	Blob	data;
+	Blob	seq_num;
+
+	explicit
+	LegacyKeys (BlobView const key):
+		hmac (calculate_hkdf<Hash::SHA3_256> ({ .salt = {}, .key_material = key, .info = value_to_blob ("hmac_key"), .result_length = 16 })),
+		data (calculate_hkdf<Hash::SHA3_256> ({ .salt = {}, .key_material = key, .info = value_to_blob ("data_encryption_key"), .result_length = 16 })),
+		seq_num (calculate_hkdf<Hash::SHA3_256> ({ .salt = {}, .key_material = key, .info = value_to_blob ("seq_num_encryption_key"), .result_length = 16 }))
+	{ }
+};
+
+
+/**
+ * Packet encryption made of neutrino's primitives, as it was done before Transport had in-place API.
+ */
+Blob
+legacy_encrypt_packet (LegacyKeys const& keys, BlobView const data, Transport::SequenceNumber const sequence_number, size_t const hmac_size)
+{
+	auto const binary_sequence_number = value_to_blob (sequence_number);
+	Blob const salt (Transport::kDataSaltSize, 0x33);
+	auto const hmac = calculate_hmac<Hash::SHA3_256> ({ .data = data + salt + binary_sequence_number, .key = keys.hmac }).substr (0, hmac_size);
+	auto const encrypted_data = aes_ctr_xor ({
+		.data = data + salt + hmac,
+		.key = keys.data,
+		.nonce = calculate_hash<Hash::SHA3_256> (binary_sequence_number).substr (0, 8),
+	});
+	auto const encrypted_sequence_number = aes_ctr_xor ({
+		.data = binary_sequence_number,
+		.key = keys.seq_num,
+		.nonce = calculate_hash<Hash::SHA3_256> (encrypted_data).substr (0, 8),
+	});
+
+	return encrypted_sequence_number + encrypted_data;
+}
+
+
+/**
+ * Counterpart of legacy_encrypt_packet(). Return nothing if authentication fails.
+ */
+std::optional<Blob>
+legacy_decrypt_packet (LegacyKeys const& keys, BlobView const encrypted_packet, size_t const hmac_size)
+{
+	auto const encrypted_data = encrypted_packet.substr (sizeof (Transport::SequenceNumber));
+	auto const binary_sequence_number = aes_ctr_xor ({
+		.data = encrypted_packet.substr (0, sizeof (Transport::SequenceNumber)),
+		.key = keys.seq_num,
+		.nonce = calculate_hash<Hash::SHA3_256> (encrypted_data).substr (0, 8),
+	});
+	auto const data_with_hmac = aes_ctr_xor ({
+		.data = encrypted_data,
+		.key = keys.data,
+		.nonce = calculate_hash<Hash::SHA3_256> (binary_sequence_number).substr (0, 8),
+	});
+	auto const data_with_salt = BlobView (data_with_hmac).substr (0, data_with_hmac.size() - hmac_size);
+	auto const hmac = calculate_hmac<Hash::SHA3_256> ({ .data = data_with_salt + binary_sequence_number, .key = keys.hmac }).substr (0, hmac_size);
+
+	if (hmac != BlobView (data_with_hmac).substr (data_with_salt.size()))
+		return std::nullopt;
+
+	return Blob (data_with_salt.substr (0, data_with_salt.size() - Transport::kDataSaltSize));
+}
+
+
 AutoTest t1 ("Xefis Lossy Encryption: encryption and decryption", []{
 	Blob const key = value_to_blob ("abcdefghijklmnop");
 
@@ -49,6 +127,94 @@ AutoTest t1 ("Xefis Lossy Encryption: encryption and decryption", []{
 	test_asserts::verify ("data margin is declared properly (2)", encrypted.size() - plain_text.size() == tx.data_margin());
 });
 
+
+AutoTest t2 ("Xefis Lossy Encryption: wire format is compatible with neutrino's primitives", []{
+	Blob const key = value_to_blob ("abcdefghijklmnop");
+	LegacyKeys const legacy_keys (key);
+	Blob const plain_text = value_to_blob ("some plain text that is longer than the AES block size");
+
+	boost::random::random_device rnd;
+	xf::crypto::xle::Transmitter tx (rnd, key);
+	xf::crypto::xle::Receiver rx (key);
+
+	test_asserts::verify ("legacy packet is decrypted",
+						  rx.decrypt_packet (legacy_encrypt_packet (legacy_keys, plain_text, 1, 12)) == plain_text);
+
+	Blob in_place = legacy_encrypt_packet (legacy_keys, plain_text, 3, 12);
+	auto const decrypted = rx.decrypt_packet_in_place (in_place);
+	test_asserts::verify ("legacy packet is decrypted in place", Blob (decrypted.begin(), decrypted.end()) == plain_text);
+	test_asserts::verify ("decrypted data is located in packet buffer",
+						  decrypted.data() == in_place.data() + Transport::kSequenceNumberSize);
+
+	auto const legacy_decrypted = legacy_decrypt_packet (legacy_keys, tx.encrypt_packet (plain_text), 12);
+	test_asserts::verify ("packet is decrypted by legacy code", legacy_decrypted && *legacy_decrypted == plain_text);
+});
+
+
+AutoTest t3 ("Xefis Lossy Encryption: in-place and batch encryption", []{
+	Blob const key = value_to_blob ("abcdefghijklmnop");
+	Blob const plain_text = value_to_blob ("some plain text");
+
+	boost::random::random_device rnd;
+	xf::crypto::xle::Transmitter tx (rnd, key);
+	xf::crypto::xle::Receiver rx (key);
+
+	// Data placed in the buffer at the right offset is encrypted in place:
+	Blob buffer (plain_text.size() + tx.data_margin() + 5, 0);
+	std::copy (plain_text.begin(), plain_text.end(), buffer.begin() + Transport::kSequenceNumberSize);
+	auto const packet = tx.encrypt_packet_into (BlobView (buffer).substr (Transport::kSequenceNumberSize, plain_text.size()), buffer);
+	test_asserts::verify ("encrypted packet has expected size", packet.size() == plain_text.size() + tx.data_margin());
+	test_asserts::verify ("packet encrypted in place is decrypted", rx.decrypt_packet (BlobView (packet.data(), packet.size())) == plain_text);
+
+	// Batch:
+	std::array<Blob, 3> buffers;
+	std::array<xf::crypto::xle::Transmitter::EncryptionJob, 3> encryption_jobs;
+
+	for (std::size_t i = 0; i < buffers.size(); ++i)
+	{
+		buffers[i].resize (plain_text.size() + tx.data_margin());
+		encryption_jobs[i] = { .plain_text = plain_text, .packet = buffers[i] };
+	}
+
+	tx.encrypt_packets (encryption_jobs);
+	// Corrupt the middle one:
+	encryption_jobs[1].packet.back() ^= 0x01;
+
+	std::array<xf::crypto::xle::Receiver::DecryptionJob, 4> decryption_jobs;
+
+	for (std::size_t i = 0; i < encryption_jobs.size(); ++i)
+		decryption_jobs[i].packet = encryption_jobs[i].packet;
+
+	// Replay of the last packet, after it's been decrypted:
+	Blob replayed (encryption_jobs[2].packet.begin(), encryption_jobs[2].packet.end());
+	decryption_jobs[3].packet = replayed;
+
+	rx.decrypt_packets (decryption_jobs);
+
+	auto const plain_text_of = [](auto const& job) {
+		return Blob (job.plain_text.begin(), job.plain_text.end());
+	};
+
+	test_asserts::verify ("first packet of batch is decrypted", !decryption_jobs[0].error && plain_text_of (decryption_jobs[0]) == plain_text);
+	test_asserts::verify ("corrupted packet is rejected", decryption_jobs[1].error == Transport::InvalidAuthentication && decryption_jobs[1].plain_text.empty());
+	test_asserts::verify ("packet after corrupted one is decrypted", !decryption_jobs[2].error && plain_text_of (decryption_jobs[2]) == plain_text);
+	test_asserts::verify ("replayed packet is rejected", decryption_jobs[3].error == Transport::SeqNumFromPast);
+
+	// Too small buffer:
+	std::array<uint8_t, 4> small_buffer;
+	bool thrown = false;
+
+	try {
+		(void) tx.encrypt_packet_into (plain_text, small_buffer);
+	}
+	catch (xf::InvalidArgument const&)
+	{
+		thrown = true;
+	}
+
+	test_asserts::verify ("too small buffer is rejected", thrown);
+});
+
 } // namespace
 } // namespace xf::test
 
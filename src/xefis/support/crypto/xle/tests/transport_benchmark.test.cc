@@ -0,0 +1,163 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/crypto/xle/transport.h>
+
+// Neutrino:
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Boost:
+#include <boost/random/random_device.hpp>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+using Transmitter = xf::crypto::xle::Transmitter;
+using Receiver = xf::crypto::xle::Receiver;
+
+constexpr std::size_t kPackets = 100'000;
+constexpr std::size_t kBatchSize = 64;
+constexpr std::size_t kPayloadSizes[] = { 32, 256, 1400 };
+
+
+void
+report (std::string_view const name, std::size_t const payload_size, si::Time const encryption_time, si::Time const decryption_time)
+{
+	std::cout << name << ", " << payload_size << " B: "
+			  << "encryption " << static_cast<std::size_t> (kPackets / encryption_time.in<si::Second>()) << " packets/s, "
+			  << "decryption " << static_cast<std::size_t> (kPackets / decryption_time.in<si::Second>()) << " packets/s" << std::endl;
+}
+
+
+/**
+ * Encrypt and decrypt with the API returning new Blobs.
+ */
+void
+run_blob_api (Blob const& key, Blob const& payload)
+{
+	boost::random::random_device rnd;
+	Transmitter tx (rnd, key);
+	Receiver rx (key);
+	std::vector<Blob> packets (kBatchSize);
+	si::Time encryption_time = 0_s;
+	si::Time decryption_time = 0_s;
+
+	for (std::size_t n = 0; n < kPackets; n += kBatchSize)
+	{
+		encryption_time += TimeHelper::measure ([&] {
+			for (auto& packet: packets)
+				packet = tx.encrypt_packet (payload);
+		});
+
+		decryption_time += TimeHelper::measure ([&] {
+			for (auto const& packet: packets)
+				(void) rx.decrypt_packet (packet);
+		});
+	}
+
+	report ("encrypt_packet()/decrypt_packet()", payload.size(), encryption_time, decryption_time);
+}
+
+
+/**
+ * Encrypt and decrypt packets one by one in caller-supplied buffers.
+ */
+void
+run_in_place_api (Blob const& key, Blob const& payload)
+{
+	boost::random::random_device rnd;
+	Transmitter tx (rnd, key);
+	Receiver rx (key);
+	std::vector<Blob> buffers (kBatchSize, Blob (payload.size() + tx.data_margin(), 0));
+	si::Time encryption_time = 0_s;
+	si::Time decryption_time = 0_s;
+
+	for (std::size_t n = 0; n < kPackets; n += kBatchSize)
+	{
+		encryption_time += TimeHelper::measure ([&] {
+			for (auto& buffer: buffers)
+				(void) tx.encrypt_packet_into (payload, buffer);
+		});
+
+		decryption_time += TimeHelper::measure ([&] {
+			for (auto& buffer: buffers)
+				(void) rx.decrypt_packet_in_place (buffer);
+		});
+	}
+
+	report ("encrypt_packet_into()/decrypt_packet_in_place()", payload.size(), encryption_time, decryption_time);
+}
+
+
+/**
+ * Encrypt and decrypt kBatchSize packets per call.
+ */
+void
+run_batch_api (Blob const& key, Blob const& payload)
+{
+	boost::random::random_device rnd;
+	Transmitter tx (rnd, key);
+	Receiver rx (key);
+	std::vector<Blob> buffers (kBatchSize, Blob (payload.size() + tx.data_margin(), 0));
+	std::vector<Transmitter::EncryptionJob> encryption_jobs (kBatchSize);
+	std::vector<Receiver::DecryptionJob> decryption_jobs (kBatchSize);
+	si::Time encryption_time = 0_s;
+	si::Time decryption_time = 0_s;
+
+	for (std::size_t n = 0; n < kPackets; n += kBatchSize)
+	{
+		for (std::size_t i = 0; i < kBatchSize; ++i)
+			encryption_jobs[i] = { .plain_text = payload, .packet = buffers[i] };
+
+		encryption_time += TimeHelper::measure ([&] {
+			tx.encrypt_packets (encryption_jobs);
+		});
+
+		for (std::size_t i = 0; i < kBatchSize; ++i)
+			decryption_jobs[i].packet = encryption_jobs[i].packet;
+
+		decryption_time += TimeHelper::measure ([&] {
+			rx.decrypt_packets (decryption_jobs);
+		});
+	}
+
+	report ("encrypt_packets()/decrypt_packets()", payload.size(), encryption_time, decryption_time);
+}
+
+
+ManualTest t_1 ("Xefis Lossy Encryption: packets/s", []{
+	Blob const key = value_to_blob ("abcdefghijklmnop");
+
+	for (auto const payload_size: kPayloadSizes)
+	{
+		Blob const payload (payload_size, 0x5a);
+
+		run_blob_api (key, payload);
+		run_in_place_api (key, payload);
+		run_batch_api (key, payload);
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -18,39 +18,122 @@
 #include <xefis/config/all.h>
 
 // Neutrino:
-#include <neutrino/crypto/aes.h>
 #include <neutrino/crypto/hkdf.h>
-#include <neutrino/crypto/utility.h>
+#include <neutrino/stdexcept.h>
+
+// Boost:
+#include <boost/endian/conversion.hpp>
 
 // Standard:
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
 
 
 namespace xf::crypto::xle {
 
-Transport::Transport (BlobView const ephemeral_session_key, size_t const hmac_size, BlobView const key_salt, BlobView const hkdf_user_info):
-	_hmac_size (hmac_size)
+static inline BlobView
+as_blob_view (std::span<uint8_t const> const span)
+{
+	return BlobView (span.data(), span.size());
+}
+
+
+static inline void
+write_sequence_number (Transport::SequenceNumber const sequence_number, std::span<uint8_t> const binary_sequence_number)
 {
-	_hmac_key = calculate_hkdf<kSignatureHMACHashAlgorithm> ({
+	auto const little_endian = boost::endian::native_to_little (sequence_number);
+	std::memcpy (binary_sequence_number.data(), &little_endian, sizeof (little_endian));
+}
+
+
+static inline Transport::SequenceNumber
+read_sequence_number (std::span<uint8_t const> const binary_sequence_number)
+{
+	Transport::SequenceNumber little_endian;
+	std::memcpy (&little_endian, binary_sequence_number.data(), sizeof (little_endian));
+	return boost::endian::little_to_native (little_endian);
+}
+
+
+Transport::Transport (BlobView const ephemeral_session_key, size_t const hmac_size, BlobView const key_salt, BlobView const hkdf_user_info):
+	_hmac_size (hmac_size),
+	_hmac (MAC::Algorithm::HMAC_SHA3_256, calculate_hkdf<kSignatureHMACHashAlgorithm> ({
 		.salt = key_salt,
 		.key_material = ephemeral_session_key,
 		.info = Blob (hkdf_user_info) + value_to_blob ("hmac_key"),
 		.result_length = 16,
-	});
+	}))
+{
+	// HMAC and nonces are calculated with SHA3-256 directly:
+	static_assert (kSignatureHMACHashAlgorithm == Hash::SHA3_256);
+	static_assert (kDataNonceHashAlgorithm == Hash::SHA3_256);
+	static_assert (kSeqNumNonceHashAlgorithm == Hash::SHA3_256);
+
+	if (_hmac_size > _hmac.size())
+		throw InvalidArgument ("HMAC size doesn't fit requirements");
 
-	_data_encryption_key = calculate_hkdf<kDataEncryptionKeyHKDFHashAlgorithm> ({
+	// Initial vectors are set for each packet:
+	std::array<uint8_t, CryptoPP::AES::BLOCKSIZE> const zero_iv {};
+
+	auto const data_encryption_key = calculate_hkdf<kDataEncryptionKeyHKDFHashAlgorithm> ({
 		.salt = key_salt,
 		.key_material = ephemeral_session_key,
 		.info = hkdf_user_info + value_to_blob ("data_encryption_key"),
 		.result_length = 16,
 	});
+	_data_cipher.SetKeyWithIV (data_encryption_key.data(), data_encryption_key.size(), zero_iv.data(), zero_iv.size());
 
-	_seq_num_encryption_key = calculate_hkdf<kSeqNumEncryptionKeyHKDFHashAlgorithm> ({
+	auto const seq_num_encryption_key = calculate_hkdf<kSeqNumEncryptionKeyHKDFHashAlgorithm> ({
 		.salt = key_salt,
 		.key_material = ephemeral_session_key,
 		.info = hkdf_user_info + value_to_blob ("seq_num_encryption_key"),
 		.result_length = 16,
 	});
+	_seq_num_cipher.SetKeyWithIV (seq_num_encryption_key.data(), seq_num_encryption_key.size(), zero_iv.data(), zero_iv.size());
+}
+
+
+std::string_view
+Transport::error_message (ErrorCode const error_code)
+{
+	switch (error_code)
+	{
+		case HMACTooShort:			return "HMAC too short";
+		case InvalidAuthentication:	return "invalid authentication";
+		case SeqNumFromPast:		return "sequence number from past is invalid";
+		case SeqNumFromFarFuture:	return "sequence number from far future is invalid";
+	}
+
+	return "unknown error";
+}
+
+
+void
+Transport::xor_data (std::span<uint8_t> const data, BlobView const binary_sequence_number)
+{
+	ctr_xor (_data_cipher, data, binary_sequence_number);
+}
+
+
+void
+Transport::xor_sequence_number (std::span<uint8_t> const binary_sequence_number, BlobView const encrypted_data)
+{
+	// Encrypted data must be at least 8 bytes, but longer is better for better entropy to avoid
+	// repeating nonce ever. That's why data salt is added before encryption.
+	ctr_xor (_seq_num_cipher, binary_sequence_number, encrypted_data);
+}
+
+
+void
+Transport::ctr_xor (Cipher& cipher, std::span<uint8_t> const data, BlobView const nonce_source)
+{
+	// Counter block is the nonce followed by 64-bit block counter starting at 0, same as with aes_ctr_xor():
+	std::array<uint8_t, CryptoPP::AES::BLOCKSIZE> iv {};
+	_nonce_hash.CalculateTruncatedDigest (iv.data(), kNonceSize, nonce_source.data(), nonce_source.size());
+	cipher.Resynchronize (iv.data(), iv.size());
+	cipher.ProcessData (data.data(), data.data(), data.size());
 }
 
 
@@ -64,6 +147,15 @@ Transmitter::Transmitter (boost::random::random_device& random_device,
 { }
 
 
+Blob
+Transmitter::encrypt_packet (BlobView const data)
+{
+	Blob packet (data.size() + data_margin(), 0);
+	encrypt_packet_into (data, packet);
+	return packet;
+}
+
+
 /**
  * Encrypted packet structure:
  *
@@ -78,96 +170,126 @@ Transmitter::Transmitter (boost::random::random_device& random_device,
  *     };
  * };
  */
-Blob
-Transmitter::encrypt_packet (BlobView const data)
+std::span<uint8_t>
+Transmitter::encrypt_packet_into (BlobView const data, std::span<uint8_t> const buffer)
 {
-	++_sequence_number;
+	auto const packet_size = data.size() + data_margin();
 
-	// It's required that value_to_blob() gives little-endian encoding:
-	auto const binary_sequence_number = value_to_blob (_sequence_number);
-	auto const salt = random_blob (kDataSaltSize, _random_device);
-	auto const full_hmac = calculate_hmac<kSignatureHMACHashAlgorithm> ({
-		.data = data + salt + binary_sequence_number,
-		.key = _hmac_key,
-	});
+	if (buffer.size() < packet_size)
+		throw InvalidArgument ("buffer is too small for the encrypted packet");
 
-	if (full_hmac.size() < _hmac_size)
-		throw std::logic_error ("HMAC size doesn't fit requirements");
+	auto const packet = buffer.first (packet_size);
+	auto const binary_sequence_number = packet.first (kSequenceNumberSize);
+	auto const encrypted_data = packet.subspan (kSequenceNumberSize);
+	auto const plain_text = encrypted_data.first (data.size());
+	auto const salt = encrypted_data.subspan (data.size(), kDataSaltSize);
+	auto const hmac = encrypted_data.subspan (data.size() + kDataSaltSize);
 
-	auto const hmac = full_hmac.substr (0, _hmac_size);
-	auto const encrypted_data = aes_ctr_xor ({
-		.data = data + salt + hmac,
-		.key = _data_encryption_key,
-		.nonce = calculate_hash<kDataNonceHashAlgorithm> (binary_sequence_number).substr (0, 8),
-	});
-	auto const encrypted_sequence_number = aes_ctr_xor ({
-		.data = binary_sequence_number,
-		.key = _seq_num_encryption_key,
-		// Encrypted data must be at least 8 bytes, but longer is better for better entropy to avoid
-		// repeating nonce ever. That's why data salt is added before encryption.
-		.nonce = calculate_hash<kSeqNumNonceHashAlgorithm> (encrypted_data).substr (0, 8),
-	});
-	auto const encrypted_packet = encrypted_sequence_number + encrypted_data;
+	++_sequence_number;
+
+	// Data may already be in place:
+	if (!data.empty() && data.data() != plain_text.data())
+		std::memmove (plain_text.data(), data.data(), data.size());
+
+	fill_random (salt);
+	write_sequence_number (_sequence_number, binary_sequence_number);
+	_hmac.calculate ({ as_blob_view (plain_text), as_blob_view (salt), as_blob_view (binary_sequence_number) }, hmac);
+	xor_data (encrypted_data, as_blob_view (binary_sequence_number));
+	xor_sequence_number (binary_sequence_number, as_blob_view (encrypted_data));
 
 	++_sequence_number;
 
-	return encrypted_packet;
+	return packet;
+}
+
+
+void
+Transmitter::encrypt_packets (std::span<EncryptionJob> const jobs)
+{
+	for (auto const& job: jobs)
+		if (job.packet.size() < job.plain_text.size() + data_margin())
+			throw InvalidArgument ("buffer is too small for the encrypted packet");
+
+	for (auto& job: jobs)
+		job.packet = encrypt_packet_into (job.plain_text, job.packet);
+}
+
+
+void
+Transmitter::fill_random (std::span<uint8_t> const bytes)
+{
+	using Word = boost::random::random_device::result_type;
+
+	std::array<Word, (kDataSaltSize + sizeof (Word) - 1) / sizeof (Word)> random;
+	_random_device.generate (random.begin(), random.end());
+	std::memcpy (bytes.data(), random.data(), std::min (bytes.size(), sizeof (random)));
 }
 
 
 Blob
 Receiver::decrypt_packet (BlobView const encrypted_packet, std::optional<SequenceNumber> const maximum_allowed_sequence_number)
 {
-	auto const encrypted_sequence_number = encrypted_packet.substr (0, sizeof (_sequence_number));
-	auto const encrypted_data = encrypted_packet.substr (sizeof (_sequence_number));
-	auto const binary_sequence_number = aes_ctr_xor ({
-		.data = encrypted_sequence_number,
-		.key = _seq_num_encryption_key,
-		.nonce = calculate_hash<kSeqNumNonceHashAlgorithm> (encrypted_data).substr (0, 8),
-	});
-	auto const data_with_hmac = aes_ctr_xor ({
-		.data = encrypted_data,
-		.key = _data_encryption_key,
-		.nonce = calculate_hash<kDataNonceHashAlgorithm> (binary_sequence_number).substr (0, 8),
-	});
+	Blob packet (encrypted_packet);
+	auto const data = decrypt_packet_in_place (packet, maximum_allowed_sequence_number);
+	return Blob (data.begin(), data.end());
+}
+
+
+std::span<uint8_t>
+Receiver::decrypt_packet_in_place (std::span<uint8_t> const packet, std::optional<SequenceNumber> const maximum_allowed_sequence_number)
+{
+	std::span<uint8_t> plain_text;
+
+	if (auto const error = decrypt (packet, plain_text, maximum_allowed_sequence_number))
+		throw DecryptionFailure (*error, error_message (*error));
 
-	if (data_with_hmac.size() >= kDataSaltSize + _hmac_size)
+	return plain_text;
+}
+
+
+void
+Receiver::decrypt_packets (std::span<DecryptionJob> const jobs, std::optional<SequenceNumber> const maximum_allowed_sequence_number)
+{
+	for (auto& job: jobs)
 	{
-		auto data = BlobView (data_with_hmac);
-		auto salt = data;
-		auto hmac = data;
-		data.remove_suffix (kDataSaltSize + _hmac_size);
-		salt.remove_prefix (data.size());
-		salt.remove_suffix (_hmac_size);
-		hmac.remove_prefix (data.size() + kDataSaltSize);
-
-		auto const calculated_full_hmac = calculate_hmac<kSignatureHMACHashAlgorithm> ({
-			.data = Blob (data) + salt + binary_sequence_number,
-			.key = _hmac_key,
-		});
-		auto calculated_hmac = BlobView (calculated_full_hmac).substr (0, _hmac_size);
-
-		if (calculated_hmac == hmac)
-		{
-			SequenceNumber sequence_number;
-			blob_to_value (binary_sequence_number, sequence_number);
-
-			if (sequence_number <= _sequence_number)
-				throw DecryptionFailure (ErrorCode::SeqNumFromPast, "sequence number from past is invalid");
-
-			if (maximum_allowed_sequence_number)
-				if (sequence_number > *maximum_allowed_sequence_number)
-					throw DecryptionFailure (ErrorCode::SeqNumFromFarFuture, "sequence number from far future is invalid");
-
-			_sequence_number = sequence_number;
-
-			return Blob (data);
-		}
-		else
-			throw DecryptionFailure (ErrorCode::InvalidAuthentication, "invalid authentication");
+		job.plain_text = {};
+		job.error = decrypt (job.packet, job.plain_text, maximum_allowed_sequence_number);
 	}
-	else
-		throw DecryptionFailure (ErrorCode::HMACTooShort, "HMAC too short");
+}
+
+
+std::optional<Transport::ErrorCode>
+Receiver::decrypt (std::span<uint8_t> const packet, std::span<uint8_t>& plain_text, std::optional<SequenceNumber> const maximum_allowed_sequence_number)
+{
+	if (packet.size() < data_margin())
+		return HMACTooShort;
+
+	auto const binary_sequence_number = packet.first (kSequenceNumberSize);
+	auto const encrypted_data = packet.subspan (kSequenceNumberSize);
+
+	xor_sequence_number (binary_sequence_number, as_blob_view (encrypted_data));
+	xor_data (encrypted_data, as_blob_view (binary_sequence_number));
+
+	auto const data_size = encrypted_data.size() - kDataSaltSize - _hmac_size;
+	auto const data = encrypted_data.first (data_size);
+	auto const salt = encrypted_data.subspan (data_size, kDataSaltSize);
+	auto const hmac = encrypted_data.subspan (data_size + kDataSaltSize);
+
+	if (!_hmac.verify ({ as_blob_view (data), as_blob_view (salt), as_blob_view (binary_sequence_number) }, as_blob_view (hmac)))
+		return InvalidAuthentication;
+
+	auto const sequence_number = read_sequence_number (binary_sequence_number);
+
+	if (sequence_number <= _sequence_number)
+		return SeqNumFromPast;
+
+	if (maximum_allowed_sequence_number)
+		if (sequence_number > *maximum_allowed_sequence_number)
+			return SeqNumFromFarFuture;
+
+	_sequence_number = sequence_number;
+	plain_text = data;
+	return std::nullopt;
 }
 
 } // namespace xf::crypto::xle
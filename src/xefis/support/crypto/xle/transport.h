@@ -18,6 +18,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/support/crypto/mac.h>
 
 // Neutrino:
 #include <neutrino/crypto/hash.h>
@@ -26,21 +27,36 @@
 // Boost:
 #include <boost/random/random_device.hpp>
 
+// Crypto++:
+#include <cryptopp/aes.h>
+#include <cryptopp/modes.h>
+#include <cryptopp/sha3.h>
+
 // Standard:
 #include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
 
 
 namespace xf::crypto::xle {
 
 /**
  * Tool for packets encryption. Allows packets to be undelivered.
+ *
+ * Keys are derived once per session. Cipher key schedules and the keyed HMAC state are prepared
+ * in the constructor too, so that encrypting and decrypting into caller-supplied buffers doesn't
+ * allocate memory.
  */
 class Transport
 {
   public:
 	using SequenceNumber = uint64_t;
 
+	static constexpr size_t kSequenceNumberSize = sizeof (SequenceNumber);
 	static constexpr size_t kDataSaltSize = 8;
+	static constexpr size_t kNonceSize = 8;
 
 	enum ErrorCode
 	{
@@ -71,7 +87,10 @@ class Transport
 	static constexpr Hash::Algorithm const kSeqNumNonceHashAlgorithm = Hash::SHA3_256;
 
   public:
-	// Ctor
+	/**
+	 * \throw	InvalidArgument
+	 *			If hmac_size is larger than result of the HMAC function.
+	 */
 	explicit
 	Transport (BlobView ephemeral_session_key, size_t hmac_size = 12, BlobView key_salt = {}, BlobView hkdf_user_info = {});
 
@@ -81,19 +100,63 @@ class Transport
 	[[nodiscard]]
 	size_t
 	data_margin() const
-		{ return sizeof (SequenceNumber) + _hmac_size + kDataSaltSize; }
+		{ return kSequenceNumberSize + _hmac_size + kDataSaltSize; }
+
+	/**
+	 * Return message for given error code.
+	 */
+	[[nodiscard]]
+	static std::string_view
+	error_message (ErrorCode);
+
+  protected:
+	/**
+	 * XOR data (in place) with AES-CTR key stream of the data encryption key.
+	 */
+	void
+	xor_data (std::span<uint8_t> data, BlobView binary_sequence_number);
+
+	/**
+	 * XOR binary sequence number (in place) with AES-CTR key stream of the sequence number encryption key.
+	 */
+	void
+	xor_sequence_number (std::span<uint8_t> binary_sequence_number, BlobView encrypted_data);
+
+  private:
+	using Cipher = CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption;
+
+	/**
+	 * XOR data with key stream of the cipher, with nonce being first kNonceSize bytes of hash of the nonce_source.
+	 */
+	void
+	ctr_xor (Cipher&, std::span<uint8_t> data, BlobView nonce_source);
 
   protected:
-	size_t			_hmac_size;
-	Blob			_hmac_key;
-	Blob			_data_encryption_key;
-	Blob			_seq_num_encryption_key;
-	SequenceNumber	_sequence_number	{ 0 };
+	size_t				_hmac_size;
+	MAC					_hmac;
+	SequenceNumber		_sequence_number	{ 0 };
+
+  private:
+	Cipher				_data_cipher;
+	Cipher				_seq_num_cipher;
+	CryptoPP::SHA3_256	_nonce_hash;
 };
 
 
 class Transmitter: public Transport
 {
+  public:
+	/**
+	 * Packet for batch encryption.
+	 */
+	struct EncryptionJob
+	{
+		BlobView			plain_text;
+		// Buffer of at least plain_text.size() + data_margin() bytes.
+		// After encryption it's narrowed to the encrypted packet:
+		std::span<uint8_t>	packet;
+	};
+
   public:
 	// Ctor
 	explicit
@@ -110,6 +173,31 @@ class Transmitter: public Transport
 	Blob
 	encrypt_packet (BlobView);
 
+	/**
+	 * Encrypt next packet into given buffer, which must be at least data.size() + data_margin() bytes long.
+	 * Data may already be located in the buffer at offset kSequenceNumberSize, in which case it's encrypted
+	 * in place.
+	 *
+	 * \return	Part of the buffer containing the encrypted packet.
+	 * \throw	InvalidArgument
+	 *			If the buffer is too small.
+	 */
+	std::span<uint8_t>
+	encrypt_packet_into (BlobView data, std::span<uint8_t> buffer);
+
+	/**
+	 * Encrypt packets in order, same as calling encrypt_packet_into() for each of them.
+	 *
+	 * \throw	InvalidArgument
+	 *			If any of the buffers is too small. In such case no packet is encrypted.
+	 */
+	void
+	encrypt_packets (std::span<EncryptionJob>);
+
+  private:
+	void
+	fill_random (std::span<uint8_t>);
+
   private:
 	boost::random::random_device& _random_device;
 };
@@ -117,6 +205,19 @@ class Transmitter: public Transport
 
 class Receiver: public Transport
 {
+  public:
+	/**
+	 * Packet for batch decryption.
+	 */
+	struct DecryptionJob
+	{
+		// Encrypted packet, decrypted in place:
+		std::span<uint8_t>			packet;
+		// Set to decrypted data (part of the packet buffer) or to empty span on failure:
+		std::span<uint8_t>			plain_text;
+		std::optional<ErrorCode>	error;
+	};
+
   public:
 	// Ctor
 	using Transport::Transport;
@@ -127,6 +228,32 @@ class Receiver: public Transport
 	[[nodiscard]]
 	Blob
 	decrypt_packet (BlobView data, std::optional<SequenceNumber> maximum_allowed_sequence_number = {});
+
+	/**
+	 * Decrypt packet in place. If decryption fails, contents of the packet buffer are unspecified.
+	 *
+	 * \return	Part of the packet buffer containing the decrypted data.
+	 * \throw	DecryptionFailure
+	 */
+	[[nodiscard]]
+	std::span<uint8_t>
+	decrypt_packet_in_place (std::span<uint8_t> packet, std::optional<SequenceNumber> maximum_allowed_sequence_number = {});
+
+	/**
+	 * Decrypt packets in place, in order. Same as calling decrypt_packet_in_place() for each of them,
+	 * but errors are reported in the jobs instead of being thrown, so that one bad packet doesn't
+	 * stop processing of others.
+	 */
+	void
+	decrypt_packets (std::span<DecryptionJob>, std::optional<SequenceNumber> maximum_allowed_sequence_number = {});
+
+  private:
+	/**
+	 * Decrypt packet in place and set plain_text on success.
+	 */
+	[[nodiscard]]
+	std::optional<ErrorCode>
+	decrypt (std::span<uint8_t> packet, std::span<uint8_t>& plain_text, std::optional<SequenceNumber> maximum_allowed_sequence_number);
 };
 
 
@@ -0,0 +1,124 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__SUPPORT__INSTRUMENT__CACHED_LAYER_H__INCLUDED
+#define XEFIS__SUPPORT__INSTRUMENT__CACHED_LAYER_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/support/instrument/instrument_painter.h>
+#include <xefis/support/instrument/instrument_support.h>
+
+// Qt:
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+
+// Standard:
+#include <cmath>
+#include <cstddef>
+#include <optional>
+
+
+namespace xf {
+
+/**
+ * Offscreen image with artwork that doesn't change between frames except for its position/rotation,
+ * like scales and tapes of instruments. It's repainted only when its key changes; key should contain
+ * the canvas metric and all parameters that affect the artwork.
+ */
+template<class pKey>
+	class CachedLayer
+	{
+	  public:
+		using Key = pKey;
+
+	  public:
+		/**
+		 * Repaint the layer if key differs from the one used for last painting.
+		 *
+		 * \param	rect
+		 *			Extent of the layer in the coordinates used by the painting function.
+		 * \param	paint
+		 *			Function called with InstrumentPainter& to paint the layer.
+		 *			The painter is already translated, so that rect is mapped onto the image.
+		 * \return	true if layer has been repainted.
+		 */
+		template<class PaintFunction>
+			bool
+			update (Key const&, QRectF const& rect, PaintRequest const&, InstrumentSupport const&, PaintFunction&& paint);
+
+		/**
+		 * Draw the layer using painter's current transform and clipping.
+		 */
+		void
+		draw (QPainter&) const;
+
+		/**
+		 * Force repainting on next update().
+		 */
+		void
+		invalidate() noexcept
+			{ _key.reset(); }
+
+	  private:
+		std::optional<Key>	_key;
+		QRectF				_rect;
+		QImage				_image;
+	};
+
+
+template<class K>
+	template<class PaintFunction>
+		inline bool
+		CachedLayer<K>::update (Key const& key, QRectF const& rect, PaintRequest const& paint_request, InstrumentSupport const& instrument_support, PaintFunction&& paint)
+		{
+			if (_key && *_key == key)
+				return false;
+
+			QSize const size (std::ceil (rect.width()), std::ceil (rect.height()));
+
+			if (_image.size() != size)
+			{
+				int const dots_per_meter = paint_request.metric().pixel_density().in<si::DotsPerMeter>();
+				_image = QImage (size, QImage::Format_ARGB32_Premultiplied);
+				_image.setDotsPerMeterX (dots_per_meter);
+				_image.setDotsPerMeterY (dots_per_meter);
+			}
+
+			_image.fill (Qt::transparent);
+			_rect = rect;
+
+			{
+				auto painter = instrument_support.get_painter (_image);
+				painter.translate (-rect.topLeft());
+				paint (painter);
+			}
+
+			_key = key;
+			return true;
+		}
+
+
+template<class K>
+	inline void
+	CachedLayer<K>::draw (QPainter& painter) const
+	{
+		if (!_image.isNull())
+			painter.drawImage (_rect.topLeft(), _image);
+	}
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,187 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "digit_strip.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Standard:
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+
+namespace xf {
+
+bool
+DigitStrip::update (Key const& key, PaintRequest const& paint_request, InstrumentSupport const& instrument_support)
+{
+	return update (key, paint_request, instrument_support, [&key] (InstrumentPainter& painter, QRectF const& cell, QString const& symbol) {
+		painter.fast_draw_text (cell, key.alignment, symbol);
+	});
+}
+
+
+DigitStrip::Cell
+DigitStrip::digit_cell (int const digit) const noexcept
+{
+	// Cell 0 is the wrap digit, then digits go from the highest one down:
+	return _digit_cells - digit / _step;
+}
+
+
+DigitStrip::Cell
+DigitStrip::symbol_cell (int const index) const noexcept
+{
+	return _digit_cells + 2 + index;
+}
+
+
+void
+DigitStrip::draw (QPainter& painter, QRectF const& rect, float const position, Cell next, Cell const curr, Cell prev) const
+{
+	if (_image.isNull())
+		return;
+
+	auto const n_symbols = static_cast<Cell> (_symbols.size());
+
+	// Use wrap cells when going 9 → 0 or 0 → 9, so that neighbours are consecutive:
+	if (curr != kBlank && next != kBlank && curr > 0 && next != curr - 1 && _symbols[next] == _symbols[curr - 1])
+		next = curr - 1;
+
+	if (curr != kBlank && prev != kBlank && curr + 1 < n_symbols && prev != curr + 1 && _symbols[prev] == _symbols[curr + 1])
+		prev = curr + 1;
+
+	float const pitch = _cell_size.height();
+	float const center_y = rect.center().y() - position * pitch;
+	std::array<Cell, 3> const cells { next, curr, prev };
+
+	// Draw each run of consecutive cells with one blit:
+	for (std::size_t i = 0; i < cells.size(); )
+	{
+		if (cells[i] == kBlank)
+		{
+			++i;
+			continue;
+		}
+
+		std::size_t j = i;
+
+		while (j + 1 < cells.size() && cells[j + 1] != kBlank && cells[j + 1] == cells[j] + 1)
+			++j;
+
+		draw_run (painter, rect, center_y + (static_cast<float> (i) - 1.f) * pitch, cells[i], cells[j]);
+		i = j + 1;
+	}
+}
+
+
+void
+DigitStrip::prepare (Key const& key, PaintRequest const& paint_request)
+{
+	if (key.step <= 0 || 10 % key.step != 0)
+		throw InvalidArgument ("DigitStrip: step must divide 10");
+
+	_step = key.step;
+	_digit_cells = 10 / key.step;
+	_cell_size = key.cell_size;
+	_symbols.clear();
+	_symbols.reserve (_digit_cells + 2 + key.extra_symbols.size());
+
+	auto const digit_symbol = [&key] (int digit) {
+		return QString::number (digit) + key.suffix;
+	};
+
+	_symbols.push_back (digit_symbol (0));
+
+	for (int digit = 10 - key.step; digit >= 0; digit -= key.step)
+		_symbols.push_back (digit_symbol (digit));
+
+	_symbols.push_back (digit_symbol (10 - key.step));
+
+	for (auto const& symbol: key.extra_symbols)
+		_symbols.push_back (symbol);
+
+	_variant_width = static_cast<int> (std::ceil (key.cell_size.width()));
+	// One pixel more for the sub-pixel shift of variants:
+	QSize const size (Rank * _variant_width, static_cast<int> (std::ceil (_symbols.size() * key.cell_size.height())) + 1);
+
+	if (_image.size() != size)
+	{
+		int const dots_per_meter = paint_request.metric().pixel_density().in<si::DotsPerMeter>();
+		_image = QImage (size, QImage::Format_ARGB32_Premultiplied);
+		_image.setDotsPerMeterX (dots_per_meter);
+		_image.setDotsPerMeterY (dots_per_meter);
+	}
+
+	_image.fill (Qt::transparent);
+}
+
+
+QRectF
+DigitStrip::cell_rect (Cell const cell, int const variant) const noexcept
+{
+	float const pitch = _cell_size.height();
+	return QRectF (variant * _variant_width, cell * pitch + static_cast<float> (variant) / Rank, _cell_size.width(), pitch);
+}
+
+
+void
+DigitStrip::draw_run (QPainter& painter, QRectF const& rect, float const center_y, Cell const first, Cell const last) const
+{
+	float const pitch = _cell_size.height();
+	// Painter's y-coordinate of the top of the strip:
+	float const strip_top = center_y - (first + 0.5f) * pitch;
+	QTransform const transform = painter.transform();
+
+	painter.save();
+	painter.setClipRect (rect, Qt::IntersectClip);
+
+	if (transform.type() <= QTransform::TxTranslate)
+	{
+		// Blit in device coordinates, choosing the variant that matches the fractional part of the position:
+		float const device_top = strip_top + transform.dy();
+		float whole = std::floor (device_top);
+		int variant = static_cast<int> (std::round ((device_top - whole) * Rank));
+
+		if (variant == Rank)
+		{
+			variant = 0;
+			whole += 1.f;
+		}
+
+		int const source_top = static_cast<int> (std::floor (cell_rect (first, variant).top()));
+		int const source_bottom = static_cast<int> (std::ceil (cell_rect (last, variant).bottom()));
+		QPoint const target (static_cast<int> (std::round (rect.left() + transform.dx())), static_cast<int> (whole) + source_top);
+
+		painter.resetTransform();
+		painter.drawImage (target, _image, QRect (variant * _variant_width, source_top, _variant_width, source_bottom - source_top));
+	}
+	else
+	{
+		// Let Qt transform the image:
+		int const source_top = static_cast<int> (std::floor (cell_rect (first, 0).top()));
+		int const source_bottom = static_cast<int> (std::ceil (cell_rect (last, 0).bottom()));
+		QRectF const source (0, source_top, _variant_width, source_bottom - source_top);
+
+		painter.setRenderHint (QPainter::SmoothPixmapTransform, true);
+		painter.drawImage (QRectF (QPointF (rect.left(), strip_top + source_top), source.size()), _image, source);
+	}
+
+	painter.restore();
+}
+
+} // namespace xf
+
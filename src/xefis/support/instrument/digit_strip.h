@@ -0,0 +1,201 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__SUPPORT__INSTRUMENT__DIGIT_STRIP_H__INCLUDED
+#define XEFIS__SUPPORT__INSTRUMENT__DIGIT_STRIP_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/support/instrument/instrument_painter.h>
+#include <xefis/support/instrument/instrument_support.h>
+
+// Qt:
+#include <QtGui/QColor>
+#include <QtGui/QFont>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+
+// Standard:
+#include <cmath>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+
+namespace xf {
+
+/**
+ * Pre-rendered vertical strip of digits for rotating (drum) readouts, like the speed and altitude
+ * counters of the ADI. Instead of painting texts of the drum every frame, the drum is drawn with
+ * one clipped blit from the strip.
+ *
+ * The strip contains cells of equal height (the drum pitch), top to bottom: the wrap digit 0,
+ * digits 9…0, the wrap digit 9 (so that 9 is followed by 0 and vice versa without a seam) and
+ * then optional extra symbols. Digits may go in larger steps (eg. 0, 2, 4, … with suffix "0" for
+ * a 20-ft altitude drum). Each cell is clipped to its own box.
+ *
+ * The strip is rendered in Rank vertical sub-pixel variants, so that the drum moves smoothly.
+ * Horizontal position is rounded to whole pixels, since drums don't move horizontally.
+ */
+class DigitStrip
+{
+  public:
+	// Index of a cell in the strip:
+	using Cell = int;
+
+	// Number of vertical sub-pixel variants:
+	static constexpr int	Rank	= 4;
+	// Cell that is not painted at all:
+	static constexpr Cell	kBlank	= -1;
+
+	/**
+	 * Everything that affects the look of the strip.
+	 */
+	class Key
+	{
+	  public:
+		QFont			font;
+		QColor			color;
+		// Width of the drum window and height of one cell (drum pitch):
+		QSizeF			cell_size;
+		Qt::Alignment	alignment		{ Qt::AlignVCenter | Qt::AlignLeft };
+		// Difference between digits in adjacent cells, must divide 10:
+		int				step			{ 1 };
+		// Text appended to each digit:
+		QString			suffix;
+		// Additional non-digit symbols, placed after digits:
+		QStringList		extra_symbols;
+
+	  public:
+		bool
+		operator== (Key const&) const = default;
+	};
+
+  public:
+	/**
+	 * Rerender the strip if key differs from the one used last time or if canvas size has changed.
+	 *
+	 * \param	paint
+	 *			Function called as paint (InstrumentPainter&, QRectF const& cell, QString const& symbol)
+	 *			to paint each cell. The painter has key's font and pen color already set and is clipped
+	 *			to the cell.
+	 * \return	true if the strip has been rerendered.
+	 */
+	template<class PaintFunction>
+		bool
+		update (Key const&, PaintRequest const&, InstrumentSupport const&, PaintFunction&& paint);
+
+	/**
+	 * Same as update() above, but paint each cell as text aligned according to key's alignment.
+	 */
+	bool
+	update (Key const&, PaintRequest const&, InstrumentSupport const&);
+
+	/**
+	 * Force rerendering on next update().
+	 */
+	void
+	invalidate() noexcept
+		{ _key.reset(); }
+
+	/**
+	 * Return cell for given digit. Digit must be in range [0, 10) and be a multiple of key's step.
+	 */
+	[[nodiscard]]
+	Cell
+	digit_cell (int digit) const noexcept;
+
+	/**
+	 * Return cell for extra symbol with given index in Key::extra_symbols.
+	 */
+	[[nodiscard]]
+	Cell
+	symbol_cell (int index) const noexcept;
+
+	/**
+	 * Draw a drum into rect with painter's current transform and clipping. Cells are positioned as
+	 * next above curr above prev, with curr centered in rect when position is 0. Positive position
+	 * (in cells) moves the drum up.
+	 *
+	 * Consecutive cells are drawn with a single blit; wrap-around between 9 and 0 is handled.
+	 * Any of cells may be kBlank.
+	 */
+	void
+	draw (QPainter&, QRectF const& rect, float position, Cell next, Cell curr, Cell prev) const;
+
+  private:
+	/**
+	 * Set up symbols and allocate the image for given key. Doesn't update _key.
+	 */
+	void
+	prepare (Key const&, PaintRequest const&);
+
+	/**
+	 * Return rect of given cell in given sub-pixel variant.
+	 */
+	[[nodiscard]]
+	QRectF
+	cell_rect (Cell, int variant) const noexcept;
+
+	/**
+	 * Draw cells first…last so that the center of first is placed at center_y (in painter coordinates).
+	 */
+	void
+	draw_run (QPainter&, QRectF const& rect, float center_y, Cell first, Cell last) const;
+
+  private:
+	std::optional<Key>		_key;
+	std::vector<QString>	_symbols;
+	QSizeF					_cell_size;
+	int						_step			{ 1 };
+	int						_digit_cells	{ 0 };
+	int						_variant_width	{ 0 };
+	QImage					_image;
+};
+
+
+template<class PaintFunction>
+	inline bool
+	DigitStrip::update (Key const& key, PaintRequest const& paint_request, InstrumentSupport const& instrument_support, PaintFunction&& paint)
+	{
+		if (_key && *_key == key && !paint_request.size_changed())
+			return false;
+
+		prepare (key, paint_request);
+
+		auto painter = instrument_support.get_painter (_image);
+		painter.setFont (key.font);
+		painter.setPen (key.color);
+
+		for (int variant = 0; variant < Rank; ++variant)
+		{
+			for (Cell cell = 0; cell < static_cast<Cell> (_symbols.size()); ++cell)
+			{
+				QRectF const rect = cell_rect (cell, variant);
+
+				painter.save_context ([&] {
+					painter.setClipRect (rect);
+					paint (painter, rect, _symbols[cell]);
+				});
+			}
+		}
+
+		_key = key;
+		return true;
+	}
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,387 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "glyph_atlas.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Qt:
+#include <QtGui/QFontMetricsF>
+#include <QtGui/QPainter>
+#include <QtGui/QPainterPath>
+
+// Standard:
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+
+namespace xf {
+
+static std::size_t
+page_bytes (GlyphAtlas::Page const& page)
+{
+	return static_cast<std::size_t> (page.image.bytesPerLine()) * page.image.height();
+}
+
+
+void
+GlyphAtlas::Index::insert (GlyphKey key, std::shared_ptr<Glyph const> glyph)
+{
+	// Keep load factor at most 0.5:
+	if (2 * (_size + 1) > _slots.size())
+		rehash (std::max<std::size_t> (64, 2 * _slots.size()));
+
+	std::size_t const mask = _slots.size() - 1;
+
+	for (std::size_t i = hash (key) & mask; ; i = (i + 1) & mask)
+	{
+		auto& slot = _slots[i];
+
+		if (!slot.glyph)
+		{
+			slot.key = key;
+			slot.glyph = std::move (glyph);
+			++_size;
+			return;
+		}
+		else if (slot.key == key)
+		{
+			slot.glyph = std::move (glyph);
+			return;
+		}
+	}
+}
+
+
+void
+GlyphAtlas::Index::erase_page (Page const* page)
+{
+	auto old_slots = std::move (_slots);
+	_slots.assign (old_slots.size(), Slot());
+	_size = 0;
+
+	for (auto& slot: old_slots)
+		if (slot.glyph && slot.glyph->page.get() != page)
+			insert (slot.key, std::move (slot.glyph));
+}
+
+
+void
+GlyphAtlas::Index::clear()
+{
+	_slots.clear();
+	_size = 0;
+}
+
+
+void
+GlyphAtlas::Index::rehash (std::size_t new_capacity)
+{
+	auto old_slots = std::move (_slots);
+	_slots.assign (new_capacity, Slot());
+	_size = 0;
+
+	for (auto& slot: old_slots)
+		if (slot.glyph)
+			insert (slot.key, std::move (slot.glyph));
+}
+
+
+GlyphAtlas::GlyphAtlas (std::size_t memory_budget):
+	_memory_budget (memory_budget)
+{ }
+
+
+GlyphAtlas&
+GlyphAtlas::shared()
+{
+	static GlyphAtlas atlas;
+	return atlas;
+}
+
+
+GlyphAtlas::FontID
+GlyphAtlas::font_id (FontKey const& font_key)
+{
+	std::lock_guard lock (_mutex);
+
+	if (auto it = std::find (_fonts.begin(), _fonts.end(), font_key); it != _fonts.end())
+		return static_cast<FontID> (std::distance (_fonts.begin(), it));
+
+	_fonts.push_back (font_key);
+	return static_cast<FontID> (_fonts.size() - 1);
+}
+
+
+std::shared_ptr<GlyphAtlas::Glyph const>
+GlyphAtlas::get (FontID font_id, QChar character)
+{
+	auto const key = glyph_key (font_id, character);
+	FontKey font_key;
+
+	{
+		std::lock_guard lock (_mutex);
+
+		if (auto const* glyph = _index.find (key))
+			return *glyph;
+
+		font_key = _fonts.at (font_id);
+	}
+
+	// Render without holding the lock, so that other painters can use the atlas meanwhile:
+	QSize variant_size;
+	QImage const block = render (font_key, character, variant_size);
+
+	std::lock_guard lock (_mutex);
+
+	// Some other thread might have been faster:
+	if (auto const* glyph = _index.find (key))
+		return *glyph;
+
+	auto [page, origin] = allocate (block.size());
+
+	for (int y = 0; y < block.height(); ++y)
+	{
+		auto* const target = page->bits + (origin.y() + y) * page->image.bytesPerLine() + origin.x() * sizeof (QRgb);
+		std::memcpy (target, block.constScanLine (y), block.width() * sizeof (QRgb));
+	}
+
+	auto glyph = std::make_shared<Glyph>();
+	glyph->page = std::move (page);
+	glyph->origin = origin;
+	glyph->size = variant_size;
+	glyph->touch (_tick.fetch_add (1, std::memory_order_relaxed) + 1);
+
+	_index.insert (key, glyph);
+	++_renders;
+
+	return glyph;
+}
+
+
+void
+GlyphAtlas::prewarm (FontKey const& font_key, QString const& characters)
+{
+	auto const id = font_id (font_key);
+
+	for (auto const c: characters)
+		(void) get (id, c);
+}
+
+
+void
+GlyphAtlas::set_memory_budget (std::size_t bytes)
+{
+	std::lock_guard lock (_mutex);
+	_memory_budget = bytes;
+	evict (0);
+}
+
+
+void
+GlyphAtlas::clear()
+{
+	std::lock_guard lock (_mutex);
+	_index.clear();
+	_pages.clear();
+	_fill_page.reset();
+	_generation.fetch_add (1, std::memory_order_release);
+}
+
+
+GlyphAtlas::Statistics
+GlyphAtlas::statistics() const
+{
+	std::lock_guard lock (_mutex);
+
+	return {
+		.pages = _pages.size(),
+		.glyphs = _index.size(),
+		.memory_usage = memory_usage(),
+		.memory_budget = _memory_budget,
+		.renders = _renders,
+		.evictions = _evictions,
+	};
+}
+
+
+QImage
+GlyphAtlas::render (FontKey const& font_key, QChar character, QSize& variant_size)
+{
+	QFontMetricsF metrics (font_key.font);
+	QPointF const position_correction (font_key.position_correction.x() * metrics.width ("0"),
+									   font_key.position_correction.y() * metrics.height());
+	variant_size = QSize (std::ceil (metrics.width (character)) + 1, std::ceil (metrics.height()) + 1);
+	QColor const color = QColor::fromRgba (font_key.color);
+
+	QImage block (variant_size * Rank, QImage::Format_ARGB32_Premultiplied);
+	block.fill (Qt::transparent);
+
+	QPainter painter (&block);
+	painter.setRenderHint (QPainter::Antialiasing, true);
+	painter.setRenderHint (QPainter::TextAntialiasing, true);
+	painter.setRenderHint (QPainter::SmoothPixmapTransform, true);
+
+	QPen shadow_pen = painter.pen();
+	bool const has_shadow = font_key.shadow_width > 0.0f;
+
+	if (has_shadow)
+	{
+		QColor shadow_color = color.darker (800);
+		shadow_color.setAlpha (100);
+		shadow_pen.setColor (shadow_color);
+		shadow_pen.setWidthF (font_key.shadow_width);
+	}
+
+	for (int x = 0; x < Rank; ++x)
+	{
+		float const fx = 1.f * x / Rank;
+
+		for (int y = 0; y < Rank; ++y)
+		{
+			float const fy = 1.f * y / Rank;
+
+			QRectF const variant_rect (QPointF (x * variant_size.width(), y * variant_size.height()), variant_size);
+			QPointF position (variant_rect.left() + fx, variant_rect.top() + fy + metrics.ascent());
+			position += position_correction;
+			QPainterPath glyph_path;
+			glyph_path.addText (position, font_key.font, character);
+
+			if (has_shadow)
+			{
+				QPainterPath clip_path;
+				clip_path.addRect (variant_rect);
+				clip_path -= glyph_path;
+
+				painter.setClipPath (clip_path);
+				painter.setPen (shadow_pen);
+				painter.setBrush (Qt::NoBrush);
+				painter.drawPath (glyph_path);
+			}
+
+			// Don't let the glyph leak into neighbouring variants:
+			painter.setClipRect (variant_rect);
+			painter.setPen (Qt::NoPen);
+			painter.setBrush (color);
+			painter.drawPath (glyph_path);
+		}
+	}
+
+	return block;
+}
+
+
+std::pair<std::shared_ptr<GlyphAtlas::Page>, QPoint>
+GlyphAtlas::allocate (QSize block_size)
+{
+	// Blocks that don't fit on a standard page get a dedicated one:
+	if (block_size.width() > kPageSize || block_size.height() > kPageSize)
+	{
+		auto page = new_page (block_size);
+		page->full = true;
+		return { page, QPoint (0, 0) };
+	}
+
+	if (_fill_page)
+	{
+		auto& page = *_fill_page;
+
+		// Start new shelf:
+		if (page.cursor + block_size.width() > kPageSize)
+		{
+			page.shelf_top += page.shelf_height;
+			page.shelf_height = 0;
+			page.cursor = 0;
+		}
+
+		if (page.shelf_top + block_size.height() <= kPageSize)
+		{
+			QPoint const position (page.cursor, page.shelf_top);
+			page.cursor += block_size.width();
+			page.shelf_height = std::max (page.shelf_height, block_size.height());
+			return { _fill_page, position };
+		}
+
+		page.full = true;
+	}
+
+	auto page = new_page (QSize (kPageSize, kPageSize));
+	page->cursor = block_size.width();
+	page->shelf_height = block_size.height();
+	_fill_page = page;
+
+	return { page, QPoint (0, 0) };
+}
+
+
+std::shared_ptr<GlyphAtlas::Page>
+GlyphAtlas::new_page (QSize size)
+{
+	auto page = std::make_shared<Page>();
+	page->image = QImage (size, QImage::Format_ARGB32_Premultiplied);
+	page->image.fill (Qt::transparent);
+	page->bits = page->image.bits();
+	page->last_use.store (tick(), std::memory_order_relaxed);
+
+	evict (page_bytes (*page));
+	_pages.push_back (page);
+
+	return page;
+}
+
+
+void
+GlyphAtlas::evict (std::size_t additional_bytes)
+{
+	auto usage = memory_usage();
+	bool evicted = false;
+
+	while (!_pages.empty() && usage + additional_bytes > _memory_budget)
+	{
+		auto const lru = std::min_element (_pages.begin(), _pages.end(), [](auto const& a, auto const& b) {
+			return a->last_use.load (std::memory_order_relaxed) < b->last_use.load (std::memory_order_relaxed);
+		});
+
+		usage -= page_bytes (**lru);
+		_index.erase_page (lru->get());
+
+		if (*lru == _fill_page)
+			_fill_page.reset();
+
+		_pages.erase (lru);
+		++_evictions;
+		evicted = true;
+	}
+
+	if (evicted)
+		_generation.fetch_add (1, std::memory_order_release);
+}
+
+
+std::size_t
+GlyphAtlas::memory_usage() const
+{
+	std::size_t sum = 0;
+
+	for (auto const& page: _pages)
+		sum += page_bytes (*page);
+
+	return sum;
+}
+
+} // namespace xf
+
@@ -0,0 +1,362 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__SUPPORT__INSTRUMENT__GLYPH_ATLAS_H__INCLUDED
+#define XEFIS__SUPPORT__INSTRUMENT__GLYPH_ATLAS_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Qt:
+#include <QtGui/QColor>
+#include <QtGui/QFont>
+#include <QtGui/QImage>
+
+// Standard:
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+
+namespace xf {
+
+/**
+ * Process-wide store of pre-rendered glyphs used by TextPainter.
+ *
+ * Each glyph is rendered in Rank×Rank sub-pixel positions. All variants of a glyph are packed as one block
+ * into large page images, so that drawing a glyph is a single drawImage() from a page. Glyphs are looked up
+ * by a 64-bit key made of the font ID (font, color, shadow width and position correction) and the character.
+ *
+ * Memory is bounded by a budget: when a new page would exceed it, least recently used pages are evicted
+ * along with their glyphs. Each eviction bumps generation(), which tells thread-local TextPainter::Caches
+ * to drop their references. Pages are reference-counted, so painters that still hold an evicted glyph can
+ * finish drawing it safely.
+ *
+ * All methods are thread-safe. Lookups and rendering lock an internal mutex; painters are supposed to
+ * keep their own lock-free front index (see TextPainter::Cache) and only call get() on a miss.
+ */
+class GlyphAtlas
+{
+  public:
+	// Number of sub-pixel positions in each axis:
+	static constexpr int			Rank					= 8;
+	static constexpr int			kPageSize				= 1024;
+	static constexpr std::size_t	kDefaultMemoryBudget	= 64 * 1024 * 1024;
+
+	using FontID	= uint32_t;
+	using GlyphKey	= uint64_t;
+
+	/**
+	 * Everything that affects how glyphs of a font look, except the character itself.
+	 */
+	class FontKey
+	{
+	  public:
+		QFont	font;
+		QRgb	color;
+		float	shadow_width;
+		QPointF	position_correction;
+
+	  public:
+		bool
+		operator== (FontKey const&) const;
+	};
+
+	class Page
+	{
+	  public:
+		QImage					image;
+		// Obtained once when page is created; new glyphs are written through this pointer,
+		// so that the atlas never calls non-const QImage methods while painters read the image:
+		uchar*					bits			{ nullptr };
+		// Shelf packer state:
+		int						shelf_top		{ 0 };
+		int						shelf_height	{ 0 };
+		int						cursor			{ 0 };
+		bool					full			{ false };
+		// Last value of GlyphAtlas::tick() when a glyph from this page was drawn:
+		std::atomic<uint64_t>	last_use		{ 0 };
+	};
+
+	class Glyph
+	{
+	  public:
+		std::shared_ptr<Page>	page;
+		// Top-left corner of the block of variants:
+		QPoint					origin;
+		// Size of a single variant:
+		QSize					size;
+
+	  public:
+		/**
+		 * Return rect of the variant for given sub-pixel offsets (both in range [0, Rank)).
+		 */
+		[[nodiscard]]
+		QRect
+		variant_rect (int dx, int dy) const noexcept;
+
+		/**
+		 * Mark glyph's page as recently used.
+		 */
+		void
+		touch (uint64_t tick) const noexcept;
+	};
+
+	/**
+	 * Flat (open-addressing) hash map GlyphKey → Glyph.
+	 */
+	class Index
+	{
+	  public:
+		/**
+		 * Return glyph or nullptr if not found.
+		 */
+		[[nodiscard]]
+		std::shared_ptr<Glyph const> const*
+		find (GlyphKey) const noexcept;
+
+		void
+		insert (GlyphKey, std::shared_ptr<Glyph const>);
+
+		/**
+		 * Remove glyphs that belong to given page.
+		 */
+		void
+		erase_page (Page const*);
+
+		void
+		clear();
+
+		[[nodiscard]]
+		std::size_t
+		size() const noexcept
+			{ return _size; }
+
+	  private:
+		struct Slot
+		{
+			GlyphKey						key		{ 0 };
+			std::shared_ptr<Glyph const>	glyph;
+		};
+
+		[[nodiscard]]
+		static std::size_t
+		hash (GlyphKey) noexcept;
+
+		void
+		rehash (std::size_t new_capacity);
+
+	  private:
+		std::vector<Slot>	_slots;
+		std::size_t			_size	{ 0 };
+	};
+
+	class Statistics
+	{
+	  public:
+		std::size_t	pages			{ 0 };
+		std::size_t	glyphs			{ 0 };
+		std::size_t	memory_usage	{ 0 };
+		std::size_t	memory_budget	{ 0 };
+		std::size_t	renders			{ 0 };
+		std::size_t	evictions		{ 0 };
+	};
+
+  public:
+	// Ctor
+	explicit
+	GlyphAtlas (std::size_t memory_budget = kDefaultMemoryBudget);
+
+	/**
+	 * Return the process-wide atlas.
+	 */
+	[[nodiscard]]
+	static GlyphAtlas&
+	shared();
+
+	/**
+	 * Make a key for given font ID and character.
+	 */
+	[[nodiscard]]
+	static constexpr GlyphKey
+	glyph_key (FontID, QChar) noexcept;
+
+	/**
+	 * Return ID for given font key, registering it if needed.
+	 * IDs are never reused, even if all glyphs of a font get evicted.
+	 */
+	[[nodiscard]]
+	FontID
+	font_id (FontKey const&);
+
+	/**
+	 * Return glyph, render it if it's not in the atlas.
+	 */
+	[[nodiscard]]
+	std::shared_ptr<Glyph const>
+	get (FontID, QChar);
+
+	/**
+	 * Render given characters in advance.
+	 */
+	void
+	prewarm (FontKey const&, QString const& characters);
+
+	/**
+	 * Increased on every eviction. Glyph pointers obtained from get() are valid in the atlas
+	 * until generation changes.
+	 */
+	[[nodiscard]]
+	uint64_t
+	generation() const noexcept
+		{ return _generation.load (std::memory_order_acquire); }
+
+	/**
+	 * LRU clock, increased every time a glyph is rendered.
+	 */
+	[[nodiscard]]
+	uint64_t
+	tick() const noexcept
+		{ return _tick.load (std::memory_order_relaxed); }
+
+	/**
+	 * Set memory budget for pages. Evicts pages if needed.
+	 */
+	void
+	set_memory_budget (std::size_t bytes);
+
+	/**
+	 * Remove all glyphs.
+	 */
+	void
+	clear();
+
+	[[nodiscard]]
+	Statistics
+	statistics() const;
+
+  private:
+	/**
+	 * Render all variants of a glyph into one block image.
+	 */
+	[[nodiscard]]
+	static QImage
+	render (FontKey const&, QChar, QSize& variant_size);
+
+	/**
+	 * Find space for a block of given size, allocating a page if needed.
+	 * Return page and top-left corner of the space.
+	 */
+	[[nodiscard]]
+	std::pair<std::shared_ptr<Page>, QPoint>
+	allocate (QSize block_size);
+
+	/**
+	 * Create new page, evicting old ones if needed.
+	 */
+	[[nodiscard]]
+	std::shared_ptr<Page>
+	new_page (QSize);
+
+	/**
+	 * Evict least recently used pages until additional_bytes fit into the budget.
+	 */
+	void
+	evict (std::size_t additional_bytes);
+
+	[[nodiscard]]
+	std::size_t
+	memory_usage() const;
+
+  private:
+	std::mutex mutable					_mutex;
+	std::size_t							_memory_budget;
+	std::vector<FontKey>				_fonts;
+	std::vector<std::shared_ptr<Page>>	_pages;
+	std::shared_ptr<Page>				_fill_page;
+	Index								_index;
+	std::size_t							_renders		{ 0 };
+	std::size_t							_evictions		{ 0 };
+	std::atomic<uint64_t>				_generation		{ 0 };
+	std::atomic<uint64_t>				_tick			{ 1 };
+};
+
+
+inline bool
+GlyphAtlas::FontKey::operator== (FontKey const& other) const
+{
+	return color == other.color
+		&& shadow_width == other.shadow_width
+		&& position_correction == other.position_correction
+		&& font == other.font;
+}
+
+
+inline QRect
+GlyphAtlas::Glyph::variant_rect (int dx, int dy) const noexcept
+{
+	return QRect (origin + QPoint (dx * size.width(), dy * size.height()), size);
+}
+
+
+inline void
+GlyphAtlas::Glyph::touch (uint64_t tick) const noexcept
+{
+	// Avoid writing to the shared cache line if not needed:
+	if (page->last_use.load (std::memory_order_relaxed) != tick)
+		page->last_use.store (tick, std::memory_order_relaxed);
+}
+
+
+inline std::shared_ptr<GlyphAtlas::Glyph const> const*
+GlyphAtlas::Index::find (GlyphKey key) const noexcept
+{
+	if (_slots.empty())
+		return nullptr;
+
+	std::size_t const mask = _slots.size() - 1;
+
+	for (std::size_t i = hash (key) & mask; ; i = (i + 1) & mask)
+	{
+		auto const& slot = _slots[i];
+
+		if (!slot.glyph)
+			return nullptr;
+		else if (slot.key == key)
+			return &slot.glyph;
+	}
+}
+
+
+inline std::size_t
+GlyphAtlas::Index::hash (GlyphKey key) noexcept
+{
+	// Fibonacci hashing, take the high bits:
+	return (key * 0x9e3779b97f4a7c15ull) >> 32;
+}
+
+
+constexpr GlyphAtlas::GlyphKey
+GlyphAtlas::glyph_key (FontID font_id, QChar character) noexcept
+{
+	return (static_cast<GlyphKey> (font_id) << 16) | character.unicode();
+}
+
+} // namespace xf
+
+#endif
+
@@ -16,6 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/support/instrument/instrument_painter.h>
 
 // Standard:
 #include <cstddef>
@@ -90,6 +91,29 @@ InstrumentAids::resized (QFont const& font, FontPixelSize font_pixel_size)
 }
 
 
+void
+InstrumentAids::prewarm_glyph_atlas (GlyphAtlas& atlas) const
+{
+	// Only white glyphs are prewarmed; each combination of font, color and shadow costs
+	// Rank² images per character, so prewarming everything would exhaust the atlas budget.
+	auto const characters = QString::fromUtf8 ("0123456789.:-") + QString::fromUtf8 (kMinusSignStrUTF8);
+	auto const shadow = default_shadow();
+
+	// Paint with a real InstrumentPainter, so that glyph keys are exactly the same as used by instruments:
+	QImage scratch (1, 1, QImage::Format_ARGB32_Premultiplied);
+	TextPainter::Cache cache (atlas);
+	InstrumentPainter painter (scratch, cache);
+	painter.setPen (get_pen (Qt::white, 1.0f));
+
+	for (auto const* font_info: { &font_0, &font_1, &font_2, &font_3, &font_4, &font_5 })
+	{
+		painter.setFont (font_info->font);
+		painter.fast_draw_text (QPointF (0.0f, 0.0f), characters);
+		painter.fast_draw_text (QPointF (0.0f, 0.0f), characters, shadow);
+	}
+}
+
+
 QFont
 InstrumentAids::scaled_default_font (float scale) const
 {
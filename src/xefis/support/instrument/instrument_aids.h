@@ -18,6 +18,7 @@
 #include <xefis/config/all.h>
 #include <xefis/core/graphics.h>
 #include <xefis/core/screen.h>
+#include <xefis/support/instrument/glyph_atlas.h>
 #include <xefis/support/instrument/shadow.h>
 #include <xefis/utility/types.h>
 
@@ -182,6 +183,13 @@ class InstrumentAids
 	Shadow
 	default_shadow() const;
 
+	/**
+	 * Render commonly used glyphs (digits and signs in all font sizes, with and without default shadow)
+	 * into the atlas, so that first frames don't have to.
+	 */
+	void
+	prewarm_glyph_atlas (GlyphAtlas&) const;
+
   private:
 	Graphics const&					_graphics;
 	std::optional<WidthForHeight>	_aspect_ratio;
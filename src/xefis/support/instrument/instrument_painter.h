@@ -24,6 +24,7 @@
 
 // Standard:
 #include <cstddef>
+#include <optional>
 
 
 namespace xf {
@@ -45,8 +46,23 @@ class InstrumentPainter:
 	 */
 	void
 	save_context (std::function<void()> paint_callback);
+
+	/**
+	 * Don't paint given shadow with primitives nor texts; the caller will add it to the whole
+	 * painted image with RasterShadow.
+	 */
+	void
+	set_deferred_shadow (std::optional<Shadow> shadow);
 };
 
+
+inline void
+InstrumentPainter::set_deferred_shadow (std::optional<Shadow> shadow)
+{
+	TextPainter::set_deferred_shadow (shadow);
+	ShadowPainter::set_deferred_shadow (shadow);
+}
+
 } // namespace xf
 
 #endif
@@ -62,6 +62,13 @@ class InstrumentSupport
 	InstrumentPainter
 	get_painter (PaintRequest const&) const;
 
+	/**
+	 * Return an instrument painter for painting on an auxiliary device,
+	 * like an offscreen layer. Shares caches with painters returned for PaintRequests.
+	 */
+	InstrumentPainter
+	get_painter (QPaintDevice&) const;
+
   private:
 	void
 	update_cache (PaintRequest const&, Data&) const;
@@ -103,6 +110,13 @@ InstrumentSupport::get_painter (PaintRequest const& paint_request) const
 }
 
 
+inline InstrumentPainter
+InstrumentSupport::get_painter (QPaintDevice& device) const
+{
+	return InstrumentPainter (device, _text_painter_cache);
+}
+
+
 inline void
 InstrumentSupport::update_cache (PaintRequest const& paint_request, Data& data) const
 {
@@ -0,0 +1,200 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "raster_shadow.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/argb_blender.h>
+
+// Standard:
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace xf {
+
+/**
+ * Scratch planes, reused between calls. Layers are shadowed concurrently, so each thread has its own.
+ */
+struct RasterShadowBuffers
+{
+	std::vector<uint8_t>	alpha;
+	std::vector<uint8_t>	horizontal;
+	std::vector<uint8_t>	dilated;
+	std::vector<uint32_t>	shadow_row;
+};
+
+
+static thread_local RasterShadowBuffers raster_shadow_buffers;
+
+
+/**
+ * target[i] = max (target[i], source[i]).
+ */
+static inline void
+max_into (uint8_t* target, uint8_t const* source, std::size_t const n) noexcept
+{
+	std::size_t i = 0;
+
+#if defined (__SSE2__)
+	for (; i + 16 <= n; i += 16)
+	{
+		auto* const t = reinterpret_cast<__m128i*> (target + i);
+		__m128i const s = _mm_loadu_si128 (reinterpret_cast<__m128i const*> (source + i));
+		_mm_storeu_si128 (t, _mm_max_epu8 (_mm_loadu_si128 (t), s));
+	}
+#endif
+
+	for (; i < n; ++i)
+		target[i] = std::max (target[i], source[i]);
+}
+
+
+/**
+ * Return true if all n bytes are zero.
+ */
+static inline bool
+all_zero (uint8_t const* data, std::size_t const n) noexcept
+{
+	std::size_t i = 0;
+
+#if defined (__SSE2__)
+	__m128i const zero = _mm_setzero_si128();
+
+	for (; i + 16 <= n; i += 16)
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 (reinterpret_cast<__m128i const*> (data + i)), zero)) != 0xffff)
+			return false;
+#endif
+
+	for (; i < n; ++i)
+		if (data[i] != 0)
+			return false;
+
+	return true;
+}
+
+
+/**
+ * Qt's BYTE_MUL(), see ArgbBlender.
+ */
+static inline uint32_t
+byte_mul (uint32_t const x, uint32_t const alpha) noexcept
+{
+	uint32_t t = (x & 0x00ff00ff) * alpha;
+	t = (t + ((t >> 8) & 0x00ff00ff) + 0x00800080) >> 8;
+	t &= 0x00ff00ff;
+
+	uint32_t u = ((x >> 8) & 0x00ff00ff) * alpha;
+	u = u + ((u >> 8) & 0x00ff00ff) + 0x00800080;
+	u &= 0xff00ff00;
+
+	return t | u;
+}
+
+
+void
+RasterShadow::apply (QImage& image, Shadow const& shadow)
+{
+	if (image.format() != QImage::Format_ARGB32_Premultiplied)
+		throw InvalidArgument ("RasterShadow::apply(): image must be in Format_ARGB32_Premultiplied");
+
+	if (image.isNull())
+		return;
+
+	auto const w = static_cast<std::size_t> (image.width());
+	auto const h = static_cast<std::size_t> (image.height());
+	auto const r = static_cast<std::size_t> (radius (shadow));
+	auto& buffers = raster_shadow_buffers;
+
+	// Alpha plane with r zero columns on both sides:
+	std::size_t const alpha_stride = w + 2 * r;
+	buffers.alpha.assign (alpha_stride * h, 0);
+
+	for (std::size_t y = 0; y < h; ++y)
+	{
+		auto const* const pixels = reinterpret_cast<uint32_t const*> (image.constScanLine (static_cast<int> (y)));
+		auto* const alpha_row = buffers.alpha.data() + y * alpha_stride + r;
+
+		for (std::size_t x = 0; x < w; ++x)
+			alpha_row[x] = static_cast<uint8_t> (pixels[x] >> 24);
+	}
+
+	// Horizontal pass, with r zero rows on top and bottom:
+	buffers.horizontal.assign (w * (h + 2 * r), 0);
+
+	for (std::size_t y = 0; y < h; ++y)
+	{
+		auto const* const alpha_row = buffers.alpha.data() + y * alpha_stride;
+		auto* const horizontal_row = buffers.horizontal.data() + (y + r) * w;
+
+		if (all_zero (alpha_row + r, w))
+			continue;
+
+		for (std::size_t k = 0; k <= 2 * r; ++k)
+			max_into (horizontal_row, alpha_row + k, w);
+	}
+
+	// Vertical pass:
+	buffers.dilated.assign (w * h, 0);
+
+	for (std::size_t y = 0; y < h; ++y)
+		for (std::size_t k = 0; k <= 2 * r; ++k)
+			max_into (buffers.dilated.data() + y * w, buffers.horizontal.data() + (y + k) * w, w);
+
+	// Composite the image over its shadow, row by row, only where there's any shadow:
+	uint32_t const shadow_color = qPremultiply (shadow.color().rgba());
+	ArgbBlender const blender;
+	buffers.shadow_row.resize (w);
+
+	for (std::size_t y = 0; y < h; ++y)
+	{
+		auto const* const dilated_row = buffers.dilated.data() + y * w;
+		auto const non_zero = [](uint8_t a) { return a != 0; };
+		auto const* const first = std::find_if (dilated_row, dilated_row + w, non_zero);
+
+		if (first == dilated_row + w)
+			continue;
+
+		auto const* const last = std::find_if (std::make_reverse_iterator (dilated_row + w), std::make_reverse_iterator (first), non_zero).base();
+		auto const begin = static_cast<std::size_t> (first - dilated_row);
+		auto const n = static_cast<std::size_t> (last - first);
+		auto* const pixels = reinterpret_cast<uint32_t*> (image.scanLine (static_cast<int> (y))) + begin;
+		auto* const shadow_row = buffers.shadow_row.data();
+
+		for (std::size_t x = 0; x < n; ++x)
+			shadow_row[x] = byte_mul (shadow_color, first[x]);
+
+		blender.blend_row (shadow_row, pixels, n);
+		std::copy_n (shadow_row, n, pixels);
+	}
+}
+
+
+int
+RasterShadow::radius (Shadow const& shadow) noexcept
+{
+	return std::max (1, static_cast<int> (std::lround (shadow.width())));
+}
+
+} // namespace xf
+
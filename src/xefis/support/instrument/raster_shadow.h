@@ -0,0 +1,62 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__SUPPORT__INSTRUMENT__RASTER_SHADOW_H__INCLUDED
+#define XEFIS__SUPPORT__INSTRUMENT__RASTER_SHADOW_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/instrument/shadow.h>
+
+// Qt:
+#include <QtGui/QImage>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf {
+
+/**
+ * Shadow computed from an already painted image, as an alternative to painting every primitive twice
+ * with ShadowPainter::paint(). Used per layer: paint the layer with InstrumentPainter::set_deferred_shadow(),
+ * then call apply() on the layer's image.
+ *
+ * The alpha channel of the image is dilated by the shadow width with a separable max filter, colored with
+ * the shadow color and composited under the image. Differences to per-primitive shadows: shadows of
+ * overlapping primitives merge instead of darkening each other, and primitives painted over other opaque
+ * primitives of the same layer don't cast visible shadows on them. So it's only suitable for layers
+ * without opaque backgrounds.
+ */
+class RasterShadow
+{
+  public:
+	/**
+	 * Add shadow under everything painted on the image.
+	 * Image must be in QImage::Format_ARGB32_Premultiplied.
+	 */
+	static void
+	apply (QImage&, Shadow const&);
+
+	/**
+	 * Return dilation radius in pixels for given shadow.
+	 */
+	[[nodiscard]]
+	static int
+	radius (Shadow const&) noexcept;
+};
+
+} // namespace xf
+
+#endif
+
@@ -47,6 +47,9 @@ class Shadow
 	float
 	width_for_pen (QPen const& pen) const;
 
+	bool
+	operator== (Shadow const&) const = default;
+
   private:
 	float	_width	{ kDefaultShadowWidth };
 	QColor	_color	{ 0x10, 0x20, 0x30, 127 };
@@ -29,6 +29,12 @@ namespace xf {
 void
 ShadowPainter::paint (Shadow const& shadow, PaintFunction paint_function)
 {
+	if (shadow == _deferred_shadow)
+	{
+		paint_function (false);
+		return;
+	}
+
 	{
 		auto saved_pen = pen();
 		Responsibility pen_restore ([&] { setPen (saved_pen); });
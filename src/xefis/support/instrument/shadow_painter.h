@@ -23,6 +23,7 @@
 
 // Standard:
 #include <cstddef>
+#include <optional>
 
 
 namespace xf {
@@ -54,6 +55,17 @@ class ShadowPainter: virtual public QPainter
 	 */
 	void
 	paint (Shadow const&, DefaultPaintFunction);
+
+	/**
+	 * Don't paint given shadow in paint(), just call the PaintFunction once, because the shadow
+	 * will be added later to the whole painted image (see RasterShadow). Other shadows are painted normally.
+	 */
+	void
+	set_deferred_shadow (std::optional<Shadow> shadow)
+		{ _deferred_shadow = shadow; }
+
+  private:
+	std::optional<Shadow>	_deferred_shadow;
 };
 
 
@@ -0,0 +1,142 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/core/paint_request.h>
+#include <xefis/support/instrument/digit_strip.h>
+#include <xefis/support/instrument/instrument_support.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QFont>
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+
+
+namespace xf::test {
+namespace {
+
+constexpr float kPitch = 30.f;
+
+
+class StripEnvironment
+{
+  public:
+	neutrino::DummyQApplication	app;
+	LoggerOutput				logger_output		{ std::clog };
+	Logger						logger				{ logger_output };
+	Graphics					graphics			{ logger };
+	InstrumentSupport			instrument_support	{ graphics };
+	QImage						canvas				{ 100, 100, QImage::Format_ARGB32_Premultiplied };
+	PaintRequest::Metric		metric				{ canvas.size(), si::PixelDensity (100.0), 1_mm, 1_mm };
+	QRectF						rect				{ 10.f, 20.f, 40.f, kPitch };
+	DigitStrip					strip;
+	DigitStrip::Key				key;
+
+  public:
+	// Ctor
+	StripEnvironment()
+	{
+		key.font.setPixelSize (20);
+		key.color = Qt::white;
+		key.cell_size = rect.size();
+		key.extra_symbols = QStringList { "-" };
+	}
+
+	bool
+	update (QSize previous_canvas_size)
+	{
+		return strip.update (key, PaintRequest (canvas, metric, previous_canvas_size), instrument_support);
+	}
+
+	/**
+	 * Paint drum on cleared canvas.
+	 */
+	QImage const&
+	paint_drum (float position, DigitStrip::Cell next, DigitStrip::Cell curr, DigitStrip::Cell prev)
+	{
+		canvas.fill (Qt::black);
+		auto painter = instrument_support.get_painter (canvas);
+		strip.draw (painter, rect, position, next, curr, prev);
+		return canvas;
+	}
+
+	/**
+	 * Paint text the way drums were painted without strips.
+	 */
+	QImage
+	paint_text (QString const& text)
+	{
+		QImage image (canvas.size(), canvas.format());
+		image.fill (Qt::black);
+		auto painter = instrument_support.get_painter (image);
+		painter.setFont (key.font);
+		painter.setPen (key.color);
+		painter.setClipRect (rect);
+		painter.fast_draw_text (rect, key.alignment, text);
+		return image;
+	}
+};
+
+
+AutoTest t1 ("xf::DigitStrip: cell layout and invalidation", []{
+	StripEnvironment env;
+
+	test_asserts::verify ("strip is rendered on first update", env.update (env.canvas.size()));
+	test_asserts::verify ("strip is not rerendered for the same key", !env.update (env.canvas.size()));
+	test_asserts::verify ("strip is rerendered when size changes", env.update (QSize()));
+
+	env.key.color = Qt::green;
+	test_asserts::verify ("strip is rerendered when key changes", env.update (env.canvas.size()));
+
+	test_asserts::verify ("digits go from 9 down to 0", env.strip.digit_cell (9) == 1 && env.strip.digit_cell (0) == 10);
+	test_asserts::verify ("extra symbols follow the wrap digit", env.strip.symbol_cell (0) == 12);
+
+	env.key.step = 2;
+	env.key.suffix = "0";
+	env.update (env.canvas.size());
+	test_asserts::verify ("20-ft strip has 5 digit cells", env.strip.digit_cell (8) == 1 && env.strip.digit_cell (0) == 5);
+});
+
+
+AutoTest t2 ("xf::DigitStrip: drum looks like painted text", []{
+	StripEnvironment env;
+	env.update (env.canvas.size());
+	auto const& s = env.strip;
+
+	test_asserts::verify ("current digit is drawn centered",
+						  env.paint_drum (0.f, s.digit_cell (6), s.digit_cell (5), s.digit_cell (4)) == env.paint_text ("5"));
+	test_asserts::verify ("next digit is shown after moving by one cell",
+						  env.paint_drum (-1.f, s.digit_cell (6), s.digit_cell (5), s.digit_cell (4)) == env.paint_text ("6"));
+	test_asserts::verify ("9 → 0 wraps around",
+						  env.paint_drum (-1.f, s.digit_cell (0), s.digit_cell (9), s.digit_cell (8)) == env.paint_text ("0"));
+	test_asserts::verify ("0 → 9 wraps around",
+						  env.paint_drum (+1.f, s.digit_cell (1), s.digit_cell (0), s.digit_cell (9)) == env.paint_text ("9"));
+	test_asserts::verify ("extra symbols can be neighbours of digits",
+						  env.paint_drum (+1.f, s.digit_cell (1), s.digit_cell (0), s.symbol_cell (0)) == env.paint_text ("-"));
+	test_asserts::verify ("blank cells are not drawn",
+						  env.paint_drum (0.f, s.digit_cell (1), DigitStrip::kBlank, s.digit_cell (9)) == env.paint_text (""));
+});
+
+} // namespace
+} // namespace xf::test
+
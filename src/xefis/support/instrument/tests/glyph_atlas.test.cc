@@ -0,0 +1,99 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/instrument/glyph_atlas.h>
+#include <xefis/support/instrument/text_painter.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QFont>
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+
+
+namespace xf::test {
+namespace {
+
+GlyphAtlas::FontKey
+make_font_key (int pixel_size, QColor color = Qt::white)
+{
+	QFont font;
+	font.setPixelSize (pixel_size);
+	return { font, color.rgba(), 0.0f, QPointF (0.0, 0.04) };
+}
+
+
+AutoTest t1 ("xf::GlyphAtlas: glyphs are rendered once and shared between caches", []{
+	neutrino::DummyQApplication app;
+	GlyphAtlas atlas;
+
+	auto const font_key = make_font_key (20);
+	auto const id = atlas.font_id (font_key);
+	test_asserts::verify ("same font gets same ID", atlas.font_id (font_key) == id);
+	test_asserts::verify ("different color gets different ID", atlas.font_id (make_font_key (20, Qt::green)) != id);
+
+	auto const a = atlas.get (id, 'A');
+	test_asserts::verify ("second lookup returns the same glyph", atlas.get (id, 'A') == a);
+	test_asserts::verify ("glyph rendered once", atlas.statistics().renders == 1);
+	test_asserts::verify ("all variants fit in the page", a->page->image.rect().contains (a->variant_rect (GlyphAtlas::Rank - 1, GlyphAtlas::Rank - 1)));
+
+	// Two painters (eg. on different threads) using separate caches:
+	QImage canvas (200, 50, QImage::Format_ARGB32_Premultiplied);
+	QString const text = "1234";
+
+	auto paint = [&] {
+		TextPainter::Cache cache (atlas);
+		TextPainter painter (canvas, cache);
+		painter.setFont (font_key.font);
+		painter.setPen (Qt::white);
+		painter.fast_draw_text (QPointF (10.0, 30.0), text);
+		return atlas.statistics().renders;
+	};
+
+	auto const renders_after_first = paint();
+	test_asserts::verify ("first painter renders its glyphs", renders_after_first >= 1 + static_cast<std::size_t> (text.size()));
+	test_asserts::verify ("second painter reuses them", paint() == renders_after_first);
+});
+
+
+AutoTest t2 ("xf::GlyphAtlas: LRU eviction keeps memory within budget", []{
+	neutrino::DummyQApplication app;
+	std::size_t const page_bytes = GlyphAtlas::kPageSize * GlyphAtlas::kPageSize * 4;
+	GlyphAtlas atlas (2 * page_bytes);
+
+	auto const id = atlas.font_id (make_font_key (60));
+	auto const first = atlas.get (id, 'A');
+	auto const generation = atlas.generation();
+
+	for (char c = 'B'; c <= 'Z'; ++c)
+		(void) atlas.get (id, c);
+
+	auto const stats = atlas.statistics();
+	test_asserts::verify ("memory usage within budget", stats.memory_usage <= 2 * page_bytes);
+	test_asserts::verify ("pages have been evicted", stats.evictions > 0);
+	test_asserts::verify ("generation changed", atlas.generation() != generation);
+	test_asserts::verify ("evicted glyph is still usable by its holder", !first->page->image.isNull());
+	test_asserts::verify ("most recent glyph is in the atlas", atlas.get (id, 'Z') == atlas.get (id, 'Z'));
+	test_asserts::verify ("evicted glyph is rendered again", atlas.get (id, 'A') != first);
+});
+
+} // namespace
+} // namespace xf::test
+
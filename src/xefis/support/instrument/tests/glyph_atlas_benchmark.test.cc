@@ -0,0 +1,147 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/instrument/glyph_atlas.h>
+#include <xefis/support/instrument/text_painter.h>
+
+// Neutrino:
+#include <neutrino/test/dummy_qapplication.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QFont>
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t	kFrames			= 200;
+constexpr std::size_t	kLinesPerFrame	= 50;
+
+
+/**
+ * Paint numbers in a few font sizes like a typical instrument frame does.
+ * Return number of glyphs drawn.
+ */
+std::size_t
+paint_frames (TextPainter::Cache& cache, std::size_t frames)
+{
+	QImage canvas (600, 400, QImage::Format_ARGB32_Premultiplied);
+	TextPainter painter (canvas, cache);
+	painter.setPen (Qt::white);
+	painter.set_font_position_correction ({ 0.0, 0.04 });
+	std::size_t glyphs = 0;
+
+	for (std::size_t frame = 0; frame < frames; ++frame)
+	{
+		canvas.fill (Qt::black);
+
+		for (std::size_t line = 0; line < kLinesPerFrame; ++line)
+		{
+			QFont font;
+			font.setPixelSize (14 + 4 * (line % 4));
+			painter.setFont (font);
+
+			auto const text = QString::number (12345.67 * (frame + 1) / (line + 1), 'f', 1);
+			// Fractional positions exercise all sub-pixel variants:
+			painter.fast_draw_text (QPointF (10.0 + 0.37 * line, 10.0 + 7.13 * line), text);
+			glyphs += text.size();
+		}
+	}
+
+	return glyphs;
+}
+
+
+/**
+ * Paint on given number of threads, each with its own cache. If shared is true, all caches use
+ * one atlas; otherwise each thread gets a private atlas, like the old thread-local caches.
+ */
+void
+run (std::size_t threads, bool shared)
+{
+	std::vector<std::unique_ptr<GlyphAtlas>> atlases;
+
+	for (std::size_t i = 0; i < (shared ? 1 : threads); ++i)
+		atlases.push_back (std::make_unique<GlyphAtlas>());
+
+	std::vector<std::unique_ptr<TextPainter::Cache>> caches;
+
+	for (std::size_t i = 0; i < threads; ++i)
+		caches.push_back (std::make_unique<TextPainter::Cache> (*atlases[shared ? 0 : i]));
+
+	auto run_threads = [&] (std::size_t frames) {
+		std::vector<std::thread> workers;
+		std::vector<std::size_t> glyphs (threads, 0);
+
+		auto const time = TimeHelper::measure ([&] {
+			for (std::size_t i = 0; i < threads; ++i)
+				workers.emplace_back ([&, i] { glyphs[i] = paint_frames (*caches[i], frames); });
+
+			for (auto& worker: workers)
+				worker.join();
+		});
+
+		std::size_t total_glyphs = 0;
+
+		for (auto g: glyphs)
+			total_glyphs += g;
+
+		return total_glyphs / time.in<si::Second>();
+	};
+
+	auto const cold_rate = run_threads (1);
+	auto const warm_rate = run_threads (kFrames);
+
+	std::size_t memory = 0;
+	std::size_t renders = 0;
+
+	for (auto const& atlas: atlases)
+	{
+		auto const stats = atlas->statistics();
+		memory += stats.memory_usage;
+		renders += stats.renders;
+	}
+
+	std::cout << threads << " thread(s), " << (shared ? "shared atlas:  " : "private atlases:") << " "
+			  << "cold " << static_cast<std::size_t> (cold_rate) << " glyphs/s, "
+			  << "warm " << static_cast<std::size_t> (warm_rate) << " glyphs/s, "
+			  << renders << " glyphs rendered, "
+			  << memory / 1024 << " KiB of atlas pages" << std::endl;
+}
+
+
+ManualTest t_1 ("xf::GlyphAtlas: fast_draw_text() throughput and memory footprint", []{
+	neutrino::DummyQApplication app;
+
+	for (std::size_t threads: { 1u, 2u, 4u })
+	{
+		run (threads, false);
+		run (threads, true);
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,139 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/support/instrument/raster_shadow.h>
+#include <xefis/support/instrument/shadow_painter.h>
+
+// Neutrino:
+#include <neutrino/test/auto_test.h>
+#include <neutrino/test/dummy_qapplication.h>
+
+// Qt:
+#include <QImage>
+
+// Standard:
+#include <cstddef>
+#include <cstdlib>
+
+
+namespace xf::test {
+namespace {
+
+QImage
+make_image()
+{
+	QImage image (40, 30, QImage::Format_ARGB32_Premultiplied);
+	image.fill (Qt::transparent);
+	return image;
+}
+
+
+Shadow
+make_shadow (float width)
+{
+	Shadow shadow;
+	shadow.set_width (width);
+	shadow.set_color (Qt::black);
+	return shadow;
+}
+
+
+AutoTest t1 ("xf::RasterShadow: transparent image stays transparent", []{
+	auto image = make_image();
+	auto const original = image;
+	RasterShadow::apply (image, make_shadow (2.f));
+
+	test_asserts::verify ("image is unchanged", image == original);
+});
+
+
+AutoTest t2 ("xf::RasterShadow: shadow surrounds painted pixels", []{
+	auto image = make_image();
+	QRgb const white = qPremultiply (qRgba (255, 255, 255, 255));
+	image.setPixel (20, 15, white);
+	image.setPixel (21, 15, white);
+	auto const shadow = make_shadow (2.f);
+	int const r = RasterShadow::radius (shadow);
+	RasterShadow::apply (image, shadow);
+
+	test_asserts::verify ("radius matches shadow width", r == 2);
+	test_asserts::verify ("painted pixels are unchanged", image.pixel (20, 15) == white && image.pixel (21, 15) == white);
+
+	bool inside_ok = true;
+	bool outside_ok = true;
+
+	for (int y = 0; y < image.height(); ++y)
+	{
+		for (int x = 0; x < image.width(); ++x)
+		{
+			if ((x == 20 || x == 21) && y == 15)
+				continue;
+
+			bool const inside = x >= 20 - r && x <= 21 + r && std::abs (y - 15) <= r;
+			QRgb const pixel = image.pixel (x, y);
+
+			if (inside)
+				inside_ok = inside_ok && pixel == qRgba (0, 0, 0, 255);
+			else
+				outside_ok = outside_ok && qAlpha (pixel) == 0;
+		}
+	}
+
+	test_asserts::verify ("shadow covers square neighbourhood of radius r", inside_ok);
+	test_asserts::verify ("nothing is painted outside of the shadow", outside_ok);
+});
+
+
+AutoTest t3 ("xf::RasterShadow: image is composited over its shadow", []{
+	auto image = make_image();
+	// Half-transparent red:
+	image.setPixel (5, 5, qPremultiply (qRgba (255, 0, 0, 128)));
+	auto shadow = make_shadow (1.f);
+	shadow.set_color (QColor (0, 0, 0, 128));
+	RasterShadow::apply (image, shadow);
+
+	QRgb const pixel = image.pixel (5, 5);
+	// Shadow under the pixel has alpha 128 × 128/255 ≈ 64, and the pixel covers half of it:
+	test_asserts::verify ("pixel is painted over its shadow", std::abs (qAlpha (pixel) - 160) <= 1);
+	test_asserts::verify ("shadow underneath keeps the color", qRed (pixel) > 0 && qGreen (pixel) == 0 && qBlue (pixel) == 0);
+	test_asserts::verify ("shadow alpha scales with the painted alpha", std::abs (qAlpha (image.pixel (4, 5)) - 64) <= 1);
+});
+
+
+AutoTest t4 ("xf::ShadowPainter: deferred shadow paints primitives once", []{
+	neutrino::DummyQApplication app;
+	auto image = make_image();
+	ShadowPainter painter (image);
+	auto const deferred = make_shadow (2.f);
+	auto const other = make_shadow (1.f);
+	int calls = 0;
+	auto count = [&] (bool) { ++calls; };
+
+	painter.paint (deferred, count);
+	test_asserts::verify ("shadow is painted normally by default", calls == 2);
+
+	calls = 0;
+	painter.set_deferred_shadow (deferred);
+	painter.paint (deferred, count);
+	test_asserts::verify ("deferred shadow is not painted", calls == 1);
+
+	calls = 0;
+	painter.paint (other, count);
+	test_asserts::verify ("other shadows are still painted", calls == 2);
+});
+
+} // namespace
+} // namespace xf::test
+
@@ -0,0 +1,184 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Xefis:
+#include <xefis/config/all.h>
+#include <xefis/core/graphics.h>
+#include <xefis/support/instrument/instrument_support.h>
+#include <xefis/support/instrument/raster_shadow.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/test/dummy_qapplication.h>
+#include <neutrino/test/manual_test.h>
+#include <neutrino/time_helper.h>
+
+// Qt:
+#include <QFont>
+#include <QImage>
+#include <QPolygonF>
+
+// Standard:
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+
+namespace xf::test {
+namespace {
+
+constexpr std::size_t kFrames = 50;
+
+
+/**
+ * Paint a compass-rose-like overlay (scale ticks, labels, arcs and an aircraft symbol),
+ * every primitive with the shadow, like the HSI and ADI overlay layers do.
+ */
+void
+paint_overlay (InstrumentPainter& painter, QSize size, Shadow const& shadow)
+{
+	float const r = 0.4f * std::min (size.width(), size.height());
+	QFont font;
+	font.setPixelSize (std::max (8, size.height() / 30));
+
+	painter.setRenderHint (QPainter::Antialiasing, true);
+	painter.translate (0.5f * size.width(), 0.5f * size.height());
+	painter.setPen (QPen (Qt::white, 1.5f));
+	painter.setFont (font);
+
+	for (int deg = 0; deg < 360; deg += 5)
+	{
+		float const length = deg % 10 == 0 ? 0.08f * r : 0.04f * r;
+
+		painter.paint (shadow, [&] {
+			painter.drawLine (QPointF (0.f, -r), QPointF (0.f, -r + length));
+		});
+
+		if (deg % 30 == 0)
+			painter.fast_draw_text (QPointF (0.f, -r + 0.15f * r), Qt::AlignHCenter | Qt::AlignTop, QString::number (deg / 10), shadow);
+
+		painter.rotate (5.f);
+	}
+
+	painter.setPen (QPen (Qt::green, 2.f));
+
+	for (int i = 1; i <= 3; ++i)
+	{
+		painter.paint (shadow, [&] {
+			float const ri = 0.25f * i * r;
+			painter.drawArc (QRectF (-ri, -ri, 2.f * ri, 2.f * ri), 30 * 16, 120 * 16);
+		});
+	}
+
+	painter.setPen (QPen (Qt::white, 2.f));
+	painter.paint (shadow, [&] {
+		painter.drawPolyline (QPolygonF ({ { -0.1f * r, 0.05f * r }, { 0.f, -0.1f * r }, { 0.1f * r, 0.05f * r } }));
+	});
+}
+
+
+/**
+ * Paint kFrames frames with per-primitive shadows or with the shadow rasterised afterwards.
+ * Return time per frame and the last frame.
+ */
+std::pair<si::Time, QImage>
+measure (InstrumentSupport const& instrument_support, QSize size, Shadow const& shadow, bool raster)
+{
+	QImage image (size, QImage::Format_ARGB32_Premultiplied);
+
+	auto const time = TimeHelper::measure ([&] {
+		for (std::size_t frame = 0; frame < kFrames; ++frame)
+		{
+			image.fill (Qt::transparent);
+
+			{
+				auto painter = instrument_support.get_painter (image);
+
+				if (raster)
+					painter.set_deferred_shadow (shadow);
+
+				paint_overlay (painter, size, shadow);
+			}
+
+			if (raster)
+				RasterShadow::apply (image, shadow);
+		}
+	});
+
+	return { time / kFrames, image };
+}
+
+
+/**
+ * Return mean and maximum per-channel difference between images.
+ */
+std::pair<double, int>
+difference (QImage const& a, QImage const& b)
+{
+	double sum = 0.0;
+	int max = 0;
+
+	for (int y = 0; y < a.height(); ++y)
+	{
+		auto const* const row_a = reinterpret_cast<QRgb const*> (a.constScanLine (y));
+		auto const* const row_b = reinterpret_cast<QRgb const*> (b.constScanLine (y));
+
+		for (int x = 0; x < a.width(); ++x)
+		{
+			for (int shift: { 0, 8, 16, 24 })
+			{
+				int const d = std::abs (static_cast<int> ((row_a[x] >> shift) & 0xff) - static_cast<int> ((row_b[x] >> shift) & 0xff));
+				sum += d;
+				max = std::max (max, d);
+			}
+		}
+	}
+
+	return { sum / (4.0 * a.width() * a.height()), max };
+}
+
+
+ManualTest t_1 ("xf::RasterShadow: per-primitive vs rasterised shadows paint time", []{
+	neutrino::DummyQApplication app;
+	LoggerOutput logger_output { std::clog };
+	Logger logger { logger_output };
+	Graphics graphics { logger };
+	InstrumentSupport instrument_support { graphics };
+
+	// Sizes of instruments on the test_instruments screens and on a bigger display:
+	for (QSize size: { QSize (480, 480), QSize (800, 800), QSize (1200, 1200) })
+	{
+		Shadow shadow;
+		shadow.set_width (std::max (1.f, size.height() / 400.f));
+
+		// Warm up glyph caches first:
+		measure (instrument_support, size, shadow, false);
+		measure (instrument_support, size, shadow, true);
+
+		auto const [primitive_time, primitive_image] = measure (instrument_support, size, shadow, false);
+		auto const [raster_time, raster_image] = measure (instrument_support, size, shadow, true);
+		auto const [mean_difference, max_difference] = difference (primitive_image, raster_image);
+
+		std::cout << size.width() << "×" << size.height() << ": "
+				  << "per-primitive " << primitive_time.in<si::Millisecond>() << " ms/frame, "
+				  << "rasterised " << raster_time.in<si::Millisecond>() << " ms/frame, "
+				  << "difference mean " << mean_difference << ", max " << max_difference << std::endl;
+	}
+});
+
+} // namespace
+} // namespace xf::test
+
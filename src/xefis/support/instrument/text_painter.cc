@@ -17,9 +17,6 @@
 // Xefis:
 #include <xefis/config/all.h>
 
-// Qt:
-#include <QPainterPath>
-
 // Neutrino:
 #include <neutrino/numeric.h>
 
@@ -30,69 +27,6 @@
 
 namespace xf {
 
-TextPainter::Cache::Glyph::Glyph (QFont const& font, QColor color, QChar character, QPointF position_correction, std::optional<Shadow> shadow):
-	data (std::make_shared<Data>())
-{
-	QFontMetricsF metrics (font);
-	position_correction.setX (position_correction.x() * metrics.width("0"));
-	position_correction.setY (position_correction.y() * metrics.height());
-	QSize size (std::ceil (metrics.width (character)) + 1, std::ceil (metrics.height()) + 1);
-	QImage image (size, QImage::Format_ARGB32_Premultiplied);
-	QColor alpha = color;
-	alpha.setAlpha (0);
-	QPainter painter (&image);
-	painter.setRenderHint (QPainter::Antialiasing, true);
-	painter.setRenderHint (QPainter::TextAntialiasing, true);
-	painter.setRenderHint (QPainter::SmoothPixmapTransform, true);
-
-	QPen shadow_pen = painter.pen();
-
-	if (shadow)
-	{
-		QColor shadow_color = color.darker (800);
-		shadow_color.setAlpha (100);
-		shadow_pen.setColor (shadow_color);
-		shadow_pen.setWidthF (shadow->width_for_pen (shadow_pen));
-	}
-
-	for (int x = 0; x < Rank; ++x)
-	{
-		float const fx = 1.f * x / Rank;
-
-		for (int y = 0; y < Rank; ++y)
-		{
-			float const fy = 1.f * y / Rank;
-
-			QPointF position (fx, fy + metrics.ascent());
-			position += position_correction;
-			QPainterPath glyph_path;
-			glyph_path.addText (position, font, character);
-
-			QPainterPath clip_path;
-			clip_path.addRect (image.rect());
-			clip_path -= glyph_path;
-
-			image.fill (alpha);
-			painter.setClipPath (clip_path);
-
-			if (shadow)
-			{
-				painter.setPen (shadow_pen);
-				painter.setBrush (Qt::NoBrush);
-				painter.drawPath (glyph_path);
-			}
-
-			painter.setClipping (false);
-			painter.setPen (Qt::NoPen);
-			painter.setBrush (color);
-			painter.drawPath (glyph_path);
-
-			data->positions[x][y] = image;
-		}
-	}
-}
-
-
 TextPainter::TextPainter (Cache& cache):
 	_cache (cache)
 { }
@@ -191,37 +125,24 @@ TextPainter::fast_draw_text (QRectF const& target, Qt::Alignment flags, QString
 
 	QColor color = pen().color();
 
-	float const shadow_width = shadow ? shadow->width_for_pen (pen()) : 0.0f;
-
-	// Find/insert to font cache:
-	Cache::Font const required_font { font(), color, shadow_width };
-	Cache::Glyphs* glyphs_cache { nullptr };
+	if (shadow && shadow == _deferred_shadow)
+		shadow.reset();
 
-	if (!_cache.last || _cache.last->font != required_font)
-	{
-		if (auto it = _cache.fonts.find (required_font); it != _cache.fonts.end())
-			_cache.last = Cache::Last { required_font, &it->second };
-		else
-		{
-			it = _cache.fonts.emplace (required_font, Cache::Glyphs()).first;
-			_cache.last = Cache::Last { required_font, &it->second };
-		}
-	}
+	float const shadow_width = shadow ? shadow->width_for_pen (pen()) : 0.0f;
 
-	glyphs_cache = _cache.last->glyphs;
+	// Find font ID, glyphs are looked up with it:
+	_cache.synchronize();
+	auto const font_id = _cache.font_id ({ font(), color.rgba(), shadow_width, _position_correction });
 
 	for (QString::ConstIterator c = text.begin(); c != text.end(); ++c)
 	{
-		auto glyph = glyphs_cache->find (*c);
-
-		if (glyph == glyphs_cache->end())
-			glyph = glyphs_cache->insert ({ *c, Cache::Glyph (font(), color, *c, _position_correction, shadow) }).first;
+		auto const& glyph = _cache.glyph (font_id, *c);
 
 		float fx = floored_mod<float> (offset.x(), 1.f);
 		float fy = floored_mod<float> (offset.y(), 1.f);
-		int dx = clamped<int> (fx * Cache::Glyph::Rank, 0, Cache::Glyph::Rank - 1);
-		int dy = clamped<int> (fy * Cache::Glyph::Rank, 0, Cache::Glyph::Rank - 1);
-		drawImage (QPoint (offset.x(), offset.y()), glyph->second.data->positions[dx][dy]);
+		int dx = clamped<int> (fx * GlyphAtlas::Rank, 0, GlyphAtlas::Rank - 1);
+		int dy = clamped<int> (fy * GlyphAtlas::Rank, 0, GlyphAtlas::Rank - 1);
+		drawImage (QPoint (offset.x(), offset.y()), glyph.page->image, glyph.variant_rect (dx, dy));
 		offset.rx() += metrics.width (*c);
 	}
 
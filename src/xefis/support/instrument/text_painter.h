@@ -16,6 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/support/instrument/glyph_atlas.h>
 #include <xefis/support/instrument/shadow.h>
 
 // Qt:
@@ -23,11 +24,12 @@
 #include <QtGui/QPainter>
 
 // Standard:
+#include <algorithm>
 #include <cstddef>
-#include <map>
-#include <memory>
+#include <cstdint>
 #include <optional>
-#include <tuple>
+#include <utility>
+#include <vector>
 
 
 namespace xf {
@@ -40,68 +42,60 @@ class TextPainter: virtual public QPainter
 {
   public:
 	/**
-	 * Stores drawn glyphs.
+	 * Thread-local front index of glyphs from a GlyphAtlas.
+	 * Once warmed up, lookups don't lock anything; the shared atlas is only consulted on a miss
+	 * or after it evicted some glyphs.
 	 */
 	class Cache
 	{
 		friend class TextPainter;
 
-		class Glyph
-		{
-		  public:
-			static constexpr int Rank = 8;
-
-		  private:
-			struct Data
-			{
-				QImage positions[Rank][Rank];
-			};
-
-		  public:
-			/**
-			 * Generate all images for given character and font.
-			 */
-			explicit
-			Glyph (QFont const&, QColor, QChar, QPointF position_correction, std::optional<Shadow> shadow);
-
-			Glyph (Glyph const& other);
-
-			Glyph&
-			operator= (Glyph const& other);
-
-		  public:
-			std::shared_ptr<Data> data;
-		};
-
-		struct Font
-		{
-			QFont	font;
-			QColor	color;
-			float	shadow_width;
-
-			bool
-			operator< (Font const&) const;
-
-			bool
-			operator== (Font const&) const;
-
-			bool
-			operator!= (Font const&) const;
-		};
-
-		using Glyphs	= std::map<QChar, Glyph>;
-		using Fonts		= std::map<Font, Glyphs>;
-
 		struct Last
 		{
-			Last (Font const&, Glyphs*);
-
-			Font	font;
-			Glyphs*	glyphs;
+			GlyphAtlas::FontKey	font;
+			GlyphAtlas::FontID	id;
 		};
 
-		Fonts				fonts;
-		std::optional<Last>	last;
+		using Fonts = std::vector<std::pair<GlyphAtlas::FontKey, GlyphAtlas::FontID>>;
+
+	  public:
+		// Ctor
+		explicit
+		Cache (GlyphAtlas& = GlyphAtlas::shared());
+
+		/**
+		 * Return the atlas used by this cache.
+		 */
+		[[nodiscard]]
+		GlyphAtlas&
+		atlas() const noexcept
+			{ return _atlas; }
+
+	  private:
+		/**
+		 * Return ID of given font, asking the atlas only for fonts not seen before.
+		 */
+		GlyphAtlas::FontID
+		font_id (GlyphAtlas::FontKey const&);
+
+		/**
+		 * Return glyph for given font and character.
+		 */
+		GlyphAtlas::Glyph const&
+		glyph (GlyphAtlas::FontID, QChar);
+
+		/**
+		 * Drop local references if the atlas evicted anything.
+		 */
+		void
+		synchronize();
+
+	  private:
+		GlyphAtlas&			_atlas;
+		GlyphAtlas::Index	_glyphs;
+		Fonts				_fonts;
+		std::optional<Last>	_last;
+		uint64_t			_generation;
 	};
 
   public:
@@ -119,6 +113,14 @@ class TextPainter: virtual public QPainter
 	void
 	set_font_position_correction (QPointF correction);
 
+	/**
+	 * Don't paint given shadow under texts, because it will be added later to the whole
+	 * painted image (see RasterShadow). Other shadows are painted normally.
+	 */
+	void
+	set_deferred_shadow (std::optional<Shadow> shadow)
+		{ _deferred_shadow = shadow; }
+
 	QRectF
 	get_text_box (QPointF const& position, Qt::Alignment flags, QString const& text) const;
 
@@ -145,53 +147,64 @@ class TextPainter: virtual public QPainter
 	apply_alignment (QRectF& rect, Qt::Alignment flags);
 
   private:
-	Cache&	_cache;
-	QPointF	_position_correction;
+	Cache&					_cache;
+	QPointF					_position_correction;
+	std::optional<Shadow>	_deferred_shadow;
 };
 
 
 inline
-TextPainter::Cache::Glyph::Glyph (Glyph const& other):
-	data (other.data)
+TextPainter::Cache::Cache (GlyphAtlas& atlas):
+	_atlas (atlas),
+	_generation (atlas.generation())
 { }
 
 
-inline TextPainter::Cache::Glyph&
-TextPainter::Cache::Glyph::operator= (Glyph const& other)
+inline GlyphAtlas::FontID
+TextPainter::Cache::font_id (GlyphAtlas::FontKey const& font_key)
 {
-	data = other.data;
-	return *this;
-}
+	if (_last && _last->font == font_key)
+		return _last->id;
 
+	auto it = std::find_if (_fonts.begin(), _fonts.end(), [&](auto const& pair) { return pair.first == font_key; });
 
-inline bool
-TextPainter::Cache::Font::operator< (Font const& other) const
-{
-	return std::tuple (font, color.rgba(), shadow_width) < std::tuple (other.font, other.color.rgba(), other.shadow_width);
+	if (it == _fonts.end())
+	{
+		_fonts.emplace_back (font_key, _atlas.font_id (font_key));
+		it = std::prev (_fonts.end());
+	}
+
+	_last = Last { font_key, it->second };
+	return it->second;
 }
 
 
-inline bool
-TextPainter::Cache::Font::operator== (Font const& other) const
+inline GlyphAtlas::Glyph const&
+TextPainter::Cache::glyph (GlyphAtlas::FontID font_id, QChar character)
 {
-	return font == other.font
-		&& color == other.color
-		&& shadow_width == other.shadow_width;
-}
+	auto const key = GlyphAtlas::glyph_key (font_id, character);
+	auto const* glyph = _glyphs.find (key);
 
+	if (!glyph)
+	{
+		_glyphs.insert (key, _atlas.get (font_id, character));
+		glyph = _glyphs.find (key);
+	}
 
-inline bool
-TextPainter::Cache::Font::operator!= (Font const& other) const
-{
-	return !(*this == other);
+	(*glyph)->touch (_atlas.tick());
+	return **glyph;
 }
 
 
-inline
-TextPainter::Cache::Last::Last (Font const& font, Glyphs* glyphs):
-	font (font),
-	glyphs (glyphs)
-{ }
+inline void
+TextPainter::Cache::synchronize()
+{
+	if (auto const generation = _atlas.generation(); generation != _generation)
+	{
+		_glyphs.clear();
+		_generation = generation;
+	}
+}
 
 } // namespace xf
 
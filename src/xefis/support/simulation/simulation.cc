@@ -16,6 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
+#include <xefis/core/clock.h>
 
 // Standard:
 #include <cstddef>
@@ -46,7 +47,8 @@ Simulation::evolve (si::Time dt, si::Time real_time_limit)
 			_evolve (_frame_dt);
 		});
 
-		if (real_time_taken >= real_time_limit)
+		// With virtual clock there's no real time to keep up with, so never skip simulation frames:
+		if (real_time_taken >= real_time_limit && !Clock::is_virtual())
 		{
 			_logger << "Simulation throttled: skipping " << (_real_time - _simulation_time) << " of real time." << std::endl;
 			_simulation_time = _real_time;
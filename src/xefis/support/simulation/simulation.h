@@ -83,6 +83,8 @@ class Simulation
 
 	/**
 	 * Evolve the rigid body system by given dt. Multiple evolve() calls will be made on the System.
+	 * If computations take longer than real_time_limit, remaining frames are skipped, unless
+	 * Clock is in virtual mode.
 	 */
 	void
 	evolve (si::Time dt, si::Time real_time_limit);
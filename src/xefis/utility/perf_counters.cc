@@ -0,0 +1,119 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "perf_counters.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// System:
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Standard:
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+
+namespace xf {
+namespace {
+
+int
+open_counter (uint32_t type, uint64_t config, int group_fd)
+{
+	perf_event_attr attr;
+	std::memset (&attr, 0, sizeof (attr));
+	attr.size = sizeof (attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group_fd == -1 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+
+	// pid = 0, cpu = -1: measure the calling thread on any CPU.
+	return static_cast<int> (::syscall (__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+} // namespace
+
+
+PerfCounters::PerfCounters()
+{
+	_cycles_fd = open_counter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+
+	if (_cycles_fd != -1)
+	{
+		_instructions_fd = open_counter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, _cycles_fd);
+		_cache_misses_fd = open_counter (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, _cycles_fd);
+		_context_switches_fd = open_counter (PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, _cycles_fd);
+
+		::ioctl (_cycles_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		::ioctl (_cycles_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+
+PerfCounters::~PerfCounters()
+{
+	for (int fd: { _context_switches_fd, _cache_misses_fd, _instructions_fd, _cycles_fd })
+		if (fd != -1)
+			::close (fd);
+}
+
+
+std::optional<PerfSample>
+PerfCounters::read() const noexcept
+{
+	if (_cycles_fd == -1)
+		return std::nullopt;
+
+	// Layout for PERF_FORMAT_GROUP: number of counters followed by values in order of opening:
+	std::array<uint64_t, 5> buffer {};
+	auto const result = ::read (_cycles_fd, buffer.data(), sizeof (buffer));
+
+	if (result < static_cast<ssize_t> (sizeof (uint64_t)))
+		return std::nullopt;
+
+	auto const n = buffer[0];
+	PerfSample sample;
+	sample.cycles = n > 0 ? buffer[1] : 0;
+	std::size_t i = 2;
+
+	// Some counters might have failed to open; they're not part of the group then:
+	if (_instructions_fd != -1 && i <= n)
+		sample.instructions = buffer[i++];
+
+	if (_cache_misses_fd != -1 && i <= n)
+		sample.cache_misses = buffer[i++];
+
+	if (_context_switches_fd != -1 && i <= n)
+		sample.context_switches = buffer[i++];
+
+	return sample;
+}
+
+
+PerfCounters&
+PerfCounters::for_current_thread()
+{
+	thread_local PerfCounters counters;
+	return counters;
+}
+
+} // namespace xf
+
@@ -0,0 +1,97 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__UTILITY__PERF_COUNTERS_H__INCLUDED
+#define XEFIS__UTILITY__PERF_COUNTERS_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+
+namespace xf {
+
+/**
+ * Values of hardware/software performance counters.
+ */
+class PerfSample
+{
+  public:
+	uint64_t	cycles				{ 0 };
+	uint64_t	instructions		{ 0 };
+	uint64_t	cache_misses		{ 0 };
+	uint64_t	context_switches	{ 0 };
+
+  public:
+	PerfSample
+	operator- (PerfSample const& other) const noexcept
+	{
+		return {
+			cycles - other.cycles,
+			instructions - other.instructions,
+			cache_misses - other.cache_misses,
+			context_switches - other.context_switches,
+		};
+	}
+};
+
+
+/**
+ * A group of perf_event_open() counters (CPU cycles, instructions, cache misses, context switches)
+ * measuring the calling thread. Counters are opened lazily, one group per thread.
+ *
+ * If the kernel doesn't allow opening counters (see /proc/sys/kernel/perf_event_paranoid)
+ * read() returns std::nullopt.
+ */
+class PerfCounters: private Noncopyable
+{
+  public:
+	// Ctor
+	explicit
+	PerfCounters();
+
+	// Dtor
+	~PerfCounters();
+
+	/**
+	 * Read current counter values.
+	 */
+	[[nodiscard]]
+	std::optional<PerfSample>
+	read() const noexcept;
+
+	/**
+	 * Return counters for the calling thread.
+	 */
+	[[nodiscard]]
+	static PerfCounters&
+	for_current_thread();
+
+  private:
+	int	_cycles_fd				{ -1 };
+	int	_instructions_fd		{ -1 };
+	int	_cache_misses_fd		{ -1 };
+	int	_context_switches_fd	{ -1 };
+};
+
+} // namespace xf
+
+#endif
+
@@ -0,0 +1,158 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+// Local:
+#include "periodic_thread.h"
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// System:
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+
+// Standard:
+#include <cstddef>
+#include <cstdint>
+
+
+namespace xf {
+namespace {
+
+constexpr int64_t kNanosecondsPerSecond = 1'000'000'000;
+
+
+int64_t
+to_nanoseconds (timespec const& ts)
+{
+	return ts.tv_sec * kNanosecondsPerSecond + ts.tv_nsec;
+}
+
+
+timespec
+to_timespec (int64_t nanoseconds)
+{
+	timespec ts;
+	ts.tv_sec = nanoseconds / kNanosecondsPerSecond;
+	ts.tv_nsec = nanoseconds % kNanosecondsPerSecond;
+	return ts;
+}
+
+
+int64_t
+monotonic_now()
+{
+	timespec ts;
+	::clock_gettime (CLOCK_MONOTONIC, &ts);
+	return to_nanoseconds (ts);
+}
+
+} // namespace
+
+
+PeriodicThread::PeriodicThread (si::Time period, Callback callback, Settings const& settings, Logger const& logger):
+	_period (period),
+	_callback (std::move (callback)),
+	_settings (settings),
+	_logger (logger.with_scope ("<periodic thread>"))
+{ }
+
+
+PeriodicThread::~PeriodicThread()
+{
+	stop();
+}
+
+
+void
+PeriodicThread::start()
+{
+	if (!_thread.joinable())
+	{
+		_stop_requested.store (false);
+		_thread = std::thread (&PeriodicThread::run, this);
+	}
+}
+
+
+void
+PeriodicThread::stop()
+{
+	if (_thread.joinable())
+	{
+		_stop_requested.store (true);
+		_thread.join();
+	}
+}
+
+
+void
+PeriodicThread::run()
+{
+	apply_settings();
+
+	auto const period = static_cast<int64_t> (_period.in<si::Nanosecond>());
+	auto deadline = monotonic_now() + period;
+
+	while (!_stop_requested.load (std::memory_order_relaxed))
+	{
+		auto const deadline_ts = to_timespec (deadline);
+
+		// Restart sleep when interrupted by a signal:
+		while (::clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline_ts, nullptr) == EINTR)
+			continue;
+
+		auto const now = monotonic_now();
+		_callback (1_ns * (now - deadline));
+
+		deadline += period;
+
+		// Skip deadlines that already passed:
+		if (auto const after_callback = monotonic_now(); after_callback > deadline)
+		{
+			auto const missed = (after_callback - deadline) / period + 1;
+			_missed_deadlines.fetch_add (static_cast<std::size_t> (missed), std::memory_order_relaxed);
+			deadline += missed * period;
+		}
+	}
+}
+
+
+void
+PeriodicThread::apply_settings()
+{
+	if (_settings.cpu)
+	{
+		cpu_set_t cpu_set;
+		CPU_ZERO (&cpu_set);
+		CPU_SET (*_settings.cpu, &cpu_set);
+
+		if (auto const error = ::pthread_setaffinity_np (::pthread_self(), sizeof (cpu_set), &cpu_set); error != 0)
+			_logger << "Could not pin thread to CPU " << *_settings.cpu << ": " << strerror (error) << std::endl;
+	}
+
+	if (_settings.fifo_priority)
+	{
+		sched_param param {};
+		param.sched_priority = *_settings.fifo_priority;
+
+		if (auto const error = ::pthread_setschedparam (::pthread_self(), SCHED_FIFO, &param); error != 0)
+			_logger << "Could not set SCHED_FIFO priority " << *_settings.fifo_priority << ": " << strerror (error) << std::endl;
+	}
+}
+
+} // namespace xf
+
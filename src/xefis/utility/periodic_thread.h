@@ -0,0 +1,121 @@
+/* vim:ts=4
+ *
+ * Copyleft 2012…2016  Michał Gawron
+ * Marduk Unix Labs, http://mulabs.org/
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Visit http://www.gnu.org/licenses/gpl-3.0.html for more information on licensing.
+ */
+
+#ifndef XEFIS__UTILITY__PERIODIC_THREAD_H__INCLUDED
+#define XEFIS__UTILITY__PERIODIC_THREAD_H__INCLUDED
+
+// Xefis:
+#include <xefis/config/all.h>
+
+// Neutrino:
+#include <neutrino/logger.h>
+#include <neutrino/noncopyable.h>
+
+// Standard:
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <thread>
+
+
+namespace xf {
+
+/**
+ * A thread that calls given function periodically.
+ * Uses absolute deadlines (clock_nanosleep() with TIMER_ABSTIME on CLOCK_MONOTONIC),
+ * so that processing time and wake-up delays don't accumulate into a drift.
+ * If the callback overruns one or more whole periods, missed deadlines are skipped
+ * instead of being executed in a burst.
+ */
+class PeriodicThread: private Noncopyable
+{
+  public:
+	class Settings
+	{
+	  public:
+		// If set, use SCHED_FIFO scheduling policy with this priority (needs CAP_SYS_NICE):
+		std::optional<int>	fifo_priority;
+		// If set, pin the thread to this CPU:
+		std::optional<int>	cpu;
+	};
+
+	/**
+	 * The callback gets the wake-up jitter: time between the deadline and the actual wake-up.
+	 */
+	using Callback = std::function<void (si::Time wakeup_jitter)>;
+
+  public:
+	// Ctor
+	explicit
+	PeriodicThread (si::Time period, Callback, Settings const&, Logger const&);
+
+	// Dtor
+	~PeriodicThread();
+
+	/**
+	 * Start the thread. Does nothing if already started.
+	 */
+	void
+	start();
+
+	/**
+	 * Stop the thread and wait until it finishes current callback.
+	 * Does nothing if not started.
+	 */
+	void
+	stop();
+
+	/**
+	 * Return true if the thread is running.
+	 */
+	[[nodiscard]]
+	bool
+	running() const noexcept
+		{ return _thread.joinable(); }
+
+	/**
+	 * Return number of deadlines skipped because of overruns.
+	 */
+	[[nodiscard]]
+	std::size_t
+	missed_deadlines() const noexcept
+		{ return _missed_deadlines.load (std::memory_order_relaxed); }
+
+  private:
+	/**
+	 * Thread main loop.
+	 */
+	void
+	run();
+
+	/**
+	 * Apply scheduling settings to the calling thread.
+	 */
+	void
+	apply_settings();
+
+  private:
+	si::Time					_period;
+	Callback					_callback;
+	Settings					_settings;
+	Logger						_logger;
+	std::thread					_thread;
+	std::atomic<bool>			_stop_requested		{ false };
+	std::atomic<std::size_t>	_missed_deadlines	{ 0 };
+};
+
+} // namespace xf
+
+#endif
+
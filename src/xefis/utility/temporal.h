@@ -16,9 +16,7 @@
 
 // Xefis:
 #include <xefis/config/all.h>
-
-// Neutrino:
-#include <neutrino/time_helper.h>
+#include <xefis/core/clock.h>
 
 // Standard:
 #include <cstddef>
@@ -64,7 +62,7 @@ template<class tValueType>
 
 		/**
 		 * Assign new value with current timestamp
-		 * (taken from TimeHelper::now()).
+		 * (taken from Clock::now()).
 		 */
 		Temporal<ValueType>&
 		operator= (ValueType&& value) noexcept (noexcept (value = value));
@@ -109,7 +107,7 @@ template<class T>
 	inline
 	Temporal<T>::Temporal (ValueType&& value) noexcept (noexcept (ValueType (value))):
 		_value (std::forward<ValueType> (value)),
-		_update_time (TimeHelper::now())
+		_update_time (Clock::now())
 	{ }
 
 
@@ -126,7 +124,7 @@ template<class T>
 	Temporal<T>::operator= (ValueType&& value) noexcept (noexcept (value = value))
 	{
 		_value.operator= (std::forward<ValueType> (value));
-		_update_time = TimeHelper::now();
+		_update_time = Clock::now();
 	}
 
 